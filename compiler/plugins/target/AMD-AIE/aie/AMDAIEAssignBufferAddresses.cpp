@@ -4,10 +4,13 @@
 // See https://llvm.org/LICENSE.txt for license information.
 // SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 
+#include <limits>
+
 #include "AIEDialect.h"
 #include "Passes.h"
 #include "iree-amd-aie/aie_runtime/iree_aie_runtime.h"
 #include "llvm/ADT/Twine.h"
+#include "llvm/Support/MathExtras.h"
 #include "mlir/IR/Attributes.h"
 #include "mlir/Pass/Pass.h"
 
@@ -285,6 +288,188 @@ LogicalResult bankAwareAllocation(TileOp tile, SetVector<BufferOp> buffers,
   return success();
 }
 
+//===----------------------------------------------------------------------===//
+// LiveRangeAllocation : reuse memory between buffers with disjoint lifetimes
+//===----------------------------------------------------------------------===//
+
+// The live range of a buffer, as an inclusive range of positions of the
+// operations in the body of the core of its tile.
+struct LiveRange {
+  int64_t begin;
+  int64_t end;
+
+  static LiveRange forever() {
+    return {0, std::numeric_limits<int64_t>::max()};
+  }
+  bool overlaps(const LiveRange &other) const {
+    return begin <= other.end && other.begin <= end;
+  }
+};
+
+// Function that computes the live ranges of the buffers of a tile. A buffer
+// that is only accessed by the core of its tile is live from the first to the
+// last operation of the core body that uses it, directly or through a view.
+// A use nested in an operation with regions, for example a loop, may execute
+// again after the last one, so it spans the whole operation. Buffers accessed
+// by the DMAs, which synchronize with the core through locks at runtime, by
+// other cores or not at all, are live forever.
+DenseMap<BufferOp, LiveRange> computeLiveRanges(TileOp tile,
+                                                SetVector<BufferOp> buffers) {
+  DenseMap<BufferOp, LiveRange> liveRanges;
+  for (BufferOp buffer : buffers) liveRanges[buffer] = LiveRange::forever();
+  CoreOp core = getCoreOp(tile);
+  // Only the straight-line order of a single block is known.
+  if (!core || !core.getBody().hasOneBlock()) return liveRanges;
+
+  Block &body = core.getBody().front();
+  DenseMap<Operation *, int64_t> positions;
+  for (Operation &op : body) positions[&op] = positions.size();
+
+  for (BufferOp buffer : buffers) {
+    std::optional<LiveRange> liveRange;
+    bool isCoreLocal = true;
+    SmallVector<Value> worklist = {buffer.getResult()};
+    while (!worklist.empty() && isCoreLocal) {
+      Value value = worklist.pop_back_val();
+      for (Operation *user : value.getUsers()) {
+        Operation *op = body.findAncestorOpInBlock(*user);
+        if (!op) {
+          isCoreLocal = false;
+          break;
+        }
+        int64_t position = positions[op];
+        if (liveRange) {
+          liveRange->begin = std::min(liveRange->begin, position);
+          liveRange->end = std::max(liveRange->end, position);
+        } else {
+          liveRange = LiveRange{position, position};
+        }
+        for (Value result : user->getResults()) {
+          if (isa<MemRefType>(result.getType())) worklist.push_back(result);
+        }
+      }
+    }
+    if (isCoreLocal && liveRange) liveRanges[buffer] = *liveRange;
+  }
+  return liveRanges;
+}
+
+LogicalResult liveRangeAllocation(TileOp tile, SetVector<BufferOp> buffers,
+                                  AMDAIEDeviceModel deviceModel) {
+  int64_t maxDataMemorySize = getMaxMemorySize(deviceModel, tile);
+  int64_t numBanks = deviceModel.getNumBanks(tile.getCol(), tile.getRow());
+  int64_t bankSize = maxDataMemorySize / numBanks;
+  int64_t alignment = deviceModel.getVectorLoadStoreAlignmentBits() / 8;
+  DenseMap<BufferOp, LiveRange> liveRanges = computeLiveRanges(tile, buffers);
+
+  // The address ranges allocated so far, with the live ranges they are
+  // occupied during.
+  struct Allocation {
+    int64_t startAddr;
+    int64_t endAddr;
+    LiveRange liveRange;
+  };
+  SmallVector<Allocation> allocations;
+
+  // Leave room at the bottom of the address range for stack.
+  if (CoreOp core = getCoreOp(tile)) {
+    allocations.push_back({0, core.getStackSize(), LiveRange::forever()});
+  }
+
+  // The buffers with an already specified address will not be overwritten.
+  SmallVector<BufferOp> buffersToAlloc;
+  for (BufferOp buffer : buffers) {
+    std::optional<uint32_t> maybeAddr = buffer.getAddress();
+    if (!maybeAddr) {
+      buffersToAlloc.push_back(buffer);
+      continue;
+    }
+    int64_t startAddr = maybeAddr.value();
+    int64_t endAddr = startAddr + getAllocationSize(buffer);
+    for (const Allocation &allocation : allocations) {
+      if (startAddr < allocation.endAddr && allocation.startAddr < endAddr)
+        return buffer->emitOpError("would override the allocated address");
+    }
+    allocations.push_back({startAddr, endAddr, LiveRange::forever()});
+    if (!buffer.getMemBank()) buffer.setMemBank(startAddr / bankSize);
+  }
+
+  // Allocate the largest buffers first, as they are the hardest to fit in the
+  // gaps left by the others.
+  llvm::stable_sort(buffersToAlloc, [](BufferOp a, BufferOp b) {
+    return getAllocationSize(a) > getAllocationSize(b);
+  });
+
+  for (BufferOp buffer : buffersToAlloc) {
+    int64_t bufferSize = getAllocationSize(buffer);
+    LiveRange liveRange = liveRanges.lookup(buffer);
+    // Buffers with a specified memory bank are allocated within that bank.
+    int64_t minAddr = 0;
+    int64_t maxAddr = maxDataMemorySize;
+    if (std::optional<uint32_t> memBank = buffer.getMemBank()) {
+      minAddr = memBank.value() * bankSize;
+      maxAddr = minAddr + bankSize;
+    }
+
+    // The buffer is placed at the lowest address where it doesn't overlap
+    // any buffer that is live at the same time. The candidates are the start
+    // of every bank and the end of every such buffer.
+    SmallVector<const Allocation *> conflicts;
+    SmallVector<int64_t> candidates;
+    for (int64_t bank = 0; bank < numBanks; ++bank)
+      candidates.push_back(bank * bankSize);
+    for (const Allocation &allocation : allocations) {
+      if (!allocation.liveRange.overlaps(liveRange)) continue;
+      conflicts.push_back(&allocation);
+      candidates.push_back(llvm::alignTo(allocation.endAddr, alignment));
+    }
+    llvm::sort(candidates);
+
+    std::optional<int64_t> address;
+    for (int64_t startAddr : candidates) {
+      int64_t endAddr = startAddr + bufferSize;
+      if (startAddr < minAddr || endAddr > maxAddr) continue;
+      // A buffer that fits in a bank shouldn't straddle two.
+      if (bufferSize <= bankSize &&
+          startAddr / bankSize != (endAddr - 1) / bankSize) {
+        continue;
+      }
+      if (llvm::none_of(conflicts, [&](const Allocation *allocation) {
+            return startAddr < allocation->endAddr &&
+                   allocation->startAddr < endAddr;
+          })) {
+        address = startAddr;
+        break;
+      }
+    }
+    if (!address) {
+      return buffer.emitError("Failed to allocate buffer: ")
+             << buffer.name() << " with size: " << bufferSize << " bytes.";
+    }
+    buffer.setAddress(*address);
+    buffer.setMemBank(*address / bankSize);
+    allocations.push_back({*address, *address + bufferSize, liveRange});
+  }
+  return success();
+}
+
+// Function that emits a remark with the highest address used by the stack and
+// buffers of the tile, above which memory is free.
+void emitPeakUsageRemark(TileOp tile, const SetVector<BufferOp> &buffers,
+                         AMDAIEDeviceModel deviceModel) {
+  int64_t peakUsage = 0;
+  if (CoreOp core = getCoreOp(tile)) peakUsage = core.getStackSize();
+  for (BufferOp buffer : buffers) {
+    std::optional<uint32_t> address = buffer.getAddress();
+    if (!address) continue;
+    peakUsage = std::max<int64_t>(peakUsage,
+                                  address.value() + getAllocationSize(buffer));
+  }
+  tile.emitRemark("peak memory usage: ")
+      << peakUsage << " of " << getMaxMemorySize(deviceModel, tile)
+      << " bytes";
+}
+
 struct AMDAIEAssignBufferAddressesPass
     : public impl::AMDAIEAssignBufferAddressesBase<
           AMDAIEAssignBufferAddressesPass> {
@@ -324,6 +509,10 @@ struct AMDAIEAssignBufferAddressesPass
           if (failed(bankAwareAllocation(tile, buffers, deviceModel)))
             return signalPassFailure();
           break;
+        case AllocScheme::LiveRange:
+          if (failed(liveRangeAllocation(tile, buffers, deviceModel)))
+            return signalPassFailure();
+          break;
         default:
           if (failed(bankAwareAllocation(tile, buffers, deviceModel))) {
             emitWarning(UnknownLoc::get(ctx))
@@ -334,6 +523,7 @@ struct AMDAIEAssignBufferAddressesPass
           }
           break;
       }
+      if (reportPeakUsage) emitPeakUsageRemark(tile, buffers, deviceModel);
     }
   }
 };
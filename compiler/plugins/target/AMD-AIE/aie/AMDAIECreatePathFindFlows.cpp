@@ -606,7 +606,12 @@ void AMDAIERouteFlowsWithPathfinderPass::runOnOperation() {
 
   AMDAIEDeviceModel deviceModel =
       getDeviceModel(static_cast<AMDAIEDevice>(device.getDevice()));
-  Router pathfinder(maxCol, maxRow);
+  RouterOptions routerOptions;
+  routerOptions.incremental = incrementalRouting;
+  routerOptions.batched = batchedRouting;
+  if (getContext().isMultithreadingEnabled())
+    routerOptions.threadPool = &getContext().getThreadPool();
+  Router pathfinder(maxCol, maxRow, routerOptions);
   pathfinder.initialize(deviceModel);
 
   // Add circuit flows to the pathfinder.
@@ -0,0 +1,90 @@
+// RUN: iree-opt --amdaie-assign-buffer-addresses="alloc-scheme=live-range report-peak-usage=true" --verify-diagnostics --split-input-file %s | FileCheck %s
+
+// `a` and `b` are used by disjoint operations of the core and share an
+// address, `b` and `c` are live at the same time and don't. `d` has no uses in
+// the core and is live forever.
+
+// CHECK-LABEL: @reuse
+// CHECK:         %[[TILE_0_2:.*]] = aie.tile(0, 2)
+// CHECK:         aie.buffer(%[[TILE_0_2]]) {address = 1024 : i32, mem_bank = 0 : i32, sym_name = "a"} : memref<1024xi32>
+// CHECK:         aie.buffer(%[[TILE_0_2]]) {address = 1024 : i32, mem_bank = 0 : i32, sym_name = "b"} : memref<1024xi32>
+// CHECK:         aie.buffer(%[[TILE_0_2]]) {address = 5120 : i32, mem_bank = 0 : i32, sym_name = "c"} : memref<256xi32>
+// CHECK:         aie.buffer(%[[TILE_0_2]]) {address = 6144 : i32, mem_bank = 0 : i32, sym_name = "d"} : memref<16xi32>
+module @reuse {
+ aie.device(npu1_4col) {
+  // expected-remark @below {{peak memory usage: 6208 of 65536 bytes}}
+  %tile = aie.tile(0, 2)
+  %a = aie.buffer(%tile) { sym_name = "a" } : memref<1024xi32>
+  %b = aie.buffer(%tile) { sym_name = "b" } : memref<1024xi32>
+  %c = aie.buffer(%tile) { sym_name = "c" } : memref<256xi32>
+  %d = aie.buffer(%tile) { sym_name = "d" } : memref<16xi32>
+  aie.core(%tile) {
+    %c0 = arith.constant 0 : index
+    %zero = arith.constant 0 : i32
+    memref.store %zero, %a[%c0] : memref<1024xi32>
+    %0 = memref.load %a[%c0] : memref<1024xi32>
+    memref.store %0, %b[%c0] : memref<1024xi32>
+    memref.store %zero, %c[%c0] : memref<256xi32>
+    %1 = memref.load %b[%c0] : memref<1024xi32>
+    memref.store %1, %c[%c0] : memref<256xi32>
+    aie.end
+  }
+ }
+}
+
+// -----
+
+// `e` and `f` are both used in the loop, which may use them again after their
+// last use, so they are live at the same time. `g` is only used after the loop
+// and can reuse the memory of `e`.
+
+// CHECK-LABEL: @loop
+// CHECK:         %[[TILE_0_2:.*]] = aie.tile(0, 2)
+// CHECK:         aie.buffer(%[[TILE_0_2]]) {address = 1024 : i32, mem_bank = 0 : i32, sym_name = "e"} : memref<256xi32>
+// CHECK:         aie.buffer(%[[TILE_0_2]]) {address = 2048 : i32, mem_bank = 0 : i32, sym_name = "f"} : memref<256xi32>
+// CHECK:         aie.buffer(%[[TILE_0_2]]) {address = 1024 : i32, mem_bank = 0 : i32, sym_name = "g"} : memref<256xi32>
+module @loop {
+ aie.device(npu1_4col) {
+  // expected-remark @below {{peak memory usage: 3072 of 65536 bytes}}
+  %tile = aie.tile(0, 2)
+  %e = aie.buffer(%tile) { sym_name = "e" } : memref<256xi32>
+  %f = aie.buffer(%tile) { sym_name = "f" } : memref<256xi32>
+  %g = aie.buffer(%tile) { sym_name = "g" } : memref<256xi32>
+  aie.core(%tile) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c4 = arith.constant 4 : index
+    %zero = arith.constant 0 : i32
+    scf.for %i = %c0 to %c4 step %c1 {
+      memref.store %zero, %e[%i] : memref<256xi32>
+      %0 = memref.load %e[%i] : memref<256xi32>
+      memref.store %0, %f[%i] : memref<256xi32>
+    }
+    memref.store %zero, %g[%c0] : memref<256xi32>
+    aie.end
+  }
+ }
+}
+
+// -----
+
+// Buffers that fit in a bank don't straddle two banks, and buffers with a
+// specified memory bank are allocated in that bank.
+
+// CHECK-LABEL: @banks
+// CHECK:         %[[TILE_0_2:.*]] = aie.tile(0, 2)
+// CHECK:         aie.buffer(%[[TILE_0_2]]) {address = 1024 : i32, mem_bank = 0 : i32, sym_name = "h"} : memref<3072xi32>
+// CHECK:         aie.buffer(%[[TILE_0_2]]) {address = 16384 : i32, mem_bank = 1 : i32, sym_name = "i"} : memref<1024xi32>
+// CHECK:         aie.buffer(%[[TILE_0_2]]) {address = 49152 : i32, mem_bank = 3 : i32, sym_name = "j"} : memref<16xi32>
+module @banks {
+ aie.device(npu1_4col) {
+  // expected-remark @below {{peak memory usage: 49216 of 65536 bytes}}
+  %tile = aie.tile(0, 2)
+  %h = aie.buffer(%tile) { sym_name = "h" } : memref<3072xi32>
+  %i = aie.buffer(%tile) { sym_name = "i" } : memref<1024xi32>
+  %j = aie.buffer(%tile) { sym_name = "j", mem_bank = 3 : i32 } : memref<16xi32>
+  aie.core(%tile) {
+    aie.end
+  }
+ }
+}
@@ -0,0 +1,46 @@
+// RUN: iree-opt --amdaie-create-pathfinder-flows %s -o %t.serial
+// RUN: iree-opt --amdaie-create-pathfinder-flows="batched-routing=true" %s -o %t.batched
+// RUN: diff %t.serial %t.batched
+// RUN: FileCheck %s --input-file=%t.batched
+
+// Batched routing gives the same routes as routing the flows one by one.
+
+// CHECK-LABEL:   aie.device(npu1_4col) {
+// CHECK-DAG:       %[[TILE_0_1:.*]] = aie.tile(0, 1)
+// CHECK-DAG:       %[[TILE_3_1:.*]] = aie.tile(3, 1)
+// CHECK-DAG:       aie.switchbox(%[[TILE_0_1]]) {
+// CHECK-DAG:         aie.connect<{{[A-Z]+}} : {{[0-9]+}}, DMA : 0>
+// CHECK-DAG:         aie.connect<{{[A-Z]+}} : {{[0-9]+}}, DMA : 1>
+// CHECK-DAG:         aie.connect<{{[A-Z]+}} : {{[0-9]+}}, DMA : 2>
+// CHECK-DAG:         aie.connect<{{[A-Z]+}} : {{[0-9]+}}, DMA : 3>
+// CHECK-DAG:       aie.switchbox(%[[TILE_3_1]]) {
+// CHECK-DAG:         aie.connect<{{[A-Z]+}} : {{[0-9]+}}, DMA : 0>
+// CHECK-DAG:         aie.connect<{{[A-Z]+}} : {{[0-9]+}}, DMA : 1>
+// CHECK-DAG:         aie.connect<{{[A-Z]+}} : {{[0-9]+}}, DMA : 2>
+// CHECK-DAG:         aie.connect<{{[A-Z]+}} : {{[0-9]+}}, DMA : 3>
+module {
+ aie.device(npu1_4col) {
+  %tile_0_0 = aie.tile(0, 0)
+  %tile_0_1 = aie.tile(0, 1)
+  %tile_0_2 = aie.tile(0, 2)
+  %tile_0_3 = aie.tile(0, 3)
+  %tile_0_4 = aie.tile(0, 4)
+  %tile_0_5 = aie.tile(0, 5)
+  %tile_3_0 = aie.tile(3, 0)
+  %tile_3_1 = aie.tile(3, 1)
+  %tile_3_2 = aie.tile(3, 2)
+  %tile_3_3 = aie.tile(3, 3)
+  %tile_3_4 = aie.tile(3, 4)
+  %tile_3_5 = aie.tile(3, 5)
+  aie.flow(%tile_0_2, DMA : 0, %tile_0_1, DMA : 0)
+  aie.flow(%tile_0_3, DMA : 0, %tile_0_1, DMA : 1)
+  aie.flow(%tile_0_4, DMA : 0, %tile_0_1, DMA : 2)
+  aie.flow(%tile_0_5, DMA : 0, %tile_0_1, DMA : 3)
+  aie.flow(%tile_0_1, DMA : 0, %tile_0_0, DMA : 0)
+  aie.flow(%tile_3_2, DMA : 0, %tile_3_1, DMA : 0)
+  aie.flow(%tile_3_3, DMA : 0, %tile_3_1, DMA : 1)
+  aie.flow(%tile_3_4, DMA : 0, %tile_3_1, DMA : 2)
+  aie.flow(%tile_3_5, DMA : 0, %tile_3_1, DMA : 3)
+  aie.flow(%tile_3_1, DMA : 0, %tile_3_0, DMA : 0)
+ }
+}
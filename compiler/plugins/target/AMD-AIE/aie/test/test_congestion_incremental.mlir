@@ -0,0 +1,44 @@
+// RUN: iree-opt --amdaie-create-pathfinder-flows="incremental-routing=true" %s | FileCheck %s
+
+// Same flows as `test_congestion1.mlir`, plus two more core to memtile flows
+// that compete for the same southbound channels, routed with incremental
+// rip-up and reroute.
+
+// CHECK-LABEL:   aie.device(npu1_2col) {
+// CHECK:           %[[TILE_0_0:.*]] = aie.tile(0, 0)
+// CHECK:           %[[TILE_0_1:.*]] = aie.tile(0, 1)
+// CHECK-DAG:       aie.switchbox(%[[TILE_0_1]]) {
+// CHECK-DAG:         aie.connect<{{[A-Z]+}} : {{[0-9]+}}, DMA : 0>
+// CHECK-DAG:         aie.connect<{{[A-Z]+}} : {{[0-9]+}}, DMA : 1>
+// CHECK-DAG:         aie.connect<{{[A-Z]+}} : {{[0-9]+}}, DMA : 2>
+// CHECK-DAG:         aie.connect<{{[A-Z]+}} : {{[0-9]+}}, DMA : 3>
+// CHECK-DAG:         aie.connect<{{[A-Z]+}} : {{[0-9]+}}, DMA : 5>
+// CHECK-DAG:         aie.masterset(DMA : 4, %{{.*}})
+// CHECK-DAG:       aie.shim_mux(%[[TILE_0_0]]) {
+// CHECK-DAG:         aie.connect<NORTH : {{[0-9]+}}, DMA : 0>
+// CHECK:         }
+module {
+ aie.device(npu1_2col) {
+  %tile_0_0 = aie.tile(0, 0)
+  %tile_0_1 = aie.tile(0, 1)
+  %tile_0_2 = aie.tile(0, 2)
+  %tile_0_3 = aie.tile(0, 3)
+  %tile_0_4 = aie.tile(0, 4)
+  %tile_0_5 = aie.tile(0, 5)
+  %tile_1_0 = aie.tile(1, 0)
+  %tile_1_1 = aie.tile(1, 1)
+  %tile_1_2 = aie.tile(1, 2)
+  %tile_1_5 = aie.tile(1, 5)
+  aie.flow(%tile_0_2, DMA : 0, %tile_0_1, DMA : 0)
+  aie.flow(%tile_0_3, DMA : 0, %tile_0_1, DMA : 1)
+  aie.flow(%tile_0_4, DMA : 0, %tile_0_1, DMA : 2)
+  aie.flow(%tile_0_5, DMA : 0, %tile_0_1, DMA : 3)
+  aie.flow(%tile_1_5, DMA : 0, %tile_0_1, DMA : 5)
+  aie.flow(%tile_1_2, DMA : 0, %tile_1_1, DMA : 0)
+  aie.flow(%tile_0_1, DMA : 0, %tile_0_0, DMA : 0)
+  aie.packet_flow(0x0) {
+    aie.packet_source<%tile_0_5, DMA : 1>
+    aie.packet_dest<%tile_0_1, DMA : 4>
+  }
+ }
+}
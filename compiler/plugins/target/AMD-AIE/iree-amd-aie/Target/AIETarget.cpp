@@ -9,6 +9,11 @@
 #include <fstream>
 #include <utility>
 
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif  // _WIN32
+
+#include "ArtifactCache.h"
 #include "XCLBinGen.h"
 #include "aie/AIEDialect.h"
 #include "aie/AIEXDialect.h"
@@ -42,6 +47,7 @@
 #include "mlir/Dialect/Math/IR/Math.h"
 #include "mlir/Dialect/Transform/IR/TransformDialect.h"
 #include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/Parser/Parser.h"
 #include "mlir/Pass/PassManager.h"
 #include "mlir/Support/FileUtilities.h"
@@ -125,7 +131,18 @@ class AIETargetDevice final : public IREE::HAL::TargetDevice {
 class AIETargetBackend final : public IREE::HAL::TargetBackend {
  public:
   explicit AIETargetBackend(AMDAIEOptions options)
-      : options(std::move(options)) {}
+      : options(std::move(options)) {
+    if (!this->options.artifactCacheDir.empty()) {
+      artifactCache = std::make_unique<ArtifactCache>(
+          this->options.artifactCacheDir,
+          uint64_t(this->options.artifactCacheMaxSizeMB) << 20);
+    }
+    if (!this->options.ukernelCacheDir.empty()) {
+      ukernelCache = std::make_unique<ArtifactCache>(
+          this->options.ukernelCacheDir,
+          uint64_t(this->options.artifactCacheMaxSizeMB) << 20);
+    }
+  }
 
   std::string getLegacyDefaultDeviceID() const override {
     switch (options.deviceHal) {
@@ -241,7 +258,7 @@ class AIETargetBackend final : public IREE::HAL::TargetBackend {
         options.enableCoalescingLoops, options.enableCollapsingUnitDims,
         options.enableFunctionOutlining, options.callReplication,
         options.insertLoopAroundCoreBlock, options.enableCtrlPkt,
-        options.coreStackSize);
+        options.coreStackSize, options.tuningDatabase, options.tuningExport);
   }
 
   void buildLinkingPassPipeline(OpPassManager &passManager) override {
@@ -255,9 +272,82 @@ class AIETargetBackend final : public IREE::HAL::TargetBackend {
   const AMDAIEOptions &getOptions() const { return options; }
 
  private:
+  /// Returns the key of the artifacts of `deviceOp` in `artifactCache`: a hash
+  /// of the device, of the options `aie2xclbin` is run with and of the
+  /// toolchains it invokes.
+  std::string getArtifactCacheKey(xilinx::AIE::DeviceOp deviceOp,
+                                  StringRef npuVersion, StringRef targetArch,
+                                  StringRef kernelId,
+                                  StringRef kernelName) const;
+
   AMDAIEOptions options;
+  /// Shared by all the executables serialized by this backend, possibly
+  /// concurrently; null if the artifact cache is disabled.
+  std::unique_ptr<ArtifactCache> artifactCache;
+  /// Cache of the compiled ukernel objects; null if disabled.
+  std::unique_ptr<ArtifactCache> ukernelCache;
 };
 
+/// Returns the path of the binary the compiler is linked into, i.e. the shared
+/// library containing this function or, where that can't be found, the
+/// executable.
+static std::string getCompilerBinaryPath() {
+#ifndef _WIN32
+  Dl_info info;
+  if (dladdr(reinterpret_cast<void *>(&getCompilerBinaryPath), &info) &&
+      info.dli_fname) {
+    return info.dli_fname;
+  }
+#endif  // _WIN32
+  return llvm::sys::fs::getMainExecutable(
+      nullptr, reinterpret_cast<void *>(&getCompilerBinaryPath));
+}
+
+std::string AIETargetBackend::getArtifactCacheKey(
+    xilinx::AIE::DeviceOp deviceOp, StringRef npuVersion, StringRef targetArch,
+    StringRef kernelId, StringRef kernelName) const {
+  std::string deviceStr;
+  {
+    llvm::raw_string_ostream os(deviceStr);
+    deviceOp->print(os, OpPrintingFlags().printGenericOpForm());
+  }
+  // Bump the version whenever the layout of the cached artifacts changes.
+  std::vector<std::string> components{
+      "aie2xclbin-v1",
+      deviceStr,
+      AMDAIE::stringifyEnum(options.AMDAIETargetDevice).str(),
+      npuVersion.str(),
+      targetArch.str(),
+      std::to_string(static_cast<int>(options.deviceHal)),
+      kernelId.str(),
+      kernelName.str(),
+      std::to_string(options.useChess),
+      std::to_string(options.useChessForUKernel),
+      std::to_string(options.enableCtrlPkt),
+      options.additionalPeanoOptFlags,
+      options.vitisInstallDir,
+      options.amdAieInstallDir};
+  for (StringRef tool : {"clang", "opt", "llc"}) {
+    SmallString<128> toolPath(options.peanoInstallDir);
+    llvm::sys::path::append(toolPath, "bin", tool);
+    components.push_back(ArtifactCache::describeFile(toolPath));
+  }
+  if (options.useChess || options.useChessForUKernel) {
+    // Resolved like `aie2xclbin` does.
+    std::optional<std::string> vitisDir =
+        options.vitisInstallDir.empty()
+            ? discoverVitis()
+            : std::optional<std::string>{options.vitisInstallDir};
+    components.push_back(
+        vitisDir ? ArtifactCache::describeFile(getChessCompilerPath(*vitisDir))
+                 : "xchesscc:missing");
+  }
+  // The compiler itself, so that a rebuilt compiler doesn't reuse artifacts
+  // produced by an older one.
+  components.push_back(ArtifactCache::describeFile(getCompilerBinaryPath()));
+  return ArtifactCache::computeKey(components);
+}
+
 void serializeXCLBinToFb(FlatbufferBuilder &builder,
                          flatbuffers_string_vec_ref_t entryPointsRef,
                          SmallVector<int32_t> &asmInstrIndices,
@@ -305,7 +395,8 @@ void serializePDIToFb(FlatbufferBuilder &builder,
                       SmallVector<int32_t> &reconfDataIndices,
                       SmallVector<flatbuffers_ref_t> pdiRefs,
                       SmallVector<flatbuffers_ref_t> asmInstrRefs,
-                      SmallVector<flatbuffers_ref_t> reconfDataRefs) {
+                      SmallVector<flatbuffers_ref_t> reconfDataRefs,
+                      SmallVector<std::vector<uint32_t>> &bindingFlags) {
   // Add the entry points to the flatbuffer.
   iree_amd_aie_hal_xrt_lite_ExecutableDef_entry_points_add(builder,
                                                            entryPointsRef);
@@ -335,6 +426,16 @@ void serializePDIToFb(FlatbufferBuilder &builder,
       builder.createOffsetVecDestructive(reconfDataRefs);
   iree_amd_aie_hal_xrt_lite_ExecutableDef_reconf_data_runlists_add(
       builder, reconfDataRef);
+  // Add the binding flags to the flatbuffer.
+  SmallVector<iree_amd_aie_hal_xrt_lite_UI32Array1dDef_ref_t> bindingFlagsRefs =
+      llvm::map_to_vector(bindingFlags, [&](std::vector<uint32_t> &flags) {
+        return iree_amd_aie_hal_xrt_lite_UI32Array1dDef_create(
+            builder, builder.createInt32Vec(flags));
+      });
+  flatbuffers_vec_ref_t bindingFlagsRef =
+      builder.createOffsetVecDestructive(bindingFlagsRefs);
+  iree_amd_aie_hal_xrt_lite_ExecutableDef_binding_flags_add(builder,
+                                                            bindingFlagsRef);
   iree_amd_aie_hal_xrt_lite_ExecutableDef_end_as_root(builder);
 }
 
@@ -475,6 +576,9 @@ LogicalResult AIETargetBackend::serializeExecutable(
   // Map to keep track of which ordinal number belongs to which entry point,
   // typically the order is sequential but that is not gauranteed
   std::map<std::string, uint64_t> entryPointOrdinals;
+  // Flags of the bindings of every entry point; only bit 0 (read-only) is
+  // used.
+  std::map<std::string, std::vector<uint32_t>> entryPointBindingFlags;
   for (IREE::HAL::ExecutableExportOp exportOp : variantOp.getExportOps()) {
     uint64_t ordinal = 0;
     if (std::optional<APInt> optionalOrdinal = exportOp.getOrdinal()) {
@@ -500,6 +604,14 @@ LogicalResult AIETargetBackend::serializeExecutable(
     sanitizeForBootgen(entryPointName);
     entryPointNames.emplace_back(entryPointName);
     entryPointOrdinals[entryPointName] = ordinal;
+    std::vector<uint32_t> &bindingFlags =
+        entryPointBindingFlags[entryPointName];
+    for (IREE::HAL::PipelineBindingAttr binding :
+         exportOp.getLayout().getBindings()) {
+      bool readOnly = IREE::HAL::bitEnumContainsAny(
+          binding.getFlags(), IREE::HAL::DescriptorFlags::ReadOnly);
+      bindingFlags.push_back(readOnly ? 1 : 0);
+    }
     // error out if we think the name will most likely be too long
     // for the artifact generation to succeed. We set this cut-off at 50
     // characters.
@@ -533,16 +645,38 @@ LogicalResult AIETargetBackend::serializeExecutable(
   Flatbuffer1dStringArrayConverter artifactConvertor(ordinalCount);
   Flatbuffer3dUInt32ArrayConverter asmInstrConverter(ordinalCount);
   Flatbuffer3dUInt32ArrayConverter reconfDataConverter(ordinalCount);
+  SmallVector<std::vector<uint32_t>> bindingFlags(ordinalCount);
+
+  // TODO(max): this should be an enum
+  // TODO(max): this needs to be pulled from PCIE
+  AMDAIEDeviceModel deviceModel = getDeviceModel(options.AMDAIETargetDevice);
+  std::optional<std::string> npuVersion = deviceModel.getNPUVersionString();
+  std::optional<std::string> targetArch = deviceModel.getTargetArchString();
+  if (!npuVersion.has_value() || !targetArch.has_value()) {
+    llvm::errs() << "unhandled NPU partitioning.\n";
+    return failure();
+  }
 
+  // The paths of the files generated for every entry point.
+  struct EntryPointPaths {
+    SmallString<128> workDir;
+    SmallString<128> artifact;
+    SmallString<128> npuInst;
+    SmallString<128> ctrlpktInst;
+    SmallString<128> ctrlpktSeq;
+    // Ordinal as a hexadecimal string, used as the kernel id.
+    std::string kernelId;
+  };
+  SmallVector<EntryPointPaths> entryPointPaths(entryPointNames.size());
   for (size_t i = 0; i < entryPointNames.size(); i++) {
     uint64_t ordinal = entryPointOrdinals.at(entryPointNames[i]);
-    entryPointNameConvertor.addEntry(ordinal, entryPointNames[i]);
-    std::string errorMessage;
+    EntryPointPaths &paths = entryPointPaths[i];
     // we add the entry point to the working directory for artifacts if
     // there are multiple entry points so that we don't overwrite the
     // generated artifacts e.g kernels.json, for different entry points which
     // will have the same exact names.
-    SmallString<128> entryPointWorkDir(workDir);
+    SmallString<128> &entryPointWorkDir = paths.workDir;
+    entryPointWorkDir = workDir;
     if (ordinalCount > 1) {
       llvm::sys::path::append(entryPointWorkDir, entryPointNames[i]);
     }
@@ -552,9 +686,9 @@ LogicalResult AIETargetBackend::serializeExecutable(
              << "failed to create working directory for artifact generation: "
              << err.message();
     }
-    llvm::outs().flush();
 
-    SmallString<128> artifactPath(entryPointWorkDir);
+    SmallString<128> &artifactPath = paths.artifact;
+    artifactPath = entryPointWorkDir;
     switch (options.deviceHal) {
       case AMDAIEOptions::DeviceHAL::XRT:
         llvm::sys::path::append(artifactPath, entryPointNames[i] + ".xclbin");
@@ -567,32 +701,32 @@ LogicalResult AIETargetBackend::serializeExecutable(
         return failure();
     }
     // Path to store the NPU instructions.
-    SmallString<128> npuInstPath(entryPointWorkDir);
+    paths.npuInst = entryPointWorkDir;
     SmallString<128> npuInstFileName(entryPointNames[i] + ".npu_inst.txt");
-    llvm::sys::path::append(npuInstPath, npuInstFileName);
+    llvm::sys::path::append(paths.npuInst, npuInstFileName);
     // Path to store the control packet instructions.
-    SmallString<128> ctrlpktInstPath(entryPointWorkDir);
+    paths.ctrlpktInst = entryPointWorkDir;
     SmallString<128> ctrlpktInstFileName(entryPointNames[i] +
                                          ".ctrlpkt_inst.txt");
-    llvm::sys::path::append(ctrlpktInstPath, ctrlpktInstFileName);
+    llvm::sys::path::append(paths.ctrlpktInst, ctrlpktInstFileName);
     // Path to store the control packet sequence.
-    SmallString<128> ctrlpktSeqPath(entryPointWorkDir);
+    paths.ctrlpktSeq = entryPointWorkDir;
     SmallString<128> ctrlpktSeqFileName(entryPointNames[i] +
                                         ".ctrlpkt_seq.txt");
-    llvm::sys::path::append(ctrlpktSeqPath, ctrlpktSeqFileName);
+    llvm::sys::path::append(paths.ctrlpktSeq, ctrlpktSeqFileName);
 
     // Convert ordinal to hexadecimal string for kernel id.
     std::stringstream ordinalHex;
     ordinalHex << "0x" << std::hex << ordinal;
-
-    ParserConfig pcfg(variantOp->getContext());
-    llvm::SourceMgr srcMgr;
+    paths.kernelId = ordinalHex.str();
 
     // Move DeviceOp into its own ModuleOp, if there are multiple DeviceOps.
     // Required as core-to-standard pass will move all ops in DeviceOps into
     // the parent ModuleOp, so if they're not separated, core code between
     // DeviceOps gets incorrectly concatenated. There's probably a simpler
     // workaround, to be reviewed as we continue to remove layers of crust.
+    // This also gives every device its own IR, so that they can be compiled
+    // concurrently below.
     if (deviceOps.size() > 1) {
       OpBuilder opBuilder(deviceOps[i].getContext());
       auto moduleWithOneDevice =
@@ -605,29 +739,52 @@ LogicalResult AIETargetBackend::serializeExecutable(
       Operation *repl = opBuilder.clone(*deviceOps[i].getOperation());
       deviceOps[i] = cast<xilinx::AIE::DeviceOp>(repl);
     }
-
-    // TODO(max): this should be an enum
-    // TODO(max): this needs to be pulled from PCIE
-    AMDAIEDeviceModel deviceModel = getDeviceModel(options.AMDAIETargetDevice);
-    std::optional<std::string> npuVersion = deviceModel.getNPUVersionString();
-    std::optional<std::string> targetArch = deviceModel.getTargetArchString();
-    if (!npuVersion.has_value() || !targetArch.has_value()) {
-      llvm::errs() << "unhandled NPU partitioning.\n";
-      return failure();
+  }
+  llvm::outs().flush();
+
+  // Generate the artifacts of the entry points concurrently, on the context's
+  // thread pool. Each of them only touches its own IR and working directory.
+  auto generateArtifacts = [&](size_t i) -> LogicalResult {
+    const EntryPointPaths &paths = entryPointPaths[i];
+    // The files generated by `aie2xclbin` that are read below; only these are
+    // stored in the artifact cache.
+    SmallVector<ArtifactCache::File> cachedFiles = {
+        {"artifact", paths.artifact.str().str()},
+        {"npu_inst.txt", paths.npuInst.str().str()}};
+    if (options.enableCtrlPkt) {
+      cachedFiles.push_back(
+          {"ctrlpkt_inst.txt", paths.ctrlpktInst.str().str()});
+      cachedFiles.push_back({"ctrlpkt_seq.txt", paths.ctrlpktSeq.str().str()});
     }
+    std::string cacheKey;
+    bool cacheHit = false;
+    if (artifactCache) {
+      cacheKey = getArtifactCacheKey(deviceOps[i], npuVersion.value(),
+                                     targetArch.value(), paths.kernelId,
+                                     entryPointNames[i]);
+      cacheHit = artifactCache->lookup(cacheKey, cachedFiles);
+      if (options.showInvokedCommands) {
+        ArtifactCache::Stats stats = artifactCache->getStats();
+        llvm::outs() << "Artifact cache " << (cacheHit ? "hit" : "miss")
+                     << " for " << entryPointNames[i] << " (" << stats.hits
+                     << " hits, " << stats.misses << " misses, "
+                     << stats.evictions << " evictions).\n";
+      }
+    }
+    if (cacheHit) return success();
 
     if (failed(aie2xclbin(
             /*ctx=*/variantOp->getContext(),
             /*deviceOp=*/deviceOps[i],
-            /*outputNpuInstPath=*/npuInstPath.str().str(),
-            /*outputCtrlPktInstPath=*/ctrlpktInstPath.str().str(),
-            /*outputCtrlPktSeqPath=*/ctrlpktSeqPath.str().str(),
-            /*artifactPath=*/artifactPath.str().str(),
+            /*outputNpuInstPath=*/paths.npuInst.str().str(),
+            /*outputCtrlPktInstPath=*/paths.ctrlpktInst.str().str(),
+            /*outputCtrlPktSeqPath=*/paths.ctrlpktSeq.str().str(),
+            /*artifactPath=*/paths.artifact.str().str(),
             /*printIRBeforeAll=*/options.aie2xclbinPrintIrBeforeAll,
             /*printIRAfterAll=*/options.aie2xclbinPrintIrAfterAll,
             /*printIRModuleScope=*/options.aie2xclbinPrintIrModuleScope,
             /*timing=*/options.aie2xclbinTiming,
-            /*tempDir=*/entryPointWorkDir.str().str(),
+            /*tempDir=*/paths.workDir.str().str(),
             /*useChess=*/options.useChess,
             /*useChessForUKernel=*/options.useChessForUKernel,
             /*verbose=*/options.showInvokedCommands,
@@ -638,33 +795,52 @@ LogicalResult AIETargetBackend::serializeExecutable(
             /*npuVersion=*/npuVersion.value(),
             /*peanoDir=*/options.peanoInstallDir,
             /*deviceHal=*/options.deviceHal,
-            /*xclBinKernelID=*/ordinalHex.str(),
+            /*xclBinKernelID=*/paths.kernelId,
             /*xclBinKernelName=*/entryPointNames[i],
             /*xclBinInstanceName=*/"IREE",
             /*amdAIEInstallDir=*/options.amdAieInstallDir,
             /*InputXCLBin=*/std::nullopt,
             /*additionalPeanoOptFlags=*/options.additionalPeanoOptFlags,
-            /*enableCtrlPkt=*/options.enableCtrlPkt))) {
+            /*enableCtrlPkt=*/options.enableCtrlPkt,
+            /*ukernelCache=*/ukernelCache.get()))) {
       return failure();
     }
+    // Failing to store the artifacts only costs a later recompilation.
+    if (artifactCache) (void)artifactCache->insert(cacheKey, cachedFiles);
+    return success();
+  };
+  if (failed(failableParallelForEach(variantOp->getContext(),
+                                     llvm::seq<size_t>(0, deviceOps.size()),
+                                     generateArtifacts))) {
+    return failure();
+  }
+
+  // Gather the artifacts by ordinal, so that the executable doesn't depend on
+  // the order in which they were generated.
+  for (size_t i = 0; i < entryPointNames.size(); i++) {
+    uint64_t ordinal = entryPointOrdinals.at(entryPointNames[i]);
+    const EntryPointPaths &paths = entryPointPaths[i];
+    entryPointNameConvertor.addEntry(ordinal, entryPointNames[i]);
+    bindingFlags[ordinal] = entryPointBindingFlags[entryPointNames[i]];
+    std::string errorMessage;
 
     SmallVector<std::vector<uint32_t>> asmInstrs2d;
     SmallVector<std::vector<uint32_t>> reconfData2d;
     if (options.enableCtrlPkt) {
       // Load control packet instructions from file.
       FailureOr<std::vector<uint32_t>> ctrlpktInstrs =
-          loadUInt32ArrayFromFile(ctrlpktInstPath);
+          loadUInt32ArrayFromFile(paths.ctrlpktInst);
       if (failed(ctrlpktInstrs)) return failure();
       asmInstrs2d.push_back(ctrlpktInstrs.value());
       // Load control packet sequence from file.
       FailureOr<std::vector<uint32_t>> ctrlpktSeq =
-          loadUInt32ArrayFromFile(ctrlpktSeqPath);
+          loadUInt32ArrayFromFile(paths.ctrlpktSeq);
       if (failed(ctrlpktSeq)) return failure();
       reconfData2d.push_back(ctrlpktSeq.value());
     }
     // Load NPU instructions from file.
     FailureOr<std::vector<uint32_t>> npuInstrs =
-        loadUInt32ArrayFromFile(npuInstPath);
+        loadUInt32ArrayFromFile(paths.npuInst);
     if (failed(npuInstrs)) return failure();
     asmInstrs2d.push_back(npuInstrs.value());
     // Add the 2D array entry to the converter.
@@ -678,7 +854,7 @@ LogicalResult AIETargetBackend::serializeExecutable(
     if (!options.enableCtrlPkt || i == 0) {
       // Load the artifact from file.
       std::unique_ptr<llvm::MemoryBuffer> artifactInput =
-          openInputFile(artifactPath, &errorMessage);
+          openInputFile(paths.artifact, &errorMessage);
       if (!artifactInput) {
         moduleOp.emitOpError()
             << "Failed to open artifact file: " << errorMessage;
@@ -724,7 +900,8 @@ LogicalResult AIETargetBackend::serializeExecutable(
                        artifactConvertor.getFlatbufferRefs(
                            builder, iree_amd_aie_hal_xrt_lite_PdiDef_create),
                        get3dUInt32ArrayRefs(asmInstrConverter),
-                       get3dUInt32ArrayRefs(reconfDataConverter));
+                       get3dUInt32ArrayRefs(reconfDataConverter),
+                       bindingFlags);
       break;
     }
     default:
@@ -92,6 +92,25 @@ struct AMDAIEOptions {
   // The default stack size for all cores is 1024 bytes.
   uint32_t coreStackSize{1024};
 
+  // Directory of the persistent cache of `aie2xclbin` artifacts. The cache is
+  // disabled if empty.
+  std::string artifactCacheDir;
+
+  // Size limit of the artifact cache, in MiB.
+  unsigned artifactCacheMaxSizeMB{1024};
+
+  // Directory of the persistent cache of compiled ukernel objects. The cache is
+  // disabled if empty.
+  std::string ukernelCacheDir;
+
+  // Path to a file with tuning records for the lowering strategy. No records
+  // are used if empty.
+  std::string tuningDatabase;
+
+  // Path to a file to append the configuration selected for every dispatch to.
+  // Nothing is exported if empty.
+  std::string tuningExport;
+
   void bindOptions(OptionsBinder &binder) {
     static llvm::cl::OptionCategory category("AMD AIE Options");
 
@@ -305,6 +324,10 @@ struct AMDAIEOptions {
                                     "No packet flow will be used."),
                          clEnumValN(PacketFlowStrategy::Auto, "auto",
                                     "Congestion-aware packet flow assignment."),
+                         clEnumValN(PacketFlowStrategy::AutoRouted,
+                                    "auto-routed",
+                                    "Packet flow assignment validated by a "
+                                    "dry run of the router."),
                          clEnumValN(PacketFlowStrategy::Inputs, "inputs",
                                     "Use packet mode on all input flows."),
                          clEnumValN(PacketFlowStrategy::Outputs, "outputs",
@@ -329,6 +352,46 @@ struct AMDAIEOptions {
     binder.opt<unsigned>(
         "iree-amdaie-stack-size", coreStackSize, llvm::cl::cat(category),
         llvm::cl::desc("The stack size to be used for the AIE cores."));
+
+    binder.opt<std::string>(
+        "iree-amd-aie-artifact-cache-dir", artifactCacheDir,
+        llvm::cl::cat(category),
+        llvm::cl::desc(
+            "Directory of a persistent cache of the artifacts (PDI/XCLBin, NPU "
+            "instructions and control packets) generated for every device, "
+            "reused by later compilations of identical devices with the same "
+            "options and toolchains. The cache is disabled if empty. Clear it "
+            "when updating the compiler."));
+
+    binder.opt<unsigned>(
+        "iree-amd-aie-artifact-cache-max-size-mb", artifactCacheMaxSizeMB,
+        llvm::cl::cat(category),
+        llvm::cl::desc("The size limit of the artifact cache in MiB; the least "
+                       "recently used artifacts are evicted beyond it."));
+
+    binder.opt<std::string>(
+        "iree-amd-aie-ukernel-cache-dir", ukernelCacheDir,
+        llvm::cl::cat(category),
+        llvm::cl::desc(
+            "Directory of a persistent cache of the ukernel objects compiled "
+            "with chess or peano, shared by all the executables and by later "
+            "compilations using the same toolchain. The cache is disabled if "
+            "empty. It is bounded by the artifact cache size limit."));
+
+    binder.opt<std::string>(
+        "iree-amdaie-tuning-database", tuningDatabase, llvm::cl::cat(category),
+        llvm::cl::desc(
+            "Path to a file with tuning records, one JSON object per line, "
+            "keyed by op, shape, element types, target device and array size. "
+            "The tile sizes, pack sizes, buffer depths and outlining strategy "
+            "of the record matching a dispatch override the heuristics."));
+
+    binder.opt<std::string>(
+        "iree-amdaie-tuning-export", tuningExport, llvm::cl::cat(category),
+        llvm::cl::desc(
+            "Path to a file to append the configuration selected for every "
+            "dispatch to, in the format of the tuning database. Useful to "
+            "script sweeps over the configurations."));
   }
 };
 
@@ -0,0 +1,219 @@
+// Copyright 2025 The IREE Authors
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "ArtifactCache.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA256.h"
+#include "llvm/Support/raw_ostream.h"
+
+#define DEBUG_TYPE "amdaie-artifact-cache"
+
+using Path = std::filesystem::path;
+
+namespace mlir::iree_compiler::AMDAIE {
+
+namespace {
+
+/// Temporary directories of entries being inserted start with this prefix;
+/// they are never looked up, and only deleted once stale.
+constexpr llvm::StringLiteral kTempPrefix = ".tmp-";
+
+/// Temporary directories that haven't been modified for this long belong to
+/// insertions that crashed, and are deleted when the cache is scanned.
+constexpr std::chrono::hours kStaleTempAge(1);
+
+struct EntryInfo {
+  Path path;
+  uint64_t size;
+  std::filesystem::file_time_type lastUse;
+};
+
+/// Returns the total size of the regular files in `entry`.
+uint64_t getEntrySize(const Path &entry) {
+  uint64_t size = 0;
+  std::error_code ec;
+  for (std::filesystem::directory_iterator it(entry, ec), end;
+       !ec && it != end; it.increment(ec)) {
+    std::error_code sizeEc;
+    uint64_t fileSize = std::filesystem::file_size(it->path(), sizeEc);
+    if (!sizeEc) size += fileSize;
+  }
+  return size;
+}
+
+}  // namespace
+
+ArtifactCache::ArtifactCache(std::string directory, uint64_t maxSizeInBytes)
+    : directory(std::move(directory)), maxSizeInBytes(maxSizeInBytes) {}
+
+std::string ArtifactCache::computeKey(llvm::ArrayRef<std::string> components) {
+  llvm::SHA256 hasher;
+  for (const std::string &component : components) {
+    // Prefix every component with its size so that different splits of the
+    // same bytes give different keys.
+    uint64_t size = component.size();
+    hasher.update(llvm::ArrayRef<uint8_t>(
+        reinterpret_cast<const uint8_t *>(&size), sizeof(size)));
+    hasher.update(component);
+  }
+  std::array<uint8_t, 32> hash = hasher.final();
+  return llvm::toHex(hash, /*LowerCase=*/true);
+}
+
+std::string ArtifactCache::describeFile(llvm::StringRef path) {
+  llvm::sys::fs::file_status status;
+  if (llvm::sys::fs::status(path, status)) return (path + ":missing").str();
+  return (path + ":" + std::to_string(status.getSize()) + ":" +
+          std::to_string(
+              status.getLastModificationTime().time_since_epoch().count()))
+      .str();
+}
+
+bool ArtifactCache::lookup(llvm::StringRef key, llvm::ArrayRef<File> files) {
+  Path entry = Path(directory) / key.str();
+  std::error_code entryEc;
+  bool hit = std::filesystem::is_directory(entry, entryEc);
+  for (const File &file : files) {
+    if (!hit) break;
+    std::error_code ec;
+    std::filesystem::copy_file(
+        entry / file.name, file.path,
+        std::filesystem::copy_options::overwrite_existing, ec);
+    // The entry may be incomplete or being evicted by another compilation.
+    if (ec) {
+      LLVM_DEBUG(llvm::dbgs() << "failed to copy " << file.name << " of entry "
+                              << key << ": " << ec.message() << "\n");
+      hit = false;
+    }
+  }
+  if (hit) {
+    // Mark the entry as recently used.
+    std::error_code ec;
+    std::filesystem::last_write_time(
+        entry, std::filesystem::file_time_type::clock::now(), ec);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  ++(hit ? stats.hits : stats.misses);
+  return hit;
+}
+
+LogicalResult ArtifactCache::insert(llvm::StringRef key,
+                                    llvm::ArrayRef<File> files) {
+  if (std::error_code ec = llvm::sys::fs::create_directories(directory)) {
+    llvm::errs() << "Failed to create cache directory " << directory << ": "
+                 << ec.message() << "\n";
+    return failure();
+  }
+  Path entry = Path(directory) / key.str();
+  std::error_code entryEc;
+  if (std::filesystem::is_directory(entry, entryEc)) return success();
+
+  // Write the entry to a temporary directory first so that no compilation
+  // ever sees a partial entry.
+  llvm::SmallString<128> tempModel(directory);
+  llvm::sys::path::append(tempModel, kTempPrefix + key + "-%%%%%%%%");
+  llvm::SmallString<128> tempDir;
+  llvm::sys::fs::createUniquePath(tempModel, tempDir, /*MakeAbsolute=*/false);
+  if (std::error_code ec = llvm::sys::fs::create_directory(tempDir)) {
+    llvm::errs() << "Failed to create " << tempDir << ": " << ec.message()
+                 << "\n";
+    return failure();
+  }
+  Path tempEntry(tempDir.str().str());
+  for (const File &file : files) {
+    std::error_code ec;
+    std::filesystem::copy_file(file.path, tempEntry / file.name, ec);
+    if (ec) {
+      llvm::errs() << "Failed to copy " << file.path << " to the cache: "
+                   << ec.message() << "\n";
+      std::filesystem::remove_all(tempEntry, ec);
+      return failure();
+    }
+  }
+  uint64_t entrySize = getEntrySize(tempEntry);
+  std::error_code ec;
+  std::filesystem::rename(tempEntry, entry, ec);
+  // Another compilation may have published the same entry in the meantime,
+  // in which case this copy is redundant.
+  if (ec) {
+    std::filesystem::remove_all(tempEntry, ec);
+    entrySize = 0;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (knownSize) *knownSize += entrySize;
+  if (!knownSize || *knownSize > maxSizeInBytes) evict();
+  return success();
+}
+
+void ArtifactCache::evict() {
+  std::vector<EntryInfo> entries;
+  uint64_t totalSize = 0;
+  auto staleTime =
+      std::filesystem::file_time_type::clock::now() - kStaleTempAge;
+  std::error_code ec;
+  for (std::filesystem::directory_iterator it(directory, ec), end;
+       !ec && it != end; it.increment(ec)) {
+    std::string name = it->path().filename().string();
+    std::error_code typeEc;
+    if (!it->is_directory(typeEc)) continue;
+    std::error_code timeEc;
+    std::filesystem::file_time_type lastWrite =
+        std::filesystem::last_write_time(it->path(), timeEc);
+    if (timeEc) continue;
+    if (llvm::StringRef(name).starts_with(kTempPrefix)) {
+      if (lastWrite < staleTime) {
+        std::error_code removeEc;
+        std::filesystem::remove_all(it->path(), removeEc);
+        LLVM_DEBUG(llvm::dbgs() << "deleted stale " << it->path().string()
+                                << "\n");
+      }
+      continue;
+    }
+    EntryInfo info{it->path(), getEntrySize(it->path()), lastWrite};
+    totalSize += info.size;
+    entries.push_back(std::move(info));
+  }
+
+  if (totalSize > maxSizeInBytes) {
+    // Evict below the limit, so that the next scan is only needed after a few
+    // more insertions.
+    uint64_t targetSize = maxSizeInBytes / 10 * 9;
+    llvm::sort(entries, [](const EntryInfo &a, const EntryInfo &b) {
+      return a.lastUse < b.lastUse;
+    });
+    for (const EntryInfo &info : entries) {
+      if (totalSize <= targetSize) break;
+      std::error_code removeEc;
+      std::filesystem::remove_all(info.path, removeEc);
+      if (removeEc) continue;
+      LLVM_DEBUG(llvm::dbgs() << "evicted " << info.path.string() << "\n");
+      totalSize -= info.size;
+      ++stats.evictions;
+    }
+  }
+  knownSize = totalSize;
+}
+
+ArtifactCache::Stats ArtifactCache::getStats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return stats;
+}
+
+}  // namespace mlir::iree_compiler::AMDAIE
@@ -0,0 +1,86 @@
+// Copyright 2025 The IREE Authors
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#ifndef IREE_AMD_AIE_TARGET_ARTIFACTCACHE_H_
+#define IREE_AMD_AIE_TARGET_ARTIFACTCACHE_H_
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "mlir/Support/LogicalResult.h"
+
+namespace mlir::iree_compiler::AMDAIE {
+
+/// A persistent, content-addressed cache of compilation artifacts on disk.
+///
+/// Every entry is a directory `<directory>/<key>` holding the files produced by
+/// one compilation, where the key is a hash of everything the compilation
+/// depends on (see `computeKey`). Entries are published atomically, by
+/// renaming a fully written temporary directory, so compilations running
+/// concurrently, in the same or in different processes, can share a cache
+/// directory. Once the entries take up more than `maxSizeInBytes`, the least
+/// recently used ones are evicted. The directory is only scanned for that when
+/// the size it is known to have crosses the limit, so that inserting doesn't
+/// take time linear in the number of entries.
+class ArtifactCache {
+ public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+  };
+
+  /// A file of an entry: its name within the entry and the path it is copied
+  /// from on insertion and to on a hit.
+  struct File {
+    std::string name;
+    std::string path;
+  };
+
+  ArtifactCache(std::string directory, uint64_t maxSizeInBytes);
+
+  /// Returns a key (a hex encoded SHA-256) that identifies `components`.
+  static std::string computeKey(llvm::ArrayRef<std::string> components);
+
+  /// Describes the file at `path` by its size and modification time, which
+  /// change whenever the file (typically a tool) is updated. Used as a key
+  /// component for the tools that produce the artifacts.
+  static std::string describeFile(llvm::StringRef path);
+
+  /// Copies the files of the entry `key` to their paths and returns true, or
+  /// returns false (a miss) if there is no complete entry for `key`.
+  bool lookup(llvm::StringRef key, llvm::ArrayRef<File> files);
+
+  /// Stores the files as the entry `key`, unless it already exists, and then
+  /// evicts entries if the cache no longer fits in its size limit.
+  LogicalResult insert(llvm::StringRef key, llvm::ArrayRef<File> files);
+
+  Stats getStats() const;
+  const std::string &getDirectory() const { return directory; }
+
+ private:
+  /// Scans the cache directory, deleting the temporary directories left
+  /// behind by crashed insertions, and evicts the least recently used entries
+  /// until the cache fits in 90% of its size limit.
+  void evict();
+
+  std::string directory;
+  uint64_t maxSizeInBytes;
+  mutable std::mutex mutex;
+  Stats stats;
+  /// The size of the entries as of the last scan, plus the entries inserted
+  /// since. Entries inserted by other processes are only accounted for by the
+  /// next scan. Unknown until the first insertion.
+  std::optional<uint64_t> knownSize;
+};
+
+}  // namespace mlir::iree_compiler::AMDAIE
+
+#endif  // IREE_AMD_AIE_TARGET_ARTIFACTCACHE_H_
@@ -11,6 +11,8 @@
 #include <filesystem>
 #include <fstream>
 #include <functional>
+#include <map>
+#include <mutex>
 #include <random>
 #include <sstream>
 
@@ -22,6 +24,7 @@
 #include "iree-dialects/Dialect/LinalgTransform/Passes.h"
 #include "iree/compiler/Utils/ToolUtils.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/JSON.h"
@@ -29,6 +32,7 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/Regex.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "mlir/Conversion/AffineToStandard/AffineToStandard.h"
 #include "mlir/Conversion/ArithToLLVM/ArithToLLVM.h"
@@ -61,6 +65,7 @@ using namespace llvm;
 using namespace mlir;
 using namespace xilinx;
 using Path = std::filesystem::path;
+using mlir::iree_compiler::AMDAIE::ArtifactCache;
 
 namespace mlir::iree_compiler::AMDAIE {
 namespace detail {
@@ -267,6 +272,24 @@ FailureOr<std::vector<std::string>> makePeanoOptArgs(
   return args;
 }
 }  // namespace detail
+
+std::optional<std::string> discoverVitis() {
+  if (::getenv("VITIS")) return std::nullopt;
+  auto vpp = sys::findProgramByName("v++");
+  if (!vpp) return std::nullopt;
+  SmallString<64> realVpp;
+  if (sys::fs::real_path(vpp.get(), realVpp)) return std::nullopt;
+  sys::path::remove_filename(realVpp);
+  sys::path::remove_filename(realVpp);
+  LLVM_DEBUG(dbgs() << "Found Vitis at " << realVpp.c_str() << "\n");
+  return realVpp.str().str();
+}
+
+std::string getChessCompilerPath(const std::string &vitisDir) {
+  return (Path(vitisDir) / "aietools" / "bin" / "unwrapped" / "lnx64.o" /
+          "xchesscc")
+      .string();
+}
 }  // namespace mlir::iree_compiler::AMDAIE
 
 namespace {
@@ -275,8 +298,10 @@ static std::random_device rd;
 static std::mt19937 gen(rd());
 static std::uniform_int_distribution<> dis(0, 15);
 static std::uniform_int_distribution<> dis2(8, 11);
+static std::mutex genMutex;
 
 std::string getUUIDString() {
+  std::lock_guard<std::mutex> lock(genMutex);
   std::stringstream ss;
   int i;
   ss << std::hex;
@@ -304,6 +329,13 @@ std::string getUUIDString() {
 }
 }  // namespace uuid
 
+/// The CDO generator and bootgen keep their state in globals, so they can only
+/// run for one device at a time, even if devices are compiled concurrently.
+std::mutex &getCDOAndBootgenMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
 FailureOr<std::string> getTargetDir(const std::string &npuVersion) {
   if (npuVersion == "npu1") return std::string{"target_aie_ml"};
   if (npuVersion == "npu4") return std::string{"target_aie2p"};
@@ -334,18 +366,9 @@ void applyConfigToPassManager(PassManager &pm, bool printIRBeforeAll,
 FailureOr<Path> findVitis(std::optional<Path> &vitisDir,
                           const std::string &npuVersion) {
   if (!vitisDir) {
-    const char *envVitis = ::getenv("VITIS");
-    if (!envVitis) {
-      if (auto vpp = sys::findProgramByName("v++")) {
-        SmallString<64> realVpp;
-        std::error_code err = sys::fs::real_path(vpp.get(), realVpp);
-        if (!err) {
-          sys::path::remove_filename(realVpp);
-          sys::path::remove_filename(realVpp);
-          vitisDir = realVpp.str().str();
-          LLVM_DEBUG(dbgs() << "Found Vitis at " << realVpp.c_str() << "\n");
-        }
-      }
+    if (std::optional<std::string> discoveredDir =
+            mlir::iree_compiler::AMDAIE::discoverVitis()) {
+      vitisDir = *discoveredDir;
     }
   }
   if (!vitisDir) {
@@ -455,8 +478,9 @@ std::pair<std::string, std::vector<std::string>> makeChessArgs(
       "-I" + (aieToolsDir / "include").string()};
   // disassemble output
   if (verbose) flags.emplace_back("-d");
-  return {(aieToolsDir / "bin" / "unwrapped" / "lnx64.o" / "xchesscc").string(),
-          flags};
+  return {
+      mlir::iree_compiler::AMDAIE::getChessCompilerPath(vitisDir.string()),
+      flags};
 }
 
 std::vector<std::string> makeChessEnv(Path &vitisDir,
@@ -720,16 +744,107 @@ FailureOr<std::string> getUkernelFileContent(StringRef fileName) {
   return failure();
 }
 
+/// Compiles the embedded ukernel source `ukernelFileName` of `npuVersion` to
+/// `tempDir / ukernelObjectName`, with chess or peano. The sources never change
+/// for a given compiler, so with a `ukernelCache` the object is reused across
+/// devices and compilations that use the same toolchain.
+FailureOr<Path> generateUkernelObject(
+    const std::string &ukernelFileName, const std::string &ukernelObjectName,
+    bool useChessForUKernel, std::optional<Path> &vitisDir, Path &peanoDir,
+    const std::string &targetArch, const std::string &npuVersion,
+    Path &tempDir, bool verbose, ArtifactCache *ukernelCache) {
+  // Get the ukernel file content as a string.
+  Path ukernelFilePath = Path(npuVersion) /
+                         (useChessForUKernel ? "chess" : "peano") /
+                         ukernelFileName;
+  FailureOr<std::string> ukernelFileContent =
+      getUkernelFileContent(ukernelFilePath.string());
+  if (failed(ukernelFileContent)) {
+    llvm::errs() << "Failed to get ukernel file content for "
+                 << ukernelFilePath.string() << '\n';
+    return failure();
+  }
+
+  Path toolDir;
+  std::string toolPath;
+  std::string targetLower = StringRef(targetArch).lower();
+  if (useChessForUKernel) {
+    FailureOr<Path> maybeVitisDir = findVitis(vitisDir, npuVersion);
+    if (failed(maybeVitisDir)) {
+      llvm::errs() << "compiling ukernels with chess requires Vitis to "
+                      "be found"
+                   << '\n';
+      return failure();
+    }
+    toolDir = *maybeVitisDir;
+    toolPath =
+        mlir::iree_compiler::AMDAIE::getChessCompilerPath(toolDir.string());
+  } else {
+    toolDir = peanoDir;
+    toolPath = (toolDir / "bin" / "clang").string();
+  }
+
+  Path objectFile = tempDir / ukernelObjectName;
+  SmallVector<ArtifactCache::File> cachedFiles = {
+      {ukernelObjectName, objectFile.string()}};
+  std::string cacheKey;
+  if (ukernelCache) {
+    // Bump the version whenever the flags the ukernels are compiled with
+    // change.
+    cacheKey = ArtifactCache::computeKey(
+        {"ukernel-v1", useChessForUKernel ? "chess" : "peano", npuVersion,
+         targetLower, ukernelFilePath.string(), *ukernelFileContent,
+         ArtifactCache::describeFile(toolPath)});
+    if (ukernelCache->lookup(cacheKey, cachedFiles)) {
+      if (verbose) {
+        llvm::outs() << "Reusing " << ukernelObjectName << " from "
+                     << ukernelCache->getDirectory() << "\n";
+      }
+      return objectFile;
+    }
+  }
+
+  FailureOr<Path> ukernelObjectFilePath;
+  if (useChessForUKernel) {
+    ukernelObjectFilePath = assembleStringUsingChess(
+        /*inputFileStr=*/*ukernelFileContent,
+        /*inputFileName=*/ukernelFileName,
+        /*outputFileName=*/ukernelObjectName,
+        /*outputDir=*/tempDir,
+        /*extraArgs=*/std::vector<std::string>{},
+        /*workDir=*/tempDir,
+        /*vitisDir=*/toolDir,
+        /*npuVersion*/ npuVersion, verbose);
+  } else {
+    std::vector<std::string> extraArgs{"--target=" + targetLower +
+                                       "-none-unknown-elf"};
+    ukernelObjectFilePath = assembleStringUsingPeano(
+        /*inputFileStr=*/*ukernelFileContent,
+        /*inputFileName=*/ukernelFileName,
+        /*outputFileName=*/ukernelObjectName,
+        /*outputDir=*/tempDir,
+        /*extraArgs=*/extraArgs,
+        /*workDir=*/tempDir,
+        /*vitisDir=*/toolDir,
+        /*npuVersion*/ npuVersion, verbose);
+  }
+  if (failed(ukernelObjectFilePath)) return failure();
+  // Failing to store the object only costs a later recompilation.
+  if (ukernelCache) (void)ukernelCache->insert(cacheKey, cachedFiles);
+  return ukernelObjectFilePath;
+}
+
 // Generate the elf files for the core
 LogicalResult generateCoreElfFiles(AIE::DeviceOp deviceOp,
                                    const std::string &objFile, Path &tempDir,
                                    bool useChess, bool useChessForUKernel,
                                    std::optional<Path> vitisDir,
                                    const std::string &targetArch, bool verbose,
-                                   Path peanoDir,
-                                   const std::string &npuVersion) {
+                                   Path peanoDir, const std::string &npuVersion,
+                                   ArtifactCache *ukernelCache,
+                                   MLIRContext *ctx) {
+  using mlir::iree_compiler::AMDAIE::detail::CoreLinkJob;
   auto tileOps = deviceOp.getOps<AIE::TileOp>();
-  std::string errorMessage;
 
   // Get all the core ops.
   SmallVector<AIE::CoreOp> coreOps;
@@ -742,6 +857,9 @@ LogicalResult generateCoreElfFiles(AIE::DeviceOp deviceOp,
   // Keep track of the ukernel object file that has been generated, so that we
   // don't need to regenerate it for every core.
   llvm::DenseMap<StringRef, Path> ukernelObjectNameToPath;
+  // The links are collected first and run concurrently once every input they
+  // depend on has been generated.
+  std::vector<CoreLinkJob> linkJobs;
   for (auto iter : llvm::enumerate(coreOps)) {
     // Control logging verbosity: lower verbosing for all but the first core.
     bool verboseForThisIteration = verbose && (iter.index() == 0);
@@ -781,50 +899,11 @@ LogicalResult generateCoreElfFiles(AIE::DeviceOp deviceOp,
       // Get the ukernel source file name by substituting the '.o' with '.cc'.
       llvm::Regex re("\\.o$");
       std::string ukernelFileName = re.sub(".cc", ukernelObjectName);
-      Path ukernelFilePath = Path(npuVersion) /
-                             (useChessForUKernel ? "chess" : "peano") /
-                             ukernelFileName;
-      // Get the ukernel file content as a string.
-      FailureOr<std::string> ukernelFileContent =
-          getUkernelFileContent(ukernelFilePath.string());
-      if (failed(ukernelFileContent)) {
-        llvm::errs() << "Failed to get ukernel file content for "
-                     << ukernelFilePath.string() << '\n';
-        return failure();
-      }
       // Generate the ukernel object file using either chess or peano.
-      FailureOr<Path> ukernelObjectFilePath;
-      if (useChessForUKernel) {
-        FailureOr<Path> maybeVitisDir = findVitis(vitisDir, npuVersion);
-        if (failed(maybeVitisDir)) {
-          llvm::errs() << "compiling ukernels with chess requires Vitis to "
-                          "be found"
-                       << '\n';
-          return failure();
-        }
-        ukernelObjectFilePath = assembleStringUsingChess(
-            /*inputFileStr=*/*ukernelFileContent,
-            /*inputFileName=*/ukernelFileName,
-            /*outputFileName=*/ukernelObjectName.str(),
-            /*outputDir=*/tempDir,
-            /*extraArgs=*/std::vector<std::string>{},
-            /*workDir=*/tempDir,
-            /*vitisDir=*/*maybeVitisDir,
-            /*npuVersion*/ npuVersion, verboseForThisIteration);
-      } else {
-        std::string targetLower = StringRef(targetArch).lower();
-        std::vector<std::string> extraArgs{"--target=" + targetLower +
-                                           "-none-unknown-elf"};
-        ukernelObjectFilePath = assembleStringUsingPeano(
-            /*inputFileStr=*/*ukernelFileContent,
-            /*inputFileName=*/ukernelFileName,
-            /*outputFileName=*/ukernelObjectName.str(),
-            /*outputDir=*/tempDir,
-            /*extraArgs=*/extraArgs,
-            /*workDir=*/tempDir,
-            /*vitisDir=*/peanoDir,
-            /*npuVersion*/ npuVersion, verboseForThisIteration);
-      }
+      FailureOr<Path> ukernelObjectFilePath = generateUkernelObject(
+          ukernelFileName, ukernelObjectName.str(), useChessForUKernel,
+          vitisDir, peanoDir, targetArch, npuVersion, tempDir,
+          verboseForThisIteration, ukernelCache);
       if (failed(ukernelObjectFilePath)) return failure();
       ukernelObjectNameToPath[ukernelObjectName] = *ukernelObjectFilePath;
     }
@@ -837,26 +916,12 @@ LogicalResult generateCoreElfFiles(AIE::DeviceOp deviceOp,
       static constexpr llvm::StringLiteral chessIntrinsicWrapperObjectName =
           "chess_intrinsic_wrapper.o";
       if (!ukernelObjectNameToPath.contains(chessIntrinsicWrapperObjectName)) {
-        // Get the chess intrinsic wrapper file content as a string.
-        Path chessIntrinsicsFilePath =
-            Path(npuVersion) / "chess" / chessIntrinsicWrapperFileName.str();
-        FailureOr<std::string> chessIntrinsicWrapperFileContent =
-            getUkernelFileContent(chessIntrinsicsFilePath.string());
-        if (failed(chessIntrinsicWrapperFileContent)) {
-          llvm::errs() << "Failed to get chess intrinsic wrapper file content "
-                       << "for " << chessIntrinsicsFilePath.string() << '\n';
-          return failure();
-        }
         // Generate the chess intrinsic wrapper object file.
-        FailureOr<Path> chessIntrinsicsObjFile = assembleStringUsingChess(
-            /*inputFileStr=*/*chessIntrinsicWrapperFileContent,
-            /*inputFileName=*/chessIntrinsicWrapperFileName.str(),
-            /*outputFileName=*/chessIntrinsicWrapperObjectName.str(),
-            /*outputDir=*/tempDir,
-            /*extraArgs*/ std::vector<std::string>{},
-            /*workDir=*/tempDir,
-            /*vitisDir=*/*maybeVitisDir,
-            /*npuVersion*/ npuVersion, verboseForThisIteration);
+        FailureOr<Path> chessIntrinsicsObjFile = generateUkernelObject(
+            chessIntrinsicWrapperFileName.str(),
+            chessIntrinsicWrapperObjectName.str(), /*useChessForUKernel=*/true,
+            vitisDir, peanoDir, targetArch, npuVersion, tempDir,
+            verboseForThisIteration, ukernelCache);
         if (failed(chessIntrinsicsObjFile)) return failure();
         ukernelObjectNameToPath[chessIntrinsicWrapperObjectName] =
             *chessIntrinsicsObjFile;
@@ -864,20 +929,19 @@ LogicalResult generateCoreElfFiles(AIE::DeviceOp deviceOp,
 
       // Use xbridge (to remove any peano dependency with use-chess option)
       Path bcfPath = tempDir / (elfFileName + ".bcf");
-
+      std::string bcf;
       {
-        auto bcfOutput = openOutputFile(bcfPath.string(), &errorMessage);
-        if (!bcfOutput) {
-          llvm::errs() << "failed to open bcf file because: " << errorMessage;
-          return failure();
-        }
-
+        llvm::raw_string_ostream bcfOutput(bcf);
         if (failed(mlir::iree_compiler::AMDAIE::AIETranslateToBCF(
-                deviceOp, bcfOutput->os(), col, row))) {
+                deviceOp, bcfOutput, col, row))) {
           llvm::errs() << "Failed to generate BCF";
           return failure();
         }
-        bcfOutput->keep();
+      }
+      if (std::optional<std::string> maybeErr =
+              dumpStrToDisk(bcf, bcfPath.string())) {
+        llvm::errs() << "failed to open bcf file because: " << *maybeErr;
+        return failure();
       }
 
       auto [xChessCCExe, chessArgs] = makeChessArgs(
@@ -889,31 +953,46 @@ LogicalResult generateCoreElfFiles(AIE::DeviceOp deviceOp,
         chessArgs.emplace_back(
             ukernelObjectNameToPath[ukernelObjectName].string());
       }
+      CoreLinkJob job;
+      job.col = col;
+      job.row = row;
+      // The links run concurrently, so every one of them gets its own work
+      // directory.
+      Path workDir = tempDir / (elfFileName + ".work");
+      std::error_code ec;
+      std::filesystem::create_directories(workDir, ec);
+      if (ec) {
+        llvm::errs() << "Failed to create directory " << workDir.string()
+                     << " because: " << ec.message() << "\n";
+        return failure();
+      }
+      for (std::string &arg : chessArgs) {
+        if (StringRef(arg).starts_with("+w")) arg = "+w" + workDir.string();
+      }
       chessArgs.emplace_back("+l");
       chessArgs.emplace_back(bcfPath.string());
       chessArgs.emplace_back("-o");
       chessArgs.emplace_back(elfFile.string());
-      std::vector<std::string> env = makeChessEnv(*vitisDir, npuVersion);
-      if (failed(
-              runTool(xChessCCExe, chessArgs, verboseForThisIteration, env))) {
-        return deviceOp.emitOpError() << "failed to generate elf for core: ("
-                                      << col << ", " << row << ")";
-      }
+      job.program = xChessCCExe;
+      job.args = std::move(chessArgs);
+      job.env = makeChessEnv(*vitisDir, npuVersion);
+      job.elfFile = elfFile;
+      job.verbose = verboseForThisIteration;
+      linkJobs.push_back(std::move(job));
     } else {
       Path ldscriptPath = tempDir / (elfFileName + ".ld");
+      std::string ldscript;
       {
-        auto ldscriptOutput =
-            openOutputFile(ldscriptPath.string(), &errorMessage);
-        if (!ldscriptOutput) {
-          llvm::errs() << "Failed to open ldscript file because: "
-                       << errorMessage;
-          return failure();
-        }
+        llvm::raw_string_ostream ldscriptOutput(ldscript);
         if (failed(mlir::iree_compiler::AMDAIE::AIETranslateToLdScript(
-                deviceOp, ldscriptOutput->os(), col, row))) {
+                deviceOp, ldscriptOutput, col, row))) {
           return failure();
         }
-        ldscriptOutput->keep();
+      }
+      if (std::optional<std::string> maybeErr =
+              dumpStrToDisk(ldscript, ldscriptPath.string())) {
+        llvm::errs() << "Failed to open ldscript file because: " << *maybeErr;
+        return failure();
       }
 
       std::string targetLower = StringRef(targetArch).lower();
@@ -931,29 +1010,40 @@ LogicalResult generateCoreElfFiles(AIE::DeviceOp deviceOp,
       // result in larger binaries. The flag '--exclude-secion' should work
       // but doesn't appear to supported with peano.
       flags.emplace_back("-Wl,--orphan-handling=warn");
-      flags.emplace_back("-Wl,-T," + ldscriptPath.string());
-      flags.emplace_back("-o");
-      flags.emplace_back(elfFile.string());
       if (verbose) flags.emplace_back("-v");
       // we run clang (ie cc) so that libc, libm, crt0/1 paths are injected
       // automatically into the ld.lld invocation
-      if (failed(runTool((peanoDir / "bin" / "clang").string(), flags,
-                         verboseForThisIteration))) {
-        return failure();
-      }
+      CoreLinkJob job;
+      job.col = col;
+      job.row = row;
+      job.program = (peanoDir / "bin" / "clang").string();
+      flags.emplace_back("-Wl,-T," + ldscriptPath.string());
+      flags.emplace_back("-o");
+      flags.emplace_back(elfFile.string());
+      job.args = std::move(flags);
+      job.elfFile = elfFile;
+      job.verbose = verboseForThisIteration;
+      linkJobs.push_back(std::move(job));
     }
   }
-  return success();
+  // The device ops of a module are compiled concurrently, so the links share
+  // the context's thread pool rather than each starting threads of their own.
+  return mlir::iree_compiler::AMDAIE::detail::runCoreLinkJobs(
+      linkJobs,
+      ctx->isMultithreadingEnabled() ? &ctx->getThreadPool() : nullptr);
 }
 
 LogicalResult generateCDO(MLIRContext *context, AIE::DeviceOp deviceOp,
                           const Path &tempDir, bool enableCtrlPkt) {
   auto copy = cast<ModuleOp>(deviceOp.getParentOp()->clone());
   deviceOp = *copy.getOps<AIE::DeviceOp>().begin();
-  if (failed(mlir::iree_compiler::AMDAIE::AIETranslateToCDODirect(
-          deviceOp, tempDir.string(), enableCtrlPkt))) {
-    llvm::errs() << "failed to emit CDO";
-    return failure();
+  {
+    std::lock_guard<std::mutex> lock(getCDOAndBootgenMutex());
+    if (failed(mlir::iree_compiler::AMDAIE::AIETranslateToCDODirect(
+            deviceOp, tempDir.string(), enableCtrlPkt))) {
+      llvm::errs() << "failed to emit CDO";
+      return failure();
+    }
   }
   copy->erase();
   return success();
@@ -1070,6 +1160,7 @@ LogicalResult generatePDI(const std::string &Output, const Path &tempDir,
     for (const auto &inputFlag : flags) {
       cstrings.push_back(const_cast<char *>(inputFlag.c_str()));
     }
+    std::lock_guard<std::mutex> lock(getCDOAndBootgenMutex());
     if (iree_aie_bootgen_main(cstrings.size(),
                               const_cast<const char **>(&cstrings[0]))) {
       llvm::errs() << "failed to execute bootgen";
@@ -1329,6 +1420,79 @@ LogicalResult checkStackSize(const std::string &outputFile, bool verbose,
   return success();
 }
 
+/// Optimizes `inputFile`, holding either LLVM bitcode or textual LLVM IR, with
+/// the Peano `opt` and compiles the result to the object `outputFile` with the
+/// Peano `llc`. The optimized module is passed between the two as bitcode.
+LogicalResult optimizeAndCompileUsingPeano(
+    const std::string &inputFile, const std::string &outputFile,
+    const std::vector<std::string> &optArgs, const std::string &targetArch,
+    Path &tempDir, Path &peanoDir, bool verbose) {
+  Path peanoOptBin = peanoDir / "bin" / "opt";
+  Path peanoLLCBin = peanoDir / "bin" / "llc";
+  std::string optLLVMIRFile = (tempDir / "input.opt.bc").string();
+
+  std::vector<std::string> peanoArgs = optArgs;
+  // Source file, IR to optimize
+  peanoArgs.emplace_back(inputFile);
+  // Output file, optimized IR
+  peanoArgs.emplace_back("-o");
+  peanoArgs.emplace_back(optLLVMIRFile);
+  if (failed(runTool(peanoOptBin.string(), peanoArgs, verbose))) {
+    llvm::errs() << "Failed to optimize " << inputFile << " with peano\n";
+    llvm::errs() << "Using peano at provided path: '" << peanoDir.string()
+                 << "'\n";
+    return failure();
+  }
+
+  std::vector<std::string> llcArgs{optLLVMIRFile,
+                                   "-O2",
+                                   "--march=" + StringRef(targetArch).lower(),
+                                   "--function-sections",
+                                   "--filetype=obj",
+                                   "-o",
+                                   outputFile,
+                                   "--stack-size-section"};
+  if (failed(runTool(peanoLLCBin.string(), llcArgs, verbose))) {
+    llvm::errs() << "Failed to assemble " << optLLVMIRFile << " with peano\n";
+    return failure();
+  }
+  return success();
+}
+
+/// Returns true if the `opt` of the Peano installation `peanoDir` reads the
+/// bitcode written by the LLVM the compiler is built with. Checked once per
+/// installation, on an empty module.
+bool peanoReadsBitcode(Path &peanoDir, Path &tempDir, bool verbose) {
+  static std::mutex mutex;
+  static std::map<std::string, bool> results;
+  std::lock_guard<std::mutex> guard(mutex);
+  auto it = results.find(peanoDir.string());
+  if (it != results.end()) return it->second;
+
+  llvm::LLVMContext llvmContext;
+  llvm::Module probeModule("probe", llvmContext);
+  std::string probeFile = (tempDir / "probe.bc").string();
+  std::error_code ec;
+  llvm::raw_fd_ostream probeOutput(probeFile, ec);
+  if (!ec) {
+    llvm::WriteBitcodeToFile(probeModule, probeOutput);
+    probeOutput.close();
+    ec = probeOutput.error();
+  }
+  // Not a property of Peano, so not remembered.
+  if (ec) return false;
+  std::vector<std::string> optArgs{probeFile, "-o",
+                                   (tempDir / "probe.opt.bc").string()};
+  bool readsBitcode = succeeded(
+      runTool((peanoDir / "bin" / "opt").string(), optArgs, verbose));
+  if (!readsBitcode) {
+    llvm::errs() << "Peano at '" << peanoDir.string()
+                 << "' can't read bitcode, using textual LLVM IR\n";
+  }
+  results[peanoDir.string()] = readsBitcode;
+  return readsBitcode;
+}
+
 LogicalResult generateUnifiedObject(
     MLIRContext *context, AIE::DeviceOp deviceOp, const std::string &outputFile,
     bool printIRBeforeAll, bool printIRAfterAll, bool printIRModuleScope,
@@ -1368,15 +1532,18 @@ LogicalResult generateUnifiedObject(
     return failure();
   }
 
-  std::string inputLLStr;
-  {
+  auto printLLVMModule = [&]() {
+    std::string inputLLStr;
     llvm::raw_string_ostream rso(inputLLStr);
     llvmModule->print(rso, nullptr);
-  }
+    return inputLLStr;
+  };
 
   if (useChess) {
     FailureOr<Path> maybeVitisDir = findVitis(vitisDir, npuVersion);
     if (failed(maybeVitisDir)) return failure();
+    // chess-clang is based on an older LLVM and only reads textual IR.
+    std::string inputLLStr = printLLVMModule();
     FailureOr<Path> objFilePath = assembleStringUsingChess(
         /*inputFileStr=*/inputLLStr,
         /*inputFileName=*/"input.ll",
@@ -1391,19 +1558,8 @@ LogicalResult generateUnifiedObject(
       return failure();
     }
   } else {
-    std::string LLVMIRFile = (tempDir / "input.ll").string();
-    if (auto maybeErr = dumpStrToDisk(inputLLStr, LLVMIRFile);
-        maybeErr.has_value()) {
-      llvm::errs() << "Failed to dump to disk input.ll"
-                   << " because: " << maybeErr;
-      return failure();
-    }
-    Path peanoOptBin = peanoDir / "bin" / "opt";
-    Path peanoLLCBin = peanoDir / "bin" / "llc";
     Path peanoReadElfBin = peanoDir / "bin" / "llvm-readelf";
 
-    std::string OptLLVMIRFile = (tempDir / "input.opt.ll").string();
-
     FailureOr<std::vector<std::string>> maybeAdditionalPeanoArgs =
         mlir::iree_compiler::AMDAIE::detail::flagStringToVector(
             additionalPeanoOptFlags);
@@ -1420,32 +1576,53 @@ LogicalResult generateUnifiedObject(
       return failure();
     }
     std::vector<std::string> peanoArgs = maybePeanoArgs.value();
-    // Source file, IR to optimize
-    peanoArgs.emplace_back("-S");
-    peanoArgs.emplace_back(LLVMIRFile);
-    // Output file, optimized IR
-    peanoArgs.emplace_back("-o");
-    peanoArgs.emplace_back(OptLLVMIRFile);
-
-    if (failed(runTool(peanoOptBin.string(), peanoArgs, verbose))) {
-      llvm::errs() << "Failed to optimize ll with peano\n";
-      llvm::errs() << "Using peano at provided path: '" << peanoDir.string()
-                   << "'\n";
-      return failure();
+
+    // Hand the module to Peano as bitcode, which is much cheaper to write and
+    // read than textual IR for large designs. The bitcode is written by the
+    // LLVM the compiler is built with, which an older Peano can't read, so
+    // textual IR is used if Peano can't read bitcode or writing it fails. The
+    // probe only shows that Peano reads an empty module, so textual IR is also
+    // tried if Peano fails on the bitcode of the actual module.
+    std::string bitcodeFile;
+    if (peanoReadsBitcode(peanoDir, tempDir, verbose)) {
+      std::string file = (tempDir / "input.bc").string();
+      std::error_code ec;
+      llvm::raw_fd_ostream bitcodeOutput(file, ec);
+      if (!ec) {
+        llvm::WriteBitcodeToFile(*llvmModule, bitcodeOutput);
+        bitcodeOutput.close();
+        ec = bitcodeOutput.error();
+      }
+      if (ec) {
+        llvm::errs() << "Failed to dump to disk input.bc because: "
+                     << ec.message() << ", using textual LLVM IR instead\n";
+      } else {
+        bitcodeFile = file;
+      }
     }
 
-    std::vector<std::string> llcArgs{OptLLVMIRFile,
-                                     "-O2",
-                                     "--march=" + StringRef(targetArch).lower(),
-                                     "--function-sections",
-                                     "--filetype=obj",
-                                     "-o",
-                                     outputFile,
-                                     "--stack-size-section"};
-
-    if (failed(runTool(peanoLLCBin.string(), llcArgs, verbose))) {
-      llvm::errs() << "Failed to assemble ll with peano\n";
-      return failure();
+    bool compiled = false;
+    if (!bitcodeFile.empty()) {
+      compiled = succeeded(optimizeAndCompileUsingPeano(
+          bitcodeFile, outputFile, peanoArgs, targetArch, tempDir, peanoDir,
+          verbose));
+      if (!compiled) {
+        llvm::errs() << "Retrying with textual LLVM IR instead of bitcode\n";
+      }
+    }
+    if (!compiled) {
+      std::string LLVMIRFile = (tempDir / "input.ll").string();
+      if (auto maybeErr = dumpStrToDisk(printLLVMModule(), LLVMIRFile);
+          maybeErr.has_value()) {
+        llvm::errs() << "Failed to dump to disk input.ll"
+                     << " because: " << maybeErr;
+        return failure();
+      }
+      if (failed(optimizeAndCompileUsingPeano(LLVMIRFile, outputFile,
+                                              peanoArgs, targetArch, tempDir,
+                                              peanoDir, verbose))) {
+        return failure();
+      }
     }
 
     // If this is not windows, we can do this check. On windows checkTool
@@ -1482,6 +1659,7 @@ LogicalResult generateControlPackets(
   {
     AMDAIEConvertDeviceToControlPacketsOptions options;
     options.pathToElfs = tempDirPath.string();
+    options.compactTransaction = true;
     pm.addPass(createAMDAIEConvertDeviceToControlPacketsPass(options));
   }
   // TODO (zhewen): avoid regeneration?
@@ -1509,7 +1687,11 @@ LogicalResult generateControlPackets(
   pm.addPass(createAMDAIEFoldDmaWaitsPass());
   // Lower the DMA instructions for sending control packets.
   pm.addPass(createAMDAIEControlCodeLoweringPass());
-  pm.addPass(createAMDAIEControlCodeToTransactionPass());
+  {
+    AMDAIEControlCodeToTransactionOptions options;
+    options.compactTransaction = true;
+    pm.addPass(createAMDAIEControlCodeToTransactionPass(options));
+  }
 
   // Run the pipeline.
   auto targetAttr = IREE::HAL::ExecutableTargetAttr::lookup(deviceOp);
@@ -1578,6 +1760,43 @@ LogicalResult emitDenseArrayAttrToFile(Operation *op, StringRef attrName,
   return success();
 }
 
+namespace detail {
+
+LogicalResult runCoreLinkJobs(ArrayRef<CoreLinkJob> jobs,
+                              llvm::ThreadPoolInterface *threadPool) {
+  // Jobs run on the thread pool, so failures are only reported once all of
+  // them have completed.
+  SmallVector<char> succeededJobs(jobs.size(), true);
+  auto runJob = [&jobs, &succeededJobs](size_t i) {
+    const CoreLinkJob &job = jobs[i];
+    succeededJobs[i] =
+        succeeded(runTool(job.program, job.args, job.verbose, job.env));
+  };
+  if (threadPool) {
+    // Only wait for this call's jobs: the pool may be running other work, and
+    // waiting on a group from one of its workers runs the group's tasks
+    // rather than blocking the worker.
+    llvm::ThreadPoolTaskGroup group(*threadPool);
+    for (size_t i = 0; i < jobs.size(); ++i) {
+      group.async(runJob, i);
+    }
+    group.wait();
+  } else {
+    for (size_t i = 0; i < jobs.size(); ++i) runJob(i);
+  }
+
+  bool allSucceeded = true;
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    if (succeededJobs[i]) continue;
+    llvm::errs() << "failed to generate elf for core: (" << jobs[i].col << ", "
+                 << jobs[i].row << ")\n";
+    allSucceeded = false;
+  }
+  return success(allSucceeded);
+}
+
+}  // namespace detail
+
 LogicalResult aie2xclbin(
     MLIRContext *ctx, AIE::DeviceOp deviceOp,
     const std::optional<std::string> &outputNpuInstPath,
@@ -1593,7 +1812,8 @@ LogicalResult aie2xclbin(
     const std::string &xclBinKernelID, const std::string &xclBinKernelName,
     const std::string &xclBinInstanceName, const std::string &amdAIEInstallDir,
     const std::optional<std::string> &InputXCLBin,
-    const std::string &additionalPeanoOptFlags, bool enableCtrlPkt) {
+    const std::string &additionalPeanoOptFlags, bool enableCtrlPkt,
+    ArtifactCache *ukernelCache) {
   if (outputNpuInstPath.has_value() &&
       failed(emitDenseArrayAttrToFile(deviceOp, "npu_instructions",
                                       outputNpuInstPath.value()))) {
@@ -1619,7 +1839,8 @@ LogicalResult aie2xclbin(
 
   if (failed(generateCoreElfFiles(deviceOp, unifiedObj.string(), tempDirPath,
                                   useChess, useChessForUKernel, vitisDirPath,
-                                  targetArch, verbose, peanoDir, npuVersion))) {
+                                  targetArch, verbose, peanoDir, npuVersion,
+                                  ukernelCache, ctx))) {
     llvm::errs() << "Failed to generate core ELF file(s)\n";
     return failure();
   }
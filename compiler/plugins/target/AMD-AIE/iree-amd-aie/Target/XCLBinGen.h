@@ -5,12 +5,17 @@
 // SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 #pragma once
 
+#include <filesystem>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "AIETarget.h"
+#include "ArtifactCache.h"
 #include "aie/AIEDialect.h"
 #include "iree/compiler/Dialect/HAL/IR/HALDialect.h"
 #include "iree/compiler/Dialect/HAL/IR/HALTypes.h"
+#include "llvm/Support/ThreadPool.h"
 #include "mlir/Support/LogicalResult.h"
 
 namespace mlir::iree_compiler::AMDAIE {
@@ -29,7 +34,16 @@ mlir::LogicalResult aie2xclbin(
     const std::string &xclBinKernelID, const std::string &xclBinKernelName,
     const std::string &xclBinInstanceName, const std::string &amdAIEInstallDir,
     const std::optional<std::string> &InputXCLBin,
-    const std::string &additionalPeanoOptFlags, bool enableCtrlPkt);
+    const std::string &additionalPeanoOptFlags, bool enableCtrlPkt,
+    ArtifactCache *ukernelCache = nullptr);
+
+/// Returns the Vitis installation found through the `v++` on the PATH, if the
+/// VITIS environment variable isn't set.
+std::optional<std::string> discoverVitis();
+
+/// Returns the path of the chess compiler `aie2xclbin` runs from the Vitis
+/// installation `vitisDir`.
+std::string getChessCompilerPath(const std::string &vitisDir);
 
 mlir::LogicalResult emitDenseArrayAttrToFile(Operation *op, StringRef attrName,
                                              StringRef fileName);
@@ -63,5 +77,21 @@ std::optional<int> safeStoi(std::string_view intString);
 FailureOr<llvm::DenseMap<std::pair<uint32_t, uint32_t>, uint32_t>>
 getUpperBoundStackSizes(const std::string &);
 
+/// The link of the ELF of one core.
+struct CoreLinkJob {
+  std::string program;
+  std::vector<std::string> args;
+  std::optional<std::vector<std::string>> env;
+  std::filesystem::path elfFile;
+  bool verbose = false;
+  /// The core, for error reporting.
+  int col = 0;
+  int row = 0;
+};
+
+/// Runs the link jobs on `threadPool`, or on the calling thread if it is null.
+LogicalResult runCoreLinkJobs(ArrayRef<CoreLinkJob> jobs,
+                              llvm::ThreadPoolInterface *threadPool);
+
 }  // namespace detail
 }  // namespace mlir::iree_compiler::AMDAIE
@@ -4,8 +4,15 @@
 // See https://llvm.org/LICENSE.txt for license information.
 // SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
 #include "gtest/gtest.h"
 #include "iree-amd-aie/Target/XCLBinGen.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ThreadPool.h"
 
 namespace {
 
@@ -125,6 +132,61 @@ TEST(XCLBinGenTest, GetStackSize0) {
   }
 }
 
+#ifndef _WIN32
+// Links with a stub toolchain which records each of its invocations and writes
+// the arguments it was called with to its output file.
+TEST(XCLBinGenTest, RunCoreLinkJobs) {
+  llvm::SmallString<128> tempDirStr;
+  ASSERT_FALSE(
+      llvm::sys::fs::createUniqueDirectory("core-link-jobs", tempDirStr));
+  std::filesystem::path tempDir(tempDirStr.str().str());
+  std::filesystem::path stub = tempDir / "stub-clang";
+  std::filesystem::path invocations = tempDir / "invocations";
+  {
+    std::ofstream stubFile(stub);
+    stubFile << "#!/bin/sh\n"
+             << "echo \"$@\" >> " << invocations.string() << "\n"
+             << "while [ $# -gt 1 ]; do\n"
+             << "  if [ \"$1\" = -o ]; then echo \"$2\" > \"$2\"; fi\n"
+             << "  shift\n"
+             << "done\n";
+  }
+  std::filesystem::permissions(stub, std::filesystem::perms::owner_all);
+
+  llvm::DefaultThreadPool threadPool(llvm::hardware_concurrency(4));
+  std::vector<detail::CoreLinkJob> jobs;
+  for (int i = 0; i < 8; ++i) {
+    detail::CoreLinkJob job;
+    job.program = stub.string();
+    job.elfFile = tempDir / ("core_0_" + std::to_string(i) + ".elf");
+    job.args = {"input.o", "-o", job.elfFile.string()};
+    job.col = 0;
+    job.row = i;
+    jobs.push_back(std::move(job));
+  }
+  EXPECT_TRUE(mlir::succeeded(detail::runCoreLinkJobs(jobs, &threadPool)));
+
+  std::ifstream invocationsFile(invocations);
+  std::stringstream invocationsStream;
+  invocationsStream << invocationsFile.rdbuf();
+  std::string invocationsStr = invocationsStream.str();
+  EXPECT_EQ(std::count(invocationsStr.begin(), invocationsStr.end(), '\n'), 8);
+  // Every core gets its own ELF.
+  for (int i = 0; i < 8; ++i) {
+    std::ifstream elf(jobs[i].elfFile);
+    std::string contents;
+    std::getline(elf, contents);
+    EXPECT_EQ(contents, jobs[i].elfFile.string());
+  }
+
+  // A single failing link fails the whole set.
+  jobs[0].program = (tempDir / "missing-clang").string();
+  EXPECT_TRUE(mlir::failed(detail::runCoreLinkJobs(jobs, &threadPool)));
+
+  std::filesystem::remove_all(tempDir);
+}
+#endif  // _WIN32
+
 }  // namespace
 
 int main(int argc, char **argv) {
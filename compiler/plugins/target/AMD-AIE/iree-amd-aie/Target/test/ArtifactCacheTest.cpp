@@ -0,0 +1,182 @@
+// Copyright 2025 The IREE Authors
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "iree-amd-aie/Target/ArtifactCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+
+namespace {
+
+using namespace mlir::iree_compiler::AMDAIE;
+using Path = std::filesystem::path;
+
+void writeFile(const Path &path, const std::string &contents) {
+  std::ofstream file(path, std::ios::binary);
+  file << contents;
+}
+
+std::string readFile(const Path &path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+class ArtifactCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    llvm::SmallString<128> tempDirStr;
+    ASSERT_FALSE(
+        llvm::sys::fs::createUniqueDirectory("artifact-cache", tempDirStr));
+    tempDir = tempDirStr.str().str();
+    cacheDir = tempDir / "cache";
+  }
+
+  void TearDown() override { std::filesystem::remove_all(tempDir); }
+
+  Path tempDir;
+  Path cacheDir;
+};
+
+TEST(ArtifactCacheKeyTest, ComputeKey) {
+  std::string key = ArtifactCache::computeKey({"a", "bc"});
+  EXPECT_EQ(key.size(), 64);
+  EXPECT_EQ(key, ArtifactCache::computeKey({"a", "bc"}));
+  // The same bytes split differently must give a different key.
+  EXPECT_NE(key, ArtifactCache::computeKey({"ab", "c"}));
+  EXPECT_NE(key, ArtifactCache::computeKey({"abc"}));
+  EXPECT_NE(key, ArtifactCache::computeKey({"a", "bc", ""}));
+}
+
+TEST_F(ArtifactCacheTest, DescribeFile) {
+  Path tool = tempDir / "tool";
+  EXPECT_EQ(ArtifactCache::describeFile(tool.string()),
+            tool.string() + ":missing");
+  writeFile(tool, "v1");
+  std::string v1 = ArtifactCache::describeFile(tool.string());
+  EXPECT_EQ(v1, ArtifactCache::describeFile(tool.string()));
+  writeFile(tool, "version 2");
+  EXPECT_NE(v1, ArtifactCache::describeFile(tool.string()));
+}
+
+TEST_F(ArtifactCacheTest, MissInsertHit) {
+  ArtifactCache cache(cacheDir.string(), /*maxSizeInBytes=*/1 << 20);
+  Path artifact = tempDir / "artifact.pdi";
+  Path insts = tempDir / "npu_inst.txt";
+  std::vector<ArtifactCache::File> files = {
+      {"artifact", artifact.string()}, {"npu_inst.txt", insts.string()}};
+  std::string key = ArtifactCache::computeKey({"kernel"});
+
+  EXPECT_FALSE(cache.lookup(key, files));
+  writeFile(artifact, "pdi contents");
+  writeFile(insts, "instructions");
+  EXPECT_TRUE(mlir::succeeded(cache.insert(key, files)));
+
+  std::filesystem::remove(artifact);
+  std::filesystem::remove(insts);
+  EXPECT_TRUE(cache.lookup(key, files));
+  EXPECT_EQ(readFile(artifact), "pdi contents");
+  EXPECT_EQ(readFile(insts), "instructions");
+
+  // Inserting an existing entry is a no-op.
+  EXPECT_TRUE(mlir::succeeded(cache.insert(key, files)));
+
+  ArtifactCache::Stats stats = cache.getStats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.evictions, 0);
+}
+
+TEST_F(ArtifactCacheTest, IncompleteEntryIsMiss) {
+  ArtifactCache cache(cacheDir.string(), /*maxSizeInBytes=*/1 << 20);
+  Path artifact = tempDir / "artifact.pdi";
+  writeFile(artifact, "pdi contents");
+  std::string key = ArtifactCache::computeKey({"kernel"});
+  EXPECT_TRUE(
+      mlir::succeeded(cache.insert(key, {{"artifact", artifact.string()}})));
+
+  // The lookup expects a file that the entry doesn't have.
+  Path insts = tempDir / "npu_inst.txt";
+  EXPECT_FALSE(cache.lookup(
+      key, {{"artifact", artifact.string()}, {"npu_inst.txt", insts.string()}}));
+  EXPECT_EQ(cache.getStats().misses, 1);
+}
+
+TEST_F(ArtifactCacheTest, EvictsLeastRecentlyUsed) {
+  // Room for two entries of 100 bytes.
+  ArtifactCache cache(cacheDir.string(), /*maxSizeInBytes=*/250);
+  Path artifact = tempDir / "artifact";
+  std::vector<ArtifactCache::File> files = {{"artifact", artifact.string()}};
+  std::string keys[3] = {ArtifactCache::computeKey({"0"}),
+                         ArtifactCache::computeKey({"1"}),
+                         ArtifactCache::computeKey({"2"})};
+
+  auto now = std::filesystem::file_time_type::clock::now();
+  for (int i = 0; i < 2; ++i) {
+    writeFile(artifact, std::string(100, '0' + i));
+    ASSERT_TRUE(mlir::succeeded(cache.insert(keys[i], files)));
+  }
+  // Entry 0 is used more recently than entry 1.
+  std::filesystem::last_write_time(cacheDir / keys[1],
+                                   now - std::chrono::hours(2));
+  std::filesystem::last_write_time(cacheDir / keys[0],
+                                   now - std::chrono::hours(1));
+
+  writeFile(artifact, std::string(100, '2'));
+  ASSERT_TRUE(mlir::succeeded(cache.insert(keys[2], files)));
+  EXPECT_EQ(cache.getStats().evictions, 1);
+  EXPECT_TRUE(std::filesystem::exists(cacheDir / keys[0]));
+  EXPECT_FALSE(std::filesystem::exists(cacheDir / keys[1]));
+  EXPECT_TRUE(std::filesystem::exists(cacheDir / keys[2]));
+
+  EXPECT_TRUE(cache.lookup(keys[0], files));
+  EXPECT_EQ(readFile(artifact), std::string(100, '0'));
+  EXPECT_FALSE(cache.lookup(keys[1], files));
+}
+
+TEST_F(ArtifactCacheTest, OnlyScansWhenFull) {
+  ArtifactCache cache(cacheDir.string(), /*maxSizeInBytes=*/250);
+  Path artifact = tempDir / "artifact";
+  std::vector<ArtifactCache::File> files = {{"artifact", artifact.string()}};
+  writeFile(artifact, std::string(100, '0'));
+  ASSERT_TRUE(mlir::succeeded(
+      cache.insert(ArtifactCache::computeKey({"0"}), files)));
+
+  // Left behind by a crashed insertion, and by one still in progress.
+  Path staleTemp = cacheDir / ".tmp-stale";
+  Path freshTemp = cacheDir / ".tmp-fresh";
+  std::filesystem::create_directory(staleTemp);
+  std::filesystem::create_directory(freshTemp);
+  std::filesystem::last_write_time(
+      staleTemp,
+      std::filesystem::file_time_type::clock::now() - std::chrono::hours(2));
+
+  // The cache still fits, so the directory isn't scanned.
+  writeFile(artifact, std::string(100, '1'));
+  ASSERT_TRUE(mlir::succeeded(
+      cache.insert(ArtifactCache::computeKey({"1"}), files)));
+  EXPECT_TRUE(std::filesystem::exists(staleTemp));
+
+  // The scan once the cache is full deletes the stale temporary directory.
+  writeFile(artifact, std::string(100, '2'));
+  ASSERT_TRUE(mlir::succeeded(
+      cache.insert(ArtifactCache::computeKey({"2"}), files)));
+  EXPECT_EQ(cache.getStats().evictions, 1);
+  EXPECT_FALSE(std::filesystem::exists(staleTemp));
+  EXPECT_TRUE(std::filesystem::exists(freshTemp));
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
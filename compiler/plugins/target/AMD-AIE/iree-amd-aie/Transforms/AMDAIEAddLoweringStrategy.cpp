@@ -7,6 +7,7 @@
 #include "iree-amd-aie/IR/AMDAIEDialect.h"
 #include "iree-amd-aie/Transforms/KernelDispatch.h"
 #include "iree-amd-aie/Transforms/Passes.h"
+#include "iree-amd-aie/Transforms/Utils/AMDAIETuningDatabase.h"
 #include "iree/compiler/Codegen/Dialect/Codegen/IR/IREECodegenDialect.h"
 #include "iree/compiler/Dialect/HAL/IR/HALDialect.h"
 #include "iree/compiler/Dialect/LinalgExt/IR/LinalgExtDialect.h"
@@ -50,15 +51,49 @@ class AMDAIELoweringStrategyPass
 void AMDAIELoweringStrategyPass::runOnOperation() {
   ModuleOp moduleOp = getOperation();
 
+  TuningDatabase tuningDatabase;
+  if (!tuningDatabasePath.empty()) {
+    std::string errorMessage;
+    FailureOr<TuningDatabase> maybeTuningDatabase =
+        TuningDatabase::load(tuningDatabasePath, errorMessage);
+    if (failed(maybeTuningDatabase)) {
+      moduleOp.emitError() << errorMessage;
+      return signalPassFailure();
+    }
+    tuningDatabase = std::move(maybeTuningDatabase.value());
+  }
+
   for (auto funcOp : moduleOp.getOps<FunctionOpInterface>()) {
-    // Set the strategy with default heuristics.
+    // Set the strategy with the tuning records or default heuristics.
     if (failed(initAIELaunchConfig(funcOp, useTilePipeline,
                                    useLowerToAIEPipeline, targetDevice, numRows,
-                                   numCols, enableAMDAIEUkernels))) {
+                                   numCols, enableAMDAIEUkernels,
+                                   tileSizeSelection, tuningDatabase))) {
       funcOp.emitOpError("failed to have a lowering configuration set for it.");
       return signalPassFailure();
     }
   }
+
+  if (!tuningExportPath.empty()) {
+    // Export the buffer depths and outlining strategy the dispatches are
+    // lowered with, also where they don't come from a tuning record.
+    SmallVector<TuningRecord> selections(tuningDatabase.getSelections());
+    for (TuningRecord &selection : selections) {
+      TuningConfig &config = selection.config;
+      if (!config.bufferDepths) {
+        config.bufferDepths = {static_cast<uint32_t>(l3BufferDepth),
+                               static_cast<uint32_t>(l2BufferDepth),
+                               static_cast<uint32_t>(l1BufferDepth)};
+      }
+      if (!config.outlining) config.outlining = outliningStrategy;
+    }
+    std::string errorMessage;
+    if (failed(TuningDatabase::append(tuningExportPath, selections,
+                                      errorMessage))) {
+      moduleOp.emitError() << errorMessage;
+      return signalPassFailure();
+    }
+  }
 }
 
 std::unique_ptr<OperationPass<ModuleOp>> createAMDAIELoweringStrategyPass(
@@ -4,6 +4,8 @@
 // See https://llvm.org/LICENSE.txt for license information.
 // SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 
+#include <limits>
+
 #include "iree-amd-aie/IR/AMDAIEOps.h"
 #include "iree-amd-aie/Transforms/Passes.h"
 #include "iree-amd-aie/Transforms/Transforms.h"
@@ -89,6 +91,26 @@ FailureOr<SmallVector<PhysPortType>> getAllPhysPortTypes(
   return physPortTypes;
 }
 
+/// Returns the number of circuit connections allowed for a physical port type,
+/// i.e. the number of channels available.
+FailureOr<uint32_t> getNumChannels(const AMDAIEDeviceModel &deviceModel,
+                                   const PhysPortType &b) {
+  // Cannot just use `getNumSource/DestSwitchBoxConnections` due to shimmux.
+  if (b.portType == AMDAIE::StrmSwPortType::DMA) {
+    AMDAIETileType tileType =
+        deviceModel.getTileType(b.tileLoc.col, b.tileLoc.row);
+    FailureOr<uint8_t> maybeNumChannels =
+        deviceModel.getDmaProp<uint8_t>(tileType, AMDAIEDmaProp::NumChannels);
+    if (failed(maybeNumChannels)) return failure();
+    return *maybeNumChannels;
+  }
+  return (b.direction == AMDAIE::DMAChannelDir::MM2S)
+             ? deviceModel.getNumSourceSwitchBoxConnections(
+                   b.tileLoc.col, b.tileLoc.row, b.portType)
+             : deviceModel.getNumDestSwitchBoxConnections(
+                   b.tileLoc.col, b.tileLoc.row, b.portType);
+}
+
 void updateConnectionType(IRRewriter &rewriter,
                           AMDAIE::ConnectionOp connectionOp,
                           AMDAIE::ConnectionType connectionType) {
@@ -140,21 +162,9 @@ LogicalResult congestionAwareAutoAssignment(Operation *parentOp,
   DenseMap<PhysPortType, uint32_t> circuitUsage, packetUsage, maxCircuitUsage;
   auto getOrInitMaxUsage = [&](const PhysPortType &b) -> FailureOr<uint32_t> {
     if (maxCircuitUsage.count(b)) return maxCircuitUsage[b];
-    // Cannot just use `getNumSource/DestSwitchBoxConnections` due to shimmux.
-    if (b.portType == AMDAIE::StrmSwPortType::DMA) {
-      AMDAIETileType tileType =
-          deviceModel.getTileType(b.tileLoc.col, b.tileLoc.row);
-      FailureOr<uint8_t> maybeNumChannels =
-          deviceModel.getDmaProp<uint8_t>(tileType, AMDAIEDmaProp::NumChannels);
-      if (failed(maybeNumChannels)) return failure();
-      maxCircuitUsage[b] = *maybeNumChannels;
-    } else {
-      maxCircuitUsage[b] = (b.direction == AMDAIE::DMAChannelDir::MM2S)
-                               ? deviceModel.getNumSourceSwitchBoxConnections(
-                                     b.tileLoc.col, b.tileLoc.row, b.portType)
-                               : deviceModel.getNumDestSwitchBoxConnections(
-                                     b.tileLoc.col, b.tileLoc.row, b.portType);
-    }
+    FailureOr<uint32_t> maybeNumChannels = getNumChannels(deviceModel, b);
+    if (failed(maybeNumChannels)) return failure();
+    maxCircuitUsage[b] = *maybeNumChannels;
     return maxCircuitUsage[b];
   };
 
@@ -213,6 +223,191 @@ LogicalResult congestionAwareAutoAssignment(Operation *parentOp,
   return success();
 }
 
+/// The maximum number of iterations of a dry run of the router. Routable
+/// connections are typically routed within a few iterations, so not finding a
+/// routing within this many is treated as congestion.
+constexpr int kDryRunMaxIterations = 100;
+
+/// Returns whether `router` finds a routing through the switchbox network for
+/// the connections with the given types, replacing the flows of any previous
+/// dry run. As channels aren't assigned yet, the circuit connections of a
+/// physical port type use consecutive channels and its packet connections
+/// share the next one.
+bool isRoutable(Router &router,
+                ArrayRef<SmallVector<PhysPortType>> connectionPorts,
+                ArrayRef<AMDAIE::ConnectionType> connectionTypes) {
+  DenseMap<PhysPortType, int> numCircuitChannels;
+  SmallVector<SmallVector<int>> channels(connectionPorts.size());
+  for (auto [ports, connectionType, portChannels] :
+       llvm::zip(connectionPorts, connectionTypes, channels)) {
+    for (const PhysPortType &port : ports) {
+      portChannels.push_back(connectionType == AMDAIE::ConnectionType::Circuit
+                                 ? numCircuitChannels[port]++
+                                 : -1);
+    }
+  }
+
+  router.clearFlows();
+  for (auto [ports, connectionType, portChannels] :
+       llvm::zip(connectionPorts, connectionTypes, channels)) {
+    bool isPacketFlow = connectionType == AMDAIE::ConnectionType::Packet;
+    auto getPort = [&](size_t index) {
+      const PhysPortType &port = ports[index];
+      int channel = isPacketFlow ? numCircuitChannels.lookup(port)
+                                 : portChannels[index];
+      return Port{port.portType, channel};
+    };
+    for (auto [i, src] : llvm::enumerate(ports)) {
+      if (src.direction != AMDAIE::DMAChannelDir::MM2S) continue;
+      for (auto [j, dst] : llvm::enumerate(ports)) {
+        if (dst.direction != AMDAIE::DMAChannelDir::S2MM) continue;
+        router.addFlow(src.tileLoc, getPort(i), dst.tileLoc, getPort(j),
+                       isPacketFlow);
+      }
+    }
+  }
+  return router.findPaths(kDryRunMaxIterations).has_value();
+}
+
+/// Returns the number of bytes the connection moves per transfer, which is
+/// used as an estimate of its bandwidth.
+int64_t getTransferSizeInBytes(AMDAIE::ConnectionOp connectionOp) {
+  int64_t size = std::numeric_limits<int64_t>::max();
+  for (Value value : {connectionOp.getSource(), connectionOp.getTarget()}) {
+    auto logicalObjFifo =
+        dyn_cast_if_present<AMDAIE::LogicalObjFifoOpInterface>(
+            value.getDefiningOp());
+    if (!logicalObjFifo) continue;
+    MemRefType memrefType = logicalObjFifo.getMemrefType();
+    size = std::min(size, memrefType.getNumElements() *
+                              memrefType.getElementTypeBitWidth() / 8);
+  }
+  return size;
+}
+
+/// Assigns connection types to the circuit mode, as long as the router finds a
+/// routing for the circuit connections. Otherwise, connections are moved to
+/// the packet mode one by one, lowest bandwidth first, until it does. This is
+/// greedy: it keeps the high-bandwidth connections in the circuit mode, but
+/// may move more connections than necessary. The channel counts of the ports
+/// are checked first, as they are much cheaper to check, and only the
+/// connections using an over-subscribed port are moved to the packet mode to
+/// fix them. All dry runs share one router, so that the routing graph is only
+/// built once, and the router rips up and reroutes incrementally, so that the
+/// iterations of a dry run only reroute the flows that run into congestion.
+LogicalResult routerValidatedAutoAssignment(Operation *parentOp,
+                                            IRRewriter &rewriter) {
+  OpBuilder::InsertionGuard g(rewriter);
+  // Get the device model.
+  auto targetAttr = IREE::HAL::ExecutableTargetAttr::lookup(parentOp);
+  std::optional<AMDAIEDevice> maybeDevice = getConfigAMDAIEDevice(targetAttr);
+  if (!maybeDevice) {
+    return parentOp->emitOpError()
+           << "has no AMDAIEDevice in the target attribute configuration.";
+  }
+  AMDAIEDeviceModel deviceModel = AMDAIE::getDeviceModel(maybeDevice.value());
+
+  TileLoc maxTileLoc(0, 0);
+  parentOp->walk([&](AMDAIE::TileOp tileOp) {
+    maxTileLoc.col = std::max<int>(maxTileLoc.col,
+                                   getConstantIndexOrAssert(tileOp.getCol()));
+    maxTileLoc.row = std::max<int>(maxTileLoc.row,
+                                   getConstantIndexOrAssert(tileOp.getRow()));
+  });
+
+  SmallVector<AMDAIE::ConnectionOp> connectionOps;
+  parentOp->walk([&](AMDAIE::ConnectionOp connectionOp) {
+    connectionOps.push_back(connectionOp);
+  });
+  SmallVector<SmallVector<PhysPortType>> connectionPorts;
+  SmallVector<AMDAIE::ConnectionType> connectionTypes;
+  SmallVector<int64_t> transferSizes;
+  DenseMap<PhysPortType, uint32_t> numChannels;
+  for (AMDAIE::ConnectionOp connectionOp : connectionOps) {
+    FailureOr<SmallVector<PhysPortType>> physPortTypes =
+        getAllPhysPortTypes(connectionOp);
+    if (failed(physPortTypes)) return failure();
+    for (PhysPortType &physPortType : *physPortTypes) {
+      if (numChannels.count(physPortType)) continue;
+      FailureOr<uint32_t> maybeNumChannels =
+          getNumChannels(deviceModel, physPortType);
+      if (failed(maybeNumChannels) || *maybeNumChannels == 0) {
+        return connectionOp.emitOpError()
+               << "expected a non-zero number of channels available";
+      }
+      numChannels[physPortType] = *maybeNumChannels;
+    }
+    connectionPorts.push_back(std::move(*physPortTypes));
+    connectionTypes.push_back(connectionOp.getConnectionType().value_or(
+        AMDAIE::ConnectionType::Circuit));
+    transferSizes.push_back(getTransferSizeInBytes(connectionOp));
+  }
+
+  RouterOptions routerOptions;
+  routerOptions.incremental = true;
+  Router router(maxTileLoc.col, maxTileLoc.row, routerOptions);
+  router.initialize(deviceModel);
+
+  while (true) {
+    // A physical port type needs a channel for each of its circuit connections
+    // and one shared by all its packet connections.
+    DenseMap<PhysPortType, uint32_t> circuitUsage, packetUsage;
+    for (auto [ports, connectionType] :
+         llvm::zip(connectionPorts, connectionTypes)) {
+      DenseMap<PhysPortType, uint32_t> &usage =
+          (connectionType == AMDAIE::ConnectionType::Circuit) ? circuitUsage
+                                                              : packetUsage;
+      for (const PhysPortType &port : ports) usage[port]++;
+    }
+    DenseSet<PhysPortType> overSubscribedPorts;
+    for (auto &&[port, maxUsage] : numChannels) {
+      uint32_t usage = circuitUsage.lookup(port) +
+                       (packetUsage.lookup(port) > 0 ? 1 : 0);
+      if (usage > maxUsage) overSubscribedPorts.insert(port);
+    }
+
+    // Select the unassigned circuit connection with the lowest bandwidth,
+    // preferring later ones on ties, among the connections using an
+    // over-subscribed port if any, or else among all if there is no routing.
+    std::optional<size_t> toPacket;
+    auto consider = [&](size_t i) {
+      if (connectionOps[i].getConnectionType().has_value() ||
+          connectionTypes[i] != AMDAIE::ConnectionType::Circuit) {
+        return;
+      }
+      if (!toPacket || transferSizes[i] <= transferSizes[*toPacket])
+        toPacket = i;
+    };
+    if (!overSubscribedPorts.empty()) {
+      for (auto [i, ports] : llvm::enumerate(connectionPorts)) {
+        if (llvm::any_of(ports, [&](const PhysPortType &port) {
+              return overSubscribedPorts.contains(port);
+            })) {
+          consider(i);
+        }
+      }
+    } else if (isRoutable(router, connectionPorts, connectionTypes)) {
+      break;
+    } else {
+      for (size_t i = 0; i < connectionOps.size(); ++i) consider(i);
+    }
+    if (!toPacket) {
+      // Leave it to the router to report the congestion.
+      LLVM_DEBUG(llvm::dbgs() << "no circuit connection left to move to the "
+                                 "packet mode\n");
+      break;
+    }
+    connectionTypes[*toPacket] = AMDAIE::ConnectionType::Packet;
+  }
+
+  for (auto [connectionOp, connectionType] :
+       llvm::zip(connectionOps, connectionTypes)) {
+    if (!connectionOp.getConnectionType().has_value())
+      updateConnectionType(rewriter, connectionOp, connectionType);
+  }
+  return success();
+}
+
 LogicalResult simpleManualAssignment(Operation *parentOp, IRRewriter &rewriter,
                                      PacketFlowStrategy packetFlowStrategy) {
   OpBuilder::InsertionGuard g(rewriter);
@@ -289,6 +484,8 @@ void AMDAIEAssignConnectionTypesPass::runOnOperation() {
   LogicalResult result = success();
   if (packetFlowStrategy == PacketFlowStrategy::Auto) {
     result = congestionAwareAutoAssignment(parentOp, rewriter);
+  } else if (packetFlowStrategy == PacketFlowStrategy::AutoRouted) {
+    result = routerValidatedAutoAssignment(parentOp, rewriter);
   } else {
     result = simpleManualAssignment(parentOp, rewriter, packetFlowStrategy);
   }
@@ -7,6 +7,7 @@
 #include "iree-amd-aie/IR/AMDAIEOps.h"
 #include "iree-amd-aie/Transforms/Passes.h"
 #include "iree-amd-aie/Transforms/Transforms.h"
+#include "iree-amd-aie/Transforms/Utils/AMDAIETuningDatabase.h"
 
 #define DEBUG_TYPE "iree-amdaie-assign-logical-objectfifo-depth"
 
@@ -39,16 +40,20 @@ void AMDAIEAssignLogicalObjectFifoDepthPass::runOnOperation() {
   WalkResult res = parentOp->walk(
       [&](AMDAIE::LogicalObjectFifoFromMemrefOp logicalObjectFifo) {
         uint8_t memSpace = logicalObjectFifo.getMemorySpaceAsUInt();
-        uint8_t bufferDepth{0};
-        if (memSpace == 0) {
-          bufferDepth = l3BufferDepth;
-        } else if (memSpace == 1) {
-          bufferDepth = l2BufferDepth;
-        } else if (memSpace == 2) {
-          bufferDepth = l1BufferDepth;
-        } else {
-          return WalkResult::advance();
+        if (memSpace > 2) return WalkResult::advance();
+        // The buffer depths of a tuning record applied to the dispatch take
+        // precedence over the options.
+        SmallVector<int64_t> bufferDepths = {l3BufferDepth, l2BufferDepth,
+                                             l1BufferDepth};
+        auto funcOp =
+            logicalObjectFifo->getParentOfType<FunctionOpInterface>();
+        if (auto tunedBufferDepths =
+                funcOp ? funcOp->getAttrOfType<DenseI64ArrayAttr>(
+                             kTuningBufferDepthsAttrName)
+                       : nullptr) {
+          bufferDepths = llvm::to_vector(tunedBufferDepths.asArrayRef());
         }
+        uint8_t bufferDepth = bufferDepths[memSpace];
         MemRefType elementType = logicalObjectFifo.getMemrefType();
         rewriter.setInsertionPoint(logicalObjectFifo);
         rewriter.replaceOpWithNewOp<AMDAIE::LogicalObjectFifoFromMemrefOp>(
@@ -75,6 +75,17 @@ std::optional<uint32_t> getNumberIterations(scf::ForOp loop) {
   }
 }
 
+/// Returns the exact number of iterations of `loop` if it is known statically.
+std::optional<uint32_t> getConstantTripCount(scf::ForOp loop) {
+  std::optional<int64_t> lowerBound = getConstantIntValue(loop.getLowerBound());
+  std::optional<int64_t> upperBound = getConstantIntValue(loop.getUpperBound());
+  std::optional<int64_t> step = getConstantIntValue(loop.getStep());
+  if (!lowerBound || !upperBound || !step || *step <= 0) return std::nullopt;
+  if (*upperBound <= *lowerBound) return 0;
+  return llvm::divideCeil(static_cast<uint64_t>(*upperBound - *lowerBound),
+                          static_cast<uint64_t>(*step));
+}
+
 /// A DmaBatch contains the following :-
 ///   1. DmaOps within the current batch.
 ///   2. Required Bd Ids by the current batch.
@@ -237,7 +248,19 @@ struct DmaTileData {
   uint32_t bdIdMapIndex = -1;
 };
 
+/// Statistics about the DMA transfers that can't be in flight at the same time
+/// because there are too few BD IDs to go around.
+struct BdIdPressureStats {
+  int64_t numBdIdLimitedDmaOps = 0;
+  int64_t numExtraDmaWaits = 0;
+};
+
 class BdIdAssignmentUtil {
+  const AMDAIEDeviceModel &deviceModel;
+  // Whether to assign a DMA op in a loop at most as many BD IDs as it can have
+  // transfers in flight.
+  bool capToQueueSize;
+  BdIdPressureStats &stats;
   // A mapping from a shim tile to its BD ID generator.
   DenseMap<Value, ChannelBdIdGenerator> shimTileToGeneratorMap;
   // A mapping from a BD ID Op to the BD IDs it covers.
@@ -248,8 +271,13 @@ class BdIdAssignmentUtil {
 
  public:
   BdIdAssignmentUtil(
+      const AMDAIEDeviceModel &deviceModel, bool capToQueueSize,
+      BdIdPressureStats &stats,
       DenseMap<Value, ChannelBdIdGenerator> shimTileToGeneratorMap)
-      : shimTileToGeneratorMap(std::move(shimTileToGeneratorMap)) {}
+      : deviceModel(deviceModel),
+        capToQueueSize(capToQueueSize),
+        stats(stats),
+        shimTileToGeneratorMap(std::move(shimTileToGeneratorMap)) {}
 
   DenseMap<AMDAIE::NpuDmaCpyNdOp, SmallVector<AMDAIE::BdIdOp, 2>> &
   getDmaOpToBdIdMap() {
@@ -350,6 +378,12 @@ class BdIdAssignmentUtil {
   /// assignment is tracked by maintaining `dmaOpToBdIdMap`, which essentially
   /// maps a DmaOp to its source/target Bd Ids. Also, the API splits the
   /// available BD IDs equally amongst all DmaOps in the DmaBatch when assigning
+  ///
+  /// A BD ID of a DMA op in a loop is in use from the issue of the transfer
+  /// until the wait that retires it, and at most `min(#iterations, DMA queue
+  /// size)` transfers of the same DMA op can be in flight before a wait is
+  /// needed. More BD IDs than that don't allow folding more waits, so with
+  /// `capToQueueSize`, the remaining BD IDs are left to the inner batches.
   LogicalResult assignRequiredBdIdsInCurrentBatch(
       IRRewriter &rewriter, AMDAIE::TileOp tileOp,
       std::unique_ptr<DmaBatch> &dmaBatch) {
@@ -373,6 +407,23 @@ class BdIdAssignmentUtil {
     if (loop = dmaBatch->forOpParent; loop && getNumberIterations(loop)) {
       iv = loop.getInductionVar();
       bindDims(loop.getContext(), ivExpr);
+      if (std::optional<uint32_t> tripCount = getConstantTripCount(loop);
+          tripCount && *tripCount > 0) {
+        uint32_t col = getConstantIndexOrAssert(tileOp.getCol());
+        uint32_t row = getConstantIndexOrAssert(tileOp.getRow());
+        uint32_t maxInFlight = std::min<uint32_t>(
+            *tripCount, deviceModel.getDmaMaxQueueSize(col, row));
+        if (capToQueueSize) size = std::min(size, maxInFlight);
+        if (size < maxInFlight) {
+          // Every `size` iterations, the DMA op has to wait for the transfer
+          // of the BD ID it is about to reuse.
+          int64_t numDmaOps = dmaBatch->currentDmaOps.size();
+          int64_t numExtraWaits = llvm::divideCeil(*tripCount, size) -
+                                  llvm::divideCeil(*tripCount, maxInFlight);
+          stats.numBdIdLimitedDmaOps += numDmaOps;
+          stats.numExtraDmaWaits += numDmaOps * numExtraWaits;
+        }
+      }
     } else {
       // In case the DMA ops are not surrounded by scf.for, we will assign
       // only one BD ID.
@@ -606,7 +657,8 @@ static TileDmaBatchGraph createTileDmaBatchGraph(
 }
 
 /// Assign BD ids to NPU dma operations using the BD generator.
-LogicalResult assignNpuDmaBdIds(AMDAIE::WorkgroupOp workgroupOp) {
+LogicalResult assignNpuDmaBdIds(AMDAIE::WorkgroupOp workgroupOp,
+                                bool capToQueueSize, BdIdPressureStats &stats) {
   IRRewriter rewriter(workgroupOp->getContext());
 
   // Get the device model.
@@ -619,7 +671,8 @@ LogicalResult assignNpuDmaBdIds(AMDAIE::WorkgroupOp workgroupOp) {
   DenseMap<Value, ChannelBdIdGenerator> shimTileToGeneratorMap;
   createShimTileToGeneratorMap(workgroupOp, deviceModel,
                                shimTileToGeneratorMap);
-  BdIdAssignmentUtil bdIdAssignmentUtil(shimTileToGeneratorMap);
+  BdIdAssignmentUtil bdIdAssignmentUtil(deviceModel, capToQueueSize, stats,
+                                        shimTileToGeneratorMap);
 
   // Walk `amdaie.npu_dma_cpy_nd` and  `amdaie.dma_wait` operations and assign
   // and release BD IDs when encountering the respective operations using the
@@ -653,25 +706,31 @@ class AMDAIEAssignNpuDmaBdIdsPass
 
   AMDAIEAssignNpuDmaBdIdsPass() = default;
   AMDAIEAssignNpuDmaBdIdsPass(const AMDAIEAssignNpuDmaBdIdsPass &pass){};
+  AMDAIEAssignNpuDmaBdIdsPass(const AMDAIEAssignNpuDmaBdIdsOptions &options)
+      : AMDAIEAssignNpuDmaBdIdsBase(options) {}
   void runOnOperation() override;
 };
 
 void AMDAIEAssignNpuDmaBdIdsPass::runOnOperation() {
   Operation *parentOp = getOperation();
 
+  BdIdPressureStats stats;
   WalkResult res = parentOp->walk([&](AMDAIE::WorkgroupOp workgroupOp) {
-    if (failed(assignNpuDmaBdIds(workgroupOp))) {
+    if (failed(assignNpuDmaBdIds(workgroupOp, capToQueueSize, stats))) {
       return WalkResult::interrupt();
     }
     return WalkResult::advance();
   });
   if (res.wasInterrupted()) return signalPassFailure();
+  numBdIdLimitedDmaOps += stats.numBdIdLimitedDmaOps;
+  numExtraDmaWaits += stats.numExtraDmaWaits;
 }
 
 }  // namespace
 
-std::unique_ptr<Pass> createAMDAIEAssignNpuDmaBdIdsPass() {
-  return std::make_unique<AMDAIEAssignNpuDmaBdIdsPass>();
+std::unique_ptr<Pass> createAMDAIEAssignNpuDmaBdIdsPass(
+    AMDAIEAssignNpuDmaBdIdsOptions options) {
+  return std::make_unique<AMDAIEAssignNpuDmaBdIdsPass>(options);
 }
 
 }  // namespace mlir::iree_compiler::AMDAIE
@@ -139,40 +139,6 @@ class TileAllocatorBase {
       uint8_t memSpace, function_ref<InFlightDiagnostic()> emitError) = 0;
 
  protected:
-  RewriterBase &rewriter;
-  const AMDAIE::AMDAIEDeviceModel &deviceModel;
-};
-
-/// A custom tile allocater that takes into consideration the usage and column
-/// of users to determine tile locations.
-class UsageAndColumnBasedTileAllocator final : public TileAllocatorBase {
- public:
-  DenseMap<Operation *, DenseSet<Operation *>> uniqueL3L2Pair;
-
-  UsageAndColumnBasedTileAllocator(
-      RewriterBase &rewriter, const AMDAIE::AMDAIEDeviceModel &deviceModel,
-      DenseMap<Operation *, DenseSet<Operation *>> uniqueL3L2Pair,
-      bool hardwareAware)
-      : TileAllocatorBase(rewriter, deviceModel),
-        uniqueL3L2Pair(uniqueL3L2Pair),
-        hardwareAware(hardwareAware) {}
-
-  LogicalResult assignTiles(
-      SmallVector<AMDAIE::LogicalObjFifoOpInterface> &objFifos,
-      uint8_t memSpace, function_ref<InFlightDiagnostic()> emitError) {
-    assert(llvm::all_of(objFifos,
-                        [&](AMDAIE::LogicalObjFifoOpInterface objFifo) {
-                          return objFifo.getMemorySpaceAsUInt() == memSpace;
-                        }) &&
-           "All logical objectFifos should have ths same memory space");
-    if (memSpace == 2) return assignLocalTiles(objFifos, memSpace, emitError);
-    if (memSpace == 0 || memSpace == 1)
-      return assignNonLocalTiles(objFifos, memSpace, emitError);
-    return emitError() << "Unsupported memory space : "
-                       << std::to_string(memSpace);
-  }
-
- private:
   /// Assign tiles to the logical objectfifos with local memory space (L1).
   /// The tiles are derived from the usage of the logical objectfifos within
   /// core operations, which are already assigned a tile location.
@@ -221,6 +187,58 @@ class UsageAndColumnBasedTileAllocator final : public TileAllocatorBase {
     return success();
   }
 
+  /// Replace the tiles of the provided non-local logical objectFifo with the
+  /// tile at `tileLoc`.
+  LogicalResult replaceWithTile(AMDAIE::LogicalObjFifoOpInterface objFifo,
+                                const TileLoc &tileLoc) {
+    rewriter.setInsertionPoint(objFifo);
+    auto getCol = rewriter.create<arith::ConstantIndexOp>(
+        rewriter.getUnknownLoc(), tileLoc.col);
+    auto getRow = rewriter.create<arith::ConstantIndexOp>(
+        rewriter.getUnknownLoc(), tileLoc.row);
+    auto assignedTileOp = rewriter.create<AMDAIE::TileOp>(
+        rewriter.getUnknownLoc(), getCol, getRow);
+    SmallVector<Value> tileResults = {cast<Value>(assignedTileOp.getResult())};
+    if (failed(objFifo.replaceWithNewTiles(rewriter, tileResults))) {
+      return objFifo.emitOpError() << "Could not replace its tiles.";
+    }
+    return success();
+  }
+
+  RewriterBase &rewriter;
+  const AMDAIE::AMDAIEDeviceModel &deviceModel;
+};
+
+/// A custom tile allocater that takes into consideration the usage and column
+/// of users to determine tile locations.
+class UsageAndColumnBasedTileAllocator final : public TileAllocatorBase {
+ public:
+  DenseMap<Operation *, DenseSet<Operation *>> uniqueL3L2Pair;
+
+  UsageAndColumnBasedTileAllocator(
+      RewriterBase &rewriter, const AMDAIE::AMDAIEDeviceModel &deviceModel,
+      DenseMap<Operation *, DenseSet<Operation *>> uniqueL3L2Pair,
+      bool hardwareAware)
+      : TileAllocatorBase(rewriter, deviceModel),
+        uniqueL3L2Pair(uniqueL3L2Pair),
+        hardwareAware(hardwareAware) {}
+
+  LogicalResult assignTiles(
+      SmallVector<AMDAIE::LogicalObjFifoOpInterface> &objFifos,
+      uint8_t memSpace, function_ref<InFlightDiagnostic()> emitError) {
+    assert(llvm::all_of(objFifos,
+                        [&](AMDAIE::LogicalObjFifoOpInterface objFifo) {
+                          return objFifo.getMemorySpaceAsUInt() == memSpace;
+                        }) &&
+           "All logical objectFifos should have ths same memory space");
+    if (memSpace == 2) return assignLocalTiles(objFifos, memSpace, emitError);
+    if (memSpace == 0 || memSpace == 1)
+      return assignNonLocalTiles(objFifos, memSpace, emitError);
+    return emitError() << "Unsupported memory space : "
+                       << std::to_string(memSpace);
+  }
+
+ private:
   /// Assign tile locations to objectFifos. Start by searching for a set of
   /// candidate tile locations and then assign tiles based on a simple
   /// usage-based model that prioritizes tiles that have the least usage.
@@ -359,18 +377,7 @@ class UsageAndColumnBasedTileAllocator final : public TileAllocatorBase {
                  << ", " << assignedTileLoc.row << ")\n");
       tileLocToUsage[assignedTileLoc] += allocationSizeInBytes;
 
-      rewriter.setInsertionPoint(objFifo);
-      auto getCol = rewriter.create<arith::ConstantIndexOp>(
-          rewriter.getUnknownLoc(), assignedTileLoc.col);
-      auto getRow = rewriter.create<arith::ConstantIndexOp>(
-          rewriter.getUnknownLoc(), assignedTileLoc.row);
-      auto assignedTileOp = rewriter.create<AMDAIE::TileOp>(
-          rewriter.getUnknownLoc(), getCol, getRow);
-      SmallVector<Value> tileResults = {
-          cast<Value>(assignedTileOp.getResult())};
-      if (failed(objFifo.replaceWithNewTiles(rewriter, tileResults))) {
-        return objFifo.emitOpError() << "Could not replace its tiles.";
-      }
+      if (failed(replaceWithTile(objFifo, assignedTileLoc))) return failure();
     }
     return success();
   }
@@ -426,18 +433,300 @@ class UsageAndColumnBasedTileAllocator final : public TileAllocatorBase {
   bool hardwareAware{true};
 };
 
+/// Weights of the terms of the cost of a placement, see
+/// `CostBasedTileAllocator`. A connection that doesn't get a DMA channel is
+/// much more expensive than a longer route, while the memory balance only
+/// breaks ties between placements with similar routes.
+constexpr double kWireLengthWeight = 1.0;
+constexpr double kPortOverflowWeight = 16.0;
+constexpr double kMemoryBalanceWeight = 4.0;
+/// The maximum number of passes over all logical objectFifos to improve their
+/// placement.
+constexpr int kMaxNumPlacementSweeps = 16;
+/// The minimum cost decrease for a placement change to be accepted.
+constexpr double kMinCostDecrease = 1e-9;
+
+/// A tile allocator that places all non-local logical objectFifos on the same
+/// memory space together by minimizing a cost made of:
+///   - the Manhattan distance to the tiles of the logical objectFifos they are
+///     copied from or to, as an estimate of the wire length of the routes;
+///   - the number of DMA channels needed on a tile beyond the ones it has, as
+///     the connections without a channel of their own have to fall back to
+///     packet mode;
+///   - the imbalance of the memory usage over the tiles.
+/// A greedy placement, largest logical objectFifos first, is refined by moving
+/// and swapping logical objectFifos as long as the cost decreases. Unlike
+/// simulated annealing, this search is deterministic, which keeps the output
+/// IR stable.
+class CostBasedTileAllocator final : public TileAllocatorBase {
+ public:
+  CostBasedTileAllocator(RewriterBase &rewriter,
+                         const AMDAIE::AMDAIEDeviceModel &deviceModel,
+                         bool hardwareAware)
+      : TileAllocatorBase(rewriter, deviceModel),
+        hardwareAware(hardwareAware) {}
+
+  LogicalResult assignTiles(
+      SmallVector<AMDAIE::LogicalObjFifoOpInterface> &objFifos,
+      uint8_t memSpace, function_ref<InFlightDiagnostic()> emitError) {
+    if (memSpace == 2) return assignLocalTiles(objFifos, memSpace, emitError);
+    if (memSpace == 0 || memSpace == 1)
+      return assignNonLocalTiles(objFifos, memSpace, emitError);
+    return emitError() << "Unsupported memory space : "
+                       << std::to_string(memSpace);
+  }
+
+ private:
+  struct Placement {
+    AMDAIE::LogicalObjFifoOpInterface objFifo;
+    size_t sizeInBytes{0};
+    // The tiles this logical objectFifo can be assigned to.
+    SmallVector<TileLoc> candidates;
+    // The tiles of the logical objectFifos this one is copied from or to.
+    // Logical objectFifos without a tile yet are not taken into account.
+    SmallVector<TileLoc> peers;
+    // The number of DMA channels needed to copy from and to this logical
+    // objectFifo.
+    uint32_t numMM2S{0};
+    uint32_t numS2MM{0};
+    TileLoc tileLoc;
+  };
+
+  struct TileUsage {
+    size_t sizeInBytes{0};
+    uint32_t numMM2S{0};
+    uint32_t numS2MM{0};
+  };
+
+  /// Initialize the peers and the number of DMA channels of the provided
+  /// placement. All copies between the same two logical objectFifos are
+  /// expected to share a connection and thus a DMA channel.
+  LogicalResult initPeers(Placement &placement) const {
+    llvm::SmallSetVector<Operation *, 8> sources;
+    llvm::SmallSetVector<Operation *, 8> targets;
+    for (Operation *user : placement.objFifo->getUsers()) {
+      auto copyOp = dyn_cast<CopyOpInterface>(user);
+      if (!copyOp) continue;
+      auto source = dyn_cast_if_present<AMDAIE::LogicalObjFifoOpInterface>(
+          copyOp.getSource().getDefiningOp());
+      auto target = dyn_cast_if_present<AMDAIE::LogicalObjFifoOpInterface>(
+          copyOp.getTarget().getDefiningOp());
+      if (!source || !target) continue;
+      AMDAIE::LogicalObjFifoOpInterface peer;
+      if (source.getOperation() == placement.objFifo.getOperation()) {
+        if (!targets.insert(target.getOperation())) continue;
+        peer = target;
+      } else {
+        if (!sources.insert(source.getOperation())) continue;
+        peer = source;
+      }
+      for (Value tile : peer.getTiles()) {
+        auto tileOp = dyn_cast_if_present<AMDAIE::TileOp>(tile.getDefiningOp());
+        if (!tileOp) continue;
+        std::optional<int64_t> col = getConstantIntValue(tileOp.getCol());
+        std::optional<int64_t> row = getConstantIntValue(tileOp.getRow());
+        if (!col || !row)
+          return tileOp.emitOpError() << "has non-constant tile location";
+        placement.peers.push_back(TileLoc(col.value(), row.value()));
+      }
+    }
+    placement.numMM2S = targets.size();
+    placement.numS2MM = sources.size();
+    return success();
+  }
+
+  /// Return the number of DMA channels per direction of the tile at `tileLoc`.
+  uint32_t getNumDmaChannels(const TileLoc &tileLoc) const {
+    AMDAIETileType tileType = deviceModel.getTileType(tileLoc.col, tileLoc.row);
+    if (tileType == AMDAIETileType::SHIMPL) return 0;
+    FailureOr<uint8_t> maybeNumDmaChannels =
+        deviceModel.getDmaProp<uint8_t>(tileType, AMDAIEDmaProp::NumChannels);
+    return succeeded(maybeNumDmaChannels) ? *maybeNumDmaChannels : 0;
+  }
+
+  /// Return the cost of the provided placements, or failure if they don't fit
+  /// into the memory of their tiles.
+  FailureOr<double> getCost(ArrayRef<Placement> placements) const {
+    double cost = 0;
+    llvm::MapVector<TileLoc, TileUsage> tileLocToUsage;
+    for (const Placement &placement : placements) {
+      for (const TileLoc &peer : placement.peers) {
+        int wireLength = std::abs(placement.tileLoc.col - peer.col) +
+                         std::abs(placement.tileLoc.row - peer.row);
+        cost += kWireLengthWeight * wireLength;
+      }
+      TileUsage &usage = tileLocToUsage[placement.tileLoc];
+      usage.sizeInBytes += placement.sizeInBytes;
+      usage.numMM2S += placement.numMM2S;
+      usage.numS2MM += placement.numS2MM;
+    }
+    for (auto &[tileLoc, usage] : tileLocToUsage) {
+      uint32_t memSize =
+          deviceModel.getTileMemorySizeInBytes(tileLoc.col, tileLoc.row);
+      if (hardwareAware && usage.sizeInBytes > memSize) return failure();
+      uint32_t numChannels = tileLocToNumDmaChannels.lookup(tileLoc);
+      uint32_t numOverflowChannels =
+          std::max(usage.numMM2S, numChannels) - numChannels +
+          std::max(usage.numS2MM, numChannels) - numChannels;
+      cost += kPortOverflowWeight * numOverflowChannels;
+      if (memSize == 0) continue;
+      double memFraction = static_cast<double>(usage.sizeInBytes) / memSize;
+      cost += kMemoryBalanceWeight * memFraction * memFraction;
+    }
+    return cost;
+  }
+
+  /// Assign tile locations to all the provided objectFifos at once, see the
+  /// description of this allocator.
+  LogicalResult assignNonLocalTiles(
+      SmallVector<AMDAIE::LogicalObjFifoOpInterface> &objFifos,
+      uint8_t memSpace, function_ref<InFlightDiagnostic()> emitError) {
+    assert((memSpace == 0 || memSpace == 1) &&
+           "The memory space of non-local objectFifos should be `0` or `1`");
+    SmallVector<uint32_t> memSpaceRows = deviceModel.getMemSpaceRows(memSpace);
+    if (memSpaceRows.size() == 0) {
+      return emitError()
+             << "No rows found for the memory space of this logical objFifo";
+    }
+    uint32_t row = memSpaceRows[0];
+
+    SmallVector<Placement> placements;
+    placements.reserve(objFifos.size());
+    for (AMDAIE::LogicalObjFifoOpInterface objFifo : objFifos) {
+      Placement placement;
+      placement.objFifo = objFifo;
+      std::optional<int64_t> sizeInBytes = objFifo.getAllocationSizeInBytes();
+      if (!sizeInBytes.has_value()) {
+        return objFifo.emitOpError()
+               << "has allocation size that is not a byte-multiple";
+      }
+      placement.sizeInBytes = sizeInBytes.value();
+      mlir::FunctionOpInterface funcOp =
+          objFifo->getParentOfType<mlir::FunctionOpInterface>();
+      if (!funcOp) {
+        return objFifo.emitOpError()
+               << "Could not find a function-like parent op.";
+      }
+      FailureOr<CoreRegionInfo> coreRegionInfo = getCoreRegionInfo(funcOp);
+      if (failed(coreRegionInfo)) return failure();
+      int startCol = coreRegionInfo.value().startCol;
+      int numCols = coreRegionInfo.value().numCols;
+      for (int i = startCol; i < startCol + numCols; i++) {
+        TileLoc tileLoc(i, row);
+        placement.candidates.push_back(tileLoc);
+        if (!tileLocToNumDmaChannels.contains(tileLoc))
+          tileLocToNumDmaChannels[tileLoc] = getNumDmaChannels(tileLoc);
+      }
+      if (placement.candidates.empty()) {
+        return objFifo.emitOpError() << "No tile locations found for this "
+                                        "logical objFifo.";
+      }
+      if (failed(initPeers(placement))) return failure();
+      placements.push_back(std::move(placement));
+    }
+
+    // Greedily place the logical objectFifos, largest first.
+    llvm::stable_sort(placements, [](const Placement &a, const Placement &b) {
+      return a.sizeInBytes > b.sizeInBytes;
+    });
+    for (auto [i, placement] : llvm::enumerate(placements)) {
+      std::optional<double> bestCost;
+      TileLoc bestTileLoc;
+      for (const TileLoc &candidate : placement.candidates) {
+        placement.tileLoc = candidate;
+        FailureOr<double> cost =
+            getCost(ArrayRef<Placement>(placements).take_front(i + 1));
+        if (succeeded(cost) && (!bestCost || *cost < *bestCost)) {
+          bestCost = *cost;
+          bestTileLoc = candidate;
+        }
+      }
+      if (!bestCost) {
+        return placement.objFifo.emitOpError()
+               << "could not find allocation space for this logical objFifo";
+      }
+      placement.tileLoc = bestTileLoc;
+    }
+
+    // Refine the placement by moving and swapping logical objectFifos.
+    double cost = getCost(placements).value();
+    auto tryPlacement = [&]() -> bool {
+      FailureOr<double> newCost = getCost(placements);
+      if (failed(newCost) || *newCost > cost - kMinCostDecrease) return false;
+      cost = *newCost;
+      return true;
+    };
+    bool changed = true;
+    for (int sweep = 0; changed && sweep < kMaxNumPlacementSweeps; ++sweep) {
+      changed = false;
+      for (Placement &placement : placements) {
+        for (const TileLoc &candidate : placement.candidates) {
+          TileLoc tileLoc = placement.tileLoc;
+          if (candidate == tileLoc) continue;
+          placement.tileLoc = candidate;
+          if (tryPlacement()) {
+            changed = true;
+          } else {
+            placement.tileLoc = tileLoc;
+          }
+        }
+      }
+      for (size_t i = 0; i < placements.size(); ++i) {
+        for (size_t j = i + 1; j < placements.size(); ++j) {
+          Placement &a = placements[i];
+          Placement &b = placements[j];
+          if (a.tileLoc == b.tileLoc ||
+              !llvm::is_contained(a.candidates, b.tileLoc) ||
+              !llvm::is_contained(b.candidates, a.tileLoc)) {
+            continue;
+          }
+          std::swap(a.tileLoc, b.tileLoc);
+          if (tryPlacement()) {
+            changed = true;
+          } else {
+            std::swap(a.tileLoc, b.tileLoc);
+          }
+        }
+      }
+    }
+    LLVM_DEBUG(llvm::dbgs() << "Placement cost: " << cost << "\n");
+
+    for (const Placement &placement : placements) {
+      LLVM_DEBUG(llvm::dbgs()
+                 << "Assign " << placement.objFifo << " to tile (col, row): ("
+                 << placement.tileLoc.col << ", " << placement.tileLoc.row
+                 << ")\n");
+      if (failed(replaceWithTile(placement.objFifo, placement.tileLoc)))
+        return failure();
+    }
+    return success();
+  }
+
+  /// Cache of the number of DMA channels of the candidate tiles.
+  DenseMap<TileLoc, uint32_t> tileLocToNumDmaChannels;
+  /// Whether to make hardware-aware tile assignment decisions, taking into
+  /// account memory limitations for example.
+  bool hardwareAware{true};
+};
+
 /// Assign tile locations to objectFifos based on available resources. Visit
 /// objectFifos based on locality to the cores, i.e. first visit the objectFifos
 /// on L1, then L2, etc.
 LogicalResult assignTiles(
     RewriterBase &rewriter, Operation *op, const AMDAIEDeviceModel &deviceModel,
     DenseMap<Operation *, DenseSet<Operation *>> uniqueL3L2Pair,
-    bool hardwareAware) {
+    bool hardwareAware, TilePlacementStrategy placementStrategy) {
   if (failed(clearNonLocalTiles(rewriter, op)))
     return op->emitOpError() << "failed to clear non-local tile assignments";
 
-  UsageAndColumnBasedTileAllocator tileAllocator(rewriter, deviceModel,
-                                                 uniqueL3L2Pair, hardwareAware);
+  std::unique_ptr<TileAllocatorBase> tileAllocator;
+  if (placementStrategy == TilePlacementStrategy::CostBased) {
+    tileAllocator = std::make_unique<CostBasedTileAllocator>(
+        rewriter, deviceModel, hardwareAware);
+  } else {
+    tileAllocator = std::make_unique<UsageAndColumnBasedTileAllocator>(
+        rewriter, deviceModel, uniqueL3L2Pair, hardwareAware);
+  }
 
   DenseMap<uint8_t, SmallVector<AMDAIE::LogicalObjFifoOpInterface>>
       memSpaceToObjFifos;
@@ -453,7 +742,7 @@ LogicalResult assignTiles(
   llvm::sort(memSpaces, std::greater<uint8_t>());
   for (uint8_t memSpace : memSpaces) {
     if (failed(
-            tileAllocator.assignTiles(memSpaceToObjFifos[memSpace], memSpace,
+            tileAllocator->assignTiles(memSpaceToObjFifos[memSpace], memSpace,
                                       [&]() { return op->emitOpError(); }))) {
       return failure();
     }
@@ -470,6 +759,10 @@ class AMDAIEAssignTilesPass
     registry.insert<AMDAIEDialect>();
   }
 
+  AMDAIEAssignTilesPass() = default;
+  AMDAIEAssignTilesPass(const AMDAIEAssignTilesPass &pass){};
+  AMDAIEAssignTilesPass(const AMDAIEAssignTilesOptions &options)
+      : AMDAIEAssignTilesBase(options) {}
   void runOnOperation() override;
 };
 
@@ -538,7 +831,7 @@ void AMDAIEAssignTilesPass::runOnOperation() {
   });
   // Assign tile locations to logical objectFifos on non-local (not L1) memory.
   if (failed(assignTiles(rewriter, parentOp, deviceModel, uniqueL3L2Pair,
-                         /*hardwareAware*/ true))) {
+                         /*hardwareAware*/ true, placementStrategy))) {
     parentOp->emitOpError() << "non-local tile assignment failed";
     return signalPassFailure();
   }
@@ -548,8 +841,9 @@ void AMDAIEAssignTilesPass::runOnOperation() {
 
 }  // namespace
 
-std::unique_ptr<Pass> createAMDAIEAssignTilesPass() {
-  return std::make_unique<AMDAIEAssignTilesPass>();
+std::unique_ptr<Pass> createAMDAIEAssignTilesPass(
+    AMDAIEAssignTilesOptions options) {
+  return std::make_unique<AMDAIEAssignTilesPass>(options);
 }
 
 }  // namespace mlir::iree_compiler::AMDAIE
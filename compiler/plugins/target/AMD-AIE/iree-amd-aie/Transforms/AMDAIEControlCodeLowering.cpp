@@ -11,6 +11,7 @@
 #include "iree-amd-aie/Transforms/Transforms.h"
 #include "iree-amd-aie/Transforms/Utils/AMDAIEDmaUtils.h"
 #include "iree-amd-aie/Transforms/Utils/AMDAIEUtils.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
 #include "mlir/Transforms/DialectConversion.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 
@@ -346,6 +347,43 @@ struct DmaWaitToTctSyncConverter final
   }
 };
 
+/// Erases the `amdaie.npu.write_bd` ops in `block` that write the same
+/// configuration to a BD as the previous write to that BD. The BD registers
+/// still hold this configuration, except for the buffer address, which is set
+/// again by the `amdaie.npu.address_patch` op following every write. After
+/// unrolling the control code loops, the iterations typically only differ in
+/// the patched addresses, so this avoids repeating the BD writes of the first
+/// iteration in every other one.
+///
+/// NOTE: BDs with an iteration dimension are always written, as their current
+/// iteration is updated by the hardware.
+void eraseRedundantWriteBdOps(RewriterBase &rewriter, Block &block) {
+  DenseMap<std::tuple<uint32_t, uint32_t, uint32_t>, AMDAIE::NpuWriteBdOp>
+      lastWriteBdOps;
+  for (Operation &op : llvm::make_early_inc_range(block)) {
+    if (auto writeBdOp = dyn_cast<AMDAIE::NpuWriteBdOp>(op)) {
+      std::tuple<uint32_t, uint32_t, uint32_t> key = {
+          writeBdOp.getCol(), writeBdOp.getRow(), writeBdOp.getBdId()};
+      auto it = lastWriteBdOps.find(key);
+      if (it != lastWriteBdOps.end() && writeBdOp.getIterationSize() == 0 &&
+          it->second->getAttrDictionary() == writeBdOp->getAttrDictionary()) {
+        rewriter.eraseOp(writeBdOp);
+        continue;
+      }
+      lastWriteBdOps[key] = writeBdOp;
+      continue;
+    }
+    // These ops don't write to BDs, except for the address.
+    if (isa<AMDAIE::NpuAddressPatchOp, AMDAIE::NpuPushToQueueOp,
+            AMDAIE::NpuTctSyncOp, AMDAIE::NpuDmaWaitOp>(op) ||
+        isMemoryEffectFree(&op)) {
+      continue;
+    }
+    // Conservatively assume that any other op can write to the BDs.
+    lastWriteBdOps.clear();
+  }
+}
+
 namespace {
 class AMDAIEControlCodeLoweringPass
     : public impl::AMDAIEControlCodeLoweringBase<
@@ -406,6 +444,16 @@ void AMDAIEControlCodeLoweringPass::runOnOperation() {
       return signalPassFailure();
     }
   }
+
+  // Finally, erase the BD writes that repeat the configuration already in the
+  // BD registers.
+  if (eraseRedundantWriteBds) {
+    IRRewriter rewriter(context);
+    parentOp->walk([&](AMDAIE::ControlCodeOp controlCodeOp) {
+      for (Block &block : controlCodeOp.getRegion())
+        eraseRedundantWriteBdOps(rewriter, block);
+    });
+  }
 }
 
 }  // namespace
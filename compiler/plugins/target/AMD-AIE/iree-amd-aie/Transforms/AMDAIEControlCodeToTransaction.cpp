@@ -130,6 +130,13 @@ void AMDAIEControlCodeToTransactionPass::runOnOperation() {
     }
     ArrayRef<uint32_t> instructions =
         transactionBuilder.finalizeAndReturnInstructions();
+    if (compactTransaction) {
+      if (failed(transactionBuilder.compactInstructions())) {
+        workgroupOp.emitOpError() << "failed to compact the transaction";
+        return WalkResult::interrupt();
+      }
+      instructions = transactionBuilder.getInstructions();
+    }
     workgroupOp.setNpuInstructionsAttr(DenseUI32ResourceElementsAttr::get(
         RankedTensorType::get(
             transactionBuilder.getInstructionSize(),
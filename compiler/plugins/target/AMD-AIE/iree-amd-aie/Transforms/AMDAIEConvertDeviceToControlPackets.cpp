@@ -13,6 +13,9 @@
 #include "iree-amd-aie/Transforms/Passes.h"
 #include "iree-amd-aie/aie_runtime/iree_aie_configure.h"
 #include "mlir/IR/AsmState.h"
+#include "mlir/Support/FileUtilities.h"
+#include "llvm/BinaryFormat/ELF.h"
+#include "llvm/Support/ToolOutputFile.h"
 
 #define DEBUG_TYPE "iree-amdaie-convert-device-to-control-packets"
 
@@ -40,12 +43,95 @@ void eraseWithAllUsers(Operation *op) {
   }
 }
 
+/// Returns what the ELF at `elfPath` loads into a core: the address, size and
+/// data of its loadable segments. ELFs that only differ in, for example, their
+/// symbols load the same contents.
+FailureOr<std::string> getLoadableContents(const Path &elfPath,
+                                           Operation *op) {
+  std::string errorMessage;
+  std::unique_ptr<llvm::MemoryBuffer> input =
+      openInputFile(elfPath.string(), &errorMessage);
+  if (!input) {
+    return op->emitOpError()
+           << "failed to open the elf file: " << errorMessage;
+  }
+  StringRef buffer = input->getBuffer();
+  auto emitInvalidElf = [&]() {
+    return op->emitOpError() << "invalid elf file: " << elfPath.string();
+  };
+  llvm::ELF::Elf32_Ehdr header;
+  if (buffer.size() < sizeof(header)) return emitInvalidElf();
+  memcpy(&header, buffer.data(), sizeof(header));
+  if (!header.checkMagic() ||
+      header.getFileClass() != llvm::ELF::ELFCLASS32 ||
+      header.getDataEncoding() != llvm::ELF::ELFDATA2LSB ||
+      header.e_phentsize != sizeof(llvm::ELF::Elf32_Phdr)) {
+    return emitInvalidElf();
+  }
+  std::string contents;
+  llvm::raw_string_ostream os(contents);
+  for (uint32_t i = 0; i < header.e_phnum; ++i) {
+    uint64_t phdrOffset =
+        header.e_phoff + uint64_t(i) * sizeof(llvm::ELF::Elf32_Phdr);
+    llvm::ELF::Elf32_Phdr phdr;
+    if (phdrOffset + sizeof(phdr) > buffer.size()) return emitInvalidElf();
+    memcpy(&phdr, buffer.data() + phdrOffset, sizeof(phdr));
+    if (phdr.p_type != llvm::ELF::PT_LOAD) continue;
+    if (uint64_t(phdr.p_offset) + phdr.p_filesz > buffer.size())
+      return emitInvalidElf();
+    // The data is delimited by its size, which precedes it.
+    os << phdr.p_paddr << ":" << phdr.p_memsz << ":" << phdr.p_filesz << ":"
+       << buffer.substr(phdr.p_offset, phdr.p_filesz);
+  }
+  return contents;
+}
+
+/// Returns whether all cores of the device operation load the same program.
+FailureOr<bool> coresRunSameProgram(const AMDAIEDeviceModel &deviceModel,
+                                    xilinx::AIE::DeviceOp deviceOp,
+                                    const Path &workDirPath) {
+  std::optional<std::string> firstContents;
+  for (auto tileOp : deviceOp.getOps<xilinx::AIE::TileOp>()) {
+    xilinx::AIE::CoreOp coreOp = xilinx::AIE::getCoreOp(tileOp);
+    if (!coreOp) continue;
+    std::string fileName;
+    if (std::optional<StringRef> elfFile = coreOp.getElfFile()) {
+      fileName = *elfFile;
+    } else {
+      fileName = "core_" + std::to_string(tileOp.getCol()) + "_" +
+                 std::to_string(tileOp.getRow()) + ".elf";
+    }
+    FailureOr<std::string> maybeContents =
+        getLoadableContents(workDirPath / fileName, deviceOp);
+    if (failed(maybeContents)) return failure();
+    if (!firstContents) {
+      firstContents = std::move(*maybeContents);
+    } else if (*maybeContents != *firstContents) {
+      return false;
+    }
+  }
+  return true;
+}
+
 /// Use aie-rt to generate transactions for the given device operation.
 LogicalResult generateTransactions(const AMDAIEDeviceModel &deviceModel,
                                    xilinx::AIE::DeviceOp deviceOp,
                                    const std::string &pathToElfs,
                                    bool broadcastCoreConfig) {
   if (broadcastCoreConfig) {
+    // The configuration of one core is broadcast to all of them, which is only
+    // correct if they run the same program. Configuring the cores separately
+    // instead isn't an option: the control overlay sends the packets of all
+    // cores over a single broadcast connection, so every core would end up
+    // with the program of the last one.
+    FailureOr<bool> maybeSameProgram =
+        coresRunSameProgram(deviceModel, deviceOp, Path{pathToElfs});
+    if (failed(maybeSameProgram)) return failure();
+    if (!*maybeSameProgram) {
+      return deviceOp.emitOpError()
+             << "has cores that run different programs, so their "
+                "configuration can't be broadcast";
+    }
     // Find all core tiles.
     SmallVector<xilinx::AIE::TileOp> coreTileOps = llvm::filter_to_vector(
         deviceOp.getOps<xilinx::AIE::TileOp>(),
@@ -78,12 +164,123 @@ LogicalResult generateTransactions(const AMDAIEDeviceModel &deviceModel,
   return success();
 }
 
-LogicalResult convertDeviceToControlPacket(IRRewriter &rewriter,
-                                           xilinx::AIE::DeviceOp deviceOp,
-                                           const std::string &pathToElfs,
-                                           bool broadcastCoreConfig) {
+/// A write of a transaction. Masked writes are resolved to plain writes.
+struct TransactionWrite {
+  uint64_t address;
+  SmallVector<uint32_t> data;
+  bool isBlockWrite;
+};
+
+/// Decodes the writes of the serialized aie-rt transaction `txn`. Masked writes
+/// are not natively supported in control packets. To emulate this
+/// functionality, the most recent data written to each address is buffered in
+/// `emulationBuffer`, which thus ends up holding the data written last to
+/// every address by the transaction.
+LogicalResult decodeTransaction(const uint8_t *txn, Operation *op,
+                                SmallVectorImpl<TransactionWrite> &writes,
+                                DenseMap<uint64_t, uint32_t> &emulationBuffer) {
+  auto *txn_header = reinterpret_cast<const XAie_TxnHeader *>(txn);
+  uint32_t NumOps = txn_header->NumOps;
+  const uint8_t *txn_ptr = txn + sizeof(XAie_TxnHeader);
+
+  // Process each operation in the transaction.
+  for (uint32_t i = 0; i < NumOps; i++) {
+    auto *op_header = reinterpret_cast<const XAie_OpHdr *>(txn_ptr);
+    auto opCode = static_cast<AMDAIE::XAie_TxnOpcode>(op_header->Op);
+    switch (opCode) {
+      case XAie_TxnOpcode::XAIE_IO_WRITE: {
+        auto *w_header = reinterpret_cast<const XAie_Write32Hdr *>(txn_ptr);
+        uint64_t addr = w_header->RegOff;
+        uint32_t value = w_header->Value;
+        writes.push_back({addr, {value}, /*isBlockWrite=*/false});
+        emulationBuffer[addr] = value;
+        txn_ptr += w_header->Size;
+        break;
+      }
+      case XAie_TxnOpcode::XAIE_IO_BLOCKWRITE: {
+        auto *bw_header =
+            reinterpret_cast<const XAie_BlockWrite32Hdr *>(txn_ptr);
+        uint64_t addr = bw_header->RegOff;
+        auto payload = reinterpret_cast<const uint32_t *>(
+            txn_ptr + sizeof(XAie_BlockWrite32Hdr));
+        // Calculate the payload length in 32-bit words.
+        uint32_t length = (bw_header->Size - sizeof(XAie_BlockWrite32Hdr)) / 4;
+        writes.push_back({addr,
+                          SmallVector<uint32_t>(payload, payload + length),
+                          /*isBlockWrite=*/true});
+        // Update the emulation buffer for the whole block of data.
+        for (size_t i = 0; i < length; i += 1) {
+          emulationBuffer[addr] = payload[i];
+          addr += sizeof(uint32_t);
+        }
+        txn_ptr += bw_header->Size;
+        break;
+      }
+      case XAie_TxnOpcode::XAIE_IO_MASKWRITE: {
+        auto *mw_header =
+            reinterpret_cast<const XAie_MaskWrite32Hdr *>(txn_ptr);
+        uint64_t addr = mw_header->RegOff;
+        uint32_t value = mw_header->Value;
+        uint32_t mask = mw_header->Mask;
+        // Apply the mask to the value and update the emulation buffer.
+        if (emulationBuffer.count(addr))
+          value = (emulationBuffer[addr] & ~mask) | (value & mask);
+        writes.push_back({addr, {value}, /*isBlockWrite=*/false});
+        emulationBuffer[addr] = value;
+        txn_ptr += mw_header->Size;
+        break;
+      }
+      default: {
+        return op->emitOpError()
+               << "Unsupported opcode in transaction: " << uint8_t(opCode);
+      }
+    }
+  }
+  return success();
+}
+
+/// Counters of the control packets generated for a device.
+struct ControlPacketStats {
+  uint64_t numControlPackets = 0;
+  uint64_t numElidedWords = 0;
+};
+
+LogicalResult convertDeviceToControlPacket(
+    IRRewriter &rewriter, xilinx::AIE::DeviceOp deviceOp,
+    const std::string &pathToElfs, bool broadcastCoreConfig,
+    const std::string &referenceTransaction, const std::string &dumpTransaction,
+    bool compact, ControlPacketStats &stats) {
   AMDAIEDeviceModel deviceModel = getDeviceModel(deviceOp.getDevice());
 
+  // In delta mode, the data the reference configuration leaves in every
+  // address it writes to.
+  std::optional<DenseMap<uint64_t, uint32_t>> referenceState;
+  if (!referenceTransaction.empty()) {
+    std::string errorMessage;
+    std::unique_ptr<llvm::MemoryBuffer> referenceInput =
+        openInputFile(referenceTransaction, &errorMessage);
+    if (!referenceInput) {
+      return deviceOp.emitOpError()
+             << "failed to open the reference transaction: " << errorMessage;
+    }
+    StringRef buffer = referenceInput->getBuffer();
+    if (buffer.size() < sizeof(XAie_TxnHeader) ||
+        reinterpret_cast<const XAie_TxnHeader *>(buffer.data())->TxnSize !=
+            buffer.size()) {
+      return deviceOp.emitOpError()
+             << "invalid reference transaction: " << referenceTransaction;
+    }
+    // Copy the transaction to make sure its headers are suitably aligned.
+    std::vector<uint32_t> txn((buffer.size() + 3) / 4);
+    memcpy(txn.data(), buffer.data(), buffer.size());
+    SmallVector<TransactionWrite> referenceWrites;
+    referenceState.emplace();
+    if (failed(decodeTransaction(reinterpret_cast<const uint8_t *>(txn.data()),
+                                 deviceOp, referenceWrites, *referenceState))) {
+      return failure();
+    }
+  }
+
   // Start collecting transations.
   TRY_XAIE_API_LOGICAL_RESULT(XAie_StartTransaction, &deviceModel.devInst,
                               XAIE_TRANSACTION_DISABLE_AUTO_FLUSH);
@@ -96,8 +293,40 @@ LogicalResult convertDeviceToControlPacket(IRRewriter &rewriter,
   uint8_t *txn_ptr =
       XAie_ExportSerializedTransaction(&deviceModel.devInst, 0, 0);
   auto *txn_header = reinterpret_cast<XAie_TxnHeader *>(txn_ptr);
-  uint32_t NumOps = txn_header->NumOps;
-  txn_ptr += sizeof(XAie_TxnHeader);
+  if (!dumpTransaction.empty()) {
+    std::string errorMessage;
+    std::unique_ptr<llvm::ToolOutputFile> output =
+        openOutputFile(dumpTransaction, &errorMessage);
+    if (!output) {
+      free(txn_header);
+      return deviceOp.emitOpError()
+             << "failed to dump the transaction: " << errorMessage;
+    }
+    output->os().write(reinterpret_cast<const char *>(txn_ptr),
+                       txn_header->TxnSize);
+    output->keep();
+  }
+  // Compact the transaction, for fewer and larger control packets.
+  std::vector<uint32_t> compactedTxn;
+  if (compact) {
+    FailureOr<std::vector<uint32_t>> maybeCompacted =
+        compactTransaction(deviceModel, txn_ptr);
+    if (failed(maybeCompacted)) {
+      free(txn_header);
+      return deviceOp.emitOpError() << "failed to compact the transaction";
+    }
+    compactedTxn = std::move(maybeCompacted.value());
+  }
+  SmallVector<TransactionWrite> writes;
+  DenseMap<uint64_t, uint32_t> emulationBuffer;
+  LogicalResult decoded = decodeTransaction(
+      compact ? reinterpret_cast<const uint8_t *>(compactedTxn.data())
+              : txn_ptr,
+      deviceOp, writes, emulationBuffer);
+  // Clear the transaction.
+  free(txn_header);
+  TRY_XAIE_API_LOGICAL_RESULT(XAie_ClearTransaction, &deviceModel.devInst);
+  if (failed(decoded)) return failure();
 
   // Create a function named `reconfigure`, with no arguments and no return.
   rewriter.setInsertionPoint(deviceOp);
@@ -125,11 +354,6 @@ LogicalResult convertDeviceToControlPacket(IRRewriter &rewriter,
   Block *controlCodeBlock = workgroupOp.getControlCode().getBody();
   rewriter.setInsertionPointToStart(controlCodeBlock);
 
-  // Masked writes are not natively supported in control packets. To emulate
-  // this functionality, we buffer the most recent data written to each
-  // specified address.
-  DenseMap<uint64_t, uint32_t> emulationBuffer;
-
   // Set the opcode to `write`, indicating data is written only
   // to the `CTRL` port with no return data expected. The `stream_id` is set
   // to 0, as it is irrelevant in this case.
@@ -139,80 +363,65 @@ LogicalResult convertDeviceToControlPacket(IRRewriter &rewriter,
   // ID for DenseI32ResourceElementsAttr.
   uint32_t resource_id = 0;
 
-  // Process each operation in the transaction.
-  for (uint32_t i = 0; i < NumOps; i++) {
-    XAie_OpHdr *op_header = (XAie_OpHdr *)txn_ptr;
-    auto opCode = static_cast<AMDAIE::XAie_TxnOpcode>(op_header->Op);
-    switch (opCode) {
-      case XAie_TxnOpcode::XAIE_IO_WRITE: {
-        XAie_Write32Hdr *w_header =
-            reinterpret_cast<XAie_Write32Hdr *>(txn_ptr);
-        uint64_t addr = w_header->RegOff;
-        uint32_t value = w_header->Value;
-        ArrayRef<int32_t> data(reinterpret_cast<int32_t &>(value));
-        rewriter.create<AMDAIE::NpuControlPacketOp>(
-            rewriter.getUnknownLoc(), addr,
-            /*length=*/1, opcode, stream_id,
-            /*data=*/rewriter.getDenseI32ArrayAttr(data));
-        emulationBuffer[addr] = value;
-        txn_ptr += w_header->Size;
-        break;
-      }
-      case XAie_TxnOpcode::XAIE_IO_BLOCKWRITE: {
-        XAie_BlockWrite32Hdr *bw_header =
-            reinterpret_cast<XAie_BlockWrite32Hdr *>(txn_ptr);
-        uint64_t addr = bw_header->RegOff;
-        auto payload =
-            reinterpret_cast<int32_t *>(txn_ptr + sizeof(XAie_BlockWrite32Hdr));
-        // Calculate the payload length in 32-bit words.
-        uint32_t length = (bw_header->Size - sizeof(XAie_BlockWrite32Hdr)) / 4;
-        ArrayRef<int32_t> data(payload, length);
-        auto dataResourceAttr = DenseI32ResourceElementsAttr::get(
-            RankedTensorType::get(data.size(),
-                                  IntegerType::get(rewriter.getContext(), 32)),
-            "ctrl_pkt_data_" + std::to_string(resource_id++),
-            HeapAsmResourceBlob::allocateAndCopyInferAlign(data));
-        rewriter.create<AMDAIE::NpuControlPacketOp>(
-            rewriter.getUnknownLoc(), addr, length, opcode, stream_id,
-            dataResourceAttr);
-        // Update the emulation buffer for the whole block of data.
-        for (size_t i = 0; i < length; i += 1) {
-          emulationBuffer[addr] = reinterpret_cast<uint32_t *>(payload)[i];
-          addr += sizeof(uint32_t);
-        }
-        txn_ptr += bw_header->Size;
-        break;
-      }
-      case XAie_TxnOpcode::XAIE_IO_MASKWRITE: {
-        XAie_MaskWrite32Hdr *mw_header =
-            reinterpret_cast<XAie_MaskWrite32Hdr *>(txn_ptr);
-        uint64_t addr = mw_header->RegOff;
-        uint32_t value = mw_header->Value;
-        uint32_t mask = mw_header->Mask;
-        // Apply the mask to the value and update the emulation buffer.
-        if (emulationBuffer.count(addr))
-          value = (emulationBuffer[addr] & ~mask) | (value & mask);
-        ArrayRef<int32_t> data(reinterpret_cast<int32_t &>(value));
-        rewriter.create<AMDAIE::NpuControlPacketOp>(
-            rewriter.getUnknownLoc(), addr,
-            /*length=*/1, opcode, stream_id,
-            rewriter.getDenseI32ArrayAttr(data));
-        emulationBuffer[addr] = value;
-        txn_ptr += mw_header->Size;
-        break;
+  auto createControlPacket = [&](uint64_t addr, ArrayRef<uint32_t> words,
+                                 bool isBlockWrite) {
+    ArrayRef<int32_t> data(reinterpret_cast<const int32_t *>(words.data()),
+                           words.size());
+    ++stats.numControlPackets;
+    if (!isBlockWrite) {
+      rewriter.create<AMDAIE::NpuControlPacketOp>(
+          rewriter.getUnknownLoc(), addr,
+          /*length=*/data.size(), opcode, stream_id,
+          /*data=*/rewriter.getDenseI32ArrayAttr(data));
+      return;
+    }
+    auto dataResourceAttr = DenseI32ResourceElementsAttr::get(
+        RankedTensorType::get(data.size(),
+                              IntegerType::get(rewriter.getContext(), 32)),
+        "ctrl_pkt_data_" + std::to_string(resource_id++),
+        HeapAsmResourceBlob::allocateAndCopyInferAlign(data));
+    rewriter.create<AMDAIE::NpuControlPacketOp>(rewriter.getUnknownLoc(), addr,
+                                                data.size(), opcode, stream_id,
+                                                dataResourceAttr);
+  };
+
+  // In delta mode, a word doesn't need to be written if it is configuration
+  // only and already holds the same data.
+  auto isUnchanged = [&](uint64_t addr, uint32_t value) {
+    if (!referenceState || !deviceModel.isConfigurationOnlyAddress(addr))
+      return false;
+    auto it = referenceState->find(addr);
+    return it != referenceState->end() && it->second == value;
+  };
+
+  for (const TransactionWrite &write : writes) {
+    ArrayRef<uint32_t> data = write.data;
+    // Emit every maximal run of changed words as a control packet.
+    size_t begin = 0;
+    while (begin < data.size()) {
+      uint64_t addr = write.address + begin * sizeof(uint32_t);
+      if (isUnchanged(addr, data[begin])) {
+        ++stats.numElidedWords;
+        ++begin;
+        continue;
       }
-      default: {
-        return deviceOp.emitOpError()
-               << "Unsupported opcode in transaction: " << uint8_t(opCode);
+      size_t end = begin + 1;
+      while (end < data.size() &&
+             !isUnchanged(write.address + end * sizeof(uint32_t), data[end])) {
+        ++end;
       }
+      createControlPacket(addr, data.slice(begin, end - begin),
+                          write.isBlockWrite);
+      begin = end;
+    }
+    // Track what the device holds after this write.
+    if (referenceState) {
+      for (auto [index, value] : llvm::enumerate(data))
+        (*referenceState)[write.address + index * sizeof(uint32_t)] = value;
     }
   }
 
-  // Clear the transaction.
-  free(txn_header);
-  TRY_XAIE_API_LOGICAL_RESULT(XAie_ClearTransaction, &deviceModel.devInst);
   rewriter.eraseOp(deviceOp);
-
   return success();
 }
 
@@ -248,9 +457,13 @@ void AMDAIEConvertDeviceToControlPacketsPass::runOnOperation() {
   }
 
   // Start the conversion.
-  if (failed(convertDeviceToControlPacket(rewriter, deviceOps[0], pathToElfs,
-                                          broadcastCoreConfig)))
+  ControlPacketStats stats;
+  if (failed(convertDeviceToControlPacket(
+          rewriter, deviceOps[0], pathToElfs, broadcastCoreConfig,
+          referenceTransaction, dumpTransaction, compactTransaction, stats)))
     return signalPassFailure();
+  numControlPackets += stats.numControlPackets;
+  numElidedWords += stats.numElidedWords;
 }
 
 }  // namespace
@@ -4,12 +4,16 @@
 // See https://llvm.org/LICENSE.txt for license information.
 // SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 
+#include <limits>
+
 #include "iree-amd-aie/IR/AMDAIEOps.h"
 #include "iree-amd-aie/Transforms/Passes.h"
 #include "iree-amd-aie/Transforms/Utils/AMDAIEDmaUtils.h"
 #include "iree-amd-aie/Transforms/Utils/AMDAIEUtils.h"
 #include "iree-amd-aie/aie_runtime/iree_aie_runtime.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
 #include "mlir/IR/Iterators.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
 #define DEBUG_TYPE "iree-amdaie-fold-dma-waits"
 
 namespace mlir::iree_compiler::AMDAIE {
@@ -53,6 +57,20 @@ FailureOr<DmaBdIdPair> retrieveDmaBdIdPair(
   return DmaBdIdPair{currBdIdKey, currBdIdVal};
 }
 
+/// Replace `dmaOp` by an equivalent operation without an async token, so that
+/// the DMA doesn't issue a task completion token that no wait consumes.
+void nullifyAsyncToken(IRRewriter &rewriter,
+                       AMDAIE::NpuHalfDmaCpyNdOp dmaOp) {
+  rewriter.setInsertionPoint(dmaOp);
+  TypeRange resultTypeRange = TypeRange{};
+  rewriter.create<AMDAIE::NpuHalfDmaCpyNdOp>(
+      dmaOp.getLoc(), resultTypeRange, dmaOp.getConnection(), dmaOp.getInput(),
+      dmaOp.getMixedOffsets(), dmaOp.getMixedSizes(), dmaOp.getMixedStrides(),
+      dmaOp.getBdId(), dmaOp.getChannel(), dmaOp.getNextBd(),
+      dmaOp.getStartBd());
+  rewriter.eraseOp(dmaOp);
+}
+
 /// Utility function to erase the DMA wait operations in the queue, except for
 /// the last one.
 LogicalResult eraseQueueOperations(IRRewriter &rewriter,
@@ -77,17 +95,8 @@ LogicalResult eraseQueueOperations(IRRewriter &rewriter,
           dyn_cast_if_present<AMDAIE::NpuHalfDmaCpyNdOp>(token.getDefiningOp());
       if (!dmaOp)
         waitOp.emitError("expected to operate on an `amdaie.half_dma_cpy_nd`");
-      if (dmaOp.use_empty()) {
-        rewriter.setInsertionPoint(dmaOp);
-        TypeRange resultTypeRange = TypeRange{};
-        // Nullify the result to avoid issuing a token.
-        rewriter.create<AMDAIE::NpuHalfDmaCpyNdOp>(
-            dmaOp.getLoc(), resultTypeRange, dmaOp.getConnection(),
-            dmaOp.getInput(), dmaOp.getMixedOffsets(), dmaOp.getMixedSizes(),
-            dmaOp.getMixedStrides(), dmaOp.getBdId(), dmaOp.getChannel(),
-            dmaOp.getNextBd(), dmaOp.getStartBd());
-        rewriter.eraseOp(dmaOp);
-      }
+      // Nullify the result to avoid issuing a token.
+      if (dmaOp.use_empty()) nullifyAsyncToken(rewriter, dmaOp);
     }
   }
   return success();
@@ -365,6 +374,233 @@ LogicalResult foldDmaWaitsByBatch(AMDAIE::ControlCodeOp controlCodeOp) {
   return success();
 }
 
+/// Number of bytes a DMA channel moves per cycle over a 32-bit stream.
+constexpr int64_t kDmaBytesPerCycle = 4;
+
+/// Returns the estimated duration of the transfer of `dmaOp` in cycles, or 0
+/// if its size isn't known statically.
+int64_t getTransferCycles(AMDAIE::NpuHalfDmaCpyNdOp dmaOp) {
+  MemRefType memrefType = dmaOp.getMemrefType();
+  std::optional<int64_t> size = dmaOp.getAccessStaticSize();
+  // An access without addressing transfers the whole memref.
+  if (size && *size == 0 && memrefType.hasStaticShape())
+    size = memrefType.getNumElements();
+  if (!size) return 0;
+  int64_t elementBytes = llvm::divideCeilSigned(
+      static_cast<int64_t>(memrefType.getElementTypeBitWidth()), 8);
+  return llvm::divideCeilSigned(*size * elementBytes, kDmaBytesPerCycle);
+}
+
+/// Returns the number of transfers to leave in the queue of a channel when the
+/// host has to wait for it to make room for the next transfer. Leaving
+/// transfers in the queue needs more waits, but keeps the channel busy while
+/// the host issues the next transfer, so the number is chosen to minimize the
+/// estimated cost of `numDmas` transfers of `transferCycles` each:
+///   - every wait costs `waitCycles` on the host;
+///   - after every wait that makes room in a full queue, the channel idles for
+///     the `issueCycles` the host takes to issue the next transfer, minus the
+///     time it takes to process the transfers left in the queue.
+uint32_t getQueueLag(int64_t numDmas, int64_t transferCycles,
+                     uint32_t maxQueueSize, int64_t issueCycles,
+                     int64_t waitCycles) {
+  uint32_t bestLag = 0;
+  int64_t bestCost = std::numeric_limits<int64_t>::max();
+  for (uint32_t lag = 0; lag < maxQueueSize; ++lag) {
+    // The first wait is needed when the queue is full, the next ones every
+    // `maxQueueSize - lag` transfers, and a final one after the last transfer.
+    int64_t numQueueWaits =
+        numDmas > maxQueueSize
+            ? 1 + (numDmas - maxQueueSize - 1) / (maxQueueSize - lag)
+            : 0;
+    int64_t idleCycles =
+        std::max<int64_t>(0, issueCycles - lag * transferCycles);
+    int64_t cost = (numQueueWaits + 1) * waitCycles + numQueueWaits * idleCycles;
+    if (cost < bestCost) {
+      bestCost = cost;
+      bestLag = lag;
+    }
+  }
+  return bestLag;
+}
+
+/// A DMA transfer that has been issued, but isn't known to be complete yet.
+struct PendingDma {
+  AMDAIE::NpuHalfDmaCpyNdOp dmaOp;
+  AMDAIE::TileOp tileOp;
+  uint32_t bdId;
+  // Whether the transfer writes to memory or reconfigures tiles, so that it
+  // has to stay ordered with the transfers its original wait preceded.
+  bool isOrdered;
+  // The position of the original wait on the transfer in the control code.
+  size_t waitPosition;
+};
+
+/// Returns whether the DMA waits of `controlCodeOp` can be placed by
+/// `foldDmaWaitsByCostModel`, i.e. the control code is a single block of DMA
+/// operations with constant BD IDs, each of them waited on exactly once and
+/// without BD chains.
+bool canFoldByCostModel(AMDAIE::ControlCodeOp controlCodeOp) {
+  WalkResult res = controlCodeOp->walk([&](Operation *op) {
+    if (auto dmaOp = dyn_cast<AMDAIE::NpuHalfDmaCpyNdOp>(op)) {
+      std::optional<AMDAIE::BdIdOp> bdIdOp = dmaOp.getBdIdOp();
+      if (dmaOp->getParentOp() != controlCodeOp || !bdIdOp ||
+          !getConstantIntValue(bdIdOp->getValue()) ||
+          !isa_and_present<AMDAIE::TileOp>(bdIdOp->getTile().getDefiningOp()) ||
+          !dmaOp.getChannelOp() || !dmaOp.getConnectionOp() ||
+          dmaOp.getNextBd() || dmaOp.getStartBd() || !dmaOp.getAsyncToken() ||
+          !dmaOp.getAsyncToken().hasOneUse() || !dmaOp.hasDmaWaitOpUser()) {
+        return WalkResult::interrupt();
+      }
+    } else if (auto waitOp = dyn_cast<AMDAIE::NpuDmaWaitOp>(op)) {
+      if (waitOp->getParentOp() != controlCodeOp) return WalkResult::interrupt();
+      for (Value token : waitOp.getAsyncTokens()) {
+        if (!isa_and_present<AMDAIE::NpuHalfDmaCpyNdOp>(token.getDefiningOp()))
+          return WalkResult::interrupt();
+      }
+    }
+    return WalkResult::advance();
+  });
+  return !res.wasInterrupted();
+}
+
+/// Places the DMA waits of the control code from scratch, based on a model of
+/// the occupancy of the DMA queues instead of the original waits:
+///   - a wait is only inserted when the next transfer would overflow the queue
+///     of its channel, reuses the BD ID of a pending transfer, or has to stay
+///     ordered with a pending transfer, and before operations other than DMA
+///     operations and at the end of the control code;
+///   - a wait on a full queue leaves the number of transfers chosen by
+///     `getQueueLag` in it;
+///   - all the waits needed before an operation are combined into a single
+///     wait, and a wait is only on the last of the transfers of a channel
+///     it has to retire, as the transfers of a channel complete in order.
+/// Transfers that read from memory are only ordered with the transfers on the
+/// same channel, so their waits can move past the transfers on other
+/// channels. Transfers that write to memory or reconfigure tiles are kept
+/// ordered with all the transfers their original wait preceded.
+LogicalResult foldDmaWaitsByCostModel(
+    const AMDAIE::AMDAIEDeviceModel &deviceModel,
+    AMDAIE::ControlCodeOp controlCodeOp, int64_t issueCycles,
+    int64_t waitCycles) {
+  IRRewriter rewriter(controlCodeOp->getContext());
+  Block *block = controlCodeOp.getBody();
+  DenseMap<Operation *, size_t> positions;
+  for (auto [position, op] : llvm::enumerate(*block)) positions[&op] = position;
+
+  // Estimate the queue lag of every channel from the transfers on it.
+  llvm::MapVector<Value, std::pair<int64_t, int64_t>> channelToTransfers;
+  for (auto dmaOp : block->getOps<AMDAIE::NpuHalfDmaCpyNdOp>()) {
+    auto &[numDmas, totalCycles] = channelToTransfers[dmaOp.getChannel()];
+    ++numDmas;
+    totalCycles += getTransferCycles(dmaOp);
+  }
+  auto getMaxQueueSize = [&](Value channel) -> uint32_t {
+    AMDAIE::TileOp tileOp = cast<AMDAIE::ChannelOp>(channel.getDefiningOp())
+                                .getTileOp();
+    uint32_t col = getConstantIndexOrAssert(tileOp.getCol());
+    uint32_t row = getConstantIndexOrAssert(tileOp.getRow());
+    return deviceModel.getDmaMaxQueueSize(col, row);
+  };
+  DenseMap<Value, uint32_t> channelToLag;
+  for (auto &[channel, transfers] : channelToTransfers) {
+    auto [numDmas, totalCycles] = transfers;
+    channelToLag[channel] =
+        getQueueLag(numDmas, totalCycles / numDmas, getMaxQueueSize(channel),
+                    issueCycles, waitCycles);
+  }
+
+  // Simulate the issue of the transfers and collect the waits needed before
+  // every operation.
+  llvm::MapVector<Value, SmallVector<PendingDma>> channelToPendingDmas;
+  SmallVector<std::pair<Operation *, SmallVector<Value>>> newWaits;
+  auto retire = [&](Operation *op,
+                    const llvm::MapVector<Value, size_t> &numToRetire) {
+    SmallVector<Value> asyncTokens;
+    for (auto &[channel, num] : numToRetire) {
+      if (num == 0) continue;
+      SmallVector<PendingDma> &pendingDmas = channelToPendingDmas[channel];
+      asyncTokens.push_back(pendingDmas[num - 1].dmaOp.getAsyncToken());
+      pendingDmas.erase(pendingDmas.begin(), pendingDmas.begin() + num);
+    }
+    if (!asyncTokens.empty()) newWaits.push_back({op, asyncTokens});
+  };
+  auto retireAll = [&](Operation *op) {
+    llvm::MapVector<Value, size_t> numToRetire;
+    for (auto &[channel, pendingDmas] : channelToPendingDmas)
+      numToRetire[channel] = pendingDmas.size();
+    retire(op, numToRetire);
+  };
+  for (Operation &op : *block) {
+    if (op.hasTrait<OpTrait::IsTerminator>()) {
+      // Complete all transfers at the end of the control code.
+      retireAll(&op);
+      continue;
+    }
+    if (isa<AMDAIE::NpuDmaWaitOp, AMDAIE::LogicalObjectFifoFromMemrefOp,
+            memref::AssumeAlignmentOp>(op) ||
+        (isMemoryEffectFree(&op) && op.getNumRegions() == 0)) {
+      continue;
+    }
+    auto dmaOp = dyn_cast<AMDAIE::NpuHalfDmaCpyNdOp>(op);
+    if (!dmaOp) {
+      // Complete all transfers before any other operation.
+      retireAll(&op);
+      continue;
+    }
+    AMDAIE::BdIdOp bdIdOp = *dmaOp.getBdIdOp();
+    PendingDma pendingDma;
+    pendingDma.dmaOp = dmaOp;
+    pendingDma.tileOp = cast<AMDAIE::TileOp>(bdIdOp.getTile().getDefiningOp());
+    pendingDma.bdId = getConstantIndexOrAssert(bdIdOp.getValue());
+    std::optional<AMDAIE::FlowOp> flowOp =
+        dmaOp.getConnectionOp()->getFlowOp();
+    FailureOr<bool> isControlFlow =
+        flowOp ? flowOp->isControlFlow() : FailureOr<bool>(failure());
+    pendingDma.isOrdered =
+        dmaOp.getChannelOp()->getDirection() == AMDAIE::DMAChannelDir::S2MM ||
+        failed(isControlFlow) || *isControlFlow;
+    pendingDma.waitPosition =
+        positions[*dmaOp.getAsyncToken().getUsers().begin()];
+
+    llvm::MapVector<Value, size_t> numToRetire;
+    auto retireUpTo = [&](Value channel, size_t num) {
+      size_t &currNum = numToRetire[channel];
+      currNum = std::max(currNum, num);
+    };
+    Value channel = dmaOp.getChannel();
+    size_t numPending = channelToPendingDmas[channel].size();
+    if (numPending >= getMaxQueueSize(channel))
+      retireUpTo(channel, numPending - channelToLag[channel]);
+    size_t position = positions[&op];
+    for (auto &[otherChannel, pendingDmas] : channelToPendingDmas) {
+      for (auto [i, other] : llvm::enumerate(pendingDmas)) {
+        bool isBdIdReuse =
+            other.tileOp == pendingDma.tileOp && other.bdId == pendingDma.bdId;
+        bool isOrdered = (other.isOrdered || pendingDma.isOrdered) &&
+                         other.waitPosition < position;
+        if (isBdIdReuse || isOrdered) retireUpTo(otherChannel, i + 1);
+      }
+    }
+    retire(&op, numToRetire);
+    channelToPendingDmas[channel].push_back(pendingDma);
+  }
+
+  // Replace the original waits by the new ones.
+  for (AMDAIE::NpuDmaWaitOp waitOp :
+       llvm::make_early_inc_range(block->getOps<AMDAIE::NpuDmaWaitOp>())) {
+    rewriter.eraseOp(waitOp);
+  }
+  for (auto &[op, asyncTokens] : newWaits) {
+    rewriter.setInsertionPoint(op);
+    rewriter.create<AMDAIE::NpuDmaWaitOp>(op->getLoc(), asyncTokens);
+  }
+  for (AMDAIE::NpuHalfDmaCpyNdOp dmaOp : llvm::make_early_inc_range(
+           block->getOps<AMDAIE::NpuHalfDmaCpyNdOp>())) {
+    if (dmaOp.use_empty()) nullifyAsyncToken(rewriter, dmaOp);
+  }
+  return success();
+}
+
 class AMDAIEFoldDmaWaitsPass
     : public impl::AMDAIEFoldDmaWaitsBase<AMDAIEFoldDmaWaitsPass> {
  public:
@@ -374,6 +610,8 @@ class AMDAIEFoldDmaWaitsPass
 
   AMDAIEFoldDmaWaitsPass() = default;
   AMDAIEFoldDmaWaitsPass(const AMDAIEFoldDmaWaitsPass &pass){};
+  AMDAIEFoldDmaWaitsPass(const AMDAIEFoldDmaWaitsOptions &options)
+      : AMDAIEFoldDmaWaitsBase(options) {}
   void runOnOperation() override;
 };
 
@@ -394,6 +632,13 @@ void AMDAIEFoldDmaWaitsPass::runOnOperation() {
 
   WalkResult res = parentOp->walk([&](AMDAIE::WorkgroupOp workgroupOp) {
     AMDAIE::ControlCodeOp controlCodeOp = workgroupOp.getControlCode();
+    if (useCostModel && canFoldByCostModel(controlCodeOp)) {
+      if (failed(foldDmaWaitsByCostModel(deviceModel, controlCodeOp,
+                                         dmaIssueCycles, dmaWaitCycles))) {
+        return WalkResult::interrupt();
+      }
+      return WalkResult::advance();
+    }
     if (failed(foldDmaWaitsByQueue(deviceModel, controlCodeOp))) {
       return WalkResult::interrupt();
     }
@@ -407,8 +652,9 @@ void AMDAIEFoldDmaWaitsPass::runOnOperation() {
 
 }  // namespace
 
-std::unique_ptr<Pass> createAMDAIEFoldDmaWaitsPass() {
-  return std::make_unique<AMDAIEFoldDmaWaitsPass>();
+std::unique_ptr<Pass> createAMDAIEFoldDmaWaitsPass(
+    AMDAIEFoldDmaWaitsOptions options) {
+  return std::make_unique<AMDAIEFoldDmaWaitsPass>(options);
 }
 
 }  // namespace mlir::iree_compiler::AMDAIE
@@ -5,6 +5,7 @@
 // SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 
 #include "iree-amd-aie/Transforms/Passes.h"
+#include "iree-amd-aie/Transforms/Utils/AMDAIETuningDatabase.h"
 #include "iree-amd-aie/Transforms/Utils/AMDAIEUtils.h"
 #include "mlir/Conversion/FuncToLLVM/ConvertFuncToLLVM.h"
 #include "mlir/Conversion/FuncToLLVM/ConvertFuncToLLVMPass.h"
@@ -158,16 +159,28 @@ class AMDAIELinalgFunctionOutliningPass
 };
 
 void AMDAIELinalgFunctionOutliningPass::runOnOperation() {
-  if (outliningStrategy == OutliningStrategy::None) return;
-
   ModuleOp moduleOp = getOperation();
   MLIRContext *context = &getContext();
   IRRewriter rewriter(context);
 
+  // The outlining strategy of a tuning record applied to a dispatch takes
+  // precedence over the option.
+  auto getOutliningStrategy = [&](Operation *op) -> OutliningStrategy {
+    auto funcOp = op->getParentOfType<FunctionOpInterface>();
+    auto tunedOutliningStrategy =
+        funcOp ? funcOp->getAttrOfType<StringAttr>(kTuningOutliningAttrName)
+               : nullptr;
+    if (!tunedOutliningStrategy) return outliningStrategy;
+    return symbolizeOutliningStrategy(tunedOutliningStrategy.getValue())
+        .value_or(outliningStrategy);
+  };
+
   SmallVector<Operation *> toBeErased;
   moduleOp.walk([&](linalg::LinalgOp computeOp) {
-    if (outliningStrategy == OutliningStrategy::Balanced &&
-        !mustOutlineBalanced(computeOp)) {
+    OutliningStrategy strategy = getOutliningStrategy(computeOp);
+    if (strategy == OutliningStrategy::None ||
+        (strategy == OutliningStrategy::Balanced &&
+         !mustOutlineBalanced(computeOp))) {
       return WalkResult::skip();
     }
 
@@ -8,6 +8,7 @@
 
 #include "iree-amd-aie/IR/AMDAIEAttrs.h"
 #include "iree-amd-aie/Transforms/Utils/AMDAIETileSizeSelectionUtils.h"
+#include "iree-amd-aie/Transforms/Utils/AMDAIETuningDatabase.h"
 #include "iree-amd-aie/Transforms/Utils/AMDAIEUtils.h"
 #include "iree-amd-aie/aie_runtime/iree_aie_runtime.h"
 #include "iree/compiler/Codegen/Dialect/Codegen/IR/IREECodegenAttrs.h"
@@ -83,6 +84,35 @@ FailureOr<std::array<uint32_t, 3>> getPackedSize(
   return instructionSize;
 }
 
+// Estimated bytes per cycle of a DMA channel (a 32-bit stream switch port).
+constexpr uint32_t kStreamBytesPerCycle = 4;
+// Estimated fixed cycles of every call of the matmul kernel on an L1 tile, for
+// the loop prologue/epilogue and the synchronization with the DMAs.
+constexpr uint32_t kKernelOverheadCycles = 64;
+
+/// Returns the parameters of the roofline model for a matmul on a (numRows,
+/// numCols) array, where one vector instruction of size (m1Pack, n1Pack,
+/// k1Pack) is assumed to be issued every cycle.
+RooflineParams getRooflineParams(const AMDAIEDeviceModel &deviceModel,
+                                 uint32_t numRows, uint32_t numCols,
+                                 uint32_t m1Pack, uint32_t n1Pack,
+                                 uint32_t k1Pack) {
+  auto getNumDmaChannels = [&](AMDAIETileType tileType) -> uint32_t {
+    FailureOr<uint8_t> maybeNumDmaChannels =
+        deviceModel.getDmaProp<uint8_t>(tileType, AMDAIEDmaProp::NumChannels);
+    if (failed(maybeNumDmaChannels) || *maybeNumDmaChannels == 0) return 1;
+    return *maybeNumDmaChannels;
+  };
+  return RooflineParams{
+      /*numRows=*/numRows,
+      /*numCols=*/numCols,
+      /*macsPerCycle=*/m1Pack * n1Pack * k1Pack,
+      /*dmaBytesPerCycle=*/kStreamBytesPerCycle,
+      /*numShimChannels=*/getNumDmaChannels(AMDAIETileType::SHIMNOC),
+      /*numMemTileChannels=*/getNumDmaChannels(AMDAIETileType::MEMTILE),
+      /*kernelOverheadCycles=*/kKernelOverheadCycles};
+}
+
 struct InputDimsAndSizes {
   SmallVector<unsigned, 2> batchDims;
   SmallVector<unsigned, 2> mDims;
@@ -172,6 +202,8 @@ class ParameterSetting {
                                             AMDAIEDeviceModel deviceModel,
                                             uint32_t numRows, uint32_t numCols,
                                             std::string enableAMDAIEUkernels,
+                                            TileSizeSelection tileSizeSelection,
+                                            const TuningConfig &tuningConfig,
                                             uint32_t kPackScaleL1 = 1);
 
  private:
@@ -196,6 +228,7 @@ class ParameterSetting {
 FailureOr<ParameterSetting> ParameterSetting::create(
     linalg::LinalgOp linalgOp, bool isObjectFifo, AMDAIEDeviceModel deviceModel,
     uint32_t numRows, uint32_t numCols, std::string enableAMDAIEUkernels,
+    TileSizeSelection tileSizeSelection, const TuningConfig &tuningConfig,
     uint32_t kPackScaleL1) {
   auto initType =
       llvm::cast<ShapedType>(linalgOp.getDpsInitOperand(0)->get().getType());
@@ -249,6 +282,11 @@ FailureOr<ParameterSetting> ParameterSetting::create(
   unsigned bufferDepthB = isObjectFifo ? 2 : 1;
   unsigned bufferDepthAcc = isObjectFifo ? 2 : 1;
   unsigned bufferDepthC = isObjectFifo ? 2 : 1;
+  // A tuning record can set the depth of the L1 buffers.
+  if (isObjectFifo && tuningConfig.bufferDepths) {
+    uint32_t l1BufferDepth = (*tuningConfig.bufferDepths)[2];
+    bufferDepthA = bufferDepthB = bufferDepthC = l1BufferDepth;
+  }
 
   // Consider fusion with elementwise op, then there is only one buffer for
   // matmul output (accumulation), i.e., bufferDepthAcc = 1.
@@ -286,6 +324,19 @@ FailureOr<ParameterSetting> ParameterSetting::create(
       /*vectorN=*/n1Pack,
       /*vectorK=*/k1Pack};
   TileSize maxL1Size = selectL1TileSizes(tileParams);
+  // For pack-peel-4-level-tiling pipeline, we use the largest tile sizes that
+  // can fit in the MemTile memory.
+  bool selectL2Size = kPackScaleL1 == 2 && isObjectFifo;
+  int64_t l2MemoryLimit = deviceModel.getMemTileSizeInBytes() * numCols;
+  std::optional<MatmulTileConfig> rooflineConfig;
+  if (tileSizeSelection == TileSizeSelection::Roofline) {
+    rooflineConfig = selectMatmulTileConfig(
+        tileParams,
+        getRooflineParams(deviceModel, numRows, numCols, m1Pack, n1Pack,
+                          k1Pack),
+        selectL2Size ? std::optional<int64_t>(l2MemoryLimit) : std::nullopt);
+    maxL1Size = {rooflineConfig->m1, rooflineConfig->n1, rooflineConfig->k1};
+  }
 
   // For pack-peel pipeline, the first level tile size has to be numRows/numCols
   // times of the L1 tile size.
@@ -296,10 +347,12 @@ FailureOr<ParameterSetting> ParameterSetting::create(
   uint32_t m0Pack = (M0 / numRows) % m1Pack == 0 ? (M0 / numRows) : M0;
   uint32_t n0Pack = (N0 / numCols) % n1Pack == 0 ? (N0 / numCols) : N0;
 
-  // For pack-peel-4-level-tiling pipeline, we use the largest tile sizes that
-  // can fit in the MemTile memory.
-  if (kPackScaleL1 == 2 && isObjectFifo) {
-    tileParams.memoryLimit = deviceModel.getMemTileSizeInBytes() * numCols;
+  if (rooflineConfig) {
+    // The array tile sizes the roofline model predicted the cycles for.
+    M0 = rooflineConfig->M0;
+    N0 = rooflineConfig->N0;
+  } else if (selectL2Size) {
+    tileParams.memoryLimit = l2MemoryLimit;
     TileSize maxL0Size = selectL2TileSizes(tileParams, m0Pack, n0Pack);
     M0 = maxL0Size.M;
     N0 = maxL0Size.N;
@@ -311,16 +364,119 @@ FailureOr<ParameterSetting> ParameterSetting::create(
   uint32_t maxL0SizeK = findLargestFactor(K, maxL1Size.K);
   // For some reason, matmul(bf16, bf16, f32) get best performance when k = 32
   // on phoenix with peano for pack-peel pipeline. So for now using max k tile
-  // size with ukernel path, while keeping smaller size for vectorization path.
+  // size with ukernel path, while keeping smaller size for vectorization path,
+  // unless the k tile size is selected by the roofline model.
   // TODO: fix vectorization path to use larger k tile size.
   uint32_t k0Pack =
-      enableAMDAIEUkernels == "none"
+      enableAMDAIEUkernels == "none" &&
+              tileSizeSelection != TileSizeSelection::Roofline
           ? std::min(static_cast<int>(kPackScaleL1 * 32), static_cast<int>(K))
           : maxL0SizeK;
 
+  // The tile and pack sizes of a tuning record override the heuristics.
+  if (tuningConfig.tileSizes) {
+    M0 = (*tuningConfig.tileSizes)[0];
+    N0 = (*tuningConfig.tileSizes)[1];
+    K0 = (*tuningConfig.tileSizes)[2];
+  }
+  if (tuningConfig.packSizesL0) {
+    m0Pack = (*tuningConfig.packSizesL0)[0];
+    n0Pack = (*tuningConfig.packSizesL0)[1];
+    k0Pack = (*tuningConfig.packSizesL0)[2];
+  }
+  if (tuningConfig.packSizesL1) {
+    m1Pack = (*tuningConfig.packSizesL1)[0];
+    n1Pack = (*tuningConfig.packSizesL1)[1];
+    k1Pack = (*tuningConfig.packSizesL1)[2];
+  }
+  if ((tuningConfig.tileSizes || tuningConfig.packSizesL0 ||
+       tuningConfig.packSizesL1) &&
+      (K0 != 1 || M % M0 != 0 || N % N0 != 0 || M0 % m0Pack != 0 ||
+       N0 % n0Pack != 0 || K % k0Pack != 0 || m0Pack % m1Pack != 0 ||
+       n0Pack % n1Pack != 0 || k0Pack % k1Pack != 0)) {
+    return linalgOp.emitOpError(
+               "has tile and pack sizes from a tuning record that are "
+               "incompatible: tile sizes = [")
+           << M0 << ", " << N0 << ", " << K0 << "], pack sizes = [[" << m0Pack
+           << ", " << n0Pack << ", " << k0Pack << "], [" << m1Pack << ", "
+           << n1Pack << ", " << k1Pack << "]] for M = " << M << ", N = " << N
+           << ", K = " << K << ".";
+  }
+
   return ParameterSetting(M0, N0, K0, m0Pack, n0Pack, k0Pack, m1Pack, n1Pack,
                           k1Pack, M, N, K);
 }
+
+/// Returns the key of the tuning record for `linalgOp` on a (numRows, numCols)
+/// array of `device`.
+TuningKey getTuningKey(linalg::LinalgOp linalgOp, AMDAIEDevice device,
+                       uint32_t numRows, uint32_t numCols) {
+  auto stringifyElementType = [](Value v) {
+    std::string str;
+    llvm::raw_string_ostream os(str);
+    getElementTypeOrSelf(v.getType()).print(os);
+    return str;
+  };
+  TuningKey key;
+  key.opName = linalgOp->getName().getStringRef().str();
+  key.shape = linalgOp.getStaticLoopRanges();
+  key.elementTypes = {
+      stringifyElementType(linalgOp.getDpsInputOperand(0)->get()),
+      stringifyElementType(linalgOp.getDpsInputOperand(1)->get()),
+      stringifyElementType(linalgOp.getDpsInitOperand(0)->get())};
+  key.device = stringifyEnum(device).str();
+  key.numRows = numRows;
+  key.numCols = numCols;
+  return key;
+}
+
+/// Creates the parameter setting of `linalgOp`, using the record for it in
+/// `tuningDatabase` if there is one and the heuristics otherwise. The buffer
+/// depths and outlining strategy of the record are attached to `entryPointFn`
+/// for the passes that apply them. The selected parameters are added to the
+/// selections of `tuningDatabase`, so they can be exported.
+FailureOr<ParameterSetting> createTunedParameterSetting(
+    mlir::FunctionOpInterface entryPointFn, linalg::LinalgOp linalgOp,
+    bool isObjectFifo, AMDAIEDeviceModel deviceModel, uint32_t numRows,
+    uint32_t numCols, std::string enableAMDAIEUkernels,
+    TileSizeSelection tileSizeSelection, TuningDatabase &tuningDatabase,
+    uint32_t kPackScaleL1 = 1) {
+  TuningKey key = getTuningKey(linalgOp, deviceModel.device, numRows, numCols);
+  TuningConfig tuningConfig =
+      tuningDatabase.lookup(key).value_or(TuningConfig{});
+  FailureOr<ParameterSetting> maybeParameterSetting = ParameterSetting::create(
+      linalgOp, isObjectFifo, deviceModel, numRows, numCols,
+      enableAMDAIEUkernels, tileSizeSelection, tuningConfig, kPackScaleL1);
+  if (failed(maybeParameterSetting)) return failure();
+  const ParameterSetting &parameterSetting = maybeParameterSetting.value();
+
+  Builder builder(entryPointFn.getContext());
+  if (tuningConfig.bufferDepths) {
+    const std::array<uint32_t, 3> &bufferDepths = *tuningConfig.bufferDepths;
+    entryPointFn->setAttr(
+        kTuningBufferDepthsAttrName,
+        builder.getDenseI64ArrayAttr(
+            {bufferDepths[0], bufferDepths[1], bufferDepths[2]}));
+  }
+  if (tuningConfig.outlining) {
+    entryPointFn->setAttr(
+        kTuningOutliningAttrName,
+        builder.getStringAttr(
+            stringifyOutliningStrategy(*tuningConfig.outlining)));
+  }
+
+  TuningConfig selectedConfig = tuningConfig;
+  selectedConfig.tileSizes = {parameterSetting.M0, parameterSetting.N0,
+                              parameterSetting.K0};
+  selectedConfig.packSizesL0 = {parameterSetting.m0Pack,
+                                parameterSetting.n0Pack,
+                                parameterSetting.k0Pack};
+  selectedConfig.packSizesL1 = {parameterSetting.m1Pack,
+                                parameterSetting.n1Pack,
+                                parameterSetting.k1Pack};
+  tuningDatabase.addSelection({std::move(key), std::move(selectedConfig)});
+  return maybeParameterSetting;
+}
 }  // namespace
 
 /// Utility to set the packing inner permutation for A/LHS so that is packed as
@@ -387,15 +543,17 @@ static SmallVector<int64_t> setOuterPermB(bool isMatmulTransposeB,
 static LogicalResult setRootConfigForPackPeel4LevelTilingPipeline(
     mlir::FunctionOpInterface entryPointFn, linalg::LinalgOp linalgOp,
     LowerToAIEPassPipeline useLowerToAIEPipeline, AMDAIEDevice targetDevice,
-    uint32_t numRows, uint32_t numCols, std::string enableAMDAIEUkernels) {
+    uint32_t numRows, uint32_t numCols, std::string enableAMDAIEUkernels,
+    TileSizeSelection tileSizeSelection, TuningDatabase &tuningDatabase) {
   // Scale the L1 K with a factor of 2 compared with the outer dimensions M and
   // N to increase the L1 memory usage.
   AMDAIEDeviceModel deviceModel = getDeviceModel(targetDevice);
   bool isObjectFifo =
       useLowerToAIEPipeline == LowerToAIEPassPipeline::ObjectFifo;
-  auto maybePackPeelTiling = ParameterSetting::create(
-      linalgOp, isObjectFifo, deviceModel, numRows, numCols,
-      enableAMDAIEUkernels, /*kPackScaleL1=*/2);
+  auto maybePackPeelTiling = createTunedParameterSetting(
+      entryPointFn, linalgOp, isObjectFifo, deviceModel, numRows, numCols,
+      enableAMDAIEUkernels, tileSizeSelection, tuningDatabase,
+      /*kPackScaleL1=*/2);
   if (failed(maybePackPeelTiling)) return failure();
   auto packPeelTiling = maybePackPeelTiling.value();
 
@@ -542,13 +700,14 @@ static LogicalResult setRootConfigForPackPeel4LevelTilingPipeline(
 static LogicalResult setRootConfigForPackPeelPipeline(
     mlir::FunctionOpInterface entryPointFn, linalg::LinalgOp linalgOp,
     LowerToAIEPassPipeline useLowerToAIEPipeline, AMDAIEDevice targetDevice,
-    uint32_t numRows, uint32_t numCols, std::string enableAMDAIEUkernels) {
+    uint32_t numRows, uint32_t numCols, std::string enableAMDAIEUkernels,
+    TileSizeSelection tileSizeSelection, TuningDatabase &tuningDatabase) {
   AMDAIEDeviceModel deviceModel = getDeviceModel(targetDevice);
   bool isObjectFifo =
       useLowerToAIEPipeline == LowerToAIEPassPipeline::ObjectFifo;
-  auto maybePackPeelTiling =
-      ParameterSetting::create(linalgOp, isObjectFifo, deviceModel, numRows,
-                               numCols, enableAMDAIEUkernels);
+  auto maybePackPeelTiling = createTunedParameterSetting(
+      entryPointFn, linalgOp, isObjectFifo, deviceModel, numRows, numCols,
+      enableAMDAIEUkernels, tileSizeSelection, tuningDatabase);
   if (failed(maybePackPeelTiling)) return failure();
   auto packPeelTiling = maybePackPeelTiling.value();
 
@@ -835,7 +994,9 @@ static LogicalResult setRootConfig(mlir::FunctionOpInterface entryPointFn,
                                    LowerToAIEPassPipeline useLowerToAIEPipeline,
                                    AMDAIEDevice targetDevice, uint32_t numRows,
                                    uint32_t numCols,
-                                   std::string enableAMDAIEUkernels) {
+                                   std::string enableAMDAIEUkernels,
+                                   TileSizeSelection tileSizeSelection,
+                                   TuningDatabase &tuningDatabase) {
   assert(!getLoweringConfig<IREE::Codegen::LoweringConfigAttr>(genericOp) &&
          "expected lowering_config is not set");
   if (!isMatmul(genericOp) && !isMatmulTransposeA(genericOp) &&
@@ -846,12 +1007,12 @@ static LogicalResult setRootConfig(mlir::FunctionOpInterface entryPointFn,
   if (passPipeline == TilePassPipeline::PackPeelPipeline) {
     return setRootConfigForPackPeelPipeline(
         entryPointFn, genericOp, useLowerToAIEPipeline, targetDevice, numRows,
-        numCols, enableAMDAIEUkernels);
+        numCols, enableAMDAIEUkernels, tileSizeSelection, tuningDatabase);
   }
   if (passPipeline == TilePassPipeline::PackPeel4LevelTilingPipeline) {
     return setRootConfigForPackPeel4LevelTilingPipeline(
         entryPointFn, genericOp, useLowerToAIEPipeline, targetDevice, numRows,
-        numCols, enableAMDAIEUkernels);
+        numCols, enableAMDAIEUkernels, tileSizeSelection, tuningDatabase);
   }
   return genericOp.emitError("Unhandled pass pipeline in setRootConfig.");
 }
@@ -864,7 +1025,9 @@ static LogicalResult setRootConfig(mlir::FunctionOpInterface entryPointFn,
                                    LowerToAIEPassPipeline useLowerToAIEPipeline,
                                    AMDAIEDevice targetDevice, uint32_t numRows,
                                    uint32_t numCols,
-                                   std::string enableAMDAIEUkernels) {
+                                   std::string enableAMDAIEUkernels,
+                                   TileSizeSelection tileSizeSelection,
+                                   TuningDatabase &tuningDatabase) {
   assert(!getLoweringConfig<IREE::Codegen::LoweringConfigAttr>(contractionOp) &&
          "expected lowering_config is not set");
   auto linalgOp = cast<linalg::LinalgOp>(contractionOp.getOperation());
@@ -875,12 +1038,12 @@ static LogicalResult setRootConfig(mlir::FunctionOpInterface entryPointFn,
   if (passPipeline == TilePassPipeline::PackPeelPipeline) {
     return setRootConfigForPackPeelPipeline(
         entryPointFn, linalgOp, useLowerToAIEPipeline, targetDevice, numRows,
-        numCols, enableAMDAIEUkernels);
+        numCols, enableAMDAIEUkernels, tileSizeSelection, tuningDatabase);
   }
   if (passPipeline == TilePassPipeline::PackPeel4LevelTilingPipeline) {
     return setRootConfigForPackPeel4LevelTilingPipeline(
         entryPointFn, linalgOp, useLowerToAIEPipeline, targetDevice, numRows,
-        numCols, enableAMDAIEUkernels);
+        numCols, enableAMDAIEUkernels, tileSizeSelection, tuningDatabase);
   }
   return linalgOp.emitError("Unhandled pass pipeline in setRootConfig.");
 }
@@ -925,7 +1088,8 @@ static LogicalResult setRootConfigImpl(
     mlir::FunctionOpInterface entryPointFn, Operation *op,
     TilePassPipeline passPipeline, LowerToAIEPassPipeline useLowerToAIEPipeline,
     AMDAIEDevice targetDevice, uint32_t numRows, uint32_t numCols,
-    std::string enableAMDAIEUkernels) {
+    std::string enableAMDAIEUkernels, TileSizeSelection tileSizeSelection,
+    TuningDatabase &tuningDatabase) {
   auto setRootConfigFn = [&](Operation *op) -> LogicalResult {
     return TypeSwitch<Operation *, LogicalResult>(op)
         // TODO (nmeshram): This is very limited for now, plan is to
@@ -940,12 +1104,14 @@ static LogicalResult setRootConfigImpl(
         .Case<linalg::GenericOp>([&](auto op) {
           return setRootConfig(entryPointFn, op, passPipeline,
                                useLowerToAIEPipeline, targetDevice, numRows,
-                               numCols, enableAMDAIEUkernels);
+                               numCols, enableAMDAIEUkernels,
+                               tileSizeSelection, tuningDatabase);
         })
         .Case<linalg::ContractionOpInterface>([&](auto op) {
           return setRootConfig(entryPointFn, op, passPipeline,
                                useLowerToAIEPipeline, targetDevice, numRows,
-                               numCols, enableAMDAIEUkernels);
+                               numCols, enableAMDAIEUkernels,
+                               tileSizeSelection, tuningDatabase);
         })
         .Case<linalg::SoftmaxOp>([&](auto op) {
           return setRootConfig(entryPointFn, op, passPipeline,
@@ -962,7 +1128,8 @@ static LogicalResult setTranslationInfoAndRootConfig(
     mlir::FunctionOpInterface entryPointFn, ArrayRef<Operation *> computeOps,
     TilePassPipeline passPipeline, LowerToAIEPassPipeline useLowerToAIEPipeline,
     AMDAIEDevice targetDevice, uint32_t numRows, uint32_t numCols,
-    std::string enableAMDAIEUkernels) {
+    std::string enableAMDAIEUkernels, TileSizeSelection tileSizeSelection,
+    TuningDatabase &tuningDatabase) {
   // Make sure that lowering_config is not preset on any compute ops.
   for (auto computeOp : computeOps) {
     if (getLoweringConfig<IREE::Codegen::LoweringConfigAttr>(computeOp))
@@ -979,7 +1146,8 @@ static LogicalResult setTranslationInfoAndRootConfig(
 
   if (failed(setRootConfigImpl(entryPointFn, rootOperation, passPipeline,
                                useLowerToAIEPipeline, targetDevice, numRows,
-                               numCols, enableAMDAIEUkernels)))
+                               numCols, enableAMDAIEUkernels,
+                               tileSizeSelection, tuningDatabase)))
     return failure();
   return success();
 }
@@ -993,7 +1161,9 @@ LogicalResult initAIELaunchConfig(FunctionOpInterface funcOp,
                                   LowerToAIEPassPipeline useLowerToAIEPipeline,
                                   AMDAIEDevice targetDevice, uint32_t numRows,
                                   uint32_t numCols,
-                                  std::string enableAMDAIEUkernels) {
+                                  std::string enableAMDAIEUkernels,
+                                  TileSizeSelection tileSizeSelection,
+                                  TuningDatabase &tuningDatabase) {
   if (getTranslationInfo(funcOp)) return success();
 
   // TODO (nmeshram): Need a default pipeline for control flow cases.
@@ -1003,7 +1173,8 @@ LogicalResult initAIELaunchConfig(FunctionOpInterface funcOp,
   SmallVector<Operation *> computeOps = getComputeOps(funcOp);
   if (failed(setTranslationInfoAndRootConfig(
           funcOp, computeOps, passPipeline, useLowerToAIEPipeline, targetDevice,
-          numRows, numCols, enableAMDAIEUkernels)))
+          numRows, numCols, enableAMDAIEUkernels, tileSizeSelection,
+          tuningDatabase)))
     return failure();
 
   // The root configuration setting introduces `tensor.dim` operations.
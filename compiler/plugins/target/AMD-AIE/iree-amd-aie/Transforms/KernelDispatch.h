@@ -59,6 +59,8 @@ enum class PacketFlowStrategy {
   None,
   // Congestion-aware packet flow assignment.
   Auto,
+  // Packet flow assignment validated by a dry run of the router.
+  AutoRouted,
   // Use packet mode on all input flows.
   Inputs,
   // Use packet mode on all output flows.
@@ -67,12 +69,37 @@ enum class PacketFlowStrategy {
   All,
 };
 
+/// Enum for the strategies to select the tile sizes of matmul-like ops.
+enum class TileSizeSelection {
+  // Pick the tile sizes that use the most memory.
+  MaxMemory,
+  // Pick the tile sizes with the fewest cycles predicted by a roofline model.
+  Roofline,
+};
+
+enum class TilePlacementStrategy {
+  // Greedy placement based on the memory usage of the tiles and the columns of
+  // the users.
+  UsageAndColumn,
+  // Placement minimizing the wire length, DMA channel pressure and memory
+  // imbalance over all logical objectFifos of a memory space.
+  CostBased,
+};
+
+class TuningDatabase;
+
+/// Sets the lowering configuration of the root op of `funcOp`. The tile and
+/// pack sizes of matmul-like ops come from the record of the op in
+/// `tuningDatabase` if there is one, and from heuristics otherwise. The
+/// selected configurations are added to the selections of `tuningDatabase`.
 LogicalResult initAIELaunchConfig(FunctionOpInterface funcOp,
                                   TilePassPipeline useTilePipeline,
                                   LowerToAIEPassPipeline useLowerToAIEPipeline,
                                   AMDAIEDevice targetDevice, uint32_t numRows,
                                   uint32_t numCols,
-                                  std::string enableAMDAIEUkernels);
+                                  std::string enableAMDAIEUkernels,
+                                  TileSizeSelection tileSizeSelection,
+                                  TuningDatabase &tuningDatabase);
 
 }  // namespace mlir::iree_compiler::AMDAIE
 
@@ -661,7 +661,8 @@ void buildAMDAIETransformPassPipeline(
     PacketFlowStrategy packetFlowStrategy, bool enableCoalescingLoops,
     bool enableCollapsingUnitDims, OutliningStrategy enableFunctionOutlining,
     int callReplication, bool insertLoopAroundCoreBlock, bool enableCtrlPkt,
-    uint32_t coreStackSize) {
+    uint32_t coreStackSize, std::string tuningDatabase,
+    std::string tuningExport) {
   OpPassManager &modulePassManager = variantPassManager.nest<ModuleOp>();
   {
     FunctionLikeNest funcPassManager(modulePassManager);
@@ -678,6 +679,15 @@ void buildAMDAIETransformPassPipeline(
     options.numRows = numRows;
     options.numCols = numCols;
     options.enableAMDAIEUkernels = enableAMDAIEUkernels;
+    options.tuningDatabasePath = tuningDatabase;
+    options.tuningExportPath = tuningExport;
+    // The buffer depths and outlining strategy of the lowering, exported for
+    // the dispatches whose tuning record doesn't set them.
+    AMDAIEAssignLogicalObjectFifoDepthOptions bufferDepthOptions;
+    options.l3BufferDepth = bufferDepthOptions.l3BufferDepth;
+    options.l2BufferDepth = bufferDepthOptions.l2BufferDepth;
+    options.l1BufferDepth = bufferDepthOptions.l1BufferDepth;
+    options.outliningStrategy = enableFunctionOutlining;
     modulePassManager.addPass(createAMDAIELoweringStrategyPass(options));
   }
   modulePassManager.addPass(createLowerExecutableUsingTransformDialectPass());
@@ -855,7 +865,11 @@ void addAMDAIEObjectFifoLoweringPasses(
   passManager.addPass(createAMDAIEInsertDmaBdChainPass());
   passManager.addPass(createAMDAIEFoldDmaWaitsPass());
   passManager.addPass(createAMDAIEControlCodeLoweringPass());
-  passManager.addPass(createAMDAIEControlCodeToTransactionPass());
+  {
+    AMDAIEControlCodeToTransactionOptions options;
+    options.compactTransaction = true;
+    passManager.addPass(createAMDAIEControlCodeToTransactionPass(options));
+  }
 
   addAMDAIEToAIEPasses(passManager, insertLoopAroundCoreBlock);
 
@@ -45,7 +45,8 @@ void buildAMDAIETransformPassPipeline(
     PacketFlowStrategy packetFlowStrategy, bool enableCoalescingLoops,
     bool enableCollapsingUnitDims, OutliningStrategy enableFunctionOutlining,
     int outliningLoopInCallCount, bool insertLoopAroundCoreBlock,
-    bool emitCtrlPkt, uint32_t coreStackSize);
+    bool emitCtrlPkt, uint32_t coreStackSize, std::string tuningDatabase,
+    std::string tuningExport);
 
 /// Populates passes needed to lower the IR via a Pack-Peel based approach.
 void addPackPeelBasedPassPipeline(OpPassManager &passManager,
@@ -89,13 +90,15 @@ std::unique_ptr<Pass> createAMDAIEAssignLogicalObjectFifoDepthPass(
     AMDAIEAssignLogicalObjectFifoDepthOptions options = {});
 
 /// Create a pass to assign BD ids to `amdaie.npu.dma_cpy_nd` operations.
-std::unique_ptr<Pass> createAMDAIEAssignNpuDmaBdIdsPass();
+std::unique_ptr<Pass> createAMDAIEAssignNpuDmaBdIdsPass(
+    AMDAIEAssignNpuDmaBdIdsOptions options = {});
 
 /// Create a pass to assign packet ids to `amdaie.flow` operations.
 std::unique_ptr<Pass> createAMDAIEAssignPacketIdsPass();
 
 /// Create a pass to assign physical tile locations to logical objFifos.
-std::unique_ptr<Pass> createAMDAIEAssignTilesPass();
+std::unique_ptr<Pass> createAMDAIEAssignTilesPass(
+    AMDAIEAssignTilesOptions options = {});
 
 /// Create a pass to do some rewrites that help bridging the path to AIR/AIE
 /// lowering.
@@ -227,7 +230,8 @@ std::unique_ptr<Pass> createAMDAIEInsertLoopsForVectorizationPass(
     AMDAIEInsertLoopsForVectorizationOptions options = {});
 
 /// Create a pass to remove redundant DMA wait operations.
-std::unique_ptr<Pass> createAMDAIEFoldDmaWaitsPass();
+std::unique_ptr<Pass> createAMDAIEFoldDmaWaitsPass(
+    AMDAIEFoldDmaWaitsOptions options = {});
 
 /// Create a pass to fuse the producer operations into the scf loops.
 std::unique_ptr<Pass> createAMDAIEFuseProducerIntoLoopPass(
@@ -8,6 +8,7 @@
 #define IREE_AMD_AIE_TRANSFORMS_AMDAIETRANSFORMS_H_
 
 #include "iree-amd-aie/IR/AMDAIEOps.h"
+#include "iree-amd-aie/Transforms/KernelDispatch.h"
 #include "iree-amd-aie/aie_runtime/iree_aie_runtime.h"
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
 #include "mlir/Dialect/SCF/IR/SCF.h"
@@ -18,7 +19,9 @@ namespace mlir::iree_compiler::AMDAIE {
 LogicalResult assignTiles(
     RewriterBase &rewriter, Operation *op, const AMDAIEDeviceModel &deviceModel,
     DenseMap<Operation *, DenseSet<Operation *>> uniqueL3L2Pair,
-    bool hardwareAware = true);
+    bool hardwareAware = true,
+    TilePlacementStrategy placementStrategy =
+        TilePlacementStrategy::UsageAndColumn);
 
 /// Unroll the loops within the control code regions.
 LogicalResult controlCodeLoopUnroll(RewriterBase &rewriter,
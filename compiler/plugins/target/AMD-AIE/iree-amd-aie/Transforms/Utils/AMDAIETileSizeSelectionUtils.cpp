@@ -6,13 +6,29 @@
 
 #include "AMDAIETileSizeSelectionUtils.h"
 
+#include <algorithm>
+#include <optional>
+#include <vector>
+
 #include "AMDAIEUtils.h"
+#include "llvm/Support/MathExtras.h"
 
 namespace mlir::iree_compiler::AMDAIE {
 
 constexpr unsigned minL1TileSize = 16;
 constexpr unsigned maxL1TileSize = 128;
 
+/// Returns the L1 memory used by tiles of m x n x k, including the buffers for
+/// multi-buffering.
+int64_t getL1MemoryUsage(const TileParams& params, uint32_t m, uint32_t n,
+                         uint32_t k) {
+  uint32_t A = params.numBytesA * m * k * params.bufferDepthA;
+  uint32_t B = params.numBytesB * n * k * params.bufferDepthB;
+  uint32_t C = params.numBytesC * m * n * params.bufferDepthC;
+  uint32_t Acc = params.numBytesAcc * m * n * params.bufferDepthAcc;
+  return A + B + C + Acc;
+}
+
 void findLargestL1TileSizes(uint32_t m, uint32_t n, uint32_t k,
                             uint32_t& curMax, const TileParams& params,
                             TileSize& best) {
@@ -25,11 +41,7 @@ void findLargestL1TileSizes(uint32_t m, uint32_t n, uint32_t k,
                               (k % params.vectorK == 0);
 
   if (isInputDivisible && isIntrinsicDivisible) {
-    uint32_t A = params.numBytesA * m * k * params.bufferDepthA;
-    uint32_t B = params.numBytesB * n * k * params.bufferDepthB;
-    uint32_t C = params.numBytesC * m * n * params.bufferDepthC;
-    uint32_t Acc = params.numBytesAcc * m * n * params.bufferDepthAcc;
-    int64_t memoryUsage = A + B + C + Acc;
+    int64_t memoryUsage = getL1MemoryUsage(params, m, n, k);
 
     if (memoryUsage < params.memoryLimit && memoryUsage > curMax) {
       curMax = memoryUsage;
@@ -108,4 +120,130 @@ TileSize selectL2TileSizes(const TileParams& params, const uint32_t maxL1TileM,
   return best;
 }
 
+uint64_t predictMatmulCycles(const TileParams& params,
+                             const RooflineParams& hwParams,
+                             const MatmulTileConfig& config) {
+  using llvm::divideCeil;
+  uint64_t numArrayTiles = divideCeil(params.inputM, config.M0) *
+                           divideCeil(params.inputN, config.N0);
+  uint64_t numL1TilesPerCore =
+      numArrayTiles * divideCeil(config.M0, hwParams.numRows * config.m1) *
+      divideCeil(config.N0, hwParams.numCols * config.n1);
+  uint64_t numKernelCalls =
+      numL1TilesPerCore * divideCeil(params.inputK, config.k1);
+  uint64_t numBytesA = uint64_t(params.numBytesA) * config.m1 * config.k1;
+  uint64_t numBytesB = uint64_t(params.numBytesB) * config.k1 * config.n1;
+  uint64_t numBytesC = uint64_t(params.numBytesC) * config.m1 * config.n1;
+
+  // A core receives the A and B tiles of the next kernel call on separate
+  // channels while computing, and sends out every output tile once.
+  uint64_t numMacs = uint64_t(config.m1) * config.n1 * config.k1;
+  uint64_t computeCycles =
+      numKernelCalls * (divideCeil(numMacs, hwParams.macsPerCycle) +
+                        hwParams.kernelOverheadCycles);
+  uint64_t coreInputCycles =
+      numKernelCalls * divideCeil(std::max(numBytesA, numBytesB),
+                                  hwParams.dmaBytesPerCycle);
+  uint64_t coreOutputCycles =
+      numL1TilesPerCore * divideCeil(numBytesC, hwParams.dmaBytesPerCycle);
+  uint64_t coreCycles =
+      std::max({computeCycles, coreInputCycles, coreOutputCycles});
+
+  // The memory tiles broadcast an A tile to the cores of a row and a B tile to
+  // the cores of a column, and collect the output tiles of all cores.
+  uint64_t numCores = uint64_t(hwParams.numRows) * hwParams.numCols;
+  uint64_t memTileBandwidth = uint64_t(hwParams.numCols) *
+                              hwParams.numMemTileChannels *
+                              hwParams.dmaBytesPerCycle;
+  uint64_t firstInputBytes =
+      hwParams.numRows * numBytesA + hwParams.numCols * numBytesB;
+  uint64_t memTileOutputBytes = numKernelCalls * firstInputBytes;
+  uint64_t memTileInputBytes = numL1TilesPerCore * numCores * numBytesC;
+  uint64_t memTileCycles = divideCeil(
+      std::max(memTileOutputBytes, memTileInputBytes), memTileBandwidth);
+
+  // The shim tiles load the rows of A and columns of B of every array tile and
+  // store the output once.
+  uint64_t shimBandwidth = uint64_t(hwParams.numCols) *
+                           hwParams.numShimChannels *
+                           hwParams.dmaBytesPerCycle;
+  uint64_t shimInputBytes = numArrayTiles * params.inputK *
+                            (uint64_t(params.numBytesA) * config.M0 +
+                             uint64_t(params.numBytesB) * config.N0);
+  uint64_t shimOutputBytes =
+      uint64_t(params.numBytesC) * params.inputM * params.inputN;
+  uint64_t shimCycles =
+      divideCeil(std::max(shimInputBytes, shimOutputBytes), shimBandwidth);
+
+  // The inputs of the first kernel call have to be loaded before any
+  // computation can start.
+  uint64_t fillCycles =
+      divideCeil(firstInputBytes, shimBandwidth) +
+      divideCeil(std::max(numBytesA, numBytesB), hwParams.dmaBytesPerCycle);
+  return std::max({coreCycles, memTileCycles, shimCycles}) + fillCycles;
+}
+
+MatmulTileConfig selectMatmulTileConfig(const TileParams& params,
+                                        const RooflineParams& hwParams,
+                                        std::optional<int64_t> l2MemoryLimit) {
+  auto getArrayTileConfig = [&](uint32_t m1, uint32_t n1, uint32_t k1) {
+    uint32_t M0 = detail::findLargestFactor(params.inputM,
+                                            hwParams.numRows * m1, m1);
+    uint32_t N0 = detail::findLargestFactor(params.inputN,
+                                            hwParams.numCols * n1, n1);
+    if (l2MemoryLimit) {
+      // Grow the array tile from the tile of a single core until it fills the
+      // memory tiles.
+      uint32_t m0Pack = (M0 / hwParams.numRows) % params.vectorM == 0
+                            ? M0 / hwParams.numRows
+                            : M0;
+      uint32_t n0Pack = (N0 / hwParams.numCols) % params.vectorN == 0
+                            ? N0 / hwParams.numCols
+                            : N0;
+      TileParams l2Params = params;
+      l2Params.memoryLimit = *l2MemoryLimit;
+      TileSize l2Size = selectL2TileSizes(l2Params, m0Pack, n0Pack);
+      M0 = l2Size.M;
+      N0 = l2Size.N;
+    }
+    return MatmulTileConfig{M0, N0, m1, n1, k1};
+  };
+  // The L1 tile sizes that are multiples of the intrinsic size and divide the
+  // input size.
+  auto getCandidates = [](uint32_t inputSize, uint32_t vectorSize) {
+    std::vector<uint32_t> candidates;
+    uint32_t minSize = std::min<uint32_t>(minL1TileSize, inputSize);
+    uint32_t maxSize = std::min<uint32_t>(maxL1TileSize, inputSize);
+    for (uint32_t size = vectorSize; size <= maxSize; size += vectorSize) {
+      if (size >= minSize && inputSize % size == 0)
+        candidates.push_back(size);
+    }
+    return candidates;
+  };
+
+  std::optional<MatmulTileConfig> best;
+  uint64_t bestCycles = 0;
+  int64_t bestMemoryUsage = 0;
+  for (uint32_t m1 : getCandidates(params.inputM, params.vectorM)) {
+    for (uint32_t n1 : getCandidates(params.inputN, params.vectorN)) {
+      for (uint32_t k1 : getCandidates(params.inputK, params.vectorK)) {
+        int64_t memoryUsage = getL1MemoryUsage(params, m1, n1, k1);
+        if (memoryUsage >= params.memoryLimit) continue;
+        MatmulTileConfig config = getArrayTileConfig(m1, n1, k1);
+        uint64_t cycles = predictMatmulCycles(params, hwParams, config);
+        if (!best || cycles < bestCycles ||
+            (cycles == bestCycles && memoryUsage > bestMemoryUsage)) {
+          best = config;
+          bestCycles = cycles;
+          bestMemoryUsage = memoryUsage;
+        }
+      }
+    }
+  }
+  if (best) return *best;
+  // No candidate fits, fall back to the default selection.
+  TileSize l1Size = selectL1TileSizes(params);
+  return getArrayTileConfig(l1Size.M, l1Size.N, l1Size.K);
+}
+
 }  // namespace mlir::iree_compiler::AMDAIE
@@ -9,6 +9,8 @@
 
 #include <stdint.h>
 
+#include <optional>
+
 namespace mlir::iree_compiler::AMDAIE {
 
 struct TileParams {
@@ -31,6 +33,50 @@ TileSize selectL1TileSizes(const TileParams& params);
 TileSize selectL2TileSizes(const TileParams& params, const uint32_t maxL1TileM,
                            const uint32_t maxL1TileN);
 
+/// Hardware parameters of the roofline model of a matmul on an array of
+/// `numRows` x `numCols` cores.
+struct RooflineParams {
+  uint32_t numRows, numCols;
+  /// Multiply-accumulates per cycle of a core.
+  uint32_t macsPerCycle;
+  /// Bytes per cycle of a DMA channel.
+  uint32_t dmaBytesPerCycle;
+  /// Number of DMA channels per direction of a shim tile and a memory tile.
+  uint32_t numShimChannels, numMemTileChannels;
+  /// Fixed cycles of every call of the kernel on an L1 tile.
+  uint32_t kernelOverheadCycles;
+};
+
+/// Tile sizes of a matmul: M0 x N0 is the output tile of the whole array, of
+/// which every core computes tiles of m1 x n1, stepping through K by k1.
+struct MatmulTileConfig {
+  uint32_t M0, N0, m1, n1, k1;
+  bool operator==(const MatmulTileConfig& config) const {
+    return M0 == config.M0 && N0 == config.N0 && m1 == config.m1 &&
+           n1 == config.n1 && k1 == config.k1;
+  }
+};
+
+/// Returns the number of cycles predicted by a roofline model for the matmul
+/// described by `params` with the tile sizes of `config`. The cores, the
+/// memory tiles feeding them and the shim tiles feeding the memory tiles are
+/// assumed to work in parallel, so the slowest of them bounds the total. The
+/// load of the first tile can't overlap with any computation and is added.
+uint64_t predictMatmulCycles(const TileParams& params,
+                             const RooflineParams& hwParams,
+                             const MatmulTileConfig& config);
+
+/// Returns the tile sizes with the fewest cycles predicted by
+/// `predictMatmulCycles`, among the L1 tiles that fit into
+/// `params.memoryLimit`. Like for the pack-peel pipeline, M0 and N0 are the
+/// largest factors of M and N up to `numRows` x m1 and `numCols` x n1. If
+/// `l2MemoryLimit` is set, they are instead selected by `selectL2TileSizes`
+/// with that limit, like for the pack-peel-4-level-tiling pipeline. Ties are
+/// broken in favour of the tile using the most memory.
+MatmulTileConfig selectMatmulTileConfig(
+    const TileParams& params, const RooflineParams& hwParams,
+    std::optional<int64_t> l2MemoryLimit = std::nullopt);
+
 }  // namespace mlir::iree_compiler::AMDAIE
 
 #endif
@@ -40,6 +40,16 @@ ArrayRef<uint32_t> TransactionBuilder::finalizeAndReturnInstructions() {
   return ArrayRef<uint32_t>(instructions.data(), instructions.size());
 }
 
+LogicalResult TransactionBuilder::compactInstructions() {
+  FailureOr<std::vector<uint32_t>> maybeCompacted = compactTransaction(
+      deviceModel, reinterpret_cast<const uint8_t *>(instructions.data()));
+  if (failed(maybeCompacted)) return failure();
+  instructions = std::move(maybeCompacted.value());
+  LLVM_DEBUG(llvm::dbgs() << "Compacted instruction size: "
+                          << getInstructionSize() << "\n");
+  return success();
+}
+
 void TransactionBuilder::dumpTransactionAsHex() const {
   llvm::outs() << "Transaction: \n";
   for (uint32_t word : instructions) {
@@ -24,6 +24,9 @@ class TransactionBuilder {
   void dumpTransactionAsHex() const;
   size_t getInstructionSize() const;
   ArrayRef<uint32_t> finalizeAndReturnInstructions();
+  /// Compacts the finalized instructions, see `compactTransaction`.
+  LogicalResult compactInstructions();
+  ArrayRef<uint32_t> getInstructions() const { return instructions; }
 
   LogicalResult appendAddressPatch(uint32_t addr, uint32_t argIdx,
                                    uint32_t offset);
@@ -0,0 +1,302 @@
+// Copyright 2025 The IREE Authors
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "AMDAIETuningDatabase.h"
+
+#include <limits>
+#include <mutex>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/ADT/StringSwitch.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace mlir::iree_compiler::AMDAIE {
+
+namespace {
+
+constexpr StringLiteral kOpKey = "op";
+constexpr StringLiteral kShapeKey = "shape";
+constexpr StringLiteral kElementTypesKey = "element_types";
+constexpr StringLiteral kDeviceKey = "device";
+constexpr StringLiteral kNumRowsKey = "num_rows";
+constexpr StringLiteral kNumColsKey = "num_cols";
+constexpr StringLiteral kTileSizesKey = "tile_sizes";
+constexpr StringLiteral kPackSizesKey = "pack_sizes";
+constexpr StringLiteral kBufferDepthsKey = "buffer_depths";
+constexpr StringLiteral kOutliningKey = "outlining";
+
+/// Returns `value` as a positive integer that fits into a uint32_t.
+std::optional<uint32_t> getPositiveInteger(const llvm::json::Value &value) {
+  std::optional<int64_t> maybeInteger = value.getAsInteger();
+  if (!maybeInteger || *maybeInteger <= 0 ||
+      *maybeInteger > std::numeric_limits<uint32_t>::max()) {
+    return std::nullopt;
+  }
+  return static_cast<uint32_t>(*maybeInteger);
+}
+
+/// Returns `value` as an array of three positive integers.
+std::optional<std::array<uint32_t, 3>> getTriple(
+    const llvm::json::Value &value) {
+  const llvm::json::Array *array = value.getAsArray();
+  if (!array || array->size() != 3) return std::nullopt;
+  std::array<uint32_t, 3> triple;
+  for (auto &&[i, element] : llvm::enumerate(*array)) {
+    std::optional<uint32_t> maybeInteger = getPositiveInteger(element);
+    if (!maybeInteger) return std::nullopt;
+    triple[i] = *maybeInteger;
+  }
+  return triple;
+}
+
+FailureOr<TuningRecord> parseRecord(const llvm::json::Object &object,
+                                    std::string &errorMessage) {
+  auto fail = [&](StringRef key) {
+    errorMessage = ("missing or invalid field `" + key + "`").str();
+    return failure();
+  };
+  static const llvm::StringSet<> knownKeys = {
+      kOpKey,        kShapeKey,     kElementTypesKey, kDeviceKey,
+      kNumRowsKey,   kNumColsKey,   kTileSizesKey,    kPackSizesKey,
+      kBufferDepthsKey, kOutliningKey};
+  for (const auto &[key, value] : object) {
+    if (!knownKeys.contains(key)) {
+      errorMessage = ("unknown field `" + StringRef(key) + "`").str();
+      return failure();
+    }
+  }
+
+  TuningRecord record;
+  TuningKey &key = record.key;
+  std::optional<StringRef> maybeOpName = object.getString(kOpKey);
+  if (!maybeOpName) return fail(kOpKey);
+  key.opName = maybeOpName->str();
+
+  const llvm::json::Array *shape = object.getArray(kShapeKey);
+  if (!shape || shape->empty()) return fail(kShapeKey);
+  for (const llvm::json::Value &size : *shape) {
+    std::optional<int64_t> maybeSize = size.getAsInteger();
+    if (!maybeSize || *maybeSize <= 0) return fail(kShapeKey);
+    key.shape.push_back(*maybeSize);
+  }
+
+  const llvm::json::Array *elementTypes = object.getArray(kElementTypesKey);
+  if (!elementTypes || elementTypes->empty()) return fail(kElementTypesKey);
+  for (const llvm::json::Value &elementType : *elementTypes) {
+    std::optional<StringRef> maybeElementType = elementType.getAsString();
+    if (!maybeElementType) return fail(kElementTypesKey);
+    key.elementTypes.push_back(maybeElementType->str());
+  }
+
+  std::optional<StringRef> maybeDevice = object.getString(kDeviceKey);
+  if (!maybeDevice) return fail(kDeviceKey);
+  key.device = maybeDevice->str();
+
+  const llvm::json::Value *numRows = object.get(kNumRowsKey);
+  std::optional<uint32_t> maybeNumRows =
+      numRows ? getPositiveInteger(*numRows) : std::nullopt;
+  if (!maybeNumRows) return fail(kNumRowsKey);
+  key.numRows = *maybeNumRows;
+
+  const llvm::json::Value *numCols = object.get(kNumColsKey);
+  std::optional<uint32_t> maybeNumCols =
+      numCols ? getPositiveInteger(*numCols) : std::nullopt;
+  if (!maybeNumCols) return fail(kNumColsKey);
+  key.numCols = *maybeNumCols;
+
+  TuningConfig &config = record.config;
+  if (const llvm::json::Value *tileSizes = object.get(kTileSizesKey)) {
+    config.tileSizes = getTriple(*tileSizes);
+    if (!config.tileSizes) return fail(kTileSizesKey);
+  }
+  if (const llvm::json::Value *packSizes = object.get(kPackSizesKey)) {
+    const llvm::json::Array *levels = packSizes->getAsArray();
+    if (!levels || levels->size() != 2) return fail(kPackSizesKey);
+    config.packSizesL0 = getTriple((*levels)[0]);
+    config.packSizesL1 = getTriple((*levels)[1]);
+    if (!config.packSizesL0 || !config.packSizesL1) return fail(kPackSizesKey);
+  }
+  if (const llvm::json::Value *bufferDepths = object.get(kBufferDepthsKey)) {
+    config.bufferDepths = getTriple(*bufferDepths);
+    if (!config.bufferDepths ||
+        llvm::any_of(*config.bufferDepths, [](uint32_t depth) {
+          return depth > kMaxTuningBufferDepth;
+        })) {
+      return fail(kBufferDepthsKey);
+    }
+  }
+  if (const llvm::json::Value *outlining = object.get(kOutliningKey)) {
+    std::optional<StringRef> maybeOutlining = outlining->getAsString();
+    if (maybeOutlining)
+      config.outlining = symbolizeOutliningStrategy(*maybeOutlining);
+    if (!config.outlining) return fail(kOutliningKey);
+  }
+  return record;
+}
+
+}  // namespace
+
+std::optional<OutliningStrategy> symbolizeOutliningStrategy(StringRef str) {
+  return llvm::StringSwitch<std::optional<OutliningStrategy>>(str)
+      .Case("none", OutliningStrategy::None)
+      .Case("all", OutliningStrategy::All)
+      .Case("balanced", OutliningStrategy::Balanced)
+      .Default(std::nullopt);
+}
+
+StringRef stringifyOutliningStrategy(OutliningStrategy strategy) {
+  switch (strategy) {
+    case OutliningStrategy::None:
+      return "none";
+    case OutliningStrategy::All:
+      return "all";
+    case OutliningStrategy::Balanced:
+      return "balanced";
+  }
+  llvm_unreachable("unhandled outlining strategy");
+}
+
+FailureOr<TuningDatabase> TuningDatabase::load(StringRef path,
+                                               std::string &errorMessage) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> maybeBuffer =
+      llvm::MemoryBuffer::getFile(path, /*IsText=*/true);
+  if (!maybeBuffer) {
+    errorMessage = ("failed to read tuning database " + path + ": " +
+                    maybeBuffer.getError().message())
+                       .str();
+    return failure();
+  }
+  FailureOr<TuningDatabase> maybeDatabase =
+      parse((*maybeBuffer)->getBuffer(), errorMessage);
+  if (failed(maybeDatabase))
+    errorMessage = (path + ":" + errorMessage).str();
+  return maybeDatabase;
+}
+
+FailureOr<TuningDatabase> TuningDatabase::parse(StringRef contents,
+                                                std::string &errorMessage) {
+  TuningDatabase database;
+  SmallVector<StringRef> lines;
+  contents.split(lines, '\n');
+  for (auto &&[lineIndex, line] : llvm::enumerate(lines)) {
+    auto fail = [&, lineIndex = lineIndex](const Twine &message) {
+      errorMessage =
+          (Twine(lineIndex + 1) + ": invalid tuning record: " + message).str();
+      return failure();
+    };
+    StringRef trimmedLine = line.trim();
+    if (trimmedLine.empty() || trimmedLine.starts_with("#")) continue;
+    llvm::Expected<llvm::json::Value> maybeValue =
+        llvm::json::parse(trimmedLine);
+    if (!maybeValue) return fail(llvm::toString(maybeValue.takeError()));
+    const llvm::json::Object *object = maybeValue->getAsObject();
+    if (!object) return fail("expected an object");
+    std::string recordErrorMessage;
+    FailureOr<TuningRecord> maybeRecord =
+        parseRecord(*object, recordErrorMessage);
+    if (failed(maybeRecord)) return fail(recordErrorMessage);
+    database.insert(std::move(maybeRecord.value()));
+  }
+  return database;
+}
+
+std::string TuningDatabase::serialize(const TuningRecord &record) {
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  llvm::json::OStream json(os);
+  auto writeTriple = [&](const std::array<uint32_t, 3> &triple) {
+    json.array([&] {
+      for (uint32_t value : triple) json.value(value);
+    });
+  };
+  const TuningKey &key = record.key;
+  const TuningConfig &config = record.config;
+  json.object([&] {
+    json.attribute(kOpKey, key.opName);
+    json.attributeArray(kShapeKey, [&] {
+      for (int64_t size : key.shape) json.value(size);
+    });
+    json.attributeArray(kElementTypesKey, [&] {
+      for (const std::string &elementType : key.elementTypes)
+        json.value(elementType);
+    });
+    json.attribute(kDeviceKey, key.device);
+    json.attribute(kNumRowsKey, key.numRows);
+    json.attribute(kNumColsKey, key.numCols);
+    if (config.tileSizes) {
+      json.attributeBegin(kTileSizesKey);
+      writeTriple(*config.tileSizes);
+      json.attributeEnd();
+    }
+    if (config.packSizesL0 && config.packSizesL1) {
+      json.attributeArray(kPackSizesKey, [&] {
+        writeTriple(*config.packSizesL0);
+        writeTriple(*config.packSizesL1);
+      });
+    }
+    if (config.bufferDepths) {
+      json.attributeBegin(kBufferDepthsKey);
+      writeTriple(*config.bufferDepths);
+      json.attributeEnd();
+    }
+    if (config.outlining) {
+      json.attribute(kOutliningKey,
+                     stringifyOutliningStrategy(*config.outlining));
+    }
+  });
+  return str;
+}
+
+LogicalResult TuningDatabase::append(StringRef path,
+                                     ArrayRef<TuningRecord> records,
+                                     std::string &errorMessage) {
+  if (records.empty()) return success();
+  // Dispatches are compiled in parallel, so serialize the writes of this
+  // process to keep the records on separate lines.
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  std::error_code ec;
+  llvm::raw_fd_ostream os(path, ec,
+                          llvm::sys::fs::OF_Append | llvm::sys::fs::OF_Text);
+  if (ec) {
+    errorMessage =
+        ("failed to open tuning export " + path + ": " + ec.message()).str();
+    return failure();
+  }
+  for (const TuningRecord &record : records) os << serialize(record) << "\n";
+  os.close();
+  if (os.has_error()) {
+    errorMessage = ("failed to write tuning export " + path + ": " +
+                    os.error().message())
+                       .str();
+    os.clear_error();
+    return failure();
+  }
+  return success();
+}
+
+std::optional<TuningConfig> TuningDatabase::lookup(const TuningKey &key) const {
+  for (const TuningRecord &record : records) {
+    if (record.key == key) return record.config;
+  }
+  return std::nullopt;
+}
+
+void TuningDatabase::insert(TuningRecord record) {
+  for (TuningRecord &existingRecord : records) {
+    if (existingRecord.key == record.key) {
+      existingRecord = std::move(record);
+      return;
+    }
+  }
+  records.push_back(std::move(record));
+}
+
+}  // namespace mlir::iree_compiler::AMDAIE
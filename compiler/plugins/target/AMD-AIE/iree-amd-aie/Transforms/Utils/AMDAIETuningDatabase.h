@@ -0,0 +1,134 @@
+// Copyright 2025 The IREE Authors
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#ifndef IREE_AMD_AIE_TRANSFORMS_AMDAIETUNINGDATABASE_H_
+#define IREE_AMD_AIE_TRANSFORMS_AMDAIETUNINGDATABASE_H_
+
+#include <array>
+#include <optional>
+#include <string>
+
+#include "iree-amd-aie/Transforms/KernelDispatch.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "mlir/Support/LogicalResult.h"
+
+namespace mlir::iree_compiler::AMDAIE {
+
+/// Name of the function attribute holding the L3, L2 and L1 buffer depths of
+/// the tuning record applied to a dispatch.
+constexpr StringLiteral kTuningBufferDepthsAttrName =
+    "amdaie.tuning.buffer_depths";
+/// Name of the function attribute holding the outlining strategy of the tuning
+/// record applied to a dispatch.
+constexpr StringLiteral kTuningOutliningAttrName = "amdaie.tuning.outlining";
+/// The largest buffer depth of a tuning record, as the depth of a logical
+/// objectFifo is 8 bits.
+constexpr uint32_t kMaxTuningBufferDepth = 255;
+
+/// Converts between an outlining strategy and its name in tuning records and
+/// in the `kTuningOutliningAttrName` attribute.
+std::optional<OutliningStrategy> symbolizeOutliningStrategy(StringRef str);
+StringRef stringifyOutliningStrategy(OutliningStrategy strategy);
+
+/// The problem a tuning record applies to.
+struct TuningKey {
+  /// Name of the root op, e.g. `linalg.matmul`.
+  std::string opName;
+  /// Static loop ranges of the root op.
+  SmallVector<int64_t> shape;
+  /// Element types of the lhs, rhs and init operands, e.g. `bf16`.
+  SmallVector<std::string> elementTypes;
+  /// Target device, e.g. `npu1_4col`.
+  std::string device;
+  uint32_t numRows;
+  uint32_t numCols;
+
+  bool operator==(const TuningKey &key) const {
+    return opName == key.opName && shape == key.shape &&
+           elementTypes == key.elementTypes && device == key.device &&
+           numRows == key.numRows && numCols == key.numCols;
+  }
+};
+
+/// The configuration of a tuning record. Fields that aren't set are selected by
+/// the heuristics.
+struct TuningConfig {
+  /// Tile sizes (M0, N0, K0) of the whole array.
+  std::optional<std::array<uint32_t, 3>> tileSizes;
+  /// Pack sizes (m, n, k) of the first packing level.
+  std::optional<std::array<uint32_t, 3>> packSizesL0;
+  /// Pack sizes (m, n, k) of the second packing level.
+  std::optional<std::array<uint32_t, 3>> packSizesL1;
+  /// Depths of the L3, L2 and L1 buffers, at most `kMaxTuningBufferDepth`.
+  std::optional<std::array<uint32_t, 3>> bufferDepths;
+  std::optional<OutliningStrategy> outlining;
+};
+
+struct TuningRecord {
+  TuningKey key;
+  TuningConfig config;
+};
+
+/// A set of tuning records, typically found by sweeping configurations on
+/// hardware. Records are stored as one JSON object per line, e.g. (on a single
+/// line):
+///
+///   {"op": "linalg.matmul", "shape": [128, 128, 256],
+///    "element_types": ["bf16", "bf16", "f32"], "device": "npu1_4col",
+///    "num_rows": 4, "num_cols": 4, "tile_sizes": [128, 128, 1],
+///    "pack_sizes": [[32, 32, 64], [4, 4, 8]], "buffer_depths": [1, 2, 2],
+///    "outlining": "balanced"}
+///
+/// The first six fields form the key and are required, the others are
+/// optional. Empty lines and lines starting with `#` are ignored. A record
+/// overrides earlier records with the same key, so records can be appended to
+/// a file.
+class TuningDatabase {
+ public:
+  /// Parses the records of the file at `path`. On failure, `errorMessage`
+  /// describes the problem.
+  static FailureOr<TuningDatabase> load(StringRef path,
+                                        std::string &errorMessage);
+
+  /// Parses the records of `contents`. On failure, `errorMessage` describes
+  /// the problem.
+  static FailureOr<TuningDatabase> parse(StringRef contents,
+                                         std::string &errorMessage);
+
+  /// Returns the record as a single line of JSON, as expected by `parse`.
+  static std::string serialize(const TuningRecord &record);
+
+  /// Appends the `records` to the file at `path`, which is created if it
+  /// doesn't exist. Safe to call from multiple threads.
+  static LogicalResult append(StringRef path, ArrayRef<TuningRecord> records,
+                              std::string &errorMessage);
+
+  /// Returns the configuration of the record with `key`, if there is one.
+  std::optional<TuningConfig> lookup(const TuningKey &key) const;
+
+  /// Adds `record`, replacing the record with the same key if there is one.
+  void insert(TuningRecord record);
+
+  ArrayRef<TuningRecord> getRecords() const { return records; }
+
+  /// The configurations selected for the dispatches, whether from a record or
+  /// by the heuristics, to be exported with `append`.
+  void addSelection(TuningRecord record) {
+    selections.push_back(std::move(record));
+  }
+  ArrayRef<TuningRecord> getSelections() const { return selections; }
+  void clearSelections() { selections.clear(); }
+
+ private:
+  SmallVector<TuningRecord> records;
+  SmallVector<TuningRecord> selections;
+};
+
+}  // namespace mlir::iree_compiler::AMDAIE
+
+#endif
@@ -121,6 +121,65 @@ TEST(SelectTileSizeTest, L2TileSizeTest) {
             (TileSize{1024, 1024, 512}));
 }
 
+TEST(SelectTileSizeTest, RooflineModelTest) {
+  // The hardware params are {numRows, numCols, macsPerCycle, dmaBytesPerCycle,
+  // numShimChannels, numMemTileChannels, kernelOverheadCycles}.
+  RooflineParams npu1{4, 4, 128, 4, 2, 6, 64};
+
+  // (bf16, bf16) -> f32.
+  TileParams params{65536, 2, 2, 4, 4, 2, 2, 2, 0, 512, 512, 512, 4, 4, 8};
+  MatmulTileConfig config = selectMatmulTileConfig(params, npu1);
+  EXPECT_EQ(config, (MatmulTileConfig{256, 256, 64, 64, 32}));
+  EXPECT_EQ(predictMatmulCycles(params, npu1, config), 71680);
+  // The model can't predict fewer cycles than the cores need for all MACs.
+  EXPECT_GE(predictMatmulCycles(params, npu1, config),
+            512 * 512 * 512 / (16 * 128));
+  // The tile sizes picked by `selectL1TileSizes` are bound by the streams into
+  // the cores and are predicted to be slower.
+  EXPECT_EQ(predictMatmulCycles(params, npu1, {128, 128, 32, 32, 128}),
+            135168);
+  // Compute bound: a higher kernel overhead makes every tile slower.
+  RooflineParams npu1HighOverhead = npu1;
+  npu1HighOverhead.kernelOverheadCycles = 128;
+  EXPECT_GT(predictMatmulCycles(params, npu1HighOverhead, config),
+            predictMatmulCycles(params, npu1, config));
+
+  // (bf16, bf16) -> bf16.
+  EXPECT_EQ(
+      (selectMatmulTileConfig(
+          {65536, 2, 2, 2, 2, 2, 2, 2, 0, 512, 512, 512, 4, 4, 8}, npu1)),
+      (MatmulTileConfig{256, 512, 64, 128, 32}));
+  // (i8, i8) -> i32.
+  EXPECT_EQ((selectMatmulTileConfig(
+                {65536, 1, 1, 4, 4, 2, 2, 2, 0, 512, 512, 512, 4, 8, 8},
+                {4, 4, 256, 4, 2, 6, 64})),
+            (MatmulTileConfig{256, 256, 64, 64, 64}));
+  // M doesn't divide evenly over the rows of the array.
+  EXPECT_EQ(
+      (selectMatmulTileConfig(
+          {65536, 2, 2, 4, 4, 2, 2, 2, 0, 308, 2432, 9728, 4, 4, 8}, npu1)),
+      (MatmulTileConfig{44, 304, 44, 76, 16}));
+
+  // Smaller input shapes, where the fill of the pipeline is significant.
+  EXPECT_EQ(
+      (selectMatmulTileConfig(
+          {65536, 2, 2, 4, 4, 2, 2, 2, 0, 128, 128, 128, 4, 4, 8}, npu1)),
+      (MatmulTileConfig{128, 128, 32, 32, 16}));
+  EXPECT_EQ((selectMatmulTileConfig(
+                {65536, 4, 4, 4, 4, 2, 2, 2, 0, 32, 32, 32, 4, 4, 8}, npu1)),
+            (MatmulTileConfig{32, 32, 16, 16, 16}));
+
+  // With the L2 tile sizes of the 4-level tiling pipeline, the array tile
+  // fills the memory tiles of the 4 columns.
+  TileParams largeParams{65536, 2, 2, 4, 4, 2, 2, 2, 0, 2048, 2048, 128, 4, 4,
+                         8};
+  EXPECT_EQ(selectMatmulTileConfig(largeParams, npu1),
+            (MatmulTileConfig{128, 128, 32, 32, 16}));
+  EXPECT_EQ(selectMatmulTileConfig(largeParams, npu1,
+                                   /*l2MemoryLimit=*/4 * 524288),
+            (MatmulTileConfig{512, 256, 32, 32, 16}));
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
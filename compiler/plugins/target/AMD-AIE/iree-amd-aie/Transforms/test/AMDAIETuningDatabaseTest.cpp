@@ -0,0 +1,173 @@
+// Copyright 2025 The IREE Authors
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <fstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "iree-amd-aie/Transforms/Utils/AMDAIETuningDatabase.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+
+namespace {
+
+using namespace mlir::iree_compiler::AMDAIE;
+
+TuningKey getMatmulKey() {
+  return TuningKey{"linalg.matmul", {128, 128, 256}, {"bf16", "bf16", "f32"},
+                   "npu1_4col",     4,               4};
+}
+
+TEST(TuningDatabaseTest, Parse) {
+  std::string errorMessage;
+  mlir::FailureOr<TuningDatabase> maybeDatabase = TuningDatabase::parse(
+      "# Found by sweeping on npu1.\n"
+      "\n"
+      "{\"op\": \"linalg.matmul\", \"shape\": [128, 128, 256], "
+      "\"element_types\": [\"bf16\", \"bf16\", \"f32\"], \"device\": "
+      "\"npu1_4col\", \"num_rows\": 4, \"num_cols\": 4, \"tile_sizes\": [64, "
+      "128, 1], \"pack_sizes\": [[16, 32, 64], [4, 4, 8]], \"buffer_depths\": "
+      "[1, 2, 1], \"outlining\": \"none\"}\n",
+      errorMessage);
+  ASSERT_TRUE(mlir::succeeded(maybeDatabase)) << errorMessage;
+  ASSERT_EQ(maybeDatabase->getRecords().size(), 1);
+
+  std::optional<TuningConfig> maybeConfig =
+      maybeDatabase->lookup(getMatmulKey());
+  ASSERT_TRUE(maybeConfig.has_value());
+  EXPECT_EQ(maybeConfig->tileSizes, (std::array<uint32_t, 3>{64, 128, 1}));
+  EXPECT_EQ(maybeConfig->packSizesL0, (std::array<uint32_t, 3>{16, 32, 64}));
+  EXPECT_EQ(maybeConfig->packSizesL1, (std::array<uint32_t, 3>{4, 4, 8}));
+  EXPECT_EQ(maybeConfig->bufferDepths, (std::array<uint32_t, 3>{1, 2, 1}));
+  EXPECT_EQ(maybeConfig->outlining, OutliningStrategy::None);
+
+  // The record doesn't apply to another array size.
+  TuningKey key = getMatmulKey();
+  key.numCols = 2;
+  EXPECT_FALSE(maybeDatabase->lookup(key).has_value());
+}
+
+TEST(TuningDatabaseTest, PartialConfig) {
+  std::string errorMessage;
+  mlir::FailureOr<TuningDatabase> maybeDatabase = TuningDatabase::parse(
+      "{\"op\": \"linalg.matmul\", \"shape\": [128, 128, 256], "
+      "\"element_types\": [\"bf16\", \"bf16\", \"f32\"], \"device\": "
+      "\"npu1_4col\", \"num_rows\": 4, \"num_cols\": 4, \"buffer_depths\": "
+      "[1, 2, 1]}",
+      errorMessage);
+  ASSERT_TRUE(mlir::succeeded(maybeDatabase)) << errorMessage;
+  std::optional<TuningConfig> maybeConfig =
+      maybeDatabase->lookup(getMatmulKey());
+  ASSERT_TRUE(maybeConfig.has_value());
+  EXPECT_FALSE(maybeConfig->tileSizes.has_value());
+  EXPECT_FALSE(maybeConfig->packSizesL0.has_value());
+  EXPECT_FALSE(maybeConfig->outlining.has_value());
+  EXPECT_EQ(maybeConfig->bufferDepths, (std::array<uint32_t, 3>{1, 2, 1}));
+}
+
+TEST(TuningDatabaseTest, LaterRecordOverrides) {
+  TuningDatabase database;
+  database.insert({getMatmulKey(), {{{128, 128, 1}}}});
+  database.insert({getMatmulKey(), {{{64, 64, 1}}}});
+  ASSERT_EQ(database.getRecords().size(), 1);
+  EXPECT_EQ(database.lookup(getMatmulKey())->tileSizes,
+            (std::array<uint32_t, 3>{64, 64, 1}));
+}
+
+TEST(TuningDatabaseTest, ParseErrors) {
+  std::string errorMessage;
+  EXPECT_TRUE(mlir::failed(TuningDatabase::parse("{", errorMessage)));
+  EXPECT_EQ(errorMessage.rfind("1: invalid tuning record", 0), 0);
+
+  // Missing key field.
+  EXPECT_TRUE(mlir::failed(TuningDatabase::parse(
+      "{\"op\": \"linalg.matmul\", \"shape\": [128, 128, 256], "
+      "\"element_types\": [\"bf16\", \"bf16\", \"f32\"], \"num_rows\": 4, "
+      "\"num_cols\": 4}",
+      errorMessage)));
+  EXPECT_NE(errorMessage.find("`device`"), std::string::npos);
+
+  // Tile sizes have to be positive.
+  EXPECT_TRUE(mlir::failed(TuningDatabase::parse(
+      "\n{\"op\": \"linalg.matmul\", \"shape\": [128, 128, 256], "
+      "\"element_types\": [\"bf16\", \"bf16\", \"f32\"], \"device\": "
+      "\"npu1_4col\", \"num_rows\": 4, \"num_cols\": 4, \"tile_sizes\": [0, "
+      "128, 1]}",
+      errorMessage)));
+  EXPECT_EQ(errorMessage.rfind("2: invalid tuning record", 0), 0);
+  EXPECT_NE(errorMessage.find("`tile_sizes`"), std::string::npos);
+
+  // Buffer depths have to fit into the depth of a logical objectFifo.
+  EXPECT_TRUE(mlir::failed(TuningDatabase::parse(
+      "{\"op\": \"linalg.matmul\", \"shape\": [128, 128, 256], "
+      "\"element_types\": [\"bf16\", \"bf16\", \"f32\"], \"device\": "
+      "\"npu1_4col\", \"num_rows\": 4, \"num_cols\": 4, \"buffer_depths\": "
+      "[1, 256, 2]}",
+      errorMessage)));
+  EXPECT_NE(errorMessage.find("`buffer_depths`"), std::string::npos);
+
+  // Unknown fields are rejected, to catch typos.
+  EXPECT_TRUE(mlir::failed(TuningDatabase::parse(
+      "{\"op\": \"linalg.matmul\", \"shape\": [128, 128, 256], "
+      "\"element_types\": [\"bf16\", \"bf16\", \"f32\"], \"device\": "
+      "\"npu1_4col\", \"num_rows\": 4, \"num_cols\": 4, \"tile_size\": [64, "
+      "128, 1]}",
+      errorMessage)));
+  EXPECT_NE(errorMessage.find("unknown field `tile_size`"), std::string::npos);
+}
+
+TEST(TuningDatabaseTest, SerializeRoundTrip) {
+  TuningRecord record{getMatmulKey(), {}};
+  record.config.tileSizes = {64, 128, 1};
+  record.config.packSizesL0 = {16, 32, 64};
+  record.config.packSizesL1 = {4, 4, 8};
+  record.config.outlining = OutliningStrategy::Balanced;
+  std::string line = TuningDatabase::serialize(record);
+  EXPECT_EQ(line.find('\n'), std::string::npos);
+
+  std::string errorMessage;
+  mlir::FailureOr<TuningDatabase> maybeDatabase =
+      TuningDatabase::parse(line, errorMessage);
+  ASSERT_TRUE(mlir::succeeded(maybeDatabase)) << errorMessage;
+  std::optional<TuningConfig> maybeConfig =
+      maybeDatabase->lookup(getMatmulKey());
+  ASSERT_TRUE(maybeConfig.has_value());
+  EXPECT_EQ(maybeConfig->tileSizes, record.config.tileSizes);
+  EXPECT_EQ(maybeConfig->packSizesL0, record.config.packSizesL0);
+  EXPECT_EQ(maybeConfig->packSizesL1, record.config.packSizesL1);
+  EXPECT_FALSE(maybeConfig->bufferDepths.has_value());
+  EXPECT_EQ(maybeConfig->outlining, OutliningStrategy::Balanced);
+}
+
+TEST(TuningDatabaseTest, AppendAndLoad) {
+  llvm::SmallString<128> path;
+  ASSERT_FALSE(
+      llvm::sys::fs::createTemporaryFile("tuning-database", "jsonl", path));
+  TuningKey otherKey = getMatmulKey();
+  otherKey.shape = {256, 256, 256};
+  std::string errorMessage;
+  ASSERT_TRUE(mlir::succeeded(TuningDatabase::append(
+      path, {{getMatmulKey(), {{{128, 128, 1}}}}}, errorMessage)));
+  ASSERT_TRUE(mlir::succeeded(TuningDatabase::append(
+      path, {{otherKey, {}}, {getMatmulKey(), {{{64, 64, 1}}}}},
+      errorMessage)));
+
+  mlir::FailureOr<TuningDatabase> maybeDatabase =
+      TuningDatabase::load(path, errorMessage);
+  llvm::sys::fs::remove(path);
+  ASSERT_TRUE(mlir::succeeded(maybeDatabase)) << errorMessage;
+  EXPECT_EQ(maybeDatabase->getRecords().size(), 2);
+  EXPECT_EQ(maybeDatabase->lookup(getMatmulKey())->tileSizes,
+            (std::array<uint32_t, 3>{64, 64, 1}));
+  EXPECT_TRUE(maybeDatabase->lookup(otherKey).has_value());
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
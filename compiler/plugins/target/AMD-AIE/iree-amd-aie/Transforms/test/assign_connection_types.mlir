@@ -1,5 +1,6 @@
 // RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-assign-connection-types{packet-flow-strategy=none})" --split-input-file --verify-diagnostics %s | FileCheck %s
 // RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-assign-connection-types{packet-flow-strategy=auto})" --split-input-file --verify-diagnostics %s | FileCheck %s -check-prefix=AUTO-PACKET
+// RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-assign-connection-types{packet-flow-strategy=auto-routed})" --split-input-file --verify-diagnostics %s | FileCheck %s -check-prefix=AUTO-ROUTED
 // RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-assign-connection-types{packet-flow-strategy=inputs})" --split-input-file --verify-diagnostics %s | FileCheck %s -check-prefix=INPUT-PACKET
 // RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-assign-connection-types{packet-flow-strategy=outputs})" --split-input-file --verify-diagnostics %s | FileCheck %s -check-prefix=OUTPUT-PACKET
 // RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-assign-connection-types{packet-flow-strategy=all})" --split-input-file --verify-diagnostics %s | FileCheck %s -check-prefix=ALL-PACKET
@@ -34,6 +35,21 @@
 // AUTO-PACKET:         amdaie.connection(%[[OBJ4]], %[[OBJ3]]) {connection_type = #amdaie<connection_type Packet>}
 // AUTO-PACKET:         amdaie.connection(%[[OBJ5]], %[[OBJ3]]) {connection_type = #amdaie<connection_type Packet>}
 
+// AUTO-ROUTED-LABEL: @assign_connection_types
+// AUTO-ROUTED-SAME:  %[[ARG0:.+]]: memref<8x16xi32>, %[[ARG1:.+]]: memref<1x1x8x16xi32, 1>, %[[ARG2:.+]]: memref<1x1x8x16xi32, 2>, %[[ARG3:.+]]: memref<8x16xi32>, %[[ARG4:.+]]: memref<1x1x8x16xi32, 1>, %[[ARG5:.+]]: memref<1x1x8x16xi32, 2>
+// AUTO-ROUTED:       amdaie.workgroup
+// AUTO-ROUTED:         %[[OBJ0:.+]] = amdaie.logicalobjectfifo.from_memref %[[ARG0]]
+// AUTO-ROUTED:         %[[OBJ1:.+]] = amdaie.logicalobjectfifo.from_memref %[[ARG1]]
+// AUTO-ROUTED:         %[[OBJ2:.+]] = amdaie.logicalobjectfifo.from_memref %[[ARG2]]
+// AUTO-ROUTED:         amdaie.connection(%[[OBJ1]], %[[OBJ0]]) {connection_type = #amdaie<connection_type Circuit>}
+// AUTO-ROUTED:         amdaie.connection(%[[OBJ0]], %[[OBJ1]]) {connection_type = #amdaie<connection_type Circuit>}
+// AUTO-ROUTED:         amdaie.connection(%[[OBJ2]], %[[OBJ1]]) {connection_type = #amdaie<connection_type Circuit>}
+// AUTO-ROUTED:         %[[OBJ3:.+]] = amdaie.logicalobjectfifo.from_memref %[[ARG3]]
+// AUTO-ROUTED:         %[[OBJ4:.+]] = amdaie.logicalobjectfifo.from_memref %[[ARG4]]
+// AUTO-ROUTED:         %[[OBJ5:.+]] = amdaie.logicalobjectfifo.from_memref %[[ARG5]]
+// AUTO-ROUTED:         amdaie.connection(%[[OBJ4]], %[[OBJ3]]) {connection_type = #amdaie<connection_type Packet>}
+// AUTO-ROUTED:         amdaie.connection(%[[OBJ5]], %[[OBJ3]]) {connection_type = #amdaie<connection_type Packet>}
+
 // INPUT-PACKET-LABEL: @assign_connection_types
 // INPUT-PACKET-SAME:  %[[ARG0:.+]]: memref<8x16xi32>, %[[ARG1:.+]]: memref<1x1x8x16xi32, 1>, %[[ARG2:.+]]: memref<1x1x8x16xi32, 2>, %[[ARG3:.+]]: memref<8x16xi32>, %[[ARG4:.+]]: memref<1x1x8x16xi32, 1>, %[[ARG5:.+]]: memref<1x1x8x16xi32, 2>
 // INPUT-PACKET:       amdaie.workgroup
@@ -107,3 +123,60 @@ module attributes {hal.executable.target = #executable_target_amdaie_xclbin_fb}
     return
   }
 }
+
+// -----
+
+// Three connections into the two shim DMA channels: only one of them can be a
+// circuit connection. The `auto` strategy keeps the first one in circuit mode,
+// whereas `auto-routed` keeps the one with the highest bandwidth.
+
+// AUTO-PACKET-LABEL: @assign_connection_types_by_bandwidth
+// AUTO-PACKET-SAME:  %[[ARG0:.+]]: memref<8x16xi32>, %[[ARG1:.+]]: memref<32x16xi32>, %[[ARG2:.+]]: memref<8x16xi32>, %[[ARG3:.+]]: memref<1x1x8x16xi32, 1>, %[[ARG4:.+]]: memref<1x1x32x16xi32, 1>, %[[ARG5:.+]]: memref<1x1x8x16xi32, 1>
+// AUTO-PACKET:       amdaie.workgroup
+// AUTO-PACKET-DAG:     %[[OBJ0:.+]] = amdaie.logicalobjectfifo.from_memref %[[ARG0]]
+// AUTO-PACKET-DAG:     %[[OBJ1:.+]] = amdaie.logicalobjectfifo.from_memref %[[ARG1]]
+// AUTO-PACKET-DAG:     %[[OBJ2:.+]] = amdaie.logicalobjectfifo.from_memref %[[ARG2]]
+// AUTO-PACKET-DAG:     %[[OBJ3:.+]] = amdaie.logicalobjectfifo.from_memref %[[ARG3]]
+// AUTO-PACKET-DAG:     %[[OBJ4:.+]] = amdaie.logicalobjectfifo.from_memref %[[ARG4]]
+// AUTO-PACKET-DAG:     %[[OBJ5:.+]] = amdaie.logicalobjectfifo.from_memref %[[ARG5]]
+// AUTO-PACKET:         amdaie.connection(%[[OBJ0]], %[[OBJ3]]) {connection_type = #amdaie<connection_type Circuit>}
+// AUTO-PACKET:         amdaie.connection(%[[OBJ1]], %[[OBJ4]]) {connection_type = #amdaie<connection_type Packet>}
+// AUTO-PACKET:         amdaie.connection(%[[OBJ2]], %[[OBJ5]]) {connection_type = #amdaie<connection_type Packet>}
+
+// AUTO-ROUTED-LABEL: @assign_connection_types_by_bandwidth
+// AUTO-ROUTED-SAME:  %[[ARG0:.+]]: memref<8x16xi32>, %[[ARG1:.+]]: memref<32x16xi32>, %[[ARG2:.+]]: memref<8x16xi32>, %[[ARG3:.+]]: memref<1x1x8x16xi32, 1>, %[[ARG4:.+]]: memref<1x1x32x16xi32, 1>, %[[ARG5:.+]]: memref<1x1x8x16xi32, 1>
+// AUTO-ROUTED:       amdaie.workgroup
+// AUTO-ROUTED-DAG:     %[[OBJ0:.+]] = amdaie.logicalobjectfifo.from_memref %[[ARG0]]
+// AUTO-ROUTED-DAG:     %[[OBJ1:.+]] = amdaie.logicalobjectfifo.from_memref %[[ARG1]]
+// AUTO-ROUTED-DAG:     %[[OBJ2:.+]] = amdaie.logicalobjectfifo.from_memref %[[ARG2]]
+// AUTO-ROUTED-DAG:     %[[OBJ3:.+]] = amdaie.logicalobjectfifo.from_memref %[[ARG3]]
+// AUTO-ROUTED-DAG:     %[[OBJ4:.+]] = amdaie.logicalobjectfifo.from_memref %[[ARG4]]
+// AUTO-ROUTED-DAG:     %[[OBJ5:.+]] = amdaie.logicalobjectfifo.from_memref %[[ARG5]]
+// AUTO-ROUTED:         amdaie.connection(%[[OBJ0]], %[[OBJ3]]) {connection_type = #amdaie<connection_type Packet>}
+// AUTO-ROUTED:         amdaie.connection(%[[OBJ1]], %[[OBJ4]]) {connection_type = #amdaie<connection_type Circuit>}
+// AUTO-ROUTED:         amdaie.connection(%[[OBJ2]], %[[OBJ5]]) {connection_type = #amdaie<connection_type Packet>}
+
+#executable_target_amdaie_xclbin_fb = #hal.executable.target<"amd-aie", "amdaie-xclbin-fb", {target_device = "npu1_4col", ukernels = "none"}>
+module attributes {hal.executable.target = #executable_target_amdaie_xclbin_fb} {
+  func.func @assign_connection_types_by_bandwidth(%arg0: memref<8x16xi32>, %arg1: memref<32x16xi32>, %arg2: memref<8x16xi32>, %arg3: memref<1x1x8x16xi32, 1>, %arg4: memref<1x1x32x16xi32, 1>, %arg5: memref<1x1x8x16xi32, 1>) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    amdaie.workgroup {
+      %tile_0_0 = amdaie.tile(%c0, %c0)
+      %tile_0_1 = amdaie.tile(%c0, %c1)
+      %0 = amdaie.logicalobjectfifo.from_memref %arg0, {%tile_0_0} : memref<8x16xi32> -> !amdaie.logicalobjectfifo<memref<8x16xi32>>
+      %1 = amdaie.logicalobjectfifo.from_memref %arg1, {%tile_0_0} : memref<32x16xi32> -> !amdaie.logicalobjectfifo<memref<32x16xi32>>
+      %2 = amdaie.logicalobjectfifo.from_memref %arg2, {%tile_0_0} : memref<8x16xi32> -> !amdaie.logicalobjectfifo<memref<8x16xi32>>
+      %3 = amdaie.logicalobjectfifo.from_memref %arg3, {%tile_0_1} : memref<1x1x8x16xi32, 1> -> !amdaie.logicalobjectfifo<memref<1x1x8x16xi32, 1>>
+      %4 = amdaie.logicalobjectfifo.from_memref %arg4, {%tile_0_1} : memref<1x1x32x16xi32, 1> -> !amdaie.logicalobjectfifo<memref<1x1x32x16xi32, 1>>
+      %5 = amdaie.logicalobjectfifo.from_memref %arg5, {%tile_0_1} : memref<1x1x8x16xi32, 1> -> !amdaie.logicalobjectfifo<memref<1x1x8x16xi32, 1>>
+      amdaie.connection(%0, %3) : (!amdaie.logicalobjectfifo<memref<8x16xi32>>, !amdaie.logicalobjectfifo<memref<1x1x8x16xi32, 1>>)
+      amdaie.connection(%1, %4) : (!amdaie.logicalobjectfifo<memref<32x16xi32>>, !amdaie.logicalobjectfifo<memref<1x1x32x16xi32, 1>>)
+      amdaie.connection(%2, %5) : (!amdaie.logicalobjectfifo<memref<8x16xi32>>, !amdaie.logicalobjectfifo<memref<1x1x8x16xi32, 1>>)
+      amdaie.controlcode {
+        amdaie.end
+      }
+    }
+    return
+  }
+}
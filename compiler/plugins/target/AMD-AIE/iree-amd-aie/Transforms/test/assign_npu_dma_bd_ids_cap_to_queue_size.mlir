@@ -0,0 +1,112 @@
+// RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-assign-npu-dma-bd-ids,canonicalize,cse)" --split-input-file %s | FileCheck %s
+// RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-assign-npu-dma-bd-ids{cap-to-queue-size=true},canonicalize,cse)" --split-input-file %s | FileCheck %s --check-prefix=CAP
+// RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-assign-npu-dma-bd-ids{cap-to-queue-size=true})" --split-input-file --mlir-pass-statistics %s 2>&1 | FileCheck %s --check-prefix=STATS
+
+// Without the cap, the outer DMA copy operation gets 5 BD IDs although at most
+// 4 of its transfers can be in flight, and the inner ones get 5 BD IDs each for
+// a loop of 2 iterations. With the cap, the outer DMA copy operation gets as
+// many BD IDs as the DMA queue size, and the inner ones as many as the number
+// of iterations.
+
+// CHECK: #map = affine_map<(d0) -> (d0 mod 5)>
+// CHECK: #map1 = affine_map<(d0) -> (d0 mod 5 + 5)>
+// CHECK: #map2 = affine_map<(d0) -> (d0 mod 5 + 10)>
+// CHECK-LABEL: @nested_loops
+// CAP: #map = affine_map<(d0) -> (d0 mod 4)>
+// CAP: #map1 = affine_map<(d0) -> (d0 mod 2 + 4)>
+// CAP: #map2 = affine_map<(d0) -> (d0 mod 2 + 6)>
+// CAP-LABEL: @nested_loops
+// CAP:       scf.for
+// CAP:         affine.apply #map(
+// CAP:         scf.for
+// CAP:           affine.apply #map1(
+// CAP:           affine.apply #map2(
+// STATS:     (S) 0 num-bd-id-limited-dma-ops
+// STATS:     (S) 0 num-extra-dma-waits
+#executable_target_amdaie_xclbin_fb = #hal.executable.target<"amd-aie", "amdaie-xclbin-fb", {target_device = "npu1_4col", ukernels = "none"}>
+module attributes {hal.executable.target = #executable_target_amdaie_xclbin_fb} {
+  func.func @nested_loops(%arg0: memref<8x16xi32>, %arg1: memref<8x16xi32>, %arg2: memref<8x16xi32>, %arg3: memref<1x1x8x16xi32, 1>) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c2 = arith.constant 2 : index
+    %c8 = arith.constant 8 : index
+    amdaie.workgroup {
+      %tile_0_0 = amdaie.tile(%c0, %c0)
+      %tile_0_1 = amdaie.tile(%c0, %c1)
+      %channel_0 = amdaie.channel(%tile_0_0, 0, port_type = DMA, direction = MM2S)
+      %channel_1 = amdaie.channel(%tile_0_0, 0, port_type = DMA, direction = S2MM)
+      %channel_2 = amdaie.channel(%tile_0_0, 1, port_type = DMA, direction = MM2S)
+      %channel_3 = amdaie.channel(%tile_0_1, 0, port_type = DMA, direction = S2MM)
+      %channel_4 = amdaie.channel(%tile_0_1, 0, port_type = DMA, direction = MM2S)
+      %channel_5 = amdaie.channel(%tile_0_1, 1, port_type = DMA, direction = S2MM)
+      %from_memref_0 = amdaie.logicalobjectfifo.from_memref %arg3, {%tile_0_1} : memref<1x1x8x16xi32, 1> -> !amdaie.logicalobjectfifo<memref<128xi32, 1>, 2>
+      %placeholder = amdaie.logicalobjectfifo.placeholder{%tile_0_0} : !amdaie.logicalobjectfifo<memref<8x16xi32>>
+      %connection_0 = amdaie.connection(%from_memref_0 {%channel_3}, %placeholder {%channel_0}) {connection_type = #amdaie<connection_type Circuit>} : (!amdaie.logicalobjectfifo<memref<128xi32, 1>, 2>, !amdaie.logicalobjectfifo<memref<8x16xi32>>)
+      %connection_1 = amdaie.connection(%placeholder {%channel_1}, %from_memref_0 {%channel_4}) {connection_type = #amdaie<connection_type Circuit>} : (!amdaie.logicalobjectfifo<memref<8x16xi32>>, !amdaie.logicalobjectfifo<memref<128xi32, 1>, 2>)
+      %connection_2 = amdaie.connection(%from_memref_0 {%channel_5}, %placeholder {%channel_2}) {connection_type = #amdaie<connection_type Circuit>} : (!amdaie.logicalobjectfifo<memref<128xi32, 1>, 2>, !amdaie.logicalobjectfifo<memref<8x16xi32>>)
+      amdaie.controlcode {
+        %from_memref_1 = amdaie.logicalobjectfifo.from_memref %arg0, {%tile_0_0} : memref<8x16xi32> -> !amdaie.logicalobjectfifo<memref<8x16xi32>>
+        %from_memref_2 = amdaie.logicalobjectfifo.from_memref %arg1, {%tile_0_0} : memref<8x16xi32> -> !amdaie.logicalobjectfifo<memref<8x16xi32>>
+        %from_memref_3 = amdaie.logicalobjectfifo.from_memref %arg2, {%tile_0_0} : memref<8x16xi32> -> !amdaie.logicalobjectfifo<memref<8x16xi32>>
+        scf.for %arg4 = %c0 to %c8 step %c1 {
+          %0 = amdaie.npu.dma_cpy_nd async_source %connection_0([] [] [], %from_memref_1[] [] []) : source_type = !amdaie.logicalobjectfifo<memref<8x16xi32>>
+          scf.for %arg5 = %c0 to %c2 step %c1 {
+            %1 = amdaie.npu.dma_cpy_nd async_target %connection_1(%from_memref_2[] [] [], [] [] []) : target_type = !amdaie.logicalobjectfifo<memref<8x16xi32>>
+            %2 = amdaie.npu.dma_cpy_nd async_source %connection_2([] [] [], %from_memref_3[] [] []) : source_type = !amdaie.logicalobjectfifo<memref<8x16xi32>>
+            amdaie.npu.dma_wait(%1 : !amdaie.async_target_token)
+            amdaie.npu.dma_wait(%2 : !amdaie.async_source_token)
+          }
+          amdaie.npu.dma_wait(%0 : !amdaie.async_source_token)
+        }
+        amdaie.end
+      }
+    }
+    return
+  }
+}
+
+// -----
+
+// Five DMA copy operations in a loop of 8 iterations share the 16 BD IDs of the
+// tile and get 3 BD IDs each, one less than the DMA queue size. Each of them
+// has to wait for the transfer of a reused BD ID once more per loop execution
+// than it would need to with 4 BD IDs.
+
+// CAP: #map = affine_map<(d0) -> (d0 mod 3)>
+// CAP: #map1 = affine_map<(d0) -> (d0 mod 3 + 3)>
+// CAP: #map2 = affine_map<(d0) -> (d0 mod 3 + 6)>
+// CAP: #map3 = affine_map<(d0) -> (d0 mod 3 + 9)>
+// CAP: #map4 = affine_map<(d0) -> (d0 mod 3 + 12)>
+// CAP-LABEL: @bd_id_pressure
+// STATS:     (S) 5 num-bd-id-limited-dma-ops
+// STATS:     (S) 5 num-extra-dma-waits
+#executable_target_amdaie_xclbin_fb = #hal.executable.target<"amd-aie", "amdaie-xclbin-fb", {target_device = "npu1_4col", ukernels = "none"}>
+module attributes {hal.executable.target = #executable_target_amdaie_xclbin_fb} {
+  func.func @bd_id_pressure(%arg0: memref<8x16xi32>, %arg1: memref<1x1x8x16xi32, 1>) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c8 = arith.constant 8 : index
+    amdaie.workgroup {
+      %tile_0_0 = amdaie.tile(%c0, %c0)
+      %tile_0_1 = amdaie.tile(%c0, %c1)
+      %channel_0 = amdaie.channel(%tile_0_0, 0, port_type = DMA, direction = MM2S)
+      %channel_1 = amdaie.channel(%tile_0_1, 0, port_type = DMA, direction = S2MM)
+      %from_memref_0 = amdaie.logicalobjectfifo.from_memref %arg1, {%tile_0_1} : memref<1x1x8x16xi32, 1> -> !amdaie.logicalobjectfifo<memref<128xi32, 1>, 2>
+      %placeholder = amdaie.logicalobjectfifo.placeholder{%tile_0_0} : !amdaie.logicalobjectfifo<memref<8x16xi32>>
+      %connection = amdaie.connection(%from_memref_0 {%channel_1}, %placeholder {%channel_0}) {connection_type = #amdaie<connection_type Circuit>} : (!amdaie.logicalobjectfifo<memref<128xi32, 1>, 2>, !amdaie.logicalobjectfifo<memref<8x16xi32>>)
+      amdaie.controlcode {
+        %from_memref_1 = amdaie.logicalobjectfifo.from_memref %arg0, {%tile_0_0} : memref<8x16xi32> -> !amdaie.logicalobjectfifo<memref<8x16xi32>>
+        scf.for %arg2 = %c0 to %c8 step %c1 {
+          %0 = amdaie.npu.dma_cpy_nd async_source %connection([] [] [], %from_memref_1[0] [16] [1]) : source_type = !amdaie.logicalobjectfifo<memref<8x16xi32>>
+          %1 = amdaie.npu.dma_cpy_nd async_source %connection([] [] [], %from_memref_1[16] [16] [1]) : source_type = !amdaie.logicalobjectfifo<memref<8x16xi32>>
+          %2 = amdaie.npu.dma_cpy_nd async_source %connection([] [] [], %from_memref_1[32] [16] [1]) : source_type = !amdaie.logicalobjectfifo<memref<8x16xi32>>
+          %3 = amdaie.npu.dma_cpy_nd async_source %connection([] [] [], %from_memref_1[48] [16] [1]) : source_type = !amdaie.logicalobjectfifo<memref<8x16xi32>>
+          %4 = amdaie.npu.dma_cpy_nd async_source %connection([] [] [], %from_memref_1[64] [16] [1]) : source_type = !amdaie.logicalobjectfifo<memref<8x16xi32>>
+          amdaie.npu.dma_wait(%0, %1, %2, %3, %4 : !amdaie.async_source_token, !amdaie.async_source_token, !amdaie.async_source_token, !amdaie.async_source_token, !amdaie.async_source_token)
+        }
+        amdaie.end
+      }
+    }
+    return
+  }
+}
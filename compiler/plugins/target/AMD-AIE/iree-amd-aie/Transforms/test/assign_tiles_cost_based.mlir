@@ -0,0 +1,152 @@
+// RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-assign-tiles{placement-strategy=cost-based},cse)" --split-input-file --verify-diagnostics %s | FileCheck %s
+
+// Test that the L2 objFifo is assigned to the column in the middle of its
+// consumers, which minimizes the wire length, and that the L3 objFifo follows.
+// CHECK-LABEL: @assign_by_wire_length
+// CHECK-DAG:   %[[C0:.*]] = arith.constant 0 : index
+// CHECK-DAG:   %[[C1:.*]] = arith.constant 1 : index
+// CHECK-DAG:   %[[C2:.*]] = arith.constant 2 : index
+// CHECK-DAG:   %[[ALLOC_0:.*]] = memref.alloc() : memref<2048xi32>
+// CHECK-DAG:   %[[ALLOC_1:.*]] = memref.alloc() : memref<2048xi32, 1>
+// CHECK:       amdaie.workgroup
+// CHECK-DAG:     %[[TILE_2_0:.*]] = amdaie.tile(%[[C2]], %[[C0]])
+// CHECK-DAG:     %[[TILE_2_1:.*]] = amdaie.tile(%[[C2]], %[[C1]])
+// CHECK-DAG:     amdaie.logicalobjectfifo.from_memref %[[ALLOC_0]], {%[[TILE_2_0]]}
+// CHECK-DAG:     amdaie.logicalobjectfifo.from_memref %[[ALLOC_1]], {%[[TILE_2_1]]}
+#executable_target_amdaie_xclbin_fb = #hal.executable.target<"amd-aie", "amdaie-xclbin-fb", {target_device = "npu1_4col", ukernels = "none"}>
+module attributes {hal.executable.target = #executable_target_amdaie_xclbin_fb} {
+  func.func @assign_by_wire_length() {
+    %c1 = arith.constant 1 : index
+    %c2 = arith.constant 2 : index
+    %c3 = arith.constant 3 : index
+    %alloc = memref.alloc() : memref<2048xi32>
+    %alloc_1 = memref.alloc() : memref<2048xi32, 1>
+    %alloc_2 = memref.alloc() : memref<1024xi32, 2>
+    %alloc_3 = memref.alloc() : memref<1024xi32, 2>
+    %alloc_4 = memref.alloc() : memref<1024xi32, 2>
+    amdaie.workgroup {
+      %tile_1_2 = amdaie.tile(%c1, %c2)
+      %tile_2_2 = amdaie.tile(%c2, %c2)
+      %tile_3_2 = amdaie.tile(%c3, %c2)
+      %0 = amdaie.logicalobjectfifo.from_memref %alloc, {} : memref<2048xi32> -> !amdaie.logicalobjectfifo<memref<2048xi32>>
+      %1 = amdaie.logicalobjectfifo.from_memref %alloc_1, {} : memref<2048xi32, 1> -> !amdaie.logicalobjectfifo<memref<2048xi32, 1>>
+      %2 = amdaie.logicalobjectfifo.from_memref %alloc_2, {} : memref<1024xi32, 2> -> !amdaie.logicalobjectfifo<memref<1024xi32, 2>>
+      %3 = amdaie.logicalobjectfifo.from_memref %alloc_3, {} : memref<1024xi32, 2> -> !amdaie.logicalobjectfifo<memref<1024xi32, 2>>
+      %4 = amdaie.logicalobjectfifo.from_memref %alloc_4, {} : memref<1024xi32, 2> -> !amdaie.logicalobjectfifo<memref<1024xi32, 2>>
+      %5 = amdaie.dma_cpy_nd(%1[] [] [], %0[] [] []) : (!amdaie.logicalobjectfifo<memref<2048xi32, 1>>, !amdaie.logicalobjectfifo<memref<2048xi32>>)
+      %6 = amdaie.dma_cpy_nd(%2[] [] [], %1[] [] []) : (!amdaie.logicalobjectfifo<memref<1024xi32, 2>>, !amdaie.logicalobjectfifo<memref<2048xi32, 1>>)
+      %7 = amdaie.dma_cpy_nd(%3[] [] [], %1[] [] []) : (!amdaie.logicalobjectfifo<memref<1024xi32, 2>>, !amdaie.logicalobjectfifo<memref<2048xi32, 1>>)
+      %8 = amdaie.dma_cpy_nd(%4[] [] [], %1[] [] []) : (!amdaie.logicalobjectfifo<memref<1024xi32, 2>>, !amdaie.logicalobjectfifo<memref<2048xi32, 1>>)
+      %9 = amdaie.core(%tile_1_2, in : [], out : []) {
+        %10 = amdaie.logicalobjectfifo.access(%2, Read) : !amdaie.logicalobjectfifo<memref<1024xi32, 2>> -> memref<1024xi32, 2>
+        amdaie.end
+      }
+      %11 = amdaie.core(%tile_2_2, in : [], out : []) {
+        %12 = amdaie.logicalobjectfifo.access(%3, Read) : !amdaie.logicalobjectfifo<memref<1024xi32, 2>> -> memref<1024xi32, 2>
+        amdaie.end
+      }
+      %13 = amdaie.core(%tile_3_2, in : [], out : []) {
+        %14 = amdaie.logicalobjectfifo.access(%4, Read) : !amdaie.logicalobjectfifo<memref<1024xi32, 2>> -> memref<1024xi32, 2>
+        amdaie.end
+      }
+      amdaie.controlcode {
+        amdaie.end
+      }
+    }
+    memref.dealloc %alloc : memref<2048xi32>
+    memref.dealloc %alloc_1 : memref<2048xi32, 1>
+    memref.dealloc %alloc_2 : memref<1024xi32, 2>
+    memref.dealloc %alloc_3 : memref<1024xi32, 2>
+    memref.dealloc %alloc_4 : memref<1024xi32, 2>
+    return
+  }
+}
+
+// -----
+
+// Test that both L2 objFifos prefer column 0, where all their consumers are,
+// but that the smaller one moves to column 1 as the eight connections would
+// exceed the six MM2S channels of the memory tile.
+// CHECK-LABEL: @assign_by_dma_channel_pressure
+// CHECK-DAG:   %[[C0:.*]] = arith.constant 0 : index
+// CHECK-DAG:   %[[C1:.*]] = arith.constant 1 : index
+// CHECK-DAG:   %[[ALLOC_0:.*]] = memref.alloc() : memref<4096xi32, 1>
+// CHECK-DAG:   %[[ALLOC_1:.*]] = memref.alloc() : memref<2048xi32, 1>
+// CHECK:       amdaie.workgroup
+// CHECK-DAG:     %[[TILE_0_1:.*]] = amdaie.tile(%[[C0]], %[[C1]])
+// CHECK-DAG:     %[[TILE_1_1:.*]] = amdaie.tile(%[[C1]], %[[C1]])
+// CHECK-DAG:     amdaie.logicalobjectfifo.from_memref %[[ALLOC_0]], {%[[TILE_0_1]]}
+// CHECK-DAG:     amdaie.logicalobjectfifo.from_memref %[[ALLOC_1]], {%[[TILE_1_1]]}
+#executable_target_amdaie_xclbin_fb = #hal.executable.target<"amd-aie", "amdaie-xclbin-fb", {target_device = "npu1_4col", ukernels = "none"}>
+module attributes {hal.executable.target = #executable_target_amdaie_xclbin_fb} {
+  func.func @assign_by_dma_channel_pressure() {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c2 = arith.constant 2 : index
+    %c3 = arith.constant 3 : index
+    %alloc = memref.alloc() : memref<4096xi32, 1>
+    %alloc_1 = memref.alloc() : memref<2048xi32, 1>
+    %alloc_2 = memref.alloc() : memref<256xi32, 2>
+    %alloc_3 = memref.alloc() : memref<256xi32, 2>
+    %alloc_4 = memref.alloc() : memref<256xi32, 2>
+    %alloc_5 = memref.alloc() : memref<256xi32, 2>
+    %alloc_6 = memref.alloc() : memref<128xi32, 2>
+    %alloc_7 = memref.alloc() : memref<128xi32, 2>
+    %alloc_8 = memref.alloc() : memref<128xi32, 2>
+    %alloc_9 = memref.alloc() : memref<128xi32, 2>
+    amdaie.workgroup {
+      %tile_0_2 = amdaie.tile(%c0, %c2)
+      %tile_0_3 = amdaie.tile(%c0, %c3)
+      %tile_1_2 = amdaie.tile(%c1, %c2)
+      %0 = amdaie.logicalobjectfifo.from_memref %alloc, {} : memref<4096xi32, 1> -> !amdaie.logicalobjectfifo<memref<4096xi32, 1>>
+      %1 = amdaie.logicalobjectfifo.from_memref %alloc_1, {} : memref<2048xi32, 1> -> !amdaie.logicalobjectfifo<memref<2048xi32, 1>>
+      %2 = amdaie.logicalobjectfifo.from_memref %alloc_2, {} : memref<256xi32, 2> -> !amdaie.logicalobjectfifo<memref<256xi32, 2>>
+      %3 = amdaie.logicalobjectfifo.from_memref %alloc_3, {} : memref<256xi32, 2> -> !amdaie.logicalobjectfifo<memref<256xi32, 2>>
+      %4 = amdaie.logicalobjectfifo.from_memref %alloc_4, {} : memref<256xi32, 2> -> !amdaie.logicalobjectfifo<memref<256xi32, 2>>
+      %5 = amdaie.logicalobjectfifo.from_memref %alloc_5, {} : memref<256xi32, 2> -> !amdaie.logicalobjectfifo<memref<256xi32, 2>>
+      %6 = amdaie.logicalobjectfifo.from_memref %alloc_6, {} : memref<128xi32, 2> -> !amdaie.logicalobjectfifo<memref<128xi32, 2>>
+      %7 = amdaie.logicalobjectfifo.from_memref %alloc_7, {} : memref<128xi32, 2> -> !amdaie.logicalobjectfifo<memref<128xi32, 2>>
+      %8 = amdaie.logicalobjectfifo.from_memref %alloc_8, {} : memref<128xi32, 2> -> !amdaie.logicalobjectfifo<memref<128xi32, 2>>
+      %9 = amdaie.logicalobjectfifo.from_memref %alloc_9, {} : memref<128xi32, 2> -> !amdaie.logicalobjectfifo<memref<128xi32, 2>>
+      %10 = amdaie.dma_cpy_nd(%2[] [] [], %0[0] [256] [1]) : (!amdaie.logicalobjectfifo<memref<256xi32, 2>>, !amdaie.logicalobjectfifo<memref<4096xi32, 1>>)
+      %11 = amdaie.dma_cpy_nd(%3[] [] [], %0[256] [256] [1]) : (!amdaie.logicalobjectfifo<memref<256xi32, 2>>, !amdaie.logicalobjectfifo<memref<4096xi32, 1>>)
+      %12 = amdaie.dma_cpy_nd(%4[] [] [], %0[512] [256] [1]) : (!amdaie.logicalobjectfifo<memref<256xi32, 2>>, !amdaie.logicalobjectfifo<memref<4096xi32, 1>>)
+      %13 = amdaie.dma_cpy_nd(%5[] [] [], %0[768] [256] [1]) : (!amdaie.logicalobjectfifo<memref<256xi32, 2>>, !amdaie.logicalobjectfifo<memref<4096xi32, 1>>)
+      %14 = amdaie.dma_cpy_nd(%6[] [] [], %1[0] [128] [1]) : (!amdaie.logicalobjectfifo<memref<128xi32, 2>>, !amdaie.logicalobjectfifo<memref<2048xi32, 1>>)
+      %15 = amdaie.dma_cpy_nd(%7[] [] [], %1[128] [128] [1]) : (!amdaie.logicalobjectfifo<memref<128xi32, 2>>, !amdaie.logicalobjectfifo<memref<2048xi32, 1>>)
+      %16 = amdaie.dma_cpy_nd(%8[] [] [], %1[256] [128] [1]) : (!amdaie.logicalobjectfifo<memref<128xi32, 2>>, !amdaie.logicalobjectfifo<memref<2048xi32, 1>>)
+      %17 = amdaie.dma_cpy_nd(%9[] [] [], %1[384] [128] [1]) : (!amdaie.logicalobjectfifo<memref<128xi32, 2>>, !amdaie.logicalobjectfifo<memref<2048xi32, 1>>)
+      %18 = amdaie.core(%tile_0_2, in : [], out : []) {
+        %19 = amdaie.logicalobjectfifo.access(%2, Read) : !amdaie.logicalobjectfifo<memref<256xi32, 2>> -> memref<256xi32, 2>
+        %20 = amdaie.logicalobjectfifo.access(%3, Read) : !amdaie.logicalobjectfifo<memref<256xi32, 2>> -> memref<256xi32, 2>
+        %21 = amdaie.logicalobjectfifo.access(%6, Read) : !amdaie.logicalobjectfifo<memref<128xi32, 2>> -> memref<128xi32, 2>
+        %22 = amdaie.logicalobjectfifo.access(%7, Read) : !amdaie.logicalobjectfifo<memref<128xi32, 2>> -> memref<128xi32, 2>
+        amdaie.end
+      }
+      %23 = amdaie.core(%tile_0_3, in : [], out : []) {
+        %24 = amdaie.logicalobjectfifo.access(%4, Read) : !amdaie.logicalobjectfifo<memref<256xi32, 2>> -> memref<256xi32, 2>
+        %25 = amdaie.logicalobjectfifo.access(%5, Read) : !amdaie.logicalobjectfifo<memref<256xi32, 2>> -> memref<256xi32, 2>
+        %26 = amdaie.logicalobjectfifo.access(%8, Read) : !amdaie.logicalobjectfifo<memref<128xi32, 2>> -> memref<128xi32, 2>
+        %27 = amdaie.logicalobjectfifo.access(%9, Read) : !amdaie.logicalobjectfifo<memref<128xi32, 2>> -> memref<128xi32, 2>
+        amdaie.end
+      }
+      %28 = amdaie.core(%tile_1_2, in : [], out : []) {
+        amdaie.end
+      }
+      amdaie.controlcode {
+        amdaie.end
+      }
+    }
+    memref.dealloc %alloc : memref<4096xi32, 1>
+    memref.dealloc %alloc_1 : memref<2048xi32, 1>
+    memref.dealloc %alloc_2 : memref<256xi32, 2>
+    memref.dealloc %alloc_3 : memref<256xi32, 2>
+    memref.dealloc %alloc_4 : memref<256xi32, 2>
+    memref.dealloc %alloc_5 : memref<256xi32, 2>
+    memref.dealloc %alloc_6 : memref<128xi32, 2>
+    memref.dealloc %alloc_7 : memref<128xi32, 2>
+    memref.dealloc %alloc_8 : memref<128xi32, 2>
+    memref.dealloc %alloc_9 : memref<128xi32, 2>
+    return
+  }
+}
@@ -1,6 +1,7 @@
 // RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-controlcode-lowering)" --split-input-file --verify-diagnostics %s | FileCheck %s
 // RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-controlcode-lowering{arg-idx-offset=1})" -split-input-file --verify-diagnostics %s | FileCheck %s --check-prefix=ADD1
 // RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-controlcode-lowering{arg-idx-offset=2})" -split-input-file --verify-diagnostics %s | FileCheck %s --check-prefix=ADD2
+// RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-controlcode-lowering{erase-redundant-write-bds=true})" -split-input-file --verify-diagnostics %s | FileCheck %s --check-prefix=ERASE
 
 // expected-error @+1 {{op has no AMDAIEDevice in the target attribute configuration}}
 module {
@@ -489,3 +490,15 @@ module attributes {hal.executable.target = #executable_target_amdaie_pdi_fb} {
 // ADD2-LABEL:   @reconfigure
 // ADD2-COUNT-3:   amdaie.npu.address_patch {arg_idx = 2
 // ADD2-NOT:       amdaie.npu.address_patch
+
+// The last DMA writes the same configuration to BD 0 as the previous one, so
+// only its address is patched.
+// ERASE-LABEL:   @reconfigure
+// ERASE:         amdaie.npu.write_bd {{.*}}packet_id = 1 : ui32
+// ERASE:         amdaie.npu.address_patch {arg_idx = 0 : ui32, bd_id = 0 : ui32, col = 0 : ui32, offset = 0 : ui32}
+// ERASE:         amdaie.npu.write_bd {{.*}}packet_id = 0 : ui32
+// ERASE:         amdaie.npu.address_patch {arg_idx = 0 : ui32, bd_id = 0 : ui32, col = 0 : ui32, offset = 1776 : ui32}
+// ERASE-NOT:     amdaie.npu.write_bd
+// ERASE:         amdaie.npu.address_patch {arg_idx = 0 : ui32, bd_id = 0 : ui32, col = 0 : ui32, offset = 2968 : ui32}
+// ERASE:         amdaie.npu.push_to_queue
+// ERASE-NOT:     amdaie.npu.write_bd
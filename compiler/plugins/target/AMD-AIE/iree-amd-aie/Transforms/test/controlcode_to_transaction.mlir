@@ -1,4 +1,5 @@
 // RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-controlcode-to-transaction{dump-transaction=true})" --split-input-file --verify-diagnostics %s | FileCheck %s
+// RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-controlcode-to-transaction{dump-transaction=true compact-transaction=true})" --split-input-file --verify-diagnostics %s | FileCheck %s --check-prefix=COMPACT
 
 // expected-error @+1 {{op has no AMDAIEDevice in the target attribute configuration}}
 module {
@@ -271,3 +272,52 @@ module attributes {hal.executable.target = #executable_target_amdaie_xclbin_fb}
     return
   }
 }
+
+// -----
+
+// The buffer descriptors are adjacent, so they are written with a single block
+// write when the transaction is compacted.
+
+// CHECK-LABEL: @write_bds_compaction
+// CHECK:       npu_instructions = dense_resource<npu_instructions> : tensor<28xui32>
+
+// COMPACT-LABEL: @write_bd_with_addressing_and_packet
+// COMPACT:       0x06030100
+// COMPACT-NEXT:  0x00000104
+// COMPACT-NEXT:  0x00000001
+// COMPACT-NEXT:  0x00000060
+// COMPACT-NEXT:  0x00000001
+// COMPACT-NEXT:  0x00000000
+// COMPACT-NEXT:  0x0001D000
+// COMPACT-NEXT:  0x00000050
+// COMPACT-NEXT:  0x00000000
+// COMPACT-NEXT:  0x00000000
+// COMPACT-NEXT:  0x00000000
+// COMPACT-NEXT:  0x00000000
+// COMPACT-NEXT:  0x80000000
+// COMPACT-NEXT:  0x00000000
+// COMPACT-NEXT:  0x00000000
+// COMPACT-NEXT:  0x02000000
+// COMPACT-NEXT:  0x00000000
+// COMPACT-NEXT:  0x00000000
+// COMPACT-NEXT:  0x00000000
+// COMPACT-NEXT:  0x00000000
+// COMPACT-NEXT:  0x80000000
+// COMPACT-NEXT:  0x00000000
+// COMPACT-NEXT:  0x00000000
+// COMPACT-NEXT:  0x02000000
+// COMPACT-LABEL: @write_bds_compaction
+// COMPACT:       npu_instructions = dense_resource<npu_instructions> : tensor<24xui32>
+#executable_target_amdaie_xclbin_fb = #hal.executable.target<"amd-aie", "amdaie-xclbin-fb", {target_device = "npu1_4col", ukernels = "none"}>
+module attributes {hal.executable.target = #executable_target_amdaie_xclbin_fb} {
+  func.func @write_bds_compaction() {
+    amdaie.workgroup {
+      amdaie.controlcode {
+        amdaie.npu.write_bd {bd_id = 0 : ui32, buffer_length = 0 : ui32, buffer_offset = 0 : ui32, col = 0 : ui32, enable_packet = false, iteration_current = 0 : ui32, iteration_size = 0 : ui32, iteration_stride = 0 : ui32, lock_acq_enable = false, lock_acq_id = 0 : ui32, lock_acq_val = 0 : i32, lock_rel_id = 0 : ui32, lock_rel_val = 0 : i32, next_bd = 0 : ui32, out_of_order_id = 0 : ui32, packet_id = 0 : ui32, packet_type = 0 : ui32, paddings_after = array<i32>, paddings_before = array<i32>, row = 0 : ui32, sizes = array<i32: 0, 0, 0>, strides = array<i32: 0, 0, 0>, use_next_bd = false, valid_bd = true}
+        amdaie.npu.write_bd {bd_id = 1 : ui32, buffer_length = 0 : ui32, buffer_offset = 0 : ui32, col = 0 : ui32, enable_packet = false, iteration_current = 0 : ui32, iteration_size = 0 : ui32, iteration_stride = 0 : ui32, lock_acq_enable = false, lock_acq_id = 0 : ui32, lock_acq_val = 0 : i32, lock_rel_id = 0 : ui32, lock_rel_val = 0 : i32, next_bd = 0 : ui32, out_of_order_id = 0 : ui32, packet_id = 0 : ui32, packet_type = 0 : ui32, paddings_after = array<i32>, paddings_before = array<i32>, row = 0 : ui32, sizes = array<i32: 0, 0, 0>, strides = array<i32: 0, 0, 0>, use_next_bd = false, valid_bd = true}
+        amdaie.end
+      }
+    }
+    return
+  }
+}
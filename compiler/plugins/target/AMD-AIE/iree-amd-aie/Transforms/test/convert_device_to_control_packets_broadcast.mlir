@@ -0,0 +1,37 @@
+// RUN: aie_elf_files_gen_test %s %T
+// RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-convert-device-to-control-packets{path-to-elfs=%T broadcast-core-config=true})" --verify-diagnostics %s
+
+// The cores run different programs, so the configuration of one of them can't
+// be broadcast to all of them.
+#executable_target_amdaie_xclbin_fb = #hal.executable.target<"amd-aie", "amdaie-xclbin-fb", {target_device = "npu1_4col", ukernels = "none"}>
+module attributes {hal.executable.target = #executable_target_amdaie_xclbin_fb} {
+  // expected-error @+1 {{has cores that run different programs, so their configuration can't be broadcast}}
+  aie.device(npu1_4col) {
+    %tile_0_1 = aie.tile(0, 1)
+    %tile_0_2 = aie.tile(0, 2)
+    %tile_0_3 = aie.tile(0, 3)
+    %buf = aie.buffer(%tile_0_2) {address = 0 : i32, sym_name = "buf"} : memref<256xi32>
+    %buf_1 = aie.buffer(%tile_0_3) {address = 0 : i32, sym_name = "buf_1"} : memref<256xi32>
+    %memtile_dma_0_1 = aie.memtile_dma(%tile_0_1) {
+      aie.end
+    }
+    %mem_0_2 = aie.mem(%tile_0_2) {
+      aie.end
+    }
+    %core_0_2 = aie.core(%tile_0_2)  {
+      %0 = arith.constant 0 : i32
+      %1 = arith.constant 0 : index
+      memref.store %0, %buf[%1] : memref<256xi32>
+      aie.end
+    }
+    %mem_0_3 = aie.mem(%tile_0_3) {
+      aie.end
+    }
+    %core_0_3 = aie.core(%tile_0_3)  {
+      %0 = arith.constant 7 : i32
+      %1 = arith.constant 1 : index
+      memref.store %0, %buf_1[%1] : memref<256xi32>
+      aie.end
+    }
+  }
+}
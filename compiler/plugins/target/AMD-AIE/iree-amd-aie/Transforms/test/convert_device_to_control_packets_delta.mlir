@@ -0,0 +1,50 @@
+// RUN: mkdir -p %t && aie_elf_files_gen_test %s %t
+// RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-convert-device-to-control-packets{path-to-elfs=%t dump-transaction=%t/full.txn})" --mlir-pass-statistics %s 2>&1 | FileCheck %s --check-prefix=FULL
+// RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-convert-device-to-control-packets{path-to-elfs=%t reference-transaction=%t/full.txn})" --mlir-pass-statistics %s 2>&1 | FileCheck %s --check-prefix=DELTA
+
+// Reconfiguring the device with the configuration it already holds only skips
+// the writes to configuration-only registers, here the program memories of the
+// two cores. The resets, which take effect on every write, are kept.
+
+// FULL-COUNT-2: dense_resource<ctrl_pkt_data_
+// FULL:         (S) 50 num-control-packets
+// FULL:         (S)  0 num-elided-words
+
+// DELTA-NOT:    dense_resource
+// DELTA:        amdaie.npu.control_packet write {address = 2301952 : ui32, data = array<i32: 0>
+// DELTA-NEXT:   amdaie.npu.control_packet write {address = 3350528 : ui32, data = array<i32: 0>
+// DELTA-NOT:    dense_resource
+// DELTA:        (S) 48 num-control-packets
+// DELTA:        (S) {{[1-9][0-9]*}} num-elided-words
+
+#executable_target_amdaie_xclbin_fb = #hal.executable.target<"amd-aie", "amdaie-xclbin-fb", {target_device = "npu1_4col", ukernels = "none"}>
+module attributes {hal.executable.target = #executable_target_amdaie_xclbin_fb} {
+  aie.device(npu1_4col) {
+    %tile_0_1 = aie.tile(0, 1)
+    %tile_0_2 = aie.tile(0, 2)
+    %tile_0_3 = aie.tile(0, 3)
+    %buf = aie.buffer(%tile_0_2) {address = 0 : i32, sym_name = "buf"} : memref<256xi32>
+    %buf_1 = aie.buffer(%tile_0_3) {address = 0 : i32, sym_name = "buf_1"} : memref<256xi32>
+    %memtile_dma_0_1 = aie.memtile_dma(%tile_0_1) {
+      aie.end
+    }
+    %mem_0_2 = aie.mem(%tile_0_2) {
+      aie.end
+    }
+    %core_0_2 = aie.core(%tile_0_2)  {
+      %0 = arith.constant 0 : i32
+      %1 = arith.constant 0 : index
+      memref.store %0, %buf[%1] : memref<256xi32>
+      aie.end
+    }
+    %mem_0_3 = aie.mem(%tile_0_3) {
+      aie.end
+    }
+    %core_0_3 = aie.core(%tile_0_3)  {
+      %0 = arith.constant 0 : i32
+      %1 = arith.constant 0 : index
+      memref.store %0, %buf_1[%1] : memref<256xi32>
+      aie.end
+    }
+  }
+}
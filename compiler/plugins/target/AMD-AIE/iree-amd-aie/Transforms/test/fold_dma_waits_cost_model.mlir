@@ -0,0 +1,276 @@
+// RUN: iree-opt --pass-pipeline="builtin.module(iree-amdaie-fold-dma-waits{use-cost-model=true})" --split-input-file %s | FileCheck %s
+
+// Eight transfers of 8 KB on the same channel. They take long enough to keep
+// the channel busy while the host issues the next transfer if one transfer is
+// left in the queue on a wait. So the host waits for the third transfer before
+// issuing the fifth, and for the sixth before issuing the eighth, while the
+// queue never holds more than 4 transfers.
+// CHECK-LABEL: @large_transfers
+// CHECK:       %[[CHANNEL:.+]] = amdaie.channel
+// CHECK:       %[[CONNECTION:.+]] = amdaie.connection
+// CHECK:         %[[OBJECT_FIFO:.+]] = amdaie.logicalobjectfifo.from_memref
+// CHECK:         %[[BD_ID_0:.+]] = amdaie.bd_id
+// CHECK-NEXT:    amdaie.npu.half_dma_cpy_nd  %[[CONNECTION]](%[[OBJECT_FIFO]] [] [] [] bd_id = %[[BD_ID_0]] channel = %[[CHANNEL]])
+// CHECK:         %[[BD_ID_1:.+]] = amdaie.bd_id
+// CHECK-NEXT:    amdaie.npu.half_dma_cpy_nd  %[[CONNECTION]](%[[OBJECT_FIFO]] [] [] [] bd_id = %[[BD_ID_1]] channel = %[[CHANNEL]])
+// CHECK:         %[[BD_ID_2:.+]] = amdaie.bd_id
+// CHECK-NEXT:    %[[TOKEN_2:.+]] = amdaie.npu.half_dma_cpy_nd async %[[CONNECTION]](%[[OBJECT_FIFO]] [] [] [] bd_id = %[[BD_ID_2]] channel = %[[CHANNEL]])
+// CHECK:         %[[BD_ID_3:.+]] = amdaie.bd_id
+// CHECK-NEXT:    amdaie.npu.half_dma_cpy_nd  %[[CONNECTION]](%[[OBJECT_FIFO]] [] [] [] bd_id = %[[BD_ID_3]] channel = %[[CHANNEL]])
+// CHECK:         %[[BD_ID_4:.+]] = amdaie.bd_id
+// CHECK-NEXT:    amdaie.npu.dma_wait(%[[TOKEN_2]] : !amdaie.async_token)
+// CHECK-NEXT:    amdaie.npu.half_dma_cpy_nd  %[[CONNECTION]](%[[OBJECT_FIFO]] [] [] [] bd_id = %[[BD_ID_4]] channel = %[[CHANNEL]])
+// CHECK:         %[[BD_ID_5:.+]] = amdaie.bd_id
+// CHECK-NEXT:    %[[TOKEN_5:.+]] = amdaie.npu.half_dma_cpy_nd async %[[CONNECTION]](%[[OBJECT_FIFO]] [] [] [] bd_id = %[[BD_ID_5]] channel = %[[CHANNEL]])
+// CHECK:         %[[BD_ID_6:.+]] = amdaie.bd_id
+// CHECK-NEXT:    amdaie.npu.half_dma_cpy_nd  %[[CONNECTION]](%[[OBJECT_FIFO]] [] [] [] bd_id = %[[BD_ID_6]] channel = %[[CHANNEL]])
+// CHECK:         %[[BD_ID_7:.+]] = amdaie.bd_id
+// CHECK-NEXT:    amdaie.npu.dma_wait(%[[TOKEN_5]] : !amdaie.async_token)
+// CHECK-NEXT:    %[[TOKEN_7:.+]] = amdaie.npu.half_dma_cpy_nd async %[[CONNECTION]](%[[OBJECT_FIFO]] [] [] [] bd_id = %[[BD_ID_7]] channel = %[[CHANNEL]])
+// CHECK-NEXT:    amdaie.npu.dma_wait(%[[TOKEN_7]] : !amdaie.async_token)
+// CHECK-NEXT:    amdaie.end
+// CHECK-NOT:     amdaie.npu.dma_wait
+#executable_target_amdaie_xclbin_fb = #hal.executable.target<"amd-aie", "amdaie-xclbin-fb", {target_device = "npu1_4col", ukernels = "none"}>
+#pipeline_layout = #hal.pipeline.layout<bindings = [#hal.pipeline.binding<storage_buffer, "ReadOnly|Indirect">, #hal.pipeline.binding<storage_buffer, "ReadOnly|Indirect">, #hal.pipeline.binding<storage_buffer, Indirect>], flags = Indirect>
+module attributes {hal.executable.target = #executable_target_amdaie_xclbin_fb} {
+  func.func @large_transfers() {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c2 = arith.constant 2 : index
+    %c3 = arith.constant 3 : index
+    %c4 = arith.constant 4 : index
+    %c5 = arith.constant 5 : index
+    %c6 = arith.constant 6 : index
+    %c7 = arith.constant 7 : index
+    amdaie.workgroup {
+      %tile = amdaie.tile(%c0, %c1)
+      %tile_0 = amdaie.tile(%c0, %c0)
+      %buffer = amdaie.buffer(%tile) : memref<2048xi32, 1 : i32>
+      %buffer_1 = amdaie.buffer(%tile) : memref<2048xi32, 1 : i32>
+      %lock = amdaie.lock(%tile(4), 4)
+      %lock_2 = amdaie.lock(%tile(5), 0)
+      %0 = amdaie.logicalobjectfifo.from_buffers({%buffer, %buffer_1}, {%lock}, {%lock_2}) : memref<2048xi32, 1 : i32>, memref<2048xi32, 1 : i32> -> !amdaie.logicalobjectfifo<memref<2048xi32, 1 : i32>, 2>
+      %1 = hal.interface.binding.subspan layout(#pipeline_layout) binding(0) alignment(64) offset(%c0) flags("ReadOnly|Indirect") : memref<64x32xi32>
+      %2 = amdaie.logicalobjectfifo.placeholder{%tile_0} : !amdaie.logicalobjectfifo<memref<64x32xi32>>
+      %channel = amdaie.channel(%tile_0, 0, port_type = DMA, direction = MM2S)
+      %channel_3 = amdaie.channel(%tile, 0, port_type = DMA, direction = S2MM)
+      %3 = amdaie.flow({%channel} -> {%channel_3}) {is_packet_flow = false}
+      %4 = amdaie.connection(%0 {%channel_3}, %2 {%channel}, flow = %3) {connection_type = #amdaie<connection_type Circuit>} : (!amdaie.logicalobjectfifo<memref<2048xi32, 1 : i32>, 2>, !amdaie.logicalobjectfifo<memref<64x32xi32>>)
+      amdaie.controlcode {
+        %5 = amdaie.logicalobjectfifo.from_memref %1, {%tile_0} : memref<64x32xi32> -> !amdaie.logicalobjectfifo<memref<2048xi32>>
+        memref.assume_alignment %1, 64 : memref<64x32xi32>
+        %bd_id_0 = amdaie.bd_id(%tile_0, %c0)
+        %6 = amdaie.npu.half_dma_cpy_nd async %4(%5 [] [] [] bd_id = %bd_id_0 channel = %channel) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%6 : !amdaie.async_token)
+        %bd_id_1 = amdaie.bd_id(%tile_0, %c1)
+        %7 = amdaie.npu.half_dma_cpy_nd async %4(%5 [] [] [] bd_id = %bd_id_1 channel = %channel) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%7 : !amdaie.async_token)
+        %bd_id_2 = amdaie.bd_id(%tile_0, %c2)
+        %8 = amdaie.npu.half_dma_cpy_nd async %4(%5 [] [] [] bd_id = %bd_id_2 channel = %channel) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%8 : !amdaie.async_token)
+        %bd_id_3 = amdaie.bd_id(%tile_0, %c3)
+        %9 = amdaie.npu.half_dma_cpy_nd async %4(%5 [] [] [] bd_id = %bd_id_3 channel = %channel) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%9 : !amdaie.async_token)
+        %bd_id_4 = amdaie.bd_id(%tile_0, %c4)
+        %10 = amdaie.npu.half_dma_cpy_nd async %4(%5 [] [] [] bd_id = %bd_id_4 channel = %channel) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%10 : !amdaie.async_token)
+        %bd_id_5 = amdaie.bd_id(%tile_0, %c5)
+        %11 = amdaie.npu.half_dma_cpy_nd async %4(%5 [] [] [] bd_id = %bd_id_5 channel = %channel) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%11 : !amdaie.async_token)
+        %bd_id_6 = amdaie.bd_id(%tile_0, %c6)
+        %12 = amdaie.npu.half_dma_cpy_nd async %4(%5 [] [] [] bd_id = %bd_id_6 channel = %channel) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%12 : !amdaie.async_token)
+        %bd_id_7 = amdaie.bd_id(%tile_0, %c7)
+        %13 = amdaie.npu.half_dma_cpy_nd async %4(%5 [] [] [] bd_id = %bd_id_7 channel = %channel) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%13 : !amdaie.async_token)
+        amdaie.end
+      }
+    }
+    return
+  }
+}
+
+// -----
+
+// Eight transfers of 64 bytes on the same channel. They are too short to hide
+// the time the host takes to issue the next transfer, so the queue is drained
+// when full, with the fewest waits.
+// CHECK-LABEL: @small_transfers
+// CHECK:       %[[CHANNEL:.+]] = amdaie.channel
+// CHECK:       %[[CONNECTION:.+]] = amdaie.connection
+// CHECK:         %[[OBJECT_FIFO:.+]] = amdaie.logicalobjectfifo.from_memref
+// CHECK:         %[[BD_ID_0:.+]] = amdaie.bd_id
+// CHECK-NEXT:    amdaie.npu.half_dma_cpy_nd  %[[CONNECTION]](%[[OBJECT_FIFO]] [0] [16] [1] bd_id = %[[BD_ID_0]] channel = %[[CHANNEL]])
+// CHECK:         %[[BD_ID_1:.+]] = amdaie.bd_id
+// CHECK-NEXT:    amdaie.npu.half_dma_cpy_nd  %[[CONNECTION]](%[[OBJECT_FIFO]] [0] [16] [1] bd_id = %[[BD_ID_1]] channel = %[[CHANNEL]])
+// CHECK:         %[[BD_ID_2:.+]] = amdaie.bd_id
+// CHECK-NEXT:    amdaie.npu.half_dma_cpy_nd  %[[CONNECTION]](%[[OBJECT_FIFO]] [0] [16] [1] bd_id = %[[BD_ID_2]] channel = %[[CHANNEL]])
+// CHECK:         %[[BD_ID_3:.+]] = amdaie.bd_id
+// CHECK-NEXT:    %[[TOKEN_3:.+]] = amdaie.npu.half_dma_cpy_nd async %[[CONNECTION]](%[[OBJECT_FIFO]] [0] [16] [1] bd_id = %[[BD_ID_3]] channel = %[[CHANNEL]])
+// CHECK:         %[[BD_ID_4:.+]] = amdaie.bd_id
+// CHECK-NEXT:    amdaie.npu.dma_wait(%[[TOKEN_3]] : !amdaie.async_token)
+// CHECK-NEXT:    amdaie.npu.half_dma_cpy_nd  %[[CONNECTION]](%[[OBJECT_FIFO]] [0] [16] [1] bd_id = %[[BD_ID_4]] channel = %[[CHANNEL]])
+// CHECK:         %[[BD_ID_5:.+]] = amdaie.bd_id
+// CHECK-NEXT:    amdaie.npu.half_dma_cpy_nd  %[[CONNECTION]](%[[OBJECT_FIFO]] [0] [16] [1] bd_id = %[[BD_ID_5]] channel = %[[CHANNEL]])
+// CHECK:         %[[BD_ID_6:.+]] = amdaie.bd_id
+// CHECK-NEXT:    amdaie.npu.half_dma_cpy_nd  %[[CONNECTION]](%[[OBJECT_FIFO]] [0] [16] [1] bd_id = %[[BD_ID_6]] channel = %[[CHANNEL]])
+// CHECK:         %[[BD_ID_7:.+]] = amdaie.bd_id
+// CHECK-NEXT:    %[[TOKEN_7:.+]] = amdaie.npu.half_dma_cpy_nd async %[[CONNECTION]](%[[OBJECT_FIFO]] [0] [16] [1] bd_id = %[[BD_ID_7]] channel = %[[CHANNEL]])
+// CHECK-NEXT:    amdaie.npu.dma_wait(%[[TOKEN_7]] : !amdaie.async_token)
+// CHECK-NEXT:    amdaie.end
+// CHECK-NOT:     amdaie.npu.dma_wait
+#executable_target_amdaie_xclbin_fb = #hal.executable.target<"amd-aie", "amdaie-xclbin-fb", {target_device = "npu1_4col", ukernels = "none"}>
+#pipeline_layout = #hal.pipeline.layout<bindings = [#hal.pipeline.binding<storage_buffer, "ReadOnly|Indirect">, #hal.pipeline.binding<storage_buffer, "ReadOnly|Indirect">, #hal.pipeline.binding<storage_buffer, Indirect>], flags = Indirect>
+module attributes {hal.executable.target = #executable_target_amdaie_xclbin_fb} {
+  func.func @small_transfers() {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c2 = arith.constant 2 : index
+    %c3 = arith.constant 3 : index
+    %c4 = arith.constant 4 : index
+    %c5 = arith.constant 5 : index
+    %c6 = arith.constant 6 : index
+    %c7 = arith.constant 7 : index
+    amdaie.workgroup {
+      %tile = amdaie.tile(%c0, %c1)
+      %tile_0 = amdaie.tile(%c0, %c0)
+      %buffer = amdaie.buffer(%tile) : memref<2048xi32, 1 : i32>
+      %buffer_1 = amdaie.buffer(%tile) : memref<2048xi32, 1 : i32>
+      %lock = amdaie.lock(%tile(4), 4)
+      %lock_2 = amdaie.lock(%tile(5), 0)
+      %0 = amdaie.logicalobjectfifo.from_buffers({%buffer, %buffer_1}, {%lock}, {%lock_2}) : memref<2048xi32, 1 : i32>, memref<2048xi32, 1 : i32> -> !amdaie.logicalobjectfifo<memref<2048xi32, 1 : i32>, 2>
+      %1 = hal.interface.binding.subspan layout(#pipeline_layout) binding(0) alignment(64) offset(%c0) flags("ReadOnly|Indirect") : memref<64x32xi32>
+      %2 = amdaie.logicalobjectfifo.placeholder{%tile_0} : !amdaie.logicalobjectfifo<memref<64x32xi32>>
+      %channel = amdaie.channel(%tile_0, 0, port_type = DMA, direction = MM2S)
+      %channel_3 = amdaie.channel(%tile, 0, port_type = DMA, direction = S2MM)
+      %3 = amdaie.flow({%channel} -> {%channel_3}) {is_packet_flow = false}
+      %4 = amdaie.connection(%0 {%channel_3}, %2 {%channel}, flow = %3) {connection_type = #amdaie<connection_type Circuit>} : (!amdaie.logicalobjectfifo<memref<2048xi32, 1 : i32>, 2>, !amdaie.logicalobjectfifo<memref<64x32xi32>>)
+      amdaie.controlcode {
+        %5 = amdaie.logicalobjectfifo.from_memref %1, {%tile_0} : memref<64x32xi32> -> !amdaie.logicalobjectfifo<memref<2048xi32>>
+        memref.assume_alignment %1, 64 : memref<64x32xi32>
+        %bd_id_0 = amdaie.bd_id(%tile_0, %c0)
+        %6 = amdaie.npu.half_dma_cpy_nd async %4(%5 [0] [16] [1] bd_id = %bd_id_0 channel = %channel) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%6 : !amdaie.async_token)
+        %bd_id_1 = amdaie.bd_id(%tile_0, %c1)
+        %7 = amdaie.npu.half_dma_cpy_nd async %4(%5 [0] [16] [1] bd_id = %bd_id_1 channel = %channel) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%7 : !amdaie.async_token)
+        %bd_id_2 = amdaie.bd_id(%tile_0, %c2)
+        %8 = amdaie.npu.half_dma_cpy_nd async %4(%5 [0] [16] [1] bd_id = %bd_id_2 channel = %channel) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%8 : !amdaie.async_token)
+        %bd_id_3 = amdaie.bd_id(%tile_0, %c3)
+        %9 = amdaie.npu.half_dma_cpy_nd async %4(%5 [0] [16] [1] bd_id = %bd_id_3 channel = %channel) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%9 : !amdaie.async_token)
+        %bd_id_4 = amdaie.bd_id(%tile_0, %c4)
+        %10 = amdaie.npu.half_dma_cpy_nd async %4(%5 [0] [16] [1] bd_id = %bd_id_4 channel = %channel) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%10 : !amdaie.async_token)
+        %bd_id_5 = amdaie.bd_id(%tile_0, %c5)
+        %11 = amdaie.npu.half_dma_cpy_nd async %4(%5 [0] [16] [1] bd_id = %bd_id_5 channel = %channel) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%11 : !amdaie.async_token)
+        %bd_id_6 = amdaie.bd_id(%tile_0, %c6)
+        %12 = amdaie.npu.half_dma_cpy_nd async %4(%5 [0] [16] [1] bd_id = %bd_id_6 channel = %channel) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%12 : !amdaie.async_token)
+        %bd_id_7 = amdaie.bd_id(%tile_0, %c7)
+        %13 = amdaie.npu.half_dma_cpy_nd async %4(%5 [0] [16] [1] bd_id = %bd_id_7 channel = %channel) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%13 : !amdaie.async_token)
+        amdaie.end
+      }
+    }
+    return
+  }
+}
+
+// -----
+
+// Transfers that read from memory on two channels, followed by a transfer that
+// writes to memory. The waits on the reads move past the reads on the other
+// channel and are combined, but the write is kept ordered with the transfers
+// that were waited on before it, and the read after the write with the write.
+// CHECK-LABEL: @ordered_transfers
+// CHECK:       %[[CHANNEL_0:.+]] = amdaie.channel(%{{.+}}, 0, port_type = DMA, direction = MM2S)
+// CHECK:       %[[CHANNEL_1:.+]] = amdaie.channel(%{{.+}}, 1, port_type = DMA, direction = MM2S)
+// CHECK:       %[[CHANNEL_2:.+]] = amdaie.channel(%{{.+}}, 0, port_type = DMA, direction = S2MM)
+// CHECK:         %[[BD_ID_0:.+]] = amdaie.bd_id
+// CHECK-NEXT:    amdaie.npu.half_dma_cpy_nd  %{{.+}}(%{{.+}} [] [] [] bd_id = %[[BD_ID_0]] channel = %[[CHANNEL_0]])
+// CHECK-NEXT:    %[[BD_ID_1:.+]] = amdaie.bd_id
+// CHECK-NEXT:    amdaie.npu.half_dma_cpy_nd  %{{.+}}(%{{.+}} [] [] [] bd_id = %[[BD_ID_1]] channel = %[[CHANNEL_1]])
+// CHECK-NEXT:    %[[BD_ID_2:.+]] = amdaie.bd_id
+// CHECK-NEXT:    %[[TOKEN_0:.+]] = amdaie.npu.half_dma_cpy_nd async %{{.+}}(%{{.+}} [] [] [] bd_id = %[[BD_ID_2]] channel = %[[CHANNEL_0]])
+// CHECK-NEXT:    %[[BD_ID_3:.+]] = amdaie.bd_id
+// CHECK-NEXT:    %[[TOKEN_1:.+]] = amdaie.npu.half_dma_cpy_nd async %{{.+}}(%{{.+}} [] [] [] bd_id = %[[BD_ID_3]] channel = %[[CHANNEL_1]])
+// CHECK-NEXT:    %[[BD_ID_4:.+]] = amdaie.bd_id
+// CHECK-NEXT:    amdaie.npu.dma_wait(%[[TOKEN_0]], %[[TOKEN_1]] : !amdaie.async_token, !amdaie.async_token)
+// CHECK-NEXT:    %[[TOKEN_2:.+]] = amdaie.npu.half_dma_cpy_nd async %{{.+}}(%{{.+}} [] [] [] bd_id = %[[BD_ID_4]] channel = %[[CHANNEL_2]])
+// CHECK-NEXT:    %[[BD_ID_5:.+]] = amdaie.bd_id
+// CHECK-NEXT:    amdaie.npu.dma_wait(%[[TOKEN_2]] : !amdaie.async_token)
+// CHECK-NEXT:    %[[TOKEN_3:.+]] = amdaie.npu.half_dma_cpy_nd async %{{.+}}(%{{.+}} [] [] [] bd_id = %[[BD_ID_5]] channel = %[[CHANNEL_0]])
+// CHECK-NEXT:    amdaie.npu.dma_wait(%[[TOKEN_3]] : !amdaie.async_token)
+// CHECK-NEXT:    amdaie.end
+#executable_target_amdaie_xclbin_fb = #hal.executable.target<"amd-aie", "amdaie-xclbin-fb", {target_device = "npu1_4col", ukernels = "none"}>
+#pipeline_layout = #hal.pipeline.layout<bindings = [#hal.pipeline.binding<storage_buffer, "ReadOnly|Indirect">, #hal.pipeline.binding<storage_buffer, "ReadOnly|Indirect">, #hal.pipeline.binding<storage_buffer, Indirect>], flags = Indirect>
+module attributes {hal.executable.target = #executable_target_amdaie_xclbin_fb} {
+  func.func @ordered_transfers() {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c2 = arith.constant 2 : index
+    %c3 = arith.constant 3 : index
+    %c4 = arith.constant 4 : index
+    %c5 = arith.constant 5 : index
+    amdaie.workgroup {
+      %tile = amdaie.tile(%c0, %c1)
+      %tile_0 = amdaie.tile(%c0, %c0)
+      %buffer = amdaie.buffer(%tile) : memref<2048xi32, 1 : i32>
+      %buffer_1 = amdaie.buffer(%tile) : memref<2048xi32, 1 : i32>
+      %buffer_2 = amdaie.buffer(%tile) : memref<2048xi32, 1 : i32>
+      %lock = amdaie.lock(%tile(4), 4)
+      %lock_1 = amdaie.lock(%tile(5), 0)
+      %lock_2 = amdaie.lock(%tile(6), 4)
+      %lock_3 = amdaie.lock(%tile(7), 0)
+      %lock_4 = amdaie.lock(%tile(8), 4)
+      %lock_5 = amdaie.lock(%tile(9), 0)
+      %0 = amdaie.logicalobjectfifo.from_buffers({%buffer}, {%lock}, {%lock_1}) : memref<2048xi32, 1 : i32> -> !amdaie.logicalobjectfifo<memref<2048xi32, 1 : i32>, 1>
+      %1 = amdaie.logicalobjectfifo.from_buffers({%buffer_1}, {%lock_2}, {%lock_3}) : memref<2048xi32, 1 : i32> -> !amdaie.logicalobjectfifo<memref<2048xi32, 1 : i32>, 1>
+      %2 = amdaie.logicalobjectfifo.from_buffers({%buffer_2}, {%lock_4}, {%lock_5}) : memref<2048xi32, 1 : i32> -> !amdaie.logicalobjectfifo<memref<2048xi32, 1 : i32>, 1>
+      %3 = hal.interface.binding.subspan layout(#pipeline_layout) binding(0) alignment(64) offset(%c0) flags("ReadOnly|Indirect") : memref<64x32xi32>
+      %4 = hal.interface.binding.subspan layout(#pipeline_layout) binding(1) alignment(64) offset(%c0) flags("ReadOnly|Indirect") : memref<64x32xi32>
+      %5 = hal.interface.binding.subspan layout(#pipeline_layout) binding(2) alignment(64) offset(%c0) flags(Indirect) : memref<64x32xi32>
+      %6 = amdaie.logicalobjectfifo.placeholder{%tile_0} : !amdaie.logicalobjectfifo<memref<64x32xi32>>
+      %channel = amdaie.channel(%tile_0, 0, port_type = DMA, direction = MM2S)
+      %channel_1 = amdaie.channel(%tile_0, 1, port_type = DMA, direction = MM2S)
+      %channel_2 = amdaie.channel(%tile_0, 0, port_type = DMA, direction = S2MM)
+      %channel_3 = amdaie.channel(%tile, 0, port_type = DMA, direction = S2MM)
+      %channel_4 = amdaie.channel(%tile, 1, port_type = DMA, direction = S2MM)
+      %channel_5 = amdaie.channel(%tile, 0, port_type = DMA, direction = MM2S)
+      %7 = amdaie.flow({%channel} -> {%channel_3}) {is_packet_flow = false}
+      %8 = amdaie.flow({%channel_1} -> {%channel_4}) {is_packet_flow = false}
+      %9 = amdaie.flow({%channel_5} -> {%channel_2}) {is_packet_flow = false}
+      %10 = amdaie.connection(%0 {%channel_3}, %6 {%channel}, flow = %7) {connection_type = #amdaie<connection_type Circuit>} : (!amdaie.logicalobjectfifo<memref<2048xi32, 1 : i32>, 1>, !amdaie.logicalobjectfifo<memref<64x32xi32>>)
+      %11 = amdaie.connection(%1 {%channel_4}, %6 {%channel_1}, flow = %8) {connection_type = #amdaie<connection_type Circuit>} : (!amdaie.logicalobjectfifo<memref<2048xi32, 1 : i32>, 1>, !amdaie.logicalobjectfifo<memref<64x32xi32>>)
+      %12 = amdaie.connection(%6 {%channel_2}, %2 {%channel_5}, flow = %9) {connection_type = #amdaie<connection_type Circuit>} : (!amdaie.logicalobjectfifo<memref<64x32xi32>>, !amdaie.logicalobjectfifo<memref<2048xi32, 1 : i32>, 1>)
+      amdaie.controlcode {
+        %13 = amdaie.logicalobjectfifo.from_memref %3, {%tile_0} : memref<64x32xi32> -> !amdaie.logicalobjectfifo<memref<2048xi32>>
+        %14 = amdaie.logicalobjectfifo.from_memref %4, {%tile_0} : memref<64x32xi32> -> !amdaie.logicalobjectfifo<memref<2048xi32>>
+        %15 = amdaie.logicalobjectfifo.from_memref %5, {%tile_0} : memref<64x32xi32> -> !amdaie.logicalobjectfifo<memref<2048xi32>>
+        %bd_id = amdaie.bd_id(%tile_0, %c0)
+        %16 = amdaie.npu.half_dma_cpy_nd async %10(%13 [] [] [] bd_id = %bd_id channel = %channel) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%16 : !amdaie.async_token)
+        %bd_id_1 = amdaie.bd_id(%tile_0, %c1)
+        %17 = amdaie.npu.half_dma_cpy_nd async %11(%14 [] [] [] bd_id = %bd_id_1 channel = %channel_1) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%17 : !amdaie.async_token)
+        %bd_id_2 = amdaie.bd_id(%tile_0, %c2)
+        %18 = amdaie.npu.half_dma_cpy_nd async %10(%13 [] [] [] bd_id = %bd_id_2 channel = %channel) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%18 : !amdaie.async_token)
+        %bd_id_3 = amdaie.bd_id(%tile_0, %c3)
+        %19 = amdaie.npu.half_dma_cpy_nd async %11(%14 [] [] [] bd_id = %bd_id_3 channel = %channel_1) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%19 : !amdaie.async_token)
+        %bd_id_4 = amdaie.bd_id(%tile_0, %c4)
+        %20 = amdaie.npu.half_dma_cpy_nd async %12(%15 [] [] [] bd_id = %bd_id_4 channel = %channel_2) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%20 : !amdaie.async_token)
+        %bd_id_5 = amdaie.bd_id(%tile_0, %c5)
+        %21 = amdaie.npu.half_dma_cpy_nd async %10(%13 [] [] [] bd_id = %bd_id_5 channel = %channel) : !amdaie.logicalobjectfifo<memref<2048xi32>>
+        amdaie.npu.dma_wait(%21 : !amdaie.async_token)
+        amdaie.end
+      }
+    }
+    return
+  }
+}
@@ -0,0 +1,48 @@
+// RUN: echo '{"op": "linalg.matmul", "shape": [128, 128, 256], "element_types": ["bf16", "bf16", "f32"], "device": "npu1_4col", "num_rows": 4, "num_cols": 4, "tile_sizes": [64, 128, 1], "pack_sizes": [[16, 32, 64], [4, 4, 8]], "buffer_depths": [1, 2, 1], "outlining": "none"}' > %t.jsonl
+// RUN: rm -f %t.export.jsonl
+// RUN: iree-opt --pass-pipeline='builtin.module(iree-amdaie-lowering-strategy{target-device=npu1_4col tuning-database=%t.jsonl tuning-export=%t.export.jsonl})' %s | FileCheck %s
+// RUN: FileCheck %s --input-file=%t.export.jsonl --check-prefix=EXPORT
+// RUN: rm -f %t.default.jsonl
+// RUN: iree-opt --pass-pipeline='builtin.module(iree-amdaie-lowering-strategy{target-device=npu1_4col num-rows=2 num-cols=2 tuning-database=%t.jsonl tuning-export=%t.default.jsonl})' %s | FileCheck %s --check-prefix=NO-RECORD
+// RUN: FileCheck %s --input-file=%t.default.jsonl --check-prefix=EXPORT-DEFAULT
+
+// The record overrides the tile and pack sizes of the heuristics and the
+// buffer depths and outlining strategy are attached to the function.
+// CHECK{LITERAL}: #config = #iree_codegen.lowering_config<tile_sizes = [[64, 128, 0], [0, 0, 1], [1, 1, 0]]>
+// CHECK{LITERAL}: #amdaie.packing_config<packing_config = [{packedSizes = [16, 32, 64], transposePackIndices = [0, 1, 2], unpackEmpty = [false, false, true], innerPerm = [[0, 1], [1, 0], [0, 1]], outerPerm = [[0, 1], [1, 0], [1, 0]]}, {packedSizes = [0, 0, 0, 4, 4, 8], transposePackIndices = [0, 1, 2], unpackEmpty = [false, false, true], innerPerm = [[0, 1], [1, 0], [0, 1]], outerPerm = [[0, 1, 3, 2], [0, 1, 3, 2], [0, 1, 3, 2]]}]>
+// CHECK:       func.func @matmul_128x128x256_bf16xbf16xf32()
+// CHECK-SAME:    amdaie.tuning.buffer_depths = array<i64: 1, 2, 1>
+// CHECK-SAME:    amdaie.tuning.outlining = "none"
+
+// The selected configuration is exported in the format of the database.
+// EXPORT: {"op":"linalg.matmul","shape":[128,128,256],"element_types":["bf16","bf16","f32"],"device":"npu1_4col","num_rows":4,"num_cols":4,"tile_sizes":[64,128,1],"pack_sizes":[[16,32,64],[4,4,8]],"buffer_depths":[1,2,1],"outlining":"none"}
+
+// The record doesn't apply to a 2x2 array, so the heuristics are used.
+// NO-RECORD{LITERAL}: #config = #iree_codegen.lowering_config<tile_sizes = [[64, 64, 0], [0, 0, 1], [1, 1, 0]]>
+// NO-RECORD-NOT:      amdaie.tuning
+
+// The buffer depths and outlining strategy the dispatch is lowered with are
+// exported too.
+// EXPORT-DEFAULT: {"op":"linalg.matmul",{{.*}}"num_rows":2,"num_cols":2,"tile_sizes":[64,64,1],{{.*}}"buffer_depths":[1,2,2],"outlining":"balanced"}
+#pipeline_layout = #hal.pipeline.layout<bindings = [
+  <storage_buffer>,
+  <storage_buffer>,
+  <storage_buffer>
+]>
+module {
+  func.func @matmul_128x128x256_bf16xbf16xf32() {
+    %cst = arith.constant 0.000000e+00 : f32
+    %c0 = arith.constant 0 : index
+    %0 = hal.interface.binding.subspan layout(#pipeline_layout) binding(0) alignment(64) offset(%c0) flags(ReadOnly) : !iree_tensor_ext.dispatch.tensor<readonly:tensor<128x256xbf16>>
+    %1 = hal.interface.binding.subspan layout(#pipeline_layout) binding(1) alignment(64) offset(%c0) flags(ReadOnly) : !iree_tensor_ext.dispatch.tensor<readonly:tensor<256x128xbf16>>
+    %2 = hal.interface.binding.subspan layout(#pipeline_layout) binding(2) alignment(64) offset(%c0) : !iree_tensor_ext.dispatch.tensor<writeonly:tensor<128x128xf32>>
+    %3 = iree_tensor_ext.dispatch.tensor.load %0, offsets = [0, 0], sizes = [128, 256], strides = [1, 1] : !iree_tensor_ext.dispatch.tensor<readonly:tensor<128x256xbf16>> -> tensor<128x256xbf16>
+    %4 = iree_tensor_ext.dispatch.tensor.load %1, offsets = [0, 0], sizes = [256, 128], strides = [1, 1] : !iree_tensor_ext.dispatch.tensor<readonly:tensor<256x128xbf16>> -> tensor<256x128xbf16>
+    %5 = tensor.empty() : tensor<128x128xf32>
+    %6 = linalg.fill ins(%cst : f32) outs(%5 : tensor<128x128xf32>) -> tensor<128x128xf32>
+    // CHECK:  linalg.matmul {lowering_config = #config, packing_config = #packingConfig}
+    %7 = linalg.matmul ins(%3, %4 : tensor<128x256xbf16>, tensor<256x128xbf16>) outs(%6 : tensor<128x128xf32>) -> tensor<128x128xf32>
+    iree_tensor_ext.dispatch.tensor.store %7, %2, offsets = [0, 0], sizes = [128, 128], strides = [1, 1] : tensor<128x128xf32> -> !iree_tensor_ext.dispatch.tensor<writeonly:tensor<128x128xf32>>
+    return
+  }
+}
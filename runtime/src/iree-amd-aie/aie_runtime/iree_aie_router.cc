@@ -11,7 +11,10 @@
 #include "amsel_generator.h"
 #include "d_ary_heap.h"
 #include "iree_aie_runtime.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/ThreadPool.h"
 
 #define DEBUG_TYPE "iree-aie-runtime-router"
 
@@ -23,6 +26,9 @@
 #define DEMAND_BASE 1.0
 #define MAX_CIRCUIT_STREAM_CAPACITY 1
 #define MAX_PACKET_STREAM_CAPACITY 32
+// The maximum number of flows whose searches run concurrently in batched
+// routing.
+#define MAX_BATCH_SIZE 64
 
 static constexpr double INF = std::numeric_limits<double>::max();
 
@@ -61,58 +67,118 @@ struct SwitchboxConnect {
   TileLoc srcCoords, dstCoords;
   std::vector<Port> srcPorts;
   std::vector<Port> dstPorts;
+  // Offset of this switchbox's (srcPort, dstPort) matrix in the per-channel
+  // arrays of `ChannelState`. Channel (i, j) is stored in row-major order at
+  // `slotOffset + i * dstPorts.size() + j`.
+  size_t slotOffset = 0;
+
+  size_t numSlots() const { return srcPorts.size() * dstPorts.size(); }
+  size_t slot(size_t i, size_t j) const {
+    return slotOffset + i * dstPorts.size() + j;
+  }
+};
+
+/// The per-channel state of all switchboxes, flattened into contiguous arrays
+/// indexed by channel slot (see `SwitchboxConnect::slot`).
+struct ChannelState {
   // connectivity between ports
-  std::vector<std::vector<Connectivity>> connectivity;
+  std::vector<Connectivity> connectivity;
   // weights of Dijkstra's shortest path
-  std::vector<std::vector<double>> demand;
+  std::vector<double> demand;
   // history of Channel being over capacity
-  std::vector<std::vector<int>> overCapacity;
+  std::vector<int> overCapacity;
   // how many circuit streams are actually using this Channel
-  std::vector<std::vector<int>> usedCapacity;
+  std::vector<int> usedCapacity;
   // how many packet streams are actually using this Channel
-  std::vector<std::vector<int>> packetFlowCount;
+  std::vector<int> packetFlowCount;
   // The number of fixed, previously-routed packet streams using each channel
   // before the pathfinder algorithm starts.
-  std::vector<std::vector<int>> fixedPacketFlowCount;
+  std::vector<int> fixedPacketFlowCount;
   // only sharing the channel with the same packet group id
-  std::vector<std::vector<int>> packetGroupId;
-
-  // resize the matrices to the size of srcPorts and dstPorts
-  void resize() {
-    connectivity.resize(
-        srcPorts.size(),
-        std::vector<Connectivity>(dstPorts.size(), Connectivity::INVALID));
-    demand.resize(srcPorts.size(), std::vector<double>(dstPorts.size(), 0.0));
-    overCapacity.resize(srcPorts.size(), std::vector<int>(dstPorts.size(), 0));
-    usedCapacity.resize(srcPorts.size(), std::vector<int>(dstPorts.size(), 0));
-    packetFlowCount.resize(srcPorts.size(),
-                           std::vector<int>(dstPorts.size(), 0));
-    fixedPacketFlowCount.resize(srcPorts.size(),
-                                std::vector<int>(dstPorts.size(), 0));
-    packetGroupId.resize(srcPorts.size(), std::vector<int>(dstPorts.size(), 0));
+  std::vector<int> packetGroupId;
+
+  size_t size() const { return connectivity.size(); }
+
+  // reserve the slots for the (srcPorts x dstPorts) matrix of `sb`
+  void allocate(SwitchboxConnect &sb) {
+    sb.slotOffset = size();
+    size_t newSize = size() + sb.numSlots();
+    connectivity.resize(newSize, Connectivity::INVALID);
+    demand.resize(newSize, 0.0);
+    overCapacity.resize(newSize, 0);
+    usedCapacity.resize(newSize, 0);
+    packetFlowCount.resize(newSize, 0);
+    fixedPacketFlowCount.resize(newSize, 0);
+    packetGroupId.resize(newSize, 0);
+  }
+
+  void clear() {
+    connectivity.clear();
+    demand.clear();
+    overCapacity.clear();
+    usedCapacity.clear();
+    packetFlowCount.clear();
+    fixedPacketFlowCount.clear();
+    packetGroupId.clear();
   }
 
   // update demand at the beginning of each dijkstraShortestPaths iteration
   void updateDemand() {
-    for (size_t i = 0; i < srcPorts.size(); i++) {
-      for (size_t j = 0; j < dstPorts.size(); j++) {
-        double history = DEMAND_BASE + OVER_CAPACITY_COEFF * overCapacity[i][j];
-        double congestion =
-            DEMAND_BASE + USED_CAPACITY_COEFF * usedCapacity[i][j];
-        demand[i][j] = history * congestion;
-      }
+    for (size_t s = 0; s < size(); s++) {
+      double history = DEMAND_BASE + OVER_CAPACITY_COEFF * overCapacity[s];
+      double congestion = DEMAND_BASE + USED_CAPACITY_COEFF * usedCapacity[s];
+      demand[s] = history * congestion;
     }
   }
 
   // inside each dijkstraShortestPaths interation, bump demand when exceeds
   // capacity
-  void bumpDemand(size_t i, size_t j) {
-    if (usedCapacity[i][j] >= MAX_CIRCUIT_STREAM_CAPACITY) {
-      demand[i][j] *= DEMAND_COEFF;
+  void bumpDemand(size_t s) {
+    if (usedCapacity[s] >= MAX_CIRCUIT_STREAM_CAPACITY) {
+      demand[s] *= DEMAND_COEFF;
     }
   }
 };
 
+/// An edge of the routing graph, i.e. a channel from the port `src` to the
+/// port `dst` (both node indices into `RouterImpl::nodes`), through the
+/// switchbox (or the wires between two switchboxes) `sb`.
+struct RoutingEdge {
+  int src;
+  int dst;
+  SwitchboxConnect *sb;
+  uint32_t i, j;
+  size_t slot;
+};
+
+/// Scratch state of a single shortest-path search, indexed by node. Kept
+/// around between searches to avoid reallocating it for every flow.
+struct ShortestPathState {
+  enum Color : uint8_t { WHITE, GRAY, BLACK };
+  std::vector<double> distance;
+  std::vector<uint64_t> indexInHeap;
+  std::vector<Color> colors;
+  // The index of the edge through which a node was reached, or -1.
+  std::vector<int> predEdge;
+  // The nodes already part of the route of the flow being traced.
+  std::vector<bool> processed;
+  // The nodes popped from the queue, in order. The search only read the demand
+  // of the channels leaving them.
+  std::vector<int> settled;
+};
+
+/// A unit of rip-up and reroute in `RouterImpl::findPathsIncremental`: either
+/// a single circuit flow or all flows of a packet group.
+struct RoutedNet {
+  int packetGroupId;
+  // Indices into `RouterImpl::flows`.
+  SmallVector<size_t> flowIndices;
+  // The current route of each flow in `flowIndices`.
+  SmallVector<SwitchSettings> switchSettings;
+  // The channels used by the net and the number of its flows using each.
+  SmallVector<std::pair<size_t, int>> slotFlowCounts;
+};
+
 struct Flow {
   int packetGroupId;
   PhysPort src;
@@ -120,7 +186,12 @@ struct Flow {
 };
 
 struct RouterImpl {
-  RouterImpl(int maxCol, int maxRow) : maxCol(maxCol), maxRow(maxRow) {}
+  RouterImpl(int maxCol, int maxRow, RouterOptions options)
+      : maxCol(maxCol), maxRow(maxRow), options(options) {
+    pathStates.resize(options.batched && options.threadPool
+                          ? options.threadPool->getMaxConcurrency()
+                          : 1);
+  }
   // Flows to be routed
   std::vector<Flow> flows;
   // Represent all routable paths as a graph
@@ -129,19 +200,74 @@ struct RouterImpl {
   // switchbox otherwise, it represents connections (South, North, West, East)
   // accross two switchboxes
   std::map<std::pair<TileLoc, TileLoc>, SwitchboxConnect> graph;
-  // Channels available in the network.
-  // The key is a `PhysPort` representing the start of a path.
-  // The value is a vector of `PhysPorts` representing the possible ends of
-  // the path.
-  std::map<PhysPort, SmallVector<PhysPort>> channels;
+  // The state of every channel of every switchbox in `graph`.
+  ChannelState channelState;
+  // The graph above, flattened into an index-based adjacency structure once
+  // in `initialize`: every `PhysPort` that can be visited gets a contiguous
+  // node index and the outgoing channels of node `n` are
+  // `edges[edgeOffsets[n]]` to `edges[edgeOffsets[n + 1] - 1]` (CSR), sorted
+  // by destination port.
+  std::vector<PhysPort> nodes;
+  DenseMap<PhysPort, int> nodeIds;
+  std::vector<size_t> edgeOffsets;
+  std::vector<RoutingEdge> edges;
   /// The dimensions (columns and rows) of the AIE device to be routed.
   /// These values may be smaller than the actual device size if only a portion
   /// of the device is intended to be routed.
   int maxCol, maxRow;
+  RouterOptions options;
+  /// State of incremental routing: the nets being routed, the nets using each
+  /// channel (with their number of flows through it) and the channels that
+  /// are currently over capacity.
+  std::vector<RoutedNet> nets;
+  std::vector<SmallVector<std::pair<size_t, int>, 1>> slotNets;
+  std::set<size_t> overCapacitySlots;
+  /// The edge of each channel, or -1, and the packet groups using the input
+  /// (indexed by `sb.slot(i, 0)`) and the output port (indexed by
+  /// `sb.slot(0, j)`) of each channel, with their number of channels through
+  /// the port.
+  std::vector<int> slotEdges;
+  std::vector<SmallVector<std::pair<int, int>, 1>> srcPortGroups;
+  std::vector<SmallVector<std::pair<int, int>, 1>> dstPortGroups;
+  /// The search state of each thread of `options.threadPool`.
+  std::vector<ShortestPathState> pathStates;
   /// Map to get the neighbor tile location given a direction.
   static const llvm::SmallDenseMap<std::pair<StrmSwPortType, StrmSwPortType>,
                                    std::pair<int, int>>
       directionToDeltaCoordsMap;
+
+  /// Returns the node index of `port` or -1 if the port can't be routed.
+  int getNodeId(const PhysPort &port) const {
+    auto it = nodeIds.find(port);
+    return it == nodeIds.end() ? -1 : it->second;
+  }
+  int getOrCreateNodeId(const PhysPort &port);
+  void buildRoutingGraph();
+  void dijkstraShortestPaths(int src, ArrayRef<int> targets,
+                             ShortestPathState &state) const;
+  /// Find the shortest paths from the source of `flow` to all of its
+  /// destinations and trace them back into `switchSettings`. Destinations
+  /// share the part of the tree that has already been traced, and
+  /// `visitChannel` is called once for every channel of the tree. Returns
+  /// false if a destination can't be reached.
+  bool routeFlow(const Flow &flow, ShortestPathState &state,
+                 SwitchSettings &switchSettings,
+                 llvm::function_ref<void(const RoutingEdge &)> visitChannel)
+      const;
+
+  std::vector<SmallVector<size_t>> formBatches(ArrayRef<Flow> flows) const;
+  bool routeFlowsInBatches(
+      ArrayRef<Flow> flows,
+      llvm::function_ref<void(const Flow &, const RoutingEdge &)> visitChannel,
+      std::map<PhysPort, SwitchSettings> &routingSolution);
+
+  int computeOccupancy(size_t slot) const;
+  void updateChannel(size_t slot);
+  void updateNetChannels(const RoutedNet &net, int delta);
+  void ripUpNet(size_t netIndex);
+  bool routeNet(size_t netIndex, ShortestPathState &state);
+  std::optional<std::map<PhysPort, SwitchSettings>> findPathsIncremental(
+      int maxIterations);
 };
 
 const llvm::SmallDenseMap<std::pair<StrmSwPortType, StrmSwPortType>,
@@ -156,12 +282,14 @@ const llvm::SmallDenseMap<std::pair<StrmSwPortType, StrmSwPortType>,
         {{StrmSwPortType::EAST, StrmSwPortType::WEST},
          {1, 0}}};  // East to West, going right, col + 1
 
-Router::Router(int maxCol, int maxRow) {
-  impl = new RouterImpl(maxCol, maxRow);
+Router::Router(int maxCol, int maxRow, RouterOptions options) {
+  impl = new RouterImpl(maxCol, maxRow, options);
 }
 Router::~Router() { delete impl; }
 
 void Router::initialize(const AMDAIEDeviceModel &deviceModel) {
+  impl->graph.clear();
+  impl->channelState.clear();
   std::map<StrmSwPortType, int> maxChannels;
   auto intraconnect = [&](int col, int row) {
     TileLoc tileLoc = {col, row};
@@ -197,16 +325,17 @@ void Router::initialize(const AMDAIEDeviceModel &deviceModel) {
       maxChannels[bundle] = channels;
     }
     // initialize matrices
-    sb.resize();
+    ChannelState &state = impl->channelState;
+    state.allocate(sb);
     for (size_t i = 0; i < sb.srcPorts.size(); i++) {
       for (size_t j = 0; j < sb.dstPorts.size(); j++) {
         auto &pIn = sb.srcPorts[i];
         auto &pOut = sb.dstPorts[j];
         if (deviceModel.isLegalTileConnection(col, row, pIn.bundle, pIn.channel,
                                               pOut.bundle, pOut.channel))
-          sb.connectivity[i][j] = Connectivity::AVAILABLE;
+          state.connectivity[sb.slot(i, j)] = Connectivity::AVAILABLE;
         else {
-          sb.connectivity[i][j] = Connectivity::INVALID;
+          state.connectivity[sb.slot(i, j)] = Connectivity::INVALID;
           if (deviceModel.isShimNOCorPLTile(col, row)) {
             // wordaround for shimMux
             auto isBundleInList = [](StrmSwPortType bundle,
@@ -218,7 +347,7 @@ void Router::initialize(const AMDAIEDeviceModel &deviceModel) {
                 StrmSwPortType::DMA, StrmSwPortType::UCTRLR};
             if (isBundleInList(pIn.bundle, bundles) ||
                 isBundleInList(pOut.bundle, bundles))
-              sb.connectivity[i][j] = Connectivity::AVAILABLE;
+              state.connectivity[sb.slot(i, j)] = Connectivity::AVAILABLE;
           }
         }
       }
@@ -233,9 +362,9 @@ void Router::initialize(const AMDAIEDeviceModel &deviceModel) {
       sb.srcPorts.push_back(Port{srcBundle, channel});
       sb.dstPorts.push_back(Port{dstBundle, channel});
     }
-    sb.resize();
+    impl->channelState.allocate(sb);
     for (size_t i = 0; i < sb.srcPorts.size(); i++) {
-      sb.connectivity[i][i] = Connectivity::AVAILABLE;
+      impl->channelState.connectivity[sb.slot(i, i)] = Connectivity::AVAILABLE;
     }
     impl->graph[std::make_pair(TileLoc{col, row},
                                TileLoc{targetCol, targetRow})] = sb;
@@ -261,6 +390,94 @@ void Router::initialize(const AMDAIEDeviceModel &deviceModel) {
       }
     }
   }
+  impl->buildRoutingGraph();
+}
+
+int RouterImpl::getOrCreateNodeId(const PhysPort &port) {
+  auto [it, inserted] = nodeIds.try_emplace(port, nodes.size());
+  if (inserted) nodes.push_back(port);
+  return it->second;
+}
+
+/// Number all ports that can be part of a route and collect the channels
+/// leaving each of them. A port's outgoing channels don't depend on its
+/// direction: they are the available connections inside its own switchbox
+/// plus the wires to the neighboring switchboxes.
+void RouterImpl::buildRoutingGraph() {
+  nodes.clear();
+  nodeIds.clear();
+  edgeOffsets.clear();
+  edges.clear();
+  for (const auto &[tileLocs, sb] : graph) {
+    if (tileLocs.first != tileLocs.second) continue;
+    for (const std::vector<Port> *ports : {&sb.srcPorts, &sb.dstPorts}) {
+      for (const Port &port : *ports) {
+        getOrCreateNodeId({tileLocs.first, port, PhysPort::Direction::SRC});
+        getOrCreateNodeId({tileLocs.first, port, PhysPort::Direction::DST});
+      }
+    }
+  }
+
+  auto getSlot = [](SwitchboxConnect &sb, const Port &srcPort,
+                    const Port &dstPort) -> std::optional<RoutingEdge> {
+    auto srcIt = std::find(sb.srcPorts.begin(), sb.srcPorts.end(), srcPort);
+    auto dstIt = std::find(sb.dstPorts.begin(), sb.dstPorts.end(), dstPort);
+    if (srcIt == sb.srcPorts.end() || dstIt == sb.dstPorts.end())
+      return std::nullopt;
+    uint32_t i = std::distance(sb.srcPorts.begin(), srcIt);
+    uint32_t j = std::distance(sb.dstPorts.begin(), dstIt);
+    return RoutingEdge{-1, -1, &sb, i, j, sb.slot(i, j)};
+  };
+
+  // Note that `nodes` may grow while iterating, as ports of neighboring
+  // switchboxes are discovered.
+  SmallVector<RoutingEdge> nodeEdges;
+  for (size_t n = 0; n < nodes.size(); n++) {
+    nodeEdges.clear();
+    PhysPort src = nodes[n];
+    // connections within the same switchbox
+    auto sbIt = graph.find(std::make_pair(src.tileLoc, src.tileLoc));
+    if (sbIt != graph.end()) {
+      SwitchboxConnect &sb = sbIt->second;
+      for (size_t i = 0; i < sb.srcPorts.size(); i++) {
+        if (sb.srcPorts[i] != src.port) continue;
+        for (size_t j = 0; j < sb.dstPorts.size(); j++) {
+          if (channelState.connectivity[sb.slot(i, j)] !=
+              Connectivity::AVAILABLE)
+            continue;
+          int dst = getOrCreateNodeId(
+              {src.tileLoc, sb.dstPorts[j], PhysPort::Direction::DST});
+          nodeEdges.push_back(RoutingEdge{static_cast<int>(n), dst, &sb,
+                                          static_cast<uint32_t>(i),
+                                          static_cast<uint32_t>(j),
+                                          sb.slot(i, j)});
+        }
+      }
+    }
+    // connections to neighboring switchboxes
+    for (const auto &[direction, deltaCoords] : directionToDeltaCoordsMap) {
+      TileLoc neighborCoords = {src.tileLoc.col + deltaCoords.first,
+                                src.tileLoc.row + deltaCoords.second};
+      Port neighborPort = {direction.second, src.port.channel};
+      auto neighborIt = graph.find(std::make_pair(src.tileLoc, neighborCoords));
+      if (neighborIt == graph.end() ||
+          src.port.bundle != getConnectingBundle(neighborPort.bundle))
+        continue;
+      std::optional<RoutingEdge> edge =
+          getSlot(neighborIt->second, src.port, neighborPort);
+      if (!edge) continue;
+      edge->src = static_cast<int>(n);
+      edge->dst = getOrCreateNodeId(
+          {neighborCoords, neighborPort, PhysPort::Direction::DST});
+      nodeEdges.push_back(*edge);
+    }
+    llvm::sort(nodeEdges, [&](const RoutingEdge &a, const RoutingEdge &b) {
+      return nodes[a.dst] < nodes[b.dst];
+    });
+    edgeOffsets.push_back(edges.size());
+    edges.insert(edges.end(), nodeEdges.begin(), nodeEdges.end());
+  }
+  edgeOffsets.push_back(edges.size());
 }
 
 void Router::addFlow(TileLoc srcCoords, Port srcPort, TileLoc dstCoords,
@@ -307,19 +524,22 @@ void Router::addFlow(TileLoc srcCoords, Port srcPort, TileLoc dstCoords,
       Flow{packetGroupId, srcPhysPort, SmallVector<PhysPort>{dstPhysPort}});
 }
 
+void Router::clearFlows() { impl->flows.clear(); }
+
 // Keep track of connections already used in the AIE; Pathfinder algorithm will
 // avoid using these.
 bool Router::addFixedCircuitConnection(
     int col, int row, const std::vector<std::tuple<Port, Port>> &connects) {
   TileLoc tileLoc = {col, row};
   auto &sb = impl->graph[std::make_pair(tileLoc, tileLoc)];
+  std::vector<Connectivity> &connectivity = impl->channelState.connectivity;
   for (auto &[sourcePort, destPort] : connects) {
     bool found = false;
     for (size_t i = 0; i < sb.srcPorts.size(); i++) {
       for (size_t j = 0; j < sb.dstPorts.size(); j++) {
         if (sb.srcPorts[i] == sourcePort && sb.dstPorts[j] == destPort &&
-            sb.connectivity[i][j] == Connectivity::AVAILABLE) {
-          sb.connectivity[i][j] = Connectivity::INVALID;
+            connectivity[sb.slot(i, j)] == Connectivity::AVAILABLE) {
+          connectivity[sb.slot(i, j)] = Connectivity::INVALID;
           found = true;
         }
       }
@@ -351,7 +571,7 @@ bool Router::addFixedPacketConnection(const PhysPort &srcPhyPort,
     return false;
   // Increment the fixed packet flow count, to indicate there is a
   // previously-routed packet stream using this channel.
-  sb.fixedPacketFlowCount[srcPortIdx][destPortIdx]++;
+  impl->channelState.fixedPacketFlowCount[sb.slot(srcPortIdx, destPortIdx)]++;
   // There are two types of `SwitchboxConnect` in `impl->graph`:
   // 1. intra-switchbox connections (`srcPhyPort.tileLoc ==
   // destPhyPort.tileLoc`), representing configurable routes within a single
@@ -400,88 +620,428 @@ bool Router::addFixedPacketConnection(const PhysPort &srcPhyPort,
   return true;
 }
 
-std::map<PhysPort, PhysPort> Router::dijkstraShortestPaths(PhysPort src) {
-  // Use std::map instead of DenseMap because DenseMap doesn't let you
-  // overwrite tombstones.
-  std::map<PhysPort, double> distance;
-  std::map<PhysPort, PhysPort> preds;
-  std::map<PhysPort, uint64_t> indexInHeap;
-  enum Color { WHITE, GRAY, BLACK };
-  std::map<PhysPort, Color> colors;
+/// Find the shortest paths from `src`, stopping once all of `targets` are
+/// settled. The paths to the settled nodes are the same as without stopping
+/// early.
+void RouterImpl::dijkstraShortestPaths(int src, ArrayRef<int> targets,
+                                       ShortestPathState &state) const {
+  const std::vector<double> &demand = channelState.demand;
+  const std::vector<Connectivity> &connectivity = channelState.connectivity;
+  std::vector<double> &distance = state.distance;
+  std::vector<ShortestPathState::Color> &colors = state.colors;
+  std::vector<int> &predEdge = state.predEdge;
+  distance.assign(nodes.size(), INF);
+  state.indexInHeap.assign(nodes.size(), static_cast<uint64_t>(-1));
+  colors.assign(nodes.size(), ShortestPathState::WHITE);
+  predEdge.assign(nodes.size(), -1);
+  state.settled.clear();
+  size_t numUnsettledTargets = targets.size();
   typedef d_ary_heap_indirect<
-      /*Value=*/PhysPort, /*Arity=*/4,
-      /*IndexInHeapPropertyMap=*/std::map<PhysPort, uint64_t>,
-      /*DistanceMap=*/std::map<PhysPort, double> &,
+      /*Value=*/int, /*Arity=*/4,
+      /*IndexInHeapPropertyMap=*/std::vector<uint64_t> &,
+      /*DistanceMap=*/std::vector<double> &,
       /*Compare=*/std::less<>>
       MutableQueue;
-  MutableQueue Q(distance, indexInHeap);
+  MutableQueue Q(distance, state.indexInHeap);
 
   distance[src] = 0.0;
   Q.push(src);
   while (!Q.empty()) {
     src = Q.top();
     Q.pop();
-
-    // get all channels src connects to
-    if (impl->channels.count(src) == 0) {
-      auto &sb = impl->graph[std::make_pair(src.tileLoc, src.tileLoc)];
-      for (size_t i = 0; i < sb.srcPorts.size(); i++) {
-        for (size_t j = 0; j < sb.dstPorts.size(); j++) {
-          if (sb.srcPorts[i] == src.port &&
-              sb.connectivity[i][j] == Connectivity::AVAILABLE) {
-            // connections within the same switchbox
-            impl->channels[src].push_back(PhysPort{src.tileLoc, sb.dstPorts[j],
-                                                   PhysPort::Direction::DST});
-          }
+    state.settled.push_back(src);
+    if (colors[src] != ShortestPathState::BLACK &&
+        llvm::is_contained(targets, src) && --numUnsettledTargets == 0)
+      break;
+
+    for (size_t e = edgeOffsets[src]; e < edgeOffsets[src + 1]; e++) {
+      const RoutingEdge &edge = edges[e];
+      // Skip channels that have been taken by fixed circuit connections.
+      if (connectivity[edge.slot] != Connectivity::AVAILABLE) continue;
+      int dest = edge.dst;
+      bool relax = distance[src] + demand[edge.slot] < distance[dest];
+      if (colors[dest] == ShortestPathState::WHITE) {
+        if (relax) {
+          distance[dest] = distance[src] + demand[edge.slot];
+          predEdge[dest] = static_cast<int>(e);
+          colors[dest] = ShortestPathState::GRAY;
         }
+        Q.push(dest);
+      } else if (colors[dest] == ShortestPathState::GRAY && relax) {
+        distance[dest] = distance[src] + demand[edge.slot];
+        predEdge[dest] = static_cast<int>(e);
       }
-      // connections to neighboring switchboxes
-      for (const auto &[direction, deltaCoords] :
-           impl->directionToDeltaCoordsMap) {
-        TileLoc neighborCoords = {src.tileLoc.col + deltaCoords.first,
-                                  src.tileLoc.row + deltaCoords.second};
-        Port neighborPort = {direction.second, src.port.channel};
-        if (impl->graph.count(std::make_pair(src.tileLoc, neighborCoords)) >
-                0 &&
-            src.port.bundle == getConnectingBundle(neighborPort.bundle)) {
-          auto &sb = impl->graph[std::make_pair(src.tileLoc, neighborCoords)];
-          if (std::find(sb.dstPorts.begin(), sb.dstPorts.end(), neighborPort) !=
-              sb.dstPorts.end())
-            impl->channels[src].push_back(
-                {neighborCoords, neighborPort, PhysPort::Direction::DST});
-        }
+    }
+    colors[src] = ShortestPathState::BLACK;
+  }
+}
+
+bool RouterImpl::routeFlow(
+    const Flow &flow, ShortestPathState &state, SwitchSettings &switchSettings,
+    llvm::function_ref<void(const RoutingEdge &)> visitChannel) const {
+  int srcId = getNodeId(flow.src);
+  if (srcId < 0) {
+    LLVM_DEBUG(llvm::dbgs() << "\t\tPathfinder: unroutable source " << flow.src
+                            << "\n");
+    return false;
+  }
+  SmallVector<int> targets;
+  for (const PhysPort &endPoint : flow.dsts) {
+    if (endPoint == flow.src) continue;
+    int dstId = getNodeId(endPoint);
+    if (dstId < 0) {
+      LLVM_DEBUG(llvm::dbgs() << "\t\tPathfinder: unroutable destination "
+                              << endPoint << "\n");
+      return false;
+    }
+    if (!llvm::is_contained(targets, dstId)) targets.push_back(dstId);
+  }
+  dijkstraShortestPaths(srcId, targets, state);
+  std::vector<bool> &processed = state.processed;
+  processed.assign(nodes.size(), false);
+  processed[srcId] = true;
+  for (const PhysPort &endPoint : flow.dsts) {
+    if (endPoint == flow.src) {
+      // route to self
+      switchSettings[flow.src.tileLoc].srcs.push_back(flow.src.port);
+      switchSettings[flow.src.tileLoc].dsts.push_back(flow.src.port);
+      continue;
+    }
+    int curr = getNodeId(endPoint);
+    // trace backwards until a vertex already processed is reached
+    while (!processed[curr]) {
+      if (state.predEdge[curr] < 0) {
+        LLVM_DEBUG(llvm::dbgs() << "\t\tPathfinder: no path from " << flow.src
+                                << " to " << endPoint << "\n");
+        return false;
+      }
+      const RoutingEdge &edge = edges[state.predEdge[curr]];
+      visitChannel(edge);
+      const SwitchboxConnect &sb = *edge.sb;
+      if (sb.srcCoords == sb.dstCoords) {
+        switchSettings[sb.srcCoords].srcs.push_back(sb.srcPorts[edge.i]);
+        switchSettings[sb.dstCoords].dsts.push_back(sb.dstPorts[edge.j]);
       }
-      std::sort(impl->channels[src].begin(), impl->channels[src].end());
+      processed[curr] = true;
+      curr = edge.src;
     }
+  }
+  return true;
+}
 
-    for (auto &dest : impl->channels[src]) {
-      if (distance.count(dest) == 0) distance[dest] = INF;
-      auto &sb = impl->graph[std::make_pair(src.tileLoc, dest.tileLoc)];
-      size_t i = std::distance(
-          sb.srcPorts.begin(),
-          std::find(sb.srcPorts.begin(), sb.srcPorts.end(), src.port));
-      size_t j = std::distance(
-          sb.dstPorts.begin(),
-          std::find(sb.dstPorts.begin(), sb.dstPorts.end(), dest.port));
-      assert(i < sb.srcPorts.size());
-      assert(j < sb.dstPorts.size());
-      bool relax = distance[src] + sb.demand[i][j] < distance[dest];
-      if (colors.count(dest) == 0) {
-        // was WHITE
-        if (relax) {
-          distance[dest] = distance[src] + sb.demand[i][j];
-          preds[dest] = src;
-          colors[dest] = GRAY;
-        }
-        Q.push(dest);
-      } else if (colors[dest] == GRAY && relax) {
-        distance[dest] = distance[src] + sb.demand[i][j];
-        preds[dest] = src;
+/// Split `flows` into batches of up to `MAX_BATCH_SIZE` consecutive flows.
+std::vector<SmallVector<size_t>> RouterImpl::formBatches(
+    ArrayRef<Flow> flows) const {
+  std::vector<SmallVector<size_t>> batches;
+  for (size_t k = 0; k < flows.size(); k++) {
+    if (k % MAX_BATCH_SIZE == 0) batches.emplace_back();
+    batches.back().push_back(k);
+  }
+  return batches;
+}
+
+/// Route `flows` in the batches formed by `formBatches`. The searches of a
+/// batch only read the router state and run concurrently on
+/// `options.threadPool`. Their routes are then committed in order of the
+/// flows, like `findPaths` routes them one by one. The search of a flow only
+/// depends on the demand of the channels leaving the nodes it settled, so its
+/// route is recomputed if an earlier flow of the batch changed the demand of
+/// one of them. This makes the result the same as without batches.
+bool RouterImpl::routeFlowsInBatches(
+    ArrayRef<Flow> flows,
+    llvm::function_ref<void(const Flow &, const RoutingEdge &)> visitChannel,
+    std::map<PhysPort, SwitchSettings> &routingSolution) {
+  struct PendingRoute {
+    bool routed = false;
+    SwitchSettings switchSettings;
+    SmallVector<const RoutingEdge *> channels;
+    std::vector<int> settled;
+  };
+  auto routePending = [&](const Flow &flow, ShortestPathState &state,
+                          PendingRoute &route) {
+    route.routed = routeFlow(
+        flow, state, route.switchSettings,
+        [&](const RoutingEdge &edge) { route.channels.push_back(&edge); });
+    route.settled = state.settled;
+  };
+  // The nodes with a channel whose demand changed in the current batch. The
+  // node of a port in either direction has the same channels.
+  std::vector<bool> changedNodes(nodes.size(), false);
+  SmallVector<int> changedNodeList;
+  auto markChanged = [&](int node) {
+    if (node < 0 || changedNodes[node]) return;
+    changedNodes[node] = true;
+    changedNodeList.push_back(node);
+  };
+  for (const SmallVector<size_t> &batch : formBatches(flows)) {
+    std::vector<PendingRoute> routes(batch.size());
+    size_t numChunks = std::min(pathStates.size(), batch.size());
+    if (numChunks <= 1) {
+      for (size_t k = 0; k < batch.size(); k++)
+        routePending(flows[batch[k]], pathStates.front(), routes[k]);
+    } else {
+      llvm::ThreadPoolTaskGroup taskGroup(*options.threadPool);
+      for (size_t c = 0; c < numChunks; c++) {
+        taskGroup.async([&, c]() {
+          for (size_t k = c * batch.size() / numChunks;
+               k < (c + 1) * batch.size() / numChunks; k++) {
+            routePending(flows[batch[k]], pathStates[c], routes[k]);
+          }
+        });
+      }
+      taskGroup.wait();
+    }
+    for (auto [flowIndex, route] : llvm::zip_equal(batch, routes)) {
+      const Flow &flow = flows[flowIndex];
+      if (llvm::any_of(route.settled,
+                       [&](int node) { return changedNodes[node]; })) {
+        route = PendingRoute();
+        routePending(flow, pathStates.front(), route);
       }
+      if (!route.routed) return false;
+      for (const RoutingEdge *edge : route.channels) {
+        double demand = channelState.demand[edge->slot];
+        visitChannel(flow, *edge);
+        if (channelState.demand[edge->slot] == demand) continue;
+        PhysPort port = nodes[edge->src];
+        markChanged(edge->src);
+        port.direction = port.direction == PhysPort::Direction::SRC
+                             ? PhysPort::Direction::DST
+                             : PhysPort::Direction::SRC;
+        markChanged(getNodeId(port));
+      }
+      routingSolution[flow.src] = std::move(route.switchSettings);
+    }
+    for (int node : changedNodeList) changedNodes[node] = false;
+    changedNodeList.clear();
+  }
+  return true;
+}
+
+/// The number of streams using channel `slot` in incremental mode. Circuit
+/// nets use a channel exclusively. Like in `findPaths`, where the first packet
+/// group routed through a port claims every channel from or to that port, the
+/// packet group with the lowest id using the input or the output port of the
+/// channel shares it among its flows, up to `MAX_PACKET_STREAM_CAPACITY` flows
+/// per stream, while every flow of any other packet group uses a stream of its
+/// own. Previously-routed packet flows occupy one stream that can be shared
+/// with packet flows.
+int RouterImpl::computeOccupancy(size_t slot) const {
+  int ownerGroupId = -1;
+  if (slotEdges[slot] >= 0) {
+    const RoutingEdge &edge = edges[slotEdges[slot]];
+    for (const auto &[packetGroupId, _] :
+         llvm::concat<const std::pair<int, int>>(
+             srcPortGroups[edge.sb->slot(edge.i, 0)],
+             dstPortGroups[edge.sb->slot(0, edge.j)])) {
+      if (ownerGroupId < 0 || packetGroupId < ownerGroupId)
+        ownerGroupId = packetGroupId;
+    }
+  }
+  int circuitStreams = 0, packetStreams = 0;
+  for (const auto &[netIndex, numFlows] : slotNets[slot]) {
+    int packetGroupId = nets[netIndex].packetGroupId;
+    if (packetGroupId >= 0 && packetGroupId == ownerGroupId) {
+      packetStreams += static_cast<int>(
+          llvm::divideCeil(numFlows, MAX_PACKET_STREAM_CAPACITY));
+    } else {
+      circuitStreams += numFlows;
     }
-    colors[src] = BLACK;
   }
+  if (channelState.fixedPacketFlowCount[slot] > 0)
+    packetStreams = std::max(packetStreams, 1);
+  return circuitStreams + packetStreams;
+}
 
+void RouterImpl::updateChannel(size_t slot) {
+  ChannelState &state = channelState;
+  state.usedCapacity[slot] = computeOccupancy(slot);
+  if (state.usedCapacity[slot] > MAX_CIRCUIT_STREAM_CAPACITY)
+    overCapacitySlots.insert(slot);
+  else
+    overCapacitySlots.erase(slot);
+  double history =
+      DEMAND_BASE + OVER_CAPACITY_COEFF * state.overCapacity[slot];
+  double congestion =
+      DEMAND_BASE + USED_CAPACITY_COEFF * state.usedCapacity[slot];
+  state.demand[slot] = history * congestion;
+  state.bumpDemand(slot);
+}
+
+/// Add (`delta` is 1) or remove (`delta` is -1) the claims of packet net `net`
+/// on the ports of the channels it uses, then update every channel of `net`
+/// and every used channel sharing a port with one of them.
+void RouterImpl::updateNetChannels(const RoutedNet &net, int delta) {
+  auto updatePortGroups = [&](SmallVector<std::pair<int, int>, 1> &groups) {
+    auto it = llvm::find_if(groups, [&](const std::pair<int, int> &group) {
+      return group.first == net.packetGroupId;
+    });
+    if (it == groups.end()) {
+      groups.emplace_back(net.packetGroupId, delta);
+    } else if ((it->second += delta) == 0) {
+      groups.erase(it);
+    }
+  };
+  std::set<size_t> slotsToUpdate;
+  for (const auto &[slot, _] : net.slotFlowCounts) {
+    slotsToUpdate.insert(slot);
+    if (net.packetGroupId < 0) continue;
+    const RoutingEdge &edge = edges[slotEdges[slot]];
+    const SwitchboxConnect &sb = *edge.sb;
+    updatePortGroups(srcPortGroups[sb.slot(edge.i, 0)]);
+    updatePortGroups(dstPortGroups[sb.slot(0, edge.j)]);
+    for (size_t l = 0; l < sb.dstPorts.size(); l++) {
+      if (!slotNets[sb.slot(edge.i, l)].empty())
+        slotsToUpdate.insert(sb.slot(edge.i, l));
+    }
+    for (size_t k = 0; k < sb.srcPorts.size(); k++) {
+      if (!slotNets[sb.slot(k, edge.j)].empty())
+        slotsToUpdate.insert(sb.slot(k, edge.j));
+    }
+  }
+  for (size_t slot : slotsToUpdate) updateChannel(slot);
+}
+
+void RouterImpl::ripUpNet(size_t netIndex) {
+  RoutedNet &net = nets[netIndex];
+  for (const auto &[slot, _] : net.slotFlowCounts) {
+    llvm::erase_if(slotNets[slot], [&](const std::pair<size_t, int> &user) {
+      return user.first == netIndex;
+    });
+  }
+  updateNetChannels(net, -1);
+  net.slotFlowCounts.clear();
+  for (SwitchSettings &switchSettings : net.switchSettings)
+    switchSettings.clear();
+}
+
+bool RouterImpl::routeNet(size_t netIndex, ShortestPathState &state) {
+  RoutedNet &net = nets[netIndex];
+  // Demand is only updated once the whole net is routed, so that the flows of
+  // a packet group aren't discouraged from sharing channels with each other.
+  DenseMap<size_t, int> slotFlowCounts;
+  for (auto [flowIndex, switchSettings] :
+       llvm::zip_equal(net.flowIndices, net.switchSettings)) {
+    auto visitChannel = [&](const RoutingEdge &edge) {
+      slotFlowCounts[edge.slot]++;
+    };
+    if (!routeFlow(flows[flowIndex], state, switchSettings, visitChannel))
+      return false;
+  }
+  for (const auto &[slot, numFlows] : slotFlowCounts)
+    net.slotFlowCounts.emplace_back(slot, numFlows);
+  llvm::sort(net.slotFlowCounts);
+  for (const auto &[slot, numFlows] : net.slotFlowCounts)
+    slotNets[slot].emplace_back(netIndex, numFlows);
+  updateNetChannels(net, 1);
+  return true;
+}
+
+// Negotiated-congestion routing: the first iteration routes all nets, every
+// later iteration only rips up and reroutes the nets that use a channel which
+// is over capacity, using the history of over-capacity channels to steer them
+// away from each other. The work per iteration therefore scales with the
+// amount of congestion rather than with the total number of flows.
+std::optional<std::map<PhysPort, SwitchSettings>>
+RouterImpl::findPathsIncremental(const int maxIterations) {
+  LLVM_DEBUG(llvm::dbgs()
+             << "\t---Begin Pathfinder::findPathsIncremental---\n");
+  ChannelState &state = channelState;
+  std::fill(state.usedCapacity.begin(), state.usedCapacity.end(), 0);
+  std::fill(state.overCapacity.begin(), state.overCapacity.end(), 0);
+  state.updateDemand();
+  overCapacitySlots.clear();
+  slotNets.assign(state.size(), {});
+  srcPortGroups.assign(state.size(), {});
+  dstPortGroups.assign(state.size(), {});
+  slotEdges.assign(state.size(), -1);
+  for (size_t e = 0; e < edges.size(); e++)
+    slotEdges[edges[e].slot] = static_cast<int>(e);
+
+  // Every circuit flow is a net of its own, the flows of a packet group form
+  // a single net. Nets are ordered like the flows in `findPaths`: circuit
+  // flows first, then packet groups in order of their ids.
+  nets.clear();
+  std::map<int, size_t> packetGroupToNet;
+  std::vector<size_t> flowOrder(flows.size());
+  std::iota(flowOrder.begin(), flowOrder.end(), 0);
+  llvm::stable_sort(flowOrder, [&](size_t a, size_t b) {
+    return flows[a].packetGroupId < flows[b].packetGroupId;
+  });
+  for (size_t flowIndex : flowOrder) {
+    int packetGroupId = flows[flowIndex].packetGroupId;
+    size_t netIndex = nets.size();
+    if (packetGroupId >= 0) {
+      netIndex =
+          packetGroupToNet.try_emplace(packetGroupId, netIndex).first->second;
+    }
+    if (netIndex == nets.size()) nets.push_back({packetGroupId, {}, {}, {}});
+    nets[netIndex].flowIndices.push_back(flowIndex);
+    nets[netIndex].switchSettings.emplace_back();
+  }
+
+  ShortestPathState &pathState = pathStates.front();
+  std::vector<size_t> netsToRoute(nets.size());
+  std::iota(netsToRoute.begin(), netsToRoute.end(), 0);
+  int iterationCount = -1;
+  while (!netsToRoute.empty()) {
+    if (++iterationCount >= maxIterations) {
+      LLVM_DEBUG(llvm::dbgs()
+                 << "\t\tPathfinder: maxIterations has been exceeded ("
+                 << maxIterations
+                 << " iterations)...unable to find routing for flows.\n");
+      return std::nullopt;
+    }
+    LLVM_DEBUG(llvm::dbgs() << "\t\t---Begin findPathsIncremental iteration #"
+                            << iterationCount << ", rerouting "
+                            << netsToRoute.size() << " of " << nets.size()
+                            << " nets---\n");
+
+    // "rip up" the conflicting nets first, so that all of them see the same
+    // congestion when they are rerouted
+    for (size_t netIndex : netsToRoute) ripUpNet(netIndex);
+    for (size_t netIndex : netsToRoute) {
+      if (!routeNet(netIndex, pathState)) return std::nullopt;
+    }
+
+    // Bump the history of all channels that are still over capacity and
+    // reroute all nets using them in the next iteration.
+    std::set<size_t> conflictingNets;
+    for (size_t slot : overCapacitySlots) {
+      state.overCapacity[slot]++;
+      for (const auto &[netIndex, _] : slotNets[slot])
+        conflictingNets.insert(netIndex);
+    }
+    for (size_t slot : overCapacitySlots) updateChannel(slot);
+    LLVM_DEBUG(llvm::dbgs()
+               << "\t\t---End findPathsIncremental iteration #"
+               << iterationCount
+               << ", illegal edges count = " << overCapacitySlots.size()
+               << "---\n");
+    netsToRoute.assign(conflictingNets.begin(), conflictingNets.end());
+  }
+
+  std::map<PhysPort, SwitchSettings> routingSolution;
+  for (const RoutedNet &net : nets) {
+    for (auto [flowIndex, switchSettings] :
+         llvm::zip_equal(net.flowIndices, net.switchSettings)) {
+      routingSolution[flows[flowIndex].src] = switchSettings;
+    }
+  }
+  LLVM_DEBUG(llvm::dbgs() << "\t---End Pathfinder::findPathsIncremental---\n");
+  return routingSolution;
+}
+
+std::map<PhysPort, PhysPort> Router::dijkstraShortestPaths(PhysPort src) {
+  std::map<PhysPort, PhysPort> preds;
+  int srcId = impl->getNodeId(src);
+  if (srcId < 0) return preds;
+  ShortestPathState state;
+  impl->dijkstraShortestPaths(srcId, /*targets=*/{}, state);
+  for (size_t n = 0; n < impl->nodes.size(); n++) {
+    if (state.predEdge[n] < 0) continue;
+    preds[impl->nodes[n]] = impl->nodes[impl->edges[state.predEdge[n]].src];
+  }
   return preds;
 }
 
@@ -493,17 +1053,14 @@ std::map<PhysPort, PhysPort> Router::dijkstraShortestPaths(PhysPort src) {
 // found after maxIterations, returns empty vector.
 std::optional<std::map<PhysPort, SwitchSettings>> Router::findPaths(
     const int maxIterations) {
+  if (impl->options.incremental)
+    return impl->findPathsIncremental(maxIterations);
   LLVM_DEBUG(llvm::dbgs() << "\t---Begin Pathfinder::findPaths---\n");
   std::map<PhysPort, SwitchSettings> routingSolution;
+  ChannelState &state = impl->channelState;
   // initialize all Channel histories to 0
-  for (auto &[_, sb] : impl->graph) {
-    for (size_t i = 0; i < sb.srcPorts.size(); i++) {
-      for (size_t j = 0; j < sb.dstPorts.size(); j++) {
-        sb.usedCapacity[i][j] = 0;
-        sb.overCapacity[i][j] = 0;
-      }
-    }
-  }
+  std::fill(state.usedCapacity.begin(), state.usedCapacity.end(), 0);
+  std::fill(state.overCapacity.begin(), state.overCapacity.end(), 0);
 
   // group flows based on packetGroupId
   std::map<int, std::vector<Flow>> groupedFlows;
@@ -511,6 +1068,32 @@ std::optional<std::map<PhysPort, SwitchSettings>> Router::findPaths(
     groupedFlows[f.packetGroupId].push_back(f);
   }
 
+  // Account for the use of channel `edge` by `flow`.
+  auto visitChannel = [&](const Flow &flow, const RoutingEdge &edge) {
+    int packetGroupId = flow.packetGroupId;
+    const SwitchboxConnect &sb = *edge.sb;
+    size_t slot = edge.slot;
+    if (packetGroupId >= 0 && (state.packetGroupId[slot] == -1 ||
+                               state.packetGroupId[slot] == packetGroupId)) {
+      for (size_t k = 0; k < sb.srcPorts.size(); k++)
+        state.packetGroupId[sb.slot(k, edge.j)] = packetGroupId;
+      for (size_t l = 0; l < sb.dstPorts.size(); l++)
+        state.packetGroupId[sb.slot(edge.i, l)] = packetGroupId;
+      state.packetFlowCount[slot]++;
+      // maximum packet stream sharing per channel
+      if (state.packetFlowCount[slot] >= MAX_PACKET_STREAM_CAPACITY) {
+        state.packetFlowCount[slot] = 0;
+        state.usedCapacity[slot]++;
+      }
+    } else {
+      state.usedCapacity[slot]++;
+    }
+    // if at capacity, bump demand to discourage using this Channel
+    // this means the order matters!
+    state.bumpDemand(slot);
+  };
+
+  ShortestPathState &pathState = impl->pathStates.front();
   int iterationCount = -1;
   int illegalEdges = 0;
   [[maybe_unused]] int totalPathLength = 0;
@@ -527,127 +1110,69 @@ std::optional<std::map<PhysPort, SwitchSettings>> Router::findPaths(
     LLVM_DEBUG(llvm::dbgs() << "\t\t---Begin findPaths iteration #"
                             << iterationCount << "---\n");
     // update demand at the beginning of each iteration
-    for (auto &[_, sb] : impl->graph) {
-      sb.updateDemand();
-    }
+    state.updateDemand();
 
     // "rip up" all routes
     illegalEdges = 0;
     totalPathLength = 0;
     routingSolution.clear();
-    for (auto &[_, sb] : impl->graph) {
-      for (size_t i = 0; i < sb.srcPorts.size(); i++) {
-        for (size_t j = 0; j < sb.dstPorts.size(); j++) {
-          sb.usedCapacity[i][j] = 0;
-          // If there is no previously-routed packet flow,
-          // `fixedPacketFlowCount` will be just 0.
-          sb.packetFlowCount[i][j] = sb.fixedPacketFlowCount[i][j];
-          sb.packetGroupId[i][j] = -1;
-        }
-      }
-    }
+    std::fill(state.usedCapacity.begin(), state.usedCapacity.end(), 0);
+    // If there is no previously-routed packet flow, `fixedPacketFlowCount`
+    // will be just 0.
+    state.packetFlowCount = state.fixedPacketFlowCount;
+    std::fill(state.packetGroupId.begin(), state.packetGroupId.end(), -1);
 
     for (const auto &[_, flows] : groupedFlows) {
-      for (const auto &[packetGroupId, src, dsts] : flows) {
-        // Use dijkstra to find path given current demand from the start
-        // switchbox; find the shortest paths to each other switchbox. Output is
-        // in the predecessor map, which must then be processed to get
-        // individual switchbox settings
-        DenseSet<PhysPort> processed;
-        std::map<PhysPort, PhysPort> preds = dijkstraShortestPaths(src);
-
-        // trace the path of the flow backwards via predecessors
-        // increment used_capacity for the associated channels
-        SwitchSettings switchSettings;
-        processed.insert(src);
-        for (auto endPoint : dsts) {
-          if (endPoint == src) {
-            // route to self
-            switchSettings[src.tileLoc].srcs.push_back(src.port);
-            switchSettings[src.tileLoc].dsts.push_back(src.port);
-          }
-          auto curr = endPoint;
-          // trace backwards until a vertex already processed is reached
-          while (!processed.count(curr)) {
-            auto &sb =
-                impl->graph[std::make_pair(preds[curr].tileLoc, curr.tileLoc)];
-            size_t i =
-                std::distance(sb.srcPorts.begin(),
-                              std::find(sb.srcPorts.begin(), sb.srcPorts.end(),
-                                        preds[curr].port));
-            size_t j = std::distance(
-                sb.dstPorts.begin(),
-                std::find(sb.dstPorts.begin(), sb.dstPorts.end(), curr.port));
-            assert(i < sb.srcPorts.size());
-            assert(j < sb.dstPorts.size());
-            if (packetGroupId >= 0 &&
-                (sb.packetGroupId[i][j] == -1 ||
-                 sb.packetGroupId[i][j] == packetGroupId)) {
-              for (size_t k = 0; k < sb.srcPorts.size(); k++) {
-                for (size_t l = 0; l < sb.dstPorts.size(); l++) {
-                  if (k == i || l == j) {
-                    sb.packetGroupId[k][l] = packetGroupId;
-                  }
-                }
-              }
-              sb.packetFlowCount[i][j]++;
-              // maximum packet stream sharing per channel
-              if (sb.packetFlowCount[i][j] >= MAX_PACKET_STREAM_CAPACITY) {
-                sb.packetFlowCount[i][j] = 0;
-                sb.usedCapacity[i][j]++;
-              }
-            } else {
-              sb.usedCapacity[i][j]++;
-            }
-            // if at capacity, bump demand to discourage using this Channel
-            // this means the order matters!
-            sb.bumpDemand(i, j);
-            if (preds[curr].tileLoc == curr.tileLoc) {
-              switchSettings[preds[curr].tileLoc].srcs.push_back(
-                  preds[curr].port);
-              switchSettings[curr.tileLoc].dsts.push_back(curr.port);
-            }
-            processed.insert(curr);
-            curr = preds[curr];
-          }
+      if (impl->options.batched) {
+        if (!impl->routeFlowsInBatches(flows, visitChannel, routingSolution))
+          return std::nullopt;
+      } else {
+        for (const Flow &flow : flows) {
+          // Use dijkstra to find path given current demand from the start
+          // switchbox; find the shortest paths to each other switchbox. Then
+          // trace the path of the flow backwards via predecessors and
+          // increment used_capacity for the associated channels
+          SwitchSettings switchSettings;
+          if (!impl->routeFlow(flow, pathState, switchSettings,
+                               [&](const RoutingEdge &edge) {
+                                 visitChannel(flow, edge);
+                               }))
+            return std::nullopt;
+          // add this flow to the proposed solution
+          routingSolution[flow.src] = switchSettings;
         }
-        // add this flow to the proposed solution
-        routingSolution[src] = switchSettings;
       }
-      for (auto &[_, sb] : impl->graph) {
-        for (size_t i = 0; i < sb.srcPorts.size(); i++) {
-          for (size_t j = 0; j < sb.dstPorts.size(); j++) {
-            // fix used capacity for packet flows
-            if (sb.packetFlowCount[i][j] > 0) {
-              sb.packetFlowCount[i][j] = 0;
-              sb.usedCapacity[i][j]++;
-            }
-            sb.bumpDemand(i, j);
-          }
+      for (size_t s = 0; s < state.size(); s++) {
+        // fix used capacity for packet flows
+        if (state.packetFlowCount[s] > 0) {
+          state.packetFlowCount[s] = 0;
+          state.usedCapacity[s]++;
         }
+        state.bumpDemand(s);
       }
     }
 
     for (auto &[_, sb] : impl->graph) {
       for (size_t i = 0; i < sb.srcPorts.size(); i++) {
         for (size_t j = 0; j < sb.dstPorts.size(); j++) {
+          size_t s = sb.slot(i, j);
           // check that every channel does not exceed max capacity
-          if (sb.usedCapacity[i][j] > MAX_CIRCUIT_STREAM_CAPACITY) {
-            sb.overCapacity[i][j]++;
+          if (state.usedCapacity[s] > MAX_CIRCUIT_STREAM_CAPACITY) {
+            state.overCapacity[s]++;
             illegalEdges++;
             LLVM_DEBUG(llvm::dbgs()
                        << "\t\t\tToo much capacity on (" << sb.srcCoords.col
                        << "," << sb.srcCoords.row << ") " << sb.srcPorts[i]
                        << " -> (" << sb.dstCoords.col << "," << sb.dstCoords.row
                        << ") " << sb.dstPorts[j]
-                       << ", used_capacity = " << sb.usedCapacity[i][j]
-                       << ", demand = " << sb.demand[i][j]
-                       << ", over_capacity_count = " << sb.overCapacity[i][j]
+                       << ", used_capacity = " << state.usedCapacity[s]
+                       << ", demand = " << state.demand[s]
+                       << ", over_capacity_count = " << state.overCapacity[s]
                        << "\n");
           }
           // calculate total path length (across switchboxes)
           if (sb.srcCoords != sb.dstCoords) {
-            totalPathLength += sb.usedCapacity[i][j];
+            totalPathLength += state.usedCapacity[s];
           }
         }
       }
@@ -16,6 +16,10 @@
 #include "llvm/ADT/DenseMapInfo.h"
 #include "llvm/ADT/SetVector.h"
 
+namespace llvm {
+class ThreadPoolInterface;
+}  // namespace llvm
+
 namespace mlir::iree_compiler::AMDAIE {
 struct Port {
   StrmSwPortType bundle;
@@ -125,14 +129,38 @@ bool existsPathToDest(const SwitchSettings &settings, TileLoc currTile,
                       TileLoc finalTile, StrmSwPortType finalDestBundle,
                       int finalDestChannel);
 
+/// Options controlling how `Router::findPaths` negotiates congestion.
+struct RouterOptions {
+  /// If set, only the flows that use an over-capacity channel are ripped up
+  /// and rerouted in each iteration (PathFinder-style negotiated congestion);
+  /// all other flows keep their routes. A circuit flow is ripped up on its
+  /// own, a packet flow together with all flows of its packet group. If not
+  /// set, every iteration reroutes all flows from scratch.
+  bool incremental = false;
+  /// If set, `findPaths` routes the flows of each packet group (and all
+  /// circuit flows) in batches of consecutive flows. The shortest-path
+  /// searches of a batch run concurrently on `threadPool` and are redone for
+  /// the flows whose search read a channel that an earlier flow of the batch
+  /// changed, so the routes are the same as without batches. Ignored in
+  /// incremental mode.
+  bool batched = false;
+  /// The threads running the searches of a batch, e.g. the thread pool of the
+  /// MLIRContext. If null, they run on the calling thread. Only used if
+  /// `batched` is set.
+  llvm::ThreadPoolInterface *threadPool = nullptr;
+};
+
 struct RouterImpl;
 struct Router {
   RouterImpl *impl;
-  Router(int maxCol, int maxRow);
+  Router(int maxCol, int maxRow, RouterOptions options = {});
   ~Router();
   void initialize(const AMDAIEDeviceModel &targetModel);
   void addFlow(TileLoc srcCoords, Port srcPort, TileLoc dstCoords, Port dstPort,
                bool isPacketFlow);
+  /// Removes all flows, keeping the routing graph and the fixed connections,
+  /// so that the router can be reused to route another set of flows.
+  void clearFlows();
   bool addFixedCircuitConnection(
       int col, int row, const std::vector<std::tuple<Port, Port>> &connects);
   bool addFixedPacketConnection(const PhysPort &srcPhyPort,
@@ -7,7 +7,10 @@
 #include "iree_aie_runtime.h"
 
 #include <cstdint>
+#include <cstring>
+#include <map>
 #include <numeric>
+#include <variant>
 
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/FormatVariadic.h"
@@ -318,6 +321,201 @@ void setOddParityBit(uint32_t &word) {
   word = (parity << 31) | lower31Bits;
 }
 
+namespace {
+
+/// Bits of a register written by a plain or block write.
+constexpr uint32_t kFullMask = 0xFFFFFFFF;
+
+/// A register write of a transaction. `mask` holds the bits that are written.
+struct TxnRegisterWrite {
+  uint64_t address;
+  uint32_t value;
+  uint32_t mask;
+  XAie_OpHdr opHdr;
+};
+
+/// An operation of a transaction that isn't a write, copied as is.
+struct TxnOtherOp {
+  const uint8_t *ptr;
+  uint32_t size;
+};
+
+using TxnItem = std::variant<TxnRegisterWrite, TxnOtherOp>;
+
+/// Zero-initializes an operation header, including its padding, so the
+/// compacted transaction is deterministic.
+template <typename T>
+T makeTxnHeader() {
+  T header;
+  memset(&header, 0, sizeof(T));
+  return header;
+}
+
+template <typename T>
+void appendToTxn(std::vector<uint8_t> &txn, const T &t) {
+  const auto *bytes = reinterpret_cast<const uint8_t *>(&t);
+  txn.insert(txn.end(), bytes, bytes + sizeof(T));
+}
+
+}  // namespace
+
+FailureOr<std::vector<uint32_t>> compactTransaction(
+    const AMDAIEDeviceModel &deviceModel, const uint8_t *txn) {
+  const auto *txnHeader = reinterpret_cast<const XAie_TxnHeader *>(txn);
+  const uint8_t *ptr = txn + sizeof(XAie_TxnHeader);
+
+  // Decode the transaction into single register writes and other operations.
+  std::vector<TxnItem> items;
+  for (uint32_t i = 0; i < txnHeader->NumOps; ++i) {
+    const auto *opHdr = reinterpret_cast<const XAie_OpHdr *>(ptr);
+    auto opCode = static_cast<XAie_TxnOpcode>(opHdr->Op);
+    switch (opCode) {
+      case XAie_TxnOpcode::XAIE_IO_WRITE: {
+        const auto *hdr = reinterpret_cast<const XAie_Write32Hdr *>(ptr);
+        items.push_back(
+            TxnRegisterWrite{hdr->RegOff, hdr->Value, kFullMask, *opHdr});
+        ptr += hdr->Size;
+        break;
+      }
+      case XAie_TxnOpcode::XAIE_IO_BLOCKWRITE: {
+        const auto *hdr = reinterpret_cast<const XAie_BlockWrite32Hdr *>(ptr);
+        const auto *payload = reinterpret_cast<const uint32_t *>(
+            ptr + sizeof(XAie_BlockWrite32Hdr));
+        uint32_t length =
+            (hdr->Size - sizeof(XAie_BlockWrite32Hdr)) / sizeof(uint32_t);
+        for (uint32_t j = 0; j < length; ++j) {
+          items.push_back(TxnRegisterWrite{hdr->RegOff + j * sizeof(uint32_t),
+                                           payload[j], kFullMask, *opHdr});
+        }
+        ptr += hdr->Size;
+        break;
+      }
+      case XAie_TxnOpcode::XAIE_IO_MASKWRITE: {
+        const auto *hdr = reinterpret_cast<const XAie_MaskWrite32Hdr *>(ptr);
+        items.push_back(
+            TxnRegisterWrite{hdr->RegOff, hdr->Value, hdr->Mask, *opHdr});
+        ptr += hdr->Size;
+        break;
+      }
+      case XAie_TxnOpcode::XAIE_IO_MASKPOLL: {
+        const auto *hdr = reinterpret_cast<const XAie_MaskPoll32Hdr *>(ptr);
+        items.push_back(TxnOtherOp{ptr, hdr->Size});
+        ptr += hdr->Size;
+        break;
+      }
+      default: {
+        if (opCode < XAie_TxnOpcode::XAIE_IO_CUSTOM_OP_BEGIN ||
+            opCode >= XAie_TxnOpcode::XAIE_IO_CUSTOM_OP_MAX) {
+          llvm::errs() << "unsupported opcode in transaction: "
+                       << static_cast<uint32_t>(opHdr->Op) << "\n";
+          return failure();
+        }
+        const auto *hdr = reinterpret_cast<const XAie_CustomOpHdr *>(ptr);
+        items.push_back(TxnOtherOp{ptr, hdr->Size});
+        ptr += hdr->Size;
+        break;
+      }
+    }
+  }
+
+  // Within a run of writes to configuration only addresses, only the value
+  // every address holds at the end of the run is observable. Keep a single
+  // write per address, holding the bits written by all of them, and order the
+  // writes by address so consecutive addresses end up next to each other.
+  auto isFoldable = [&](const TxnItem &item) {
+    const auto *write = std::get_if<TxnRegisterWrite>(&item);
+    return write && deviceModel.isConfigurationOnlyAddress(write->address);
+  };
+  std::vector<TxnItem> foldedItems;
+  foldedItems.reserve(items.size());
+  for (size_t begin = 0; begin < items.size();) {
+    if (!isFoldable(items[begin])) {
+      foldedItems.push_back(items[begin++]);
+      continue;
+    }
+    size_t end = begin;
+    while (end < items.size() && isFoldable(items[end])) ++end;
+    std::map<uint64_t, TxnRegisterWrite> foldedWrites;
+    for (size_t i = begin; i < end; ++i) {
+      const auto &write = std::get<TxnRegisterWrite>(items[i]);
+      auto [it, inserted] = foldedWrites.try_emplace(write.address, write);
+      if (inserted) continue;
+      TxnRegisterWrite &folded = it->second;
+      folded.value = (folded.value & ~write.mask) | (write.value & write.mask);
+      folded.mask |= write.mask;
+    }
+    for (const auto &[address, write] : foldedWrites)
+      foldedItems.push_back(write);
+    begin = end;
+  }
+
+  // Emit the compacted transaction, coalescing the plain writes to
+  // consecutive addresses into block writes.
+  XAie_TxnHeader header = *txnHeader;
+  header.NumOps = 0;
+  std::vector<uint8_t> compacted;
+  appendToTxn(compacted, header);
+  SmallVector<TxnRegisterWrite> block;
+  auto flushBlock = [&]() {
+    if (block.empty()) return;
+    const TxnRegisterWrite &first = block.front();
+    if (block.size() == 1) {
+      auto hdr = makeTxnHeader<XAie_Write32Hdr>();
+      hdr.OpHdr = first.opHdr;
+      hdr.OpHdr.Op = static_cast<uint8_t>(XAie_TxnOpcode::XAIE_IO_WRITE);
+      hdr.RegOff = first.address;
+      hdr.Value = first.value;
+      hdr.Size = sizeof(XAie_Write32Hdr);
+      appendToTxn(compacted, hdr);
+    } else {
+      auto hdr = makeTxnHeader<XAie_BlockWrite32Hdr>();
+      hdr.OpHdr = first.opHdr;
+      hdr.OpHdr.Op = static_cast<uint8_t>(XAie_TxnOpcode::XAIE_IO_BLOCKWRITE);
+      hdr.RegOff = first.address;
+      hdr.Size = sizeof(XAie_BlockWrite32Hdr) + block.size() * sizeof(uint32_t);
+      appendToTxn(compacted, hdr);
+      for (const TxnRegisterWrite &write : block)
+        appendToTxn(compacted, write.value);
+    }
+    ++header.NumOps;
+    block.clear();
+  };
+  for (const TxnItem &item : foldedItems) {
+    if (const auto *write = std::get_if<TxnRegisterWrite>(&item)) {
+      if (write->mask == kFullMask) {
+        if (!block.empty() &&
+            write->address != block.back().address + sizeof(uint32_t)) {
+          flushBlock();
+        }
+        block.push_back(*write);
+        continue;
+      }
+      flushBlock();
+      auto hdr = makeTxnHeader<XAie_MaskWrite32Hdr>();
+      hdr.OpHdr = write->opHdr;
+      hdr.OpHdr.Op = static_cast<uint8_t>(XAie_TxnOpcode::XAIE_IO_MASKWRITE);
+      hdr.RegOff = write->address;
+      hdr.Value = write->value & write->mask;
+      hdr.Mask = write->mask;
+      hdr.Size = sizeof(XAie_MaskWrite32Hdr);
+      appendToTxn(compacted, hdr);
+      ++header.NumOps;
+      continue;
+    }
+    flushBlock();
+    const auto &op = std::get<TxnOtherOp>(item);
+    compacted.insert(compacted.end(), op.ptr, op.ptr + op.size);
+    ++header.NumOps;
+  }
+  flushBlock();
+  header.TxnSize = compacted.size();
+  memcpy(compacted.data(), &header, sizeof(XAie_TxnHeader));
+
+  std::vector<uint32_t> words((compacted.size() + 3) / 4, 0);
+  memcpy(words.data(), compacted.data(), compacted.size());
+  return words;
+}
+
 FailureOr<uint32_t> AMDAIEDeviceModel::getPacketHeader(uint32_t streamId,
                                                        uint32_t packetType,
                                                        uint32_t srcRow,
@@ -641,6 +839,37 @@ uint32_t AMDAIEDeviceModel::getOffsetFromAddress(uint32_t address) const {
   return address & offsetMask;
 }
 
+bool AMDAIEDeviceModel::isConfigurationOnlyAddress(uint64_t address) const {
+  // Only the AIE2 register layout is modelled.
+  if (configPtr.AieGen != XAIE_DEV_GEN_AIE2IPU) return false;
+  // Checked before narrowing, so that the bits above the column can't alias
+  // an address of the array.
+  if ((address >> getColumnShift()) >= static_cast<uint64_t>(columns()))
+    return false;
+  uint32_t col = getColumnFromAddress(static_cast<uint32_t>(address));
+  uint32_t row = getRowFromAddress(static_cast<uint32_t>(address));
+  if (row >= static_cast<uint32_t>(rows())) return false;
+  uint32_t offset = getOffsetFromAddress(static_cast<uint32_t>(address));
+  auto inRange = [offset](uint32_t begin, uint32_t end) {
+    return offset >= begin && offset < end;
+  };
+  switch (getTileType(col, row)) {
+    case AMDAIETileType::AIETILE:
+      // Program memory and stream switch master, slave and slot
+      // configuration.
+      return inRange(0x20000, 0x24000) || inRange(0x3F000, 0x3F400);
+    case AMDAIETileType::MEMTILE:
+      // Stream switch configuration.
+      return inRange(0xB0000, 0xB0400);
+    case AMDAIETileType::SHIMNOC:
+    case AMDAIETileType::SHIMPL:
+      // Mux/demux and stream switch configuration.
+      return inRange(0x1F000, 0x1F008) || inRange(0x3F000, 0x3F400);
+    default:
+      return false;
+  }
+}
+
 uint8_t AMDAIEDeviceModel::getPacketIdMaxIdx() const {
   return deviceConfig.packetIdMaxIdx;
 }
@@ -10,6 +10,7 @@
 #include <optional>
 #include <tuple>
 #include <type_traits>
+#include <vector>
 
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/Debug.h"
@@ -618,6 +619,14 @@ struct AMDAIEDeviceModel {
   uint32_t getRowFromAddress(uint32_t address) const;
   /// Extract the offset from a register address.
   uint32_t getOffsetFromAddress(uint32_t address) const;
+  /// Returns true if `address` is in program memory or in the stream switch
+  /// configuration. These are only ever written by a configuration, never by
+  /// the cores, DMAs or locks at runtime, so rewriting them with the value
+  /// they already hold is a no-op. Buffer descriptors aren't: the runtime
+  /// sequence patches the shim ones and the DMAs update their iteration
+  /// state. Conservatively returns false for devices whose register layout
+  /// isn't modelled.
+  bool isConfigurationOnlyAddress(uint64_t address) const;
 
   /// Get the maximum for the `packetId` field in the packet header.
   uint8_t getPacketIdMaxIdx() const;
@@ -683,6 +692,19 @@ bool isNPUDevice(mlir::iree_compiler::AMDAIE::AMDAIEDevice d);
 /// Given a 32-bit word, set its most significant bit for odd parity.
 void setOddParityBit(uint32_t &word);
 
+/// Compacts the serialized aie-rt transaction `txn` into an equivalent one with
+/// fewer operations:
+///   - runs of writes to consecutive addresses are coalesced into block writes,
+///   - masked writes are folded into an earlier write of the same register,
+///   - writes that are overwritten later on are dropped.
+/// Writes are only folded or dropped within a run of writes to configuration
+/// only addresses (see `AMDAIEDeviceModel::isConfigurationOnlyAddress`), as the
+/// intermediate values of other registers, like the core control or the DMA
+/// queues, are observable. All other operations are kept in order. Fails if
+/// `txn` has an operation of an unsupported type.
+FailureOr<std::vector<uint32_t>> compactTransaction(
+    const AMDAIEDeviceModel &deviceModel, const uint8_t *txn);
+
 // So that we can use the pattern if(auto r = TRY_XAIE_API...) { // r is nonzero
 // }
 static_assert(XAIE_OK == 0);
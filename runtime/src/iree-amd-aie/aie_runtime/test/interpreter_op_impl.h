@@ -12,6 +12,8 @@
 #define IREE_INTERPRETER_OP_IMPL_H
 
 #include <iostream>
+#include <map>
+#include <vector>
 
 #include "iree-amd-aie/aie_runtime/iree_aie_runtime.h"
 
@@ -124,4 +126,65 @@ inline void SubmitSerializedTransaction(XAie_DevInst &DevInst,
   }
 }
 
+/// Applies the register writes of the serialized transaction `txn` to
+/// `registers`, which maps addresses to the values they hold. Addresses that
+/// aren't in `registers` are assumed to hold 0. Other operations don't change
+/// the registers. Returns the opcodes of the operations of `txn` in order.
+inline std::vector<mlir::iree_compiler::AMDAIE::XAie_TxnOpcode>
+ReplaySerializedTransaction(const uint8_t *txn,
+                            std::map<uint64_t, uint32_t> &registers) {
+  using namespace mlir::iree_compiler;
+  using namespace mlir::iree_compiler::AMDAIE;
+
+  const auto *txn_header = reinterpret_cast<const XAie_TxnHeader *>(txn);
+  std::vector<AMDAIE::XAie_TxnOpcode> opCodes;
+  const uint8_t *ptr = txn + sizeof(XAie_TxnHeader);
+  for (uint32_t i = 0; i < txn_header->NumOps; i++) {
+    const auto *op_header = reinterpret_cast<const XAie_OpHdr *>(ptr);
+    auto opCode = static_cast<AMDAIE::XAie_TxnOpcode>(op_header->Op);
+    opCodes.push_back(opCode);
+    switch (opCode) {
+      case AMDAIE::XAie_TxnOpcode::XAIE_IO_WRITE: {
+        const auto *w_header = reinterpret_cast<const XAie_Write32Hdr *>(ptr);
+        registers[w_header->RegOff] = w_header->Value;
+        ptr += w_header->Size;
+        break;
+      }
+      case AMDAIE::XAie_TxnOpcode::XAIE_IO_BLOCKWRITE: {
+        const auto *bw_header =
+            reinterpret_cast<const XAie_BlockWrite32Hdr *>(ptr);
+        const auto *payload = reinterpret_cast<const uint32_t *>(
+            ptr + sizeof(XAie_BlockWrite32Hdr));
+        uint32_t size = (bw_header->Size - sizeof(*bw_header)) / 4;
+        for (uint32_t ii = 0; ii < size; ii++)
+          registers[bw_header->RegOff + ii * 4U] = payload[ii];
+        ptr += bw_header->Size;
+        break;
+      }
+      case AMDAIE::XAie_TxnOpcode::XAIE_IO_MASKWRITE: {
+        const auto *mw_header =
+            reinterpret_cast<const XAie_MaskWrite32Hdr *>(ptr);
+        uint32_t &value = registers[mw_header->RegOff];
+        value = (value & ~mw_header->Mask) |
+                (mw_header->Value & mw_header->Mask);
+        ptr += mw_header->Size;
+        break;
+      }
+      case AMDAIE::XAie_TxnOpcode::XAIE_IO_MASKPOLL: {
+        const auto *mp_header =
+            reinterpret_cast<const XAie_MaskPoll32Hdr *>(ptr);
+        ptr += mp_header->Size;
+        break;
+      }
+      default: {
+        // All custom operations start with the same header.
+        const auto *co_header = reinterpret_cast<const XAie_CustomOpHdr *>(ptr);
+        ptr += co_header->Size;
+        break;
+      }
+    }
+  }
+  return opCodes;
+}
+
 #endif  // IREE_INTERPRETER_OP_IMPL_H
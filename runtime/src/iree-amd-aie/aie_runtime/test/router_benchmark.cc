@@ -0,0 +1,171 @@
+// Copyright 2024 The IREE Authors
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+/*
+clang-format off
+
+RUN: aie_router_benchmark 1 | FileCheck %s
+
+CHECK: npu1_4col circuit (full): {{[0-9]+}} flows routed
+CHECK: npu1_4col circuit (incremental): {{[0-9]+}} flows routed, {{.*}}speedup over full
+CHECK: npu1_4col circuit (batched): {{[0-9]+}} flows routed, {{.*}}speedup over full
+CHECK: npu1_4col packet (full): {{[0-9]+}} flows routed
+CHECK: npu1_4col packet (incremental): {{[0-9]+}} flows routed, {{.*}}speedup over full
+CHECK: npu1_4col packet (batched): {{[0-9]+}} flows routed, {{.*}}speedup over full
+CHECK: npu4 circuit (full): {{[0-9]+}} flows routed
+CHECK: npu4 circuit (incremental): {{[0-9]+}} flows routed, {{.*}}speedup over full
+CHECK: npu4 circuit (batched): {{[0-9]+}} flows routed, {{.*}}speedup over full
+CHECK: npu4 packet (full): {{[0-9]+}} flows routed
+CHECK: npu4 packet (incremental): {{[0-9]+}} flows routed, {{.*}}speedup over full
+CHECK: npu4 packet (batched): {{[0-9]+}} flows routed, {{.*}}speedup over full
+
+clang-format on
+*/
+
+// Micro-benchmark for `Router`: routes synthetic, matmul-like flow sets over
+// the full array of a device and reports the time spent in
+// `Router::initialize` and `Router::findPaths`. The incremental and batched
+// modes are compared against the full (serial) router in the same run, as
+// absolute timings vary between machines. Usage:
+//
+//   aie_router_benchmark [repetitions]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <optional>
+#include <string>
+
+#include "iree-amd-aie/aie_runtime/iree_aie_router.h"
+#include "iree-amd-aie/aie_runtime/iree_aie_runtime.h"
+#include "llvm/Support/ThreadPool.h"
+
+using namespace mlir::iree_compiler::AMDAIE;
+
+namespace {
+
+struct SyntheticFlow {
+  TileLoc src;
+  Port srcPort;
+  TileLoc dst;
+  Port dstPort;
+};
+
+/// Every column runs its own matmul-like pipeline: the shim feeds two input
+/// streams into the memtile, the memtile broadcasts one operand to all cores
+/// of the column and sends a private operand to every core, and the cores
+/// write their results back to the shim through the memtile.
+std::vector<SyntheticFlow> createMatmulFlows(
+    const AMDAIEDeviceModel &deviceModel) {
+  std::vector<SyntheticFlow> flows;
+  int numCols = deviceModel.columns();
+  int numCoreRows = deviceModel.getNumCoreRows();
+  int memRow = 1;
+  int firstCoreRow = memRow + deviceModel.getNumMemTileRows();
+  for (int col = 0; col < numCols; col++) {
+    TileLoc shim = {col, 0};
+    TileLoc mem = {col, memRow};
+    flows.push_back({shim, {StrmSwPortType::DMA, 0}, mem,
+                     {StrmSwPortType::DMA, 0}});
+    flows.push_back({shim, {StrmSwPortType::DMA, 1}, mem,
+                     {StrmSwPortType::DMA, 1}});
+    for (int i = 0; i < numCoreRows; i++) {
+      TileLoc core = {col, firstCoreRow + i};
+      flows.push_back({mem, {StrmSwPortType::DMA, 0}, core,
+                       {StrmSwPortType::DMA, 0}});
+      flows.push_back({mem, {StrmSwPortType::DMA, i + 1}, core,
+                       {StrmSwPortType::DMA, 1}});
+      flows.push_back({core, {StrmSwPortType::DMA, 0}, mem,
+                       {StrmSwPortType::DMA, i + 2}});
+    }
+    flows.push_back({mem, {StrmSwPortType::DMA, numCoreRows + 1}, shim,
+                     {StrmSwPortType::DMA, 0}});
+  }
+  return flows;
+}
+
+double elapsedMicroseconds(const std::function<void()> &fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+/// Routes the flows `repetitions` times and prints the average times. If
+/// `baselineFindPathsTime` is set, the average `findPaths` time of the full
+/// router, also prints the speedup over it. Returns the average `findPaths`
+/// time, or nullopt if the flows aren't routed.
+std::optional<double> runBenchmark(
+    AMDAIEDevice device, bool isPacketFlow, int repetitions,
+    RouterOptions options, const char *mode,
+    std::optional<double> baselineFindPathsTime) {
+  AMDAIEDeviceModel deviceModel = getDeviceModel(device);
+  std::vector<SyntheticFlow> flows = createMatmulFlows(deviceModel);
+  int maxCol = deviceModel.columns() - 1;
+  int maxRow = deviceModel.rows() - 1;
+  double initializeTime = 0, findPathsTime = 0;
+  bool routed = true;
+  for (int r = 0; r < repetitions; r++) {
+    Router router(maxCol, maxRow, options);
+    initializeTime +=
+        elapsedMicroseconds([&]() { router.initialize(deviceModel); });
+    for (const SyntheticFlow &flow : flows) {
+      router.addFlow(flow.src, flow.srcPort, flow.dst, flow.dstPort,
+                     isPacketFlow);
+    }
+    findPathsTime += elapsedMicroseconds(
+        [&]() { routed &= router.findPaths().has_value(); });
+  }
+  findPathsTime /= repetitions;
+  std::string deviceName = stringifyAMDAIEDevice(device).str();
+  printf("%s %s (%s): %zu flows %s, initialize: %.1f us, findPaths: %.1f us",
+         deviceName.c_str(), isPacketFlow ? "packet" : "circuit", mode,
+         flows.size(), routed ? "routed" : "NOT routed",
+         initializeTime / repetitions, findPathsTime);
+  if (baselineFindPathsTime) {
+    printf(", speedup over full: %.2fx",
+           *baselineFindPathsTime / std::max(findPathsTime, 1e-3));
+  }
+  printf("\n");
+  if (!routed) return std::nullopt;
+  return findPathsTime;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int repetitions = argc > 1 ? std::atoi(argv[1]) : 10;
+  if (repetitions <= 0) {
+    fprintf(stderr, "usage: %s [repetitions]\n", argv[0]);
+    return 1;
+  }
+  RouterOptions incremental;
+  incremental.incremental = true;
+  llvm::DefaultThreadPool threadPool;
+  RouterOptions batched;
+  batched.batched = true;
+  batched.threadPool = &threadPool;
+  std::pair<RouterOptions, const char *> modes[] = {
+      {incremental, "incremental"}, {batched, "batched"}};
+  bool routed = true;
+  for (AMDAIEDevice device : {AMDAIEDevice::npu1_4col, AMDAIEDevice::npu4}) {
+    for (bool isPacketFlow : {false, true}) {
+      // The full router is the baseline the other modes are compared with.
+      std::optional<double> fullFindPathsTime =
+          runBenchmark(device, isPacketFlow, repetitions, RouterOptions(),
+                       "full", /*baselineFindPathsTime=*/std::nullopt);
+      routed &= fullFindPathsTime.has_value();
+      for (auto [options, mode] : modes) {
+        routed &= runBenchmark(device, isPacketFlow, repetitions, options,
+                               mode, fullFindPathsTime)
+                      .has_value();
+      }
+    }
+  }
+  return routed ? 0 : 1;
+}
@@ -0,0 +1,201 @@
+// Copyright 2024 The IREE Authors
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <map>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "iree-amd-aie/aie_runtime/iree_aie_router.h"
+#include "llvm/Support/ThreadPool.h"
+
+namespace mlir::iree_compiler::AMDAIE {
+
+namespace {
+
+/// Adds matmul-like flows to `router`: per column, the shim feeds the
+/// memtile, the memtile broadcasts to and receives from every core. Returns
+/// the sources of the flows in the order they are added. As no two flows share
+/// a destination, every packet flow forms a packet group of its own and the
+/// index of its source is its packet group id.
+std::vector<PhysPort> addMatmulFlows(Router &router,
+                                     const AMDAIEDeviceModel &deviceModel,
+                                     bool isPacketFlow) {
+  std::vector<PhysPort> srcs;
+  auto addFlow = [&](TileLoc srcCoords, Port srcPort, TileLoc dstCoords,
+                     Port dstPort) {
+    router.addFlow(srcCoords, srcPort, dstCoords, dstPort, isPacketFlow);
+    PhysPort src = {srcCoords, srcPort, PhysPort::Direction::SRC};
+    if (!llvm::is_contained(srcs, src)) srcs.push_back(src);
+  };
+  int numCoreRows = deviceModel.getNumCoreRows();
+  for (int col = 0; col < deviceModel.columns(); col++) {
+    TileLoc shim = {col, 0};
+    TileLoc mem = {col, 1};
+    addFlow(shim, {StrmSwPortType::DMA, 0}, mem, {StrmSwPortType::DMA, 0});
+    for (int i = 0; i < numCoreRows; i++) {
+      TileLoc core = {col, 2 + i};
+      addFlow(mem, {StrmSwPortType::DMA, 0}, core, {StrmSwPortType::DMA, 0});
+      addFlow(core, {StrmSwPortType::DMA, 0}, mem,
+              {StrmSwPortType::DMA, i + 1});
+    }
+    addFlow(mem, {StrmSwPortType::DMA, 1}, shim, {StrmSwPortType::DMA, 0});
+  }
+  return srcs;
+}
+
+std::optional<std::map<PhysPort, SwitchSettings>> route(
+    AMDAIEDevice device, bool isPacketFlow, RouterOptions options,
+    std::vector<PhysPort> *srcs = nullptr) {
+  AMDAIEDeviceModel deviceModel = getDeviceModel(device);
+  Router router(deviceModel.columns() - 1, deviceModel.rows() - 1, options);
+  router.initialize(deviceModel);
+  std::vector<PhysPort> flowSrcs =
+      addMatmulFlows(router, deviceModel, isPacketFlow);
+  if (srcs) *srcs = std::move(flowSrcs);
+  return router.findPaths();
+}
+
+/// Checks that no channel of a switchbox is used by more streams than it can
+/// carry, accounting for packet flows like `Router::findPaths` does: the
+/// packet group with the lowest id using the input or the output port of a
+/// channel shares it among its flows, every other flow uses a stream of its
+/// own. `packetGroupIds` maps the source of every packet flow to its group.
+void expectLegalSolution(const std::map<PhysPort, SwitchSettings> &solution,
+                         const std::map<PhysPort, int> &packetGroupIds) {
+  using SwitchPort = std::pair<TileLoc, Port>;
+  std::map<std::tuple<TileLoc, Port, Port>, std::map<int, int>> channelFlows;
+  std::map<SwitchPort, std::set<int>> srcPortGroups, dstPortGroups;
+  for (const auto &[src, settings] : solution) {
+    auto it = packetGroupIds.find(src);
+    int packetGroupId = it == packetGroupIds.end() ? -1 : it->second;
+    for (const auto &[tileLoc, setting] : settings) {
+      ASSERT_EQ(setting.srcs.size(), setting.dsts.size());
+      for (auto [srcPort, dstPort] :
+           llvm::zip_equal(setting.srcs, setting.dsts)) {
+        channelFlows[{tileLoc, srcPort, dstPort}][packetGroupId]++;
+        if (packetGroupId < 0) continue;
+        srcPortGroups[{tileLoc, srcPort}].insert(packetGroupId);
+        dstPortGroups[{tileLoc, dstPort}].insert(packetGroupId);
+      }
+    }
+  }
+  for (const auto &[channel, groupFlows] : channelFlows) {
+    auto [tileLoc, srcPort, dstPort] = channel;
+    std::set<int> portGroups = srcPortGroups[{tileLoc, srcPort}];
+    portGroups.insert(dstPortGroups[{tileLoc, dstPort}].begin(),
+                      dstPortGroups[{tileLoc, dstPort}].end());
+    int ownerGroupId = portGroups.empty() ? -1 : *portGroups.begin();
+    int streams = 0;
+    for (auto [packetGroupId, numFlows] : groupFlows) {
+      bool shared = packetGroupId >= 0 && packetGroupId == ownerGroupId;
+      streams += shared ? 1 : numFlows;
+    }
+    EXPECT_LE(streams, 1) << "channel " << srcPort << " -> " << dstPort
+                          << " of " << tileLoc << " is over capacity";
+  }
+}
+
+void expectSameSolutions(const std::map<PhysPort, SwitchSettings> &lhs,
+                         const std::map<PhysPort, SwitchSettings> &rhs) {
+  ASSERT_EQ(lhs.size(), rhs.size());
+  for (const auto &[src, settings] : lhs) {
+    ASSERT_EQ(rhs.count(src), 1u);
+    const SwitchSettings &otherSettings = rhs.at(src);
+    ASSERT_EQ(settings.size(), otherSettings.size());
+    for (const auto &[tileLoc, setting] : settings) {
+      ASSERT_EQ(otherSettings.count(tileLoc), 1u);
+      EXPECT_EQ(setting.srcs, otherSettings.at(tileLoc).srcs);
+      EXPECT_EQ(setting.dsts, otherSettings.at(tileLoc).dsts);
+    }
+  }
+}
+
+class RouterTest : public ::testing::TestWithParam<bool> {};
+
+TEST_P(RouterTest, BatchedMatchesSerial) {
+  llvm::DefaultThreadPool threadPool(llvm::hardware_concurrency(4));
+  RouterOptions batched;
+  batched.batched = true;
+  batched.threadPool = &threadPool;
+  RouterOptions batchedOnCallingThread;
+  batchedOnCallingThread.batched = true;
+  for (AMDAIEDevice device : {AMDAIEDevice::npu1_4col, AMDAIEDevice::npu4}) {
+    auto serialSolution = route(device, GetParam(), RouterOptions());
+    ASSERT_TRUE(serialSolution.has_value());
+    for (RouterOptions options : {batched, batchedOnCallingThread}) {
+      auto batchedSolution = route(device, GetParam(), options);
+      ASSERT_TRUE(batchedSolution.has_value());
+      expectSameSolutions(*serialSolution, *batchedSolution);
+    }
+  }
+}
+
+TEST_P(RouterTest, AllModesRoute) {
+  RouterOptions incremental;
+  incremental.incremental = true;
+  RouterOptions batched;
+  batched.batched = true;
+  for (AMDAIEDevice device : {AMDAIEDevice::npu1_4col, AMDAIEDevice::npu4}) {
+    auto fullSolution = route(device, GetParam(), RouterOptions());
+    ASSERT_TRUE(fullSolution.has_value());
+    for (RouterOptions options : {incremental, batched}) {
+      auto solution = route(device, GetParam(), options);
+      ASSERT_TRUE(solution.has_value());
+      // Every flow is routed, though possibly along a different path.
+      EXPECT_EQ(solution->size(), fullSolution->size());
+    }
+  }
+}
+
+TEST_P(RouterTest, IncrementalRoutesAreLegal) {
+  RouterOptions incremental;
+  incremental.incremental = true;
+  for (AMDAIEDevice device : {AMDAIEDevice::npu1_4col, AMDAIEDevice::npu4}) {
+    std::vector<PhysPort> srcs;
+    auto solution = route(device, GetParam(), incremental, &srcs);
+    ASSERT_TRUE(solution.has_value());
+    std::map<PhysPort, int> packetGroupIds;
+    if (GetParam()) {
+      for (auto [packetGroupId, src] : llvm::enumerate(srcs))
+        packetGroupIds[src] = static_cast<int>(packetGroupId);
+    }
+    expectLegalSolution(*solution, packetGroupIds);
+  }
+}
+
+TEST_P(RouterTest, ClearedRouterMatchesNewRouter) {
+  RouterOptions incremental;
+  incremental.incremental = true;
+  for (AMDAIEDevice device : {AMDAIEDevice::npu1_4col, AMDAIEDevice::npu4}) {
+    AMDAIEDeviceModel deviceModel = getDeviceModel(device);
+    Router router(deviceModel.columns() - 1, deviceModel.rows() - 1,
+                  incremental);
+    router.initialize(deviceModel);
+    addMatmulFlows(router, deviceModel, !GetParam());
+    ASSERT_TRUE(router.findPaths().has_value());
+    router.clearFlows();
+    addMatmulFlows(router, deviceModel, GetParam());
+    auto solution = router.findPaths();
+    ASSERT_TRUE(solution.has_value());
+    auto newRouterSolution = route(device, GetParam(), incremental);
+    ASSERT_TRUE(newRouterSolution.has_value());
+    expectSameSolutions(*newRouterSolution, *solution);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(CircuitAndPacketFlows, RouterTest,
+                         ::testing::Bool());
+
+}  // namespace
+
+}  // namespace mlir::iree_compiler::AMDAIE
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
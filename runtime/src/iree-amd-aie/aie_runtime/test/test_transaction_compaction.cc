@@ -0,0 +1,168 @@
+// Copyright 2025 The IREE Authors
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <array>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "interpreter_op_impl.h"
+#include "iree-amd-aie/aie_runtime/iree_aie_configure.h"
+#include "iree-amd-aie/aie_runtime/iree_aie_runtime.h"
+
+namespace mlir::iree_compiler::AMDAIE {
+
+namespace {
+
+using Opcode = XAie_TxnOpcode;
+
+// Configuration only registers.
+constexpr uint32_t kProgramMemory = 0x20000;
+constexpr uint32_t kStreamSwitchMaster0 = 0x3F000;
+// Registers that aren't configuration only.
+constexpr uint32_t kShimBd0 = 0x1D000;
+constexpr uint32_t kShimS2MM0TaskQueue = 0x1D204;
+constexpr uint32_t kCoreControl = 0x32000;
+constexpr uint32_t kDataMemory = 0x400;
+
+class TransactionCompactionTest : public ::testing::Test {
+ protected:
+  TransactionCompactionTest()
+      : deviceModel(getDeviceModel(AMDAIEDevice::npu1_4col)) {
+    XAie_StartTransaction(&deviceModel.devInst,
+                          XAIE_TRANSACTION_DISABLE_AUTO_FLUSH);
+  }
+
+  ~TransactionCompactionTest() override {
+    XAie_ClearTransaction(&deviceModel.devInst);
+  }
+
+  uint64_t getAddress(uint8_t col, uint8_t row, uint32_t offset) const {
+    const XAie_DevProp &devProp = deviceModel.devInst.DevProp;
+    return (static_cast<uint64_t>(col) << devProp.ColShift) |
+           (static_cast<uint64_t>(row) << devProp.RowShift) | offset;
+  }
+
+  void write(uint64_t address, uint32_t value) {
+    XAie_Write32(&deviceModel.devInst, address, value);
+  }
+
+  void maskWrite(uint64_t address, uint32_t mask, uint32_t value) {
+    XAie_MaskWrite32(&deviceModel.devInst, address, mask, value);
+  }
+
+  /// Compacts the transaction built so far and checks that replaying it leaves
+  /// the registers in the same state as replaying the original transaction.
+  /// Returns the opcodes of the compacted transaction.
+  std::vector<Opcode> compactAndReplay() {
+    std::unique_ptr<uint8_t, decltype(&free)> txn(
+        XAie_ExportSerializedTransaction(&deviceModel.devInst, 0, 0), &free);
+    FailureOr<std::vector<uint32_t>> maybeCompacted =
+        compactTransaction(deviceModel, txn.get());
+    EXPECT_TRUE(succeeded(maybeCompacted));
+    if (failed(maybeCompacted)) return {};
+    const auto *compactedTxn =
+        reinterpret_cast<const uint8_t *>(maybeCompacted->data());
+    const auto *header = reinterpret_cast<const XAie_TxnHeader *>(compactedTxn);
+    EXPECT_EQ(header->TxnSize, maybeCompacted->size() * sizeof(uint32_t));
+
+    std::map<uint64_t, uint32_t> registers;
+    std::map<uint64_t, uint32_t> compactedRegisters;
+    ReplaySerializedTransaction(txn.get(), registers);
+    std::vector<Opcode> opCodes =
+        ReplaySerializedTransaction(compactedTxn, compactedRegisters);
+    EXPECT_EQ(registers, compactedRegisters);
+    return opCodes;
+  }
+
+  AMDAIEDeviceModel deviceModel;
+};
+
+TEST_F(TransactionCompactionTest, Empty) {
+  EXPECT_TRUE(compactAndReplay().empty());
+}
+
+TEST_F(TransactionCompactionTest, CoalescesConsecutiveWrites) {
+  // A program written one word at a time.
+  for (uint32_t i = 0; i < 8; ++i)
+    write(getAddress(0, 2, kProgramMemory + 4 * i), i);
+  // Writes to registers that aren't configuration only are coalesced in the
+  // order they are written.
+  for (uint32_t i = 0; i < 4; ++i)
+    write(getAddress(0, 2, kDataMemory + 4 * i), i + 1);
+  write(getAddress(0, 2, kDataMemory + 0x14), 6);
+  write(getAddress(0, 2, kDataMemory + 0x10), 5);
+  EXPECT_EQ(compactAndReplay(),
+            (std::vector<Opcode>{
+                Opcode::XAIE_IO_BLOCKWRITE, Opcode::XAIE_IO_BLOCKWRITE,
+                Opcode::XAIE_IO_WRITE, Opcode::XAIE_IO_WRITE}));
+}
+
+TEST_F(TransactionCompactionTest, FoldsMaskWrites) {
+  // Folded into the earlier write of the same register.
+  write(getAddress(0, 2, kStreamSwitchMaster0), 0x1);
+  maskWrite(getAddress(0, 2, kStreamSwitchMaster0), 0x80000000, 0x80000000);
+  // Merged into a single masked write.
+  maskWrite(getAddress(0, 2, kStreamSwitchMaster0 + 4), 0xF, 0x3);
+  maskWrite(getAddress(0, 2, kStreamSwitchMaster0 + 4), 0xF0, 0x50);
+  // The core reset pulse is observable, so both writes are kept.
+  maskWrite(getAddress(0, 2, kCoreControl), 0x2, 0x2);
+  maskWrite(getAddress(0, 2, kCoreControl), 0x2, 0x0);
+  EXPECT_EQ(compactAndReplay(),
+            (std::vector<Opcode>{
+                Opcode::XAIE_IO_WRITE, Opcode::XAIE_IO_MASKWRITE,
+                Opcode::XAIE_IO_MASKWRITE, Opcode::XAIE_IO_MASKWRITE}));
+}
+
+TEST_F(TransactionCompactionTest, DropsOverwrittenWrites) {
+  write(getAddress(0, 2, kProgramMemory), 1);
+  write(getAddress(0, 2, kProgramMemory + 4), 2);
+  write(getAddress(0, 2, kProgramMemory + 8), 3);
+  write(getAddress(0, 2, kProgramMemory), 4);
+  write(getAddress(0, 2, kProgramMemory + 4), 5);
+  // Only the last value of every word is written.
+  EXPECT_EQ(compactAndReplay(),
+            (std::vector<Opcode>{Opcode::XAIE_IO_BLOCKWRITE}));
+}
+
+TEST_F(TransactionCompactionTest, KeepsBufferDescriptorWrites) {
+  // Buffer descriptors are updated at runtime, so every write is kept.
+  write(getAddress(0, 0, kShimBd0), 1);
+  write(getAddress(0, 0, kShimBd0), 2);
+  write(getAddress(0, 2, kStreamSwitchMaster0), 3);
+  write(getAddress(0, 2, kStreamSwitchMaster0), 4);
+  EXPECT_EQ(compactAndReplay(),
+            (std::vector<Opcode>{Opcode::XAIE_IO_WRITE, Opcode::XAIE_IO_WRITE,
+                                 Opcode::XAIE_IO_WRITE}));
+}
+
+TEST_F(TransactionCompactionTest, KeepsWritesObservedByOtherOps) {
+  // The stream switch is used by the DMA before it is reconfigured.
+  write(getAddress(0, 0, kStreamSwitchMaster0), 1);
+  write(getAddress(0, 0, kShimS2MM0TaskQueue), 0);
+  write(getAddress(0, 0, kStreamSwitchMaster0), 2);
+  // Nor are writes folded across other operations.
+  std::array<uint32_t, 2> tct = {0, 0};
+  ASSERT_TRUE(succeeded(configureCustomTxnOp(
+      deviceModel, static_cast<uint8_t>(Opcode::XAIE_IO_CUSTOM_OP_TCT),
+      tct.data(), tct.size() * sizeof(uint32_t))));
+  write(getAddress(0, 0, kStreamSwitchMaster0), 3);
+  EXPECT_EQ(compactAndReplay(),
+            (std::vector<Opcode>{Opcode::XAIE_IO_WRITE, Opcode::XAIE_IO_WRITE,
+                                 Opcode::XAIE_IO_WRITE,
+                                 Opcode::XAIE_IO_CUSTOM_OP_TCT,
+                                 Opcode::XAIE_IO_WRITE}));
+}
+
+}  // namespace
+
+}  // namespace mlir::iree_compiler::AMDAIE
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -15,6 +15,9 @@ struct iree_hal_xrt_lite_device_params {
   int32_t n_core_rows;
   int32_t n_core_cols;
   iree_string_view_t power_mode;
+  // Number of hardware contexts (i.e., loaded PDIs) the device keeps around
+  // for reuse by later dispatches.
+  int32_t hw_ctx_cache_capacity;
 };
 
 IREE_API_EXPORT void iree_hal_xrt_lite_device_options_initialize(
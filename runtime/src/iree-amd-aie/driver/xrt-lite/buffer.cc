@@ -8,6 +8,7 @@
 
 #include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/bo.h"
 #include "iree-amd-aie/driver/xrt-lite/util.h"
+#include "iree/base/internal/atomics.h"
 
 namespace {
 extern const iree_hal_buffer_vtable_t iree_hal_xrt_lite_buffer_vtable;
@@ -18,6 +19,9 @@ struct iree_hal_xrt_lite_buffer {
   shim_xdna::bo* bo;
   iree_allocator_t host_allocator;
   iree_hal_buffer_release_callback_t release_callback;
+  // Non-zero when a dispatch wrote `bo` on the device and the host copy has not
+  // been synced since.
+  iree_atomic_int32_t device_written;
 };
 
 static iree_status_t iree_hal_xrt_lite_buffer_invalidate_range(
@@ -66,8 +70,11 @@ static iree_status_t iree_hal_xrt_lite_buffer_map_range(
   // Should be guaranteed by previous checks.
   IREE_ASSERT(host_ptr != nullptr);
   uint8_t* data_ptr = reinterpret_cast<uint8_t*>(host_ptr) + local_byte_offset;
-  iree_status_t status = iree_hal_xrt_lite_buffer_invalidate_range(
-      base_buffer, local_byte_offset, local_byte_length);
+  // Only dispatches make the host copy stale; discarded contents need no sync
+  // at all.
+  if (!iree_any_bit_set(memory_access, IREE_HAL_MEMORY_ACCESS_DISCARD)) {
+    iree_hal_xrt_lite_buffer_sync_device_writes(base_buffer);
+  }
   // If we mapped for discard, scribble over the bytes. This is not a mandated
   // behavior but it will make debugging issues easier. Alternatively for heap
   // buffers we could reallocate them such that ASAN yells, but that would
@@ -80,7 +87,7 @@ static iree_status_t iree_hal_xrt_lite_buffer_map_range(
   mapping->contents = iree_make_byte_span(data_ptr, local_byte_length);
 
   IREE_TRACE_ZONE_END(z0);
-  return status;
+  return iree_ok_status();
 }
 
 static iree_status_t iree_hal_xrt_lite_buffer_flush_range(
@@ -132,6 +139,7 @@ iree_status_t iree_hal_xrt_lite_buffer_wrap(
                              &iree_hal_xrt_lite_buffer_vtable, &buffer->base);
   buffer->release_callback = release_callback;
   buffer->bo = bo;
+  iree_atomic_store(&buffer->device_written, 0, iree_memory_order_relaxed);
   *out_buffer = &buffer->base;
 
   IREE_TRACE_ZONE_END(z0);
@@ -165,6 +173,27 @@ shim_xdna::bo* iree_hal_xrt_lite_buffer_handle(iree_hal_buffer_t* base_buffer) {
   return buffer->bo;
 }
 
+void iree_hal_xrt_lite_buffer_mark_device_written(
+    iree_hal_buffer_t* base_buffer) {
+  iree_hal_xrt_lite_buffer* buffer = IREE_HAL_XRT_LITE_CHECKED_VTABLE_CAST(
+      base_buffer, iree_hal_xrt_lite_buffer_vtable, iree_hal_xrt_lite_buffer);
+  iree_atomic_store(&buffer->device_written, 1, iree_memory_order_release);
+}
+
+void iree_hal_xrt_lite_buffer_sync_device_writes(
+    iree_hal_buffer_t* base_buffer) {
+  iree_hal_xrt_lite_buffer* buffer = IREE_HAL_XRT_LITE_CHECKED_VTABLE_CAST(
+      base_buffer, iree_hal_xrt_lite_buffer_vtable, iree_hal_xrt_lite_buffer);
+  if (!buffer->bo ||
+      !iree_atomic_exchange(&buffer->device_written, 0,
+                            iree_memory_order_acq_rel)) {
+    return;
+  }
+  IREE_TRACE_ZONE_BEGIN(z0);
+  buffer->bo->sync(shim_xdna::direction::device2host);
+  IREE_TRACE_ZONE_END(z0);
+}
+
 namespace {
 const iree_hal_buffer_vtable_t iree_hal_xrt_lite_buffer_vtable = {
     .recycle = iree_hal_buffer_recycle,
@@ -21,4 +21,15 @@ iree_status_t iree_hal_xrt_lite_buffer_wrap(
 
 shim_xdna::bo* iree_hal_xrt_lite_buffer_handle(iree_hal_buffer_t* base_buffer);
 
+// Records that a dispatch may have written the BO of `base_buffer` (an
+// allocated buffer) on the device. The BO is only synced back to the host when
+// the buffer is next accessed from the host.
+void iree_hal_xrt_lite_buffer_mark_device_written(
+    iree_hal_buffer_t* base_buffer);
+
+// Syncs the BO of `base_buffer` (an allocated buffer) back to the host if a
+// dispatch wrote it since the last sync.
+void iree_hal_xrt_lite_buffer_sync_device_writes(
+    iree_hal_buffer_t* base_buffer);
+
 #endif  // IREE_HAL_DRIVERS_XRT_LITE_BUFFER_H_
@@ -6,12 +6,15 @@
 
 #include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/device.h"
 
+#include <algorithm>
+
 #include "iree-amd-aie/driver/xrt-lite/allocator.h"
 #include "iree-amd-aie/driver/xrt-lite/api.h"
 #include "iree-amd-aie/driver/xrt-lite/device.h"
 #include "iree-amd-aie/driver/xrt-lite/direct_command_buffer.h"
 #include "iree-amd-aie/driver/xrt-lite/nop_executable_cache.h"
-#include "iree-amd-aie/driver/xrt-lite/nop_semaphore.h"
+#include "iree-amd-aie/driver/xrt-lite/semaphore.h"
+#include "iree-amd-aie/driver/xrt-lite/submission_queue.h"
 #include "iree-amd-aie/driver/xrt-lite/util.h"
 #include "iree/hal/utils/deferred_command_buffer.h"
 #include "iree/hal/utils/deferred_work_queue.h"
@@ -51,11 +54,17 @@ iree_hal_xrt_lite_device::iree_hal_xrt_lite_device(
         new shim_xdna::device(options->n_core_rows, options->n_core_cols);
   }
 
+  hw_ctx_cache = new shim_xdna::hw_ctx_cache(
+      *shim_device, std::max(options->hw_ctx_cache_capacity, 1));
+
   iree_status_t status = iree_hal_xrt_lite_allocator_create(
       host_allocator, shim_device, &device_allocator);
   IREE_ASSERT(iree_status_is_ok(status));
   iree_arena_block_pool_initialize(ARENA_BLOCK_SIZE, host_allocator,
                                    &block_pool);
+  status = iree_hal_xrt_lite_submission_queue_create(this, host_allocator,
+                                                     &submission_queue);
+  IREE_ASSERT(iree_status_is_ok(status));
 
   IREE_TRACE_ZONE_END(z0);
 }
@@ -81,15 +90,19 @@ static iree_status_t iree_hal_xrt_lite_device_create_command_buffer(
     iree_hal_command_buffer_t** out_command_buffer) {
   IREE_TRACE_ZONE_BEGIN(z0);
 
+  iree_hal_xrt_lite_device* device = IREE_HAL_XRT_LITE_CHECKED_VTABLE_CAST(
+      base_device, iree_hal_xrt_lite_device_vtable, iree_hal_xrt_lite_device);
+
+  // Reusable command buffers build their exec bufs once while recording and
+  // are replayed by the submission queue; one-shot ones are recorded as
+  // deferred commands and executed through a fresh direct command buffer.
   if (!iree_all_bits_set(mode, IREE_HAL_COMMAND_BUFFER_MODE_ONE_SHOT)) {
     IREE_TRACE_ZONE_END(z0);
-    return iree_make_status(IREE_STATUS_UNIMPLEMENTED,
-                            "unimplemented multi-shot command buffer");
+    return iree_hal_xrt_lite_direct_command_buffer_create(
+        device, mode, command_categories, binding_capacity,
+        &device->block_pool, device->host_allocator, out_command_buffer);
   }
 
-  iree_hal_xrt_lite_device* device = IREE_HAL_XRT_LITE_CHECKED_VTABLE_CAST(
-      base_device, iree_hal_xrt_lite_device_vtable, iree_hal_xrt_lite_device);
-
   IREE_TRACE_ZONE_END(z0);
   return iree_hal_deferred_command_buffer_create(
       device->device_allocator, mode, command_categories, queue_affinity,
@@ -106,8 +119,9 @@ static iree_status_t iree_hal_xrt_lite_device_create_semaphore(
       base_device, iree_hal_xrt_lite_device_vtable, iree_hal_xrt_lite_device);
 
   IREE_TRACE_ZONE_END(z0);
-  return iree_hal_xrt_lite_semaphore_create(device->host_allocator,
-                                            initial_value, out_semaphore);
+  return iree_hal_xrt_lite_semaphore_create(
+      device->shim_device, device->host_allocator, initial_value,
+      out_semaphore);
 }
 
 static iree_status_t iree_hal_xrt_lite_device_queue_execute(
@@ -122,21 +136,12 @@ static iree_status_t iree_hal_xrt_lite_device_queue_execute(
   iree_hal_xrt_lite_device* device = IREE_HAL_XRT_LITE_CHECKED_VTABLE_CAST(
       base_device, iree_hal_xrt_lite_device_vtable, iree_hal_xrt_lite_device);
 
-  if (command_buffer) {
-    iree_hal_command_buffer_t* xrt_command_buffer = nullptr;
-    iree_hal_command_buffer_mode_t mode =
-        IREE_HAL_COMMAND_BUFFER_MODE_ONE_SHOT |
-        IREE_HAL_COMMAND_BUFFER_MODE_ALLOW_INLINE_EXECUTION |
-        IREE_HAL_COMMAND_BUFFER_MODE_UNVALIDATED;
-    IREE_RETURN_AND_END_ZONE_IF_ERROR(
-        z0, iree_hal_xrt_lite_direct_command_buffer_create(
-                device, mode, IREE_HAL_COMMAND_CATEGORY_ANY,
-                /*binding_capacity=*/0, &device->block_pool,
-                device->host_allocator, &xrt_command_buffer));
-    IREE_RETURN_AND_END_ZONE_IF_ERROR(
-        z0, iree_hal_deferred_command_buffer_apply(
-                command_buffer, xrt_command_buffer, binding_table));
-  }
+  // The submission queue waits on `wait_semaphore_list`, runs the command
+  // buffer and signals `signal_semaphore_list` on its own thread.
+  IREE_RETURN_AND_END_ZONE_IF_ERROR(
+      z0, iree_hal_xrt_lite_submission_queue_enqueue(
+              device->submission_queue, wait_semaphore_list,
+              signal_semaphore_list, command_buffer, binding_table));
 
   IREE_TRACE_ZONE_END(z0);
   return iree_ok_status();
@@ -174,6 +179,25 @@ static iree_status_t iree_hal_xrt_lite_device_query_i64(
     return iree_ok_status();
   }
 
+  // Statistics of the hardware context cache, to see how often PDIs are still
+  // being (re)loaded.
+  if (iree_string_view_equal(category, IREE_SV("xrt-lite.hw_ctx_cache"))) {
+    if (iree_string_view_equal(key, IREE_SV("hits"))) {
+      *out_value = device->hw_ctx_cache->hits();
+    } else if (iree_string_view_equal(key, IREE_SV("misses"))) {
+      *out_value = device->hw_ctx_cache->misses();
+    } else if (iree_string_view_equal(key, IREE_SV("size"))) {
+      *out_value = device->hw_ctx_cache->size();
+    } else {
+      IREE_TRACE_ZONE_END(z0);
+      return iree_make_status(IREE_STATUS_NOT_FOUND,
+                              "unknown hw_ctx_cache statistic '%.*s'",
+                              (int)key.size, key.data);
+    }
+    IREE_TRACE_ZONE_END(z0);
+    return iree_ok_status();
+  }
+
   IREE_TRACE_ZONE_END(z0);
   return iree_make_status(IREE_STATUS_UNIMPLEMENTED, "unsupported query");
 }
@@ -189,17 +213,21 @@ static iree_status_t iree_hal_xrt_lite_device_queue_alloca(
 
   iree_hal_xrt_lite_device* device = IREE_HAL_XRT_LITE_CHECKED_VTABLE_CAST(
       base_device, iree_hal_xrt_lite_device_vtable, iree_hal_xrt_lite_device);
-  IREE_RETURN_AND_END_ZONE_IF_ERROR(
-      z0, iree_hal_semaphore_list_wait(wait_semaphore_list,
-                                       iree_infinite_timeout()));
+  // The allocation doesn't depend on the waits, so it happens right away and
+  // only the signal is ordered after them on the submission queue.
   IREE_RETURN_AND_END_ZONE_IF_ERROR(
       z0, iree_hal_allocator_allocate_buffer(device->device_allocator, params,
                                              allocation_size, out_buffer));
-  IREE_RETURN_AND_END_ZONE_IF_ERROR(
-      z0, iree_hal_semaphore_list_signal(signal_semaphore_list));
+  iree_status_t status = iree_hal_xrt_lite_submission_queue_enqueue_barrier(
+      device->submission_queue, wait_semaphore_list, signal_semaphore_list,
+      /*buffer=*/nullptr);
+  if (!iree_status_is_ok(status)) {
+    iree_hal_buffer_release(*out_buffer);
+    *out_buffer = nullptr;
+  }
 
   IREE_TRACE_ZONE_END(z0);
-  return iree_ok_status();
+  return status;
 }
 
 static iree_status_t iree_hal_xrt_lite_device_queue_dealloca(
@@ -207,9 +235,17 @@ static iree_status_t iree_hal_xrt_lite_device_queue_dealloca(
     const iree_hal_semaphore_list_t wait_semaphore_list,
     const iree_hal_semaphore_list_t signal_semaphore_list,
     iree_hal_buffer_t* buffer, iree_hal_alloca_flags_t flags) {
-  IREE_RETURN_IF_ERROR(iree_hal_semaphore_list_wait(wait_semaphore_list,
-                                                    iree_infinite_timeout()));
-  iree_status_t status = iree_hal_semaphore_list_signal(signal_semaphore_list);
+  IREE_TRACE_ZONE_BEGIN(z0);
+
+  iree_hal_xrt_lite_device* device = IREE_HAL_XRT_LITE_CHECKED_VTABLE_CAST(
+      base_device, iree_hal_xrt_lite_device_vtable, iree_hal_xrt_lite_device);
+  // The submission queue keeps the buffer alive until the waits are reached,
+  // so that it isn't freed while earlier submissions may still use it.
+  iree_status_t status = iree_hal_xrt_lite_submission_queue_enqueue_barrier(
+      device->submission_queue, wait_semaphore_list, signal_semaphore_list,
+      buffer);
+
+  IREE_TRACE_ZONE_END(z0);
   return status;
 }
 
@@ -230,6 +266,10 @@ static void iree_hal_xrt_lite_device_destroy(iree_hal_device_t* base_device) {
   iree_hal_xrt_lite_device* device = IREE_HAL_XRT_LITE_CHECKED_VTABLE_CAST(
       base_device, iree_hal_xrt_lite_device_vtable, iree_hal_xrt_lite_device);
 
+  // Finish all in-flight submissions before tearing down the device they
+  // execute on.
+  iree_hal_xrt_lite_submission_queue_destroy(device->submission_queue);
+  delete device->hw_ctx_cache;
   iree_hal_allocator_release(device->device_allocator);
   if (!iree_string_view_is_empty(device->power_mode) &&
       !iree_string_view_equal(device->power_mode, IREE_SV("default"))) {
@@ -268,6 +308,7 @@ void iree_hal_xrt_lite_device_options_initialize(
   IREE_TRACE_ZONE_BEGIN(z0);
 
   memset(out_options, 0, sizeof(*out_options));
+  out_options->hw_ctx_cache_capacity = 4;
 
   IREE_TRACE_ZONE_END(z0);
 }
@@ -9,9 +9,12 @@
 
 #include "iree-amd-aie/driver/xrt-lite/api.h"
 #include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/device.h"
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/hwctx.h"
 #include "iree/base/internal/arena.h"
 #include "iree/hal/api.h"
 
+struct iree_hal_xrt_lite_submission_queue;
+
 struct iree_hal_xrt_lite_device {
   iree_hal_resource_t resource;
   iree_allocator_t host_allocator;
@@ -22,6 +25,12 @@ struct iree_hal_xrt_lite_device {
   // since command buffers can contain inlined data
   iree_arena_block_pool_t block_pool;
   shim_xdna::device* shim_device;
+  // hardware contexts of recent dispatches, so that their PDIs are only loaded
+  // again once evicted; command buffers hold the contexts they have pending
+  // runs on, so an evicted context lives until those are submitted
+  shim_xdna::hw_ctx_cache* hw_ctx_cache;
+  // executes queue_execute submissions in the background
+  iree_hal_xrt_lite_submission_queue* submission_queue;
   // should come last; see the definition of total_size below in
   // iree_hal_xrt_lite_device_create
   iree_string_view_t identifier;
@@ -6,6 +6,10 @@
 
 #include "iree-amd-aie/driver/xrt-lite/direct_command_buffer.h"
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 #include "iree-amd-aie/driver/xrt-lite/buffer.h"
 #include "iree-amd-aie/driver/xrt-lite/executable.h"
 #include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/hwq.h"
@@ -14,6 +18,54 @@
 #include "iree/hal/utils/resource_set.h"
 #include "llvm/Support/raw_ostream.h"
 
+// Kernel runs that have been recorded but not yet submitted. They are issued
+// on `hwq` as a single chained command; once the whole chain has completed, the
+// bindings they write are marked as written by the device so that the host
+// syncs them when it next accesses them.
+struct iree_hal_xrt_lite_pending_commands {
+  explicit iree_hal_xrt_lite_pending_commands(const shim_xdna::pdev& pdev)
+      : chain(pdev) {}
+
+  shim_xdna::hw_q* hwq = nullptr;
+  // The cached hardware context of `hwq`, held so that the cache can't destroy
+  // it while the chain is pending.
+  std::shared_ptr<shim_xdna::hw_ctx_cache::entry> hw_ctx;
+  shim_xdna::cmd_chain chain;
+  // The exec buf BOs referenced by `chain`; they must outlive the submission.
+  // The control code BOs they point at are owned by the executables, which
+  // the resource set keeps alive.
+  std::vector<std::unique_ptr<shim_xdna::kernel>> kernels;
+  // The (deduplicated) allocated buffers written by the pending kernel runs.
+  std::vector<iree_hal_buffer_t*> written_buffers;
+};
+
+// A kernel run built for a dispatch; it is issued `n_runs` times.
+struct iree_hal_xrt_lite_kernel_run {
+  std::unique_ptr<shim_xdna::kernel> ebuf;
+  uint32_t n_runs;
+  // Whether the bindings of the dispatch are passed to the run, starting at
+  // argument `kBindingArgIndex`.
+  bool has_bindings;
+};
+
+// A command recorded by a reusable command buffer. The exec bufs of a dispatch
+// are built once when recording; replaying only rebinds the arguments whose
+// binding resolves to a different BO than during the previous replay.
+struct iree_hal_xrt_lite_recorded_command {
+  enum class kind { dispatch, update_buffer, copy_buffer };
+  kind type;
+  // dispatch: the bindings. update_buffer: the target. copy_buffer: the source
+  // and the target.
+  std::vector<iree_hal_buffer_ref_t> refs;
+  iree_hal_xrt_lite_executable* executable = nullptr;
+  int32_t entry_point = 0;
+  std::vector<iree_hal_xrt_lite_kernel_run> runs;
+  // The BOs the bindings of `runs` are currently bound to, if any.
+  std::vector<shim_xdna::bo*> bound_bos;
+  // The update_buffer source data; allocated from the command buffer arena.
+  const uint8_t* source_data = nullptr;
+};
+
 struct iree_hal_xrt_lite_direct_command_buffer {
   iree_hal_command_buffer_t base;
   iree_allocator_t host_allocator;
@@ -24,8 +76,16 @@ struct iree_hal_xrt_lite_direct_command_buffer {
   iree_arena_allocator_t arena;
 
   iree_hal_xrt_lite_device* device;
+  iree_hal_xrt_lite_pending_commands* pending;
+  // The recorded commands of a reusable (not one-shot) command buffer, or null
+  // for one-shot command buffers, which execute commands as they are recorded.
+  std::vector<iree_hal_xrt_lite_recorded_command>* recorded;
 };
 
+// The first kernel argument holding a binding; the arguments before it are the
+// opcode, the control code BO and the control code size.
+static constexpr uint32_t kBindingArgIndex = 3;
+
 namespace {
 extern const iree_hal_command_buffer_vtable_t
     iree_hal_xrt_lite_direct_command_buffer_vtable;
@@ -40,8 +100,10 @@ iree_status_t iree_hal_xrt_lite_direct_command_buffer_create(
   IREE_ASSERT_ARGUMENT(device);
   IREE_ASSERT_ARGUMENT(out_command_buffer);
   *out_command_buffer = nullptr;
-  if (binding_capacity > 0) {
-    // TODO(#10144): support indirect command buffers with binding tables.
+  bool reusable =
+      !iree_all_bits_set(mode, IREE_HAL_COMMAND_BUFFER_MODE_ONE_SHOT);
+  if (binding_capacity > 0 && !reusable) {
+    // TODO(#10144): support one-shot indirect command buffers.
     return iree_make_status(IREE_STATUS_UNIMPLEMENTED,
                             "indirect command buffers not yet implemented");
   }
@@ -63,6 +125,11 @@ iree_status_t iree_hal_xrt_lite_direct_command_buffer_create(
       &iree_hal_xrt_lite_direct_command_buffer_vtable, &command_buffer->base);
   command_buffer->host_allocator = host_allocator;
   command_buffer->device = device;
+  command_buffer->pending = new iree_hal_xrt_lite_pending_commands(
+      device->shim_device->get_pdev());
+  command_buffer->recorded =
+      reusable ? new std::vector<iree_hal_xrt_lite_recorded_command>()
+               : nullptr;
   iree_arena_initialize(block_pool, &command_buffer->arena);
   iree_status_t status =
       iree_hal_resource_set_allocate(block_pool, &command_buffer->resource_set);
@@ -86,6 +153,8 @@ static void iree_hal_xrt_lite_direct_command_buffer_destroy(
           base_command_buffer, iree_hal_xrt_lite_direct_command_buffer_vtable,
           iree_hal_xrt_lite_direct_command_buffer);
   iree_allocator_t host_allocator = command_buffer->host_allocator;
+  delete command_buffer->recorded;
+  delete command_buffer->pending;
   iree_hal_resource_set_free(command_buffer->resource_set);
   iree_arena_deinitialize(&command_buffer->arena);
   iree_allocator_free(host_allocator, command_buffer);
@@ -93,42 +162,173 @@ static void iree_hal_xrt_lite_direct_command_buffer_destroy(
   IREE_TRACE_ZONE_END(z0);
 }
 
-static iree_status_t iree_hal_xrt_lite_direct_command_buffer_update_buffer(
-    iree_hal_command_buffer_t* base_command_buffer, const void* source_buffer,
-    iree_host_size_t source_offset, iree_hal_buffer_ref_t target_ref,
-    iree_hal_update_flags_t flags) {
+bool iree_hal_xrt_lite_direct_command_buffer_isa(
+    iree_hal_command_buffer_t* command_buffer) {
+  return iree_hal_resource_is(&command_buffer->resource,
+                              &iree_hal_xrt_lite_direct_command_buffer_vtable);
+}
+
+// Submits all pending kernel runs as one chained command, waits for the chain
+// to complete and marks the buffers written by the runs.
+static iree_status_t iree_hal_xrt_lite_direct_command_buffer_flush(
+    iree_hal_xrt_lite_direct_command_buffer* command_buffer) {
+  iree_hal_xrt_lite_pending_commands* pending = command_buffer->pending;
+  if (pending->chain.empty()) return iree_ok_status();
   IREE_TRACE_ZONE_BEGIN(z0);
 
-  const uint8_t* src =
-      reinterpret_cast<const uint8_t*>(source_buffer) + source_offset;
+  uint32_t error_index = 0;
+  ert_cmd_state state =
+      pending->chain.submit_and_wait(*pending->hwq, &error_index);
+  iree_status_t status = iree_ok_status();
+  if (state != ERT_CMD_STATE_COMPLETED) {
+    status = iree_make_status(IREE_STATUS_INTERNAL,
+                              "chained command %u failed with ERT state %d",
+                              error_index, static_cast<int>(state));
+  } else {
+    for (iree_hal_buffer_t* buffer : pending->written_buffers) {
+      iree_hal_xrt_lite_buffer_mark_device_written(buffer);
+    }
+  }
+  pending->hwq = nullptr;
+  pending->hw_ctx.reset();
+  pending->kernels.clear();
+  pending->written_buffers.clear();
+
+  IREE_TRACE_ZONE_END(z0);
+  return status;
+}
+
+// Drops all pending kernel runs without submitting them.
+static void iree_hal_xrt_lite_direct_command_buffer_discard(
+    iree_hal_xrt_lite_direct_command_buffer* command_buffer) {
+  iree_hal_xrt_lite_pending_commands* pending = command_buffer->pending;
+  pending->chain.clear();
+  pending->hwq = nullptr;
+  pending->hw_ctx.reset();
+  pending->kernels.clear();
+  pending->written_buffers.clear();
+}
+
+// Appends `n_runs` runs of `ebuf` on the queue of `hw_ctx` to the pending
+// chain, submitting the chain first whenever it targets a different queue or is
+// full. `written_buffers` are the allocated buffers the runs write. `ebuf` must
+// stay alive until the chain has been submitted.
+static iree_status_t iree_hal_xrt_lite_direct_command_buffer_enqueue(
+    iree_hal_xrt_lite_direct_command_buffer* command_buffer,
+    const std::shared_ptr<shim_xdna::hw_ctx_cache::entry>& hw_ctx,
+    shim_xdna::kernel& ebuf,
+    const std::vector<iree_hal_buffer_t*>& written_buffers, uint32_t n_runs) {
+  iree_hal_xrt_lite_pending_commands* pending = command_buffer->pending;
+  shim_xdna::hw_q* hwq = hw_ctx->m_ctx->get_hw_queue();
+  for (uint32_t i = 0; i < n_runs; ++i) {
+    if (pending->hwq != hwq || pending->chain.full()) {
+      IREE_RETURN_IF_ERROR(
+          iree_hal_xrt_lite_direct_command_buffer_flush(command_buffer));
+      pending->hwq = hwq;
+      pending->hw_ctx = hw_ctx;
+    }
+    for (iree_hal_buffer_t* buffer : written_buffers) {
+      if (std::find(pending->written_buffers.begin(),
+                    pending->written_buffers.end(),
+                    buffer) == pending->written_buffers.end()) {
+        pending->written_buffers.push_back(buffer);
+      }
+    }
+    pending->chain.add(ebuf.get_exec_buf_bo());
+  }
+  return iree_ok_status();
+}
+
+static iree_status_t iree_hal_xrt_lite_direct_command_buffer_end(
+    iree_hal_command_buffer_t* base_command_buffer) {
+  iree_hal_xrt_lite_direct_command_buffer* command_buffer =
+      IREE_HAL_XRT_LITE_CHECKED_VTABLE_CAST(
+          base_command_buffer, iree_hal_xrt_lite_direct_command_buffer_vtable,
+          iree_hal_xrt_lite_direct_command_buffer);
+  return iree_hal_xrt_lite_direct_command_buffer_flush(command_buffer);
+}
+
+// Keeps the buffers `refs` point at directly alive for the lifetime of the
+// command buffer; buffers referenced through binding table slots are kept
+// alive by the submission.
+static iree_status_t iree_hal_xrt_lite_direct_command_buffer_retain_refs(
+    iree_hal_xrt_lite_direct_command_buffer* command_buffer,
+    const std::vector<iree_hal_buffer_ref_t>& refs) {
+  for (const iree_hal_buffer_ref_t& ref : refs) {
+    if (!ref.buffer) continue;
+    IREE_RETURN_IF_ERROR(iree_hal_resource_set_insert(
+        command_buffer->resource_set, 1, &ref.buffer));
+  }
+  return iree_ok_status();
+}
+
+static shim_xdna::bo* iree_hal_xrt_lite_direct_command_buffer_bo(
+    const iree_hal_buffer_ref_t& ref) {
+  return iree_hal_xrt_lite_buffer_handle(
+      iree_hal_buffer_allocated_buffer(ref.buffer));
+}
+
+// Returns the allocated buffers of the (resolved) `bindings` of a dispatch of
+// `kernel_params` that the dispatch may write; read-only bindings never need
+// to be synced back to the host.
+static std::vector<iree_hal_buffer_t*>
+iree_hal_xrt_lite_direct_command_buffer_written_buffers(
+    const iree_hal_xrt_lite_kernel_params& kernel_params,
+    const iree_hal_buffer_ref_t* bindings, iree_host_size_t binding_count) {
+  std::vector<iree_hal_buffer_t*> written_buffers;
+  for (iree_host_size_t j = 0; j < binding_count; ++j) {
+    if (!iree_hal_xrt_lite_kernel_params_is_binding_written(kernel_params, j)) {
+      continue;
+    }
+    written_buffers.push_back(
+        iree_hal_buffer_allocated_buffer(bindings[j].buffer));
+  }
+  return written_buffers;
+}
+
+static iree_status_t iree_hal_xrt_lite_direct_command_buffer_host_update(
+    iree_hal_xrt_lite_direct_command_buffer* command_buffer,
+    const uint8_t* src, iree_hal_buffer_ref_t target_ref) {
+  // The update happens on the host right away, so previously recorded kernel
+  // runs have to complete first.
+  IREE_RETURN_IF_ERROR(
+      iree_hal_xrt_lite_direct_command_buffer_flush(command_buffer));
+
   // No need to Allocate scratch space (in an arena) as the memcpy
-  // used below is expected to be synchronized.
-  shim_xdna::bo* target_device_buffer = iree_hal_xrt_lite_buffer_handle(
+  // used below is expected to be synchronized. Pending device writes to the
+  // target have to land first or a later sync would clobber the update.
+  iree_hal_xrt_lite_buffer_sync_device_writes(
       iree_hal_buffer_allocated_buffer(target_ref.buffer));
+  shim_xdna::bo* target_device_buffer =
+      iree_hal_xrt_lite_direct_command_buffer_bo(target_ref);
   void* target_device_buffer_ptr = target_device_buffer->map();
   uint8_t* dst = reinterpret_cast<uint8_t*>(target_device_buffer_ptr) +
                  iree_hal_buffer_byte_offset(target_ref.buffer) +
                  target_ref.offset;
   memcpy(dst, src, target_ref.length);
-
-  IREE_TRACE_ZONE_END(z0);
   return iree_ok_status();
 }
 
-static iree_status_t iree_hal_xrt_lite_direct_command_buffer_copy_buffer(
-    iree_hal_command_buffer_t* base_command_buffer,
-    iree_hal_buffer_ref_t source_ref, iree_hal_buffer_ref_t target_ref,
-    iree_hal_copy_flags_t flags) {
-  IREE_TRACE_ZONE_BEGIN(z0);
-
-  shim_xdna::bo* target_device_buffer = iree_hal_xrt_lite_buffer_handle(
+static iree_status_t iree_hal_xrt_lite_direct_command_buffer_host_copy(
+    iree_hal_xrt_lite_direct_command_buffer* command_buffer,
+    iree_hal_buffer_ref_t source_ref, iree_hal_buffer_ref_t target_ref) {
+  // The copy happens on the host right away, so previously recorded kernel
+  // runs have to complete first.
+  IREE_RETURN_IF_ERROR(
+      iree_hal_xrt_lite_direct_command_buffer_flush(command_buffer));
+  iree_hal_xrt_lite_buffer_sync_device_writes(
+      iree_hal_buffer_allocated_buffer(source_ref.buffer));
+  iree_hal_xrt_lite_buffer_sync_device_writes(
       iree_hal_buffer_allocated_buffer(target_ref.buffer));
+
+  shim_xdna::bo* target_device_buffer =
+      iree_hal_xrt_lite_direct_command_buffer_bo(target_ref);
   void* target_device_buffer_ptr = target_device_buffer->map();
   iree_device_size_t target_offset =
       iree_hal_buffer_byte_offset(target_ref.buffer) + target_ref.offset;
 
-  shim_xdna::bo* source_device_buffer = iree_hal_xrt_lite_buffer_handle(
-      iree_hal_buffer_allocated_buffer(source_ref.buffer));
+  shim_xdna::bo* source_device_buffer =
+      iree_hal_xrt_lite_direct_command_buffer_bo(source_ref);
   void* source_device_buffer_ptr = source_device_buffer->map();
   iree_device_size_t source_offset =
       iree_hal_buffer_byte_offset(source_ref.buffer) + source_ref.offset;
@@ -138,103 +338,215 @@ static iree_status_t iree_hal_xrt_lite_direct_command_buffer_copy_buffer(
   uint8_t* src =
       reinterpret_cast<uint8_t*>(source_device_buffer_ptr) + source_offset;
   memcpy(dst, src, target_ref.length);
+  return iree_ok_status();
+}
+
+static iree_status_t iree_hal_xrt_lite_direct_command_buffer_update_buffer(
+    iree_hal_command_buffer_t* base_command_buffer, const void* source_buffer,
+    iree_host_size_t source_offset, iree_hal_buffer_ref_t target_ref,
+    iree_hal_update_flags_t flags) {
+  IREE_TRACE_ZONE_BEGIN(z0);
+
+  iree_hal_xrt_lite_direct_command_buffer* command_buffer =
+      IREE_HAL_XRT_LITE_CHECKED_VTABLE_CAST(
+          base_command_buffer, iree_hal_xrt_lite_direct_command_buffer_vtable,
+          iree_hal_xrt_lite_direct_command_buffer);
+  const uint8_t* src =
+      reinterpret_cast<const uint8_t*>(source_buffer) + source_offset;
+  if (!command_buffer->recorded) {
+    IREE_RETURN_AND_END_ZONE_IF_ERROR(
+        z0, iree_hal_xrt_lite_direct_command_buffer_host_update(
+                command_buffer, src, target_ref));
+    IREE_TRACE_ZONE_END(z0);
+    return iree_ok_status();
+  }
+
+  // The source data only has to live until this call returns, so replays use
+  // a copy of it.
+  iree_hal_xrt_lite_recorded_command command;
+  command.type = iree_hal_xrt_lite_recorded_command::kind::update_buffer;
+  command.refs = {target_ref};
+  uint8_t* source_data = nullptr;
+  IREE_RETURN_AND_END_ZONE_IF_ERROR(
+      z0, iree_arena_allocate(&command_buffer->arena, target_ref.length,
+                              reinterpret_cast<void**>(&source_data)));
+  memcpy(source_data, src, target_ref.length);
+  command.source_data = source_data;
+  IREE_RETURN_AND_END_ZONE_IF_ERROR(
+      z0, iree_hal_xrt_lite_direct_command_buffer_retain_refs(command_buffer,
+                                                               command.refs));
+  command_buffer->recorded->push_back(std::move(command));
 
   IREE_TRACE_ZONE_END(z0);
   return iree_ok_status();
 }
 
-static iree_status_t iree_hal_xrt_lite_direct_command_buffer_normal_run(
-    iree_hal_buffer_ref_list_t& bindings,
-    iree_hal_xrt_lite_direct_command_buffer* command_buffer,
-    shim_xdna::hw_q* hwq, shim_xdna::cuidx_t cu_idx, uint32_t n_kernel_runs,
-    std::vector<uint32_t>& asm_inst) {
+static iree_status_t iree_hal_xrt_lite_direct_command_buffer_copy_buffer(
+    iree_hal_command_buffer_t* base_command_buffer,
+    iree_hal_buffer_ref_t source_ref, iree_hal_buffer_ref_t target_ref,
+    iree_hal_copy_flags_t flags) {
   IREE_TRACE_ZONE_BEGIN(z0);
 
-  // Check if the kernel should be executed.
-  if (n_kernel_runs == 0) {
+  iree_hal_xrt_lite_direct_command_buffer* command_buffer =
+      IREE_HAL_XRT_LITE_CHECKED_VTABLE_CAST(
+          base_command_buffer, iree_hal_xrt_lite_direct_command_buffer_vtable,
+          iree_hal_xrt_lite_direct_command_buffer);
+  if (!command_buffer->recorded) {
+    IREE_RETURN_AND_END_ZONE_IF_ERROR(
+        z0, iree_hal_xrt_lite_direct_command_buffer_host_copy(
+                command_buffer, source_ref, target_ref));
     IREE_TRACE_ZONE_END(z0);
     return iree_ok_status();
   }
 
-  // Allocate a buffer object to hold the control code (`asm_inst`).
-  size_t ctrl_code_size = asm_inst.size() * sizeof(uint32_t);
-  auto bo_ctrl_code = command_buffer->device->shim_device->alloc_bo(
-      ctrl_code_size, XCL_BO_FLAGS_CACHEABLE);
-  uint32_t* instr_buffer = static_cast<uint32_t*>(bo_ctrl_code->map());
-  memcpy(instr_buffer, asm_inst.data(), ctrl_code_size);
-  bo_ctrl_code->sync(shim_xdna::direction::host2device);
+  iree_hal_xrt_lite_recorded_command command;
+  command.type = iree_hal_xrt_lite_recorded_command::kind::copy_buffer;
+  command.refs = {source_ref, target_ref};
+  IREE_RETURN_AND_END_ZONE_IF_ERROR(
+      z0, iree_hal_xrt_lite_direct_command_buffer_retain_refs(command_buffer,
+                                                               command.refs));
+  command_buffer->recorded->push_back(std::move(command));
 
-  shim_xdna::kernel ebuf(command_buffer->device->shim_device->get_pdev(),
-                         ERT_START_CU);
+  IREE_TRACE_ZONE_END(z0);
+  return iree_ok_status();
+}
+
+// Builds an exec buf running `bo_ctrl_code` with `args` as its arguments after
+// the control code size. Null `args` are left unbound, to be bound with
+// `shim_xdna::kernel::set_arg_bo` before the exec buf is submitted.
+static std::unique_ptr<shim_xdna::kernel>
+iree_hal_xrt_lite_direct_command_buffer_make_ebuf(
+    iree_hal_xrt_lite_direct_command_buffer* command_buffer,
+    shim_xdna::bo* bo_ctrl_code, size_t n_ctrl_code_words,
+    const std::vector<shim_xdna::bo*>& args) {
+  auto ebuf = std::make_unique<shim_xdna::kernel>(
+      command_buffer->device->shim_device->get_pdev(), ERT_START_CU);
   // Add the kernel arguments.
-  ebuf.set_cu_idx(cu_idx);
   unsigned int opcode = 3;
-  ebuf.add_arg_64(opcode);
-  ebuf.add_arg_bo(*bo_ctrl_code);
-  ebuf.add_arg_32(asm_inst.size());
-  for (iree_host_size_t j = 0; j < bindings.count; ++j) {
-    shim_xdna::bo* bo = iree_hal_xrt_lite_buffer_handle(
-        iree_hal_buffer_allocated_buffer(bindings.values[j].buffer));
-    ebuf.add_arg_bo(*bo);
-  }
-  // Repeat the kernel execution `n_kernel_runs` times.
-  for (int i = 0; i < n_kernel_runs; i++) {
-    ebuf.m_cmd_pkt->state = ERT_CMD_STATE_NEW;
-    hwq->issue_command(ebuf.get_exec_buf_bo());
-    hwq->wait_command(ebuf.get_exec_buf_bo(), 0);
-  }
-  // Sync the bindings back to the host.
-  for (iree_host_size_t j = 0; j < bindings.count; ++j) {
-    shim_xdna::bo* bo = iree_hal_xrt_lite_buffer_handle(
-        iree_hal_buffer_allocated_buffer(bindings.values[j].buffer));
-    // TODO(max): this should be happening automatically via a call to some
-    // buffer API that performs the sync (maybe invalidate_range)
-    bo->sync(shim_xdna::direction::device2host);
+  ebuf->add_arg_64(opcode);
+  ebuf->add_arg_bo(*bo_ctrl_code);
+  ebuf->add_arg_32(n_ctrl_code_words);
+  for (shim_xdna::bo* bo : args) {
+    if (bo) {
+      ebuf->add_arg_bo(*bo);
+    } else {
+      ebuf->add_arg_64(0);
+    }
   }
+  return ebuf;
+}
 
-  IREE_TRACE_ZONE_END(z0);
+static iree_status_t iree_hal_xrt_lite_direct_command_buffer_normal_run(
+    const std::vector<shim_xdna::bo*>& bindings,
+    iree_hal_xrt_lite_direct_command_buffer* command_buffer,
+    uint32_t n_kernel_runs, const std::vector<uint32_t>& asm_inst,
+    shim_xdna::bo* bo_ctrl_code,
+    std::vector<iree_hal_xrt_lite_kernel_run>& runs) {
+  // Check if the kernel should be executed.
+  if (n_kernel_runs == 0) return iree_ok_status();
+  if (!bo_ctrl_code) {
+    return iree_make_status(IREE_STATUS_FAILED_PRECONDITION,
+                            "kernel dispatch without control code");
+  }
+  // Repeat the kernel execution `n_kernel_runs` times. The bindings are synced
+  // back to the host once the pending chain has been submitted.
+  runs.push_back({iree_hal_xrt_lite_direct_command_buffer_make_ebuf(
+                      command_buffer, bo_ctrl_code, asm_inst.size(), bindings),
+                  n_kernel_runs, /*has_bindings=*/true});
   return iree_ok_status();
 }
 
 static iree_status_t iree_hal_xrt_lite_direct_command_buffer_reconfigure(
     iree_hal_xrt_lite_direct_command_buffer* command_buffer,
-    shim_xdna::hw_q* hwq, shim_xdna::cuidx_t cu_idx,
-    uint32_t n_reconfigure_runs, std::vector<uint32_t>& ctrlpkt_inst,
-    std::vector<uint32_t>& ctrlpkt_seq) {
-  IREE_TRACE_ZONE_BEGIN(z0);
-  // Allocate a buffer object to hold the control packet instructions.
-  size_t ctrlpkt_inst_size = ctrlpkt_inst.size() * sizeof(uint32_t);
-  auto bo_ctrlpkt_inst = command_buffer->device->shim_device->alloc_bo(
-      ctrlpkt_inst_size, XCL_BO_FLAGS_CACHEABLE);
-  uint32_t* ctrlpkt_inst_buffer =
-      static_cast<uint32_t*>(bo_ctrlpkt_inst->map());
-  memcpy(ctrlpkt_inst_buffer, ctrlpkt_inst.data(), ctrlpkt_inst_size);
-  bo_ctrlpkt_inst->sync(shim_xdna::direction::host2device);
-  // Allocate a buffer object to hold the control packet sequence (content).
-  size_t ctrlpkt_seq_size = ctrlpkt_seq.size() * sizeof(uint32_t);
-  auto bo_ctrlpkt_seq = command_buffer->device->shim_device->alloc_bo(
-      ctrlpkt_seq_size, XRT_BO_FLAGS_HOST_ONLY);
-  uint32_t* ctrlpkt_seq_buffer = static_cast<uint32_t*>(bo_ctrlpkt_seq->map());
-  memcpy(ctrlpkt_seq_buffer, ctrlpkt_seq.data(), ctrlpkt_seq_size);
-  bo_ctrlpkt_seq->sync(shim_xdna::direction::host2device);
-
-  shim_xdna::kernel ebuf(command_buffer->device->shim_device->get_pdev(),
-                         ERT_START_CU);
-  // Add the kernel arguments.
-  ebuf.set_cu_idx(cu_idx);
-  unsigned int opcode = 3;
-  ebuf.add_arg_64(opcode);
-  ebuf.add_arg_bo(*bo_ctrlpkt_inst);
-  ebuf.add_arg_32(ctrlpkt_inst.size());
-  ebuf.add_arg_bo(*bo_ctrlpkt_seq);
+    uint32_t n_reconfigure_runs, const std::vector<uint32_t>& ctrlpkt_inst,
+    shim_xdna::bo* bo_ctrlpkt_inst, shim_xdna::bo* bo_ctrlpkt_seq,
+    std::vector<iree_hal_xrt_lite_kernel_run>& runs) {
+  if (!bo_ctrlpkt_inst || !bo_ctrlpkt_seq) {
+    return iree_make_status(IREE_STATUS_FAILED_PRECONDITION,
+                            "reconfiguration without control packets");
+  }
   // Execute the reconfiguration for `n_reconfigure_runs` times.
-  for (int i = 0; i < n_reconfigure_runs; ++i) {
-    ebuf.m_cmd_pkt->state = ERT_CMD_STATE_NEW;
-    hwq->issue_command(ebuf.get_exec_buf_bo());
-    hwq->wait_command(ebuf.get_exec_buf_bo(), 0);
+  runs.push_back({iree_hal_xrt_lite_direct_command_buffer_make_ebuf(
+                      command_buffer, bo_ctrlpkt_inst, ctrlpkt_inst.size(),
+                      {bo_ctrlpkt_seq}),
+                  n_reconfigure_runs, /*has_bindings=*/false});
+  return iree_ok_status();
+}
+
+// Builds the exec bufs of a dispatch of `kernel_params` with `bindings` (which
+// may be null to leave them unbound) in the order they have to be issued.
+static iree_status_t iree_hal_xrt_lite_direct_command_buffer_build_runs(
+    iree_hal_xrt_lite_direct_command_buffer* command_buffer,
+    const iree_hal_xrt_lite_kernel_params& kernel_params,
+    const std::vector<shim_xdna::bo*>& bindings,
+    std::vector<iree_hal_xrt_lite_kernel_run>& runs) {
+  size_t num_reconfigurations = kernel_params.reconf_data_runlist.size();
+  if (num_reconfigurations == 0) {
+    // Normal kernel dispatch.
+    return iree_hal_xrt_lite_direct_command_buffer_normal_run(
+        bindings, command_buffer, kernel_params.n_kernel_runs,
+        kernel_params.asm_inst_runlist[0], kernel_params.asm_inst_bos[0].get(),
+        runs);
+  }
+  for (size_t i = 0; i < num_reconfigurations; i++) {
+    // Reconfigure the device.
+    IREE_RETURN_IF_ERROR(iree_hal_xrt_lite_direct_command_buffer_reconfigure(
+        command_buffer, kernel_params.n_reconfigure_runs,
+        kernel_params.asm_inst_runlist[2 * i],
+        kernel_params.asm_inst_bos[2 * i].get(),
+        kernel_params.reconf_data_bos[i].get(), runs));
+    // Dispatch the new kernel.
+    IREE_RETURN_IF_ERROR(iree_hal_xrt_lite_direct_command_buffer_normal_run(
+        bindings, command_buffer, kernel_params.n_kernel_runs,
+        kernel_params.asm_inst_runlist[2 * i + 1],
+        kernel_params.asm_inst_bos[2 * i + 1].get(), runs));
   }
+  return iree_ok_status();
+}
 
-  IREE_TRACE_ZONE_END(z0);
+// Returns the hardware context to run `kernel_params` on, with its queue and
+// the index of the kernel's CU, taking it from the device cache and only
+// loading the PDI on a miss.
+static iree_status_t iree_hal_xrt_lite_direct_command_buffer_prepare_context(
+    iree_hal_xrt_lite_direct_command_buffer* command_buffer,
+    const iree_hal_xrt_lite_kernel_params& kernel_params,
+    std::shared_ptr<shim_xdna::hw_ctx_cache::entry>* out_hw_ctx) {
+  shim_xdna::hw_ctx_cache* cache = command_buffer->device->hw_ctx_cache;
+  // Repeated PDI loads are requested to measure them, so they bypass the
+  // cache.
+  if (kernel_params.n_pdi_loads > 1) {
+    IREE_RETURN_IF_ERROR(
+        iree_hal_xrt_lite_direct_command_buffer_flush(command_buffer));
+    cache->erase(kernel_params.hw_ctx_key);
+  }
+  std::shared_ptr<shim_xdna::hw_ctx_cache::entry> hw_ctx =
+      cache->lookup(kernel_params.hw_ctx_key);
+  if (!hw_ctx) {
+    // Inserting may evict a context. Submitting anything still pending first
+    // releases the pending context, so that an evicted one is destroyed before
+    // the new one is created.
+    IREE_RETURN_IF_ERROR(
+        iree_hal_xrt_lite_direct_command_buffer_flush(command_buffer));
+    hw_ctx = cache->insert(kernel_params.hw_ctx_key, kernel_params.n_pdi_loads);
+  }
+  *out_hw_ctx = std::move(hw_ctx);
+  return iree_ok_status();
+}
+
+// Enqueues `runs` on the queue of `hw_ctx`, with `written_buffers` as the
+// buffers written by the runs that use the bindings.
+static iree_status_t iree_hal_xrt_lite_direct_command_buffer_enqueue_runs(
+    iree_hal_xrt_lite_direct_command_buffer* command_buffer,
+    const std::shared_ptr<shim_xdna::hw_ctx_cache::entry>& hw_ctx,
+    const std::vector<iree_hal_xrt_lite_kernel_run>& runs,
+    const std::vector<iree_hal_buffer_t*>& written_buffers) {
+  static const std::vector<iree_hal_buffer_t*> no_buffers;
+  for (const iree_hal_xrt_lite_kernel_run& run : runs) {
+    run.ebuf->set_cu_idx(hw_ctx->m_cu_idx);
+    IREE_RETURN_IF_ERROR(iree_hal_xrt_lite_direct_command_buffer_enqueue(
+        command_buffer, hw_ctx, *run.ebuf,
+        run.has_bindings ? written_buffers : no_buffers, run.n_runs));
+  }
   return iree_ok_status();
 }
 
@@ -253,63 +565,160 @@ static iree_status_t iree_hal_xrt_lite_direct_command_buffer_dispatch(
   // information from the compiler.
   iree_hal_xrt_lite_executable* executable =
       iree_hal_xrt_lite_executable_cast(base_executable);
-  iree_hal_xrt_lite_kernel_params kernel_params =
+  const iree_hal_xrt_lite_kernel_params& kernel_params =
       executable->entry_points[entry_point];
 
   IREE_RETURN_AND_END_ZONE_IF_ERROR(
       z0, iree_hal_resource_set_insert(command_buffer->resource_set, 1,
                                        &executable));
 
-  size_t num_reconfigurations = kernel_params.reconf_data_runlist.size();
-  // Only create the context when either the context does not exist or no
-  // control packet reconfiguration is present.
-  bool create_context =
-      (executable->context == nullptr || num_reconfigurations == 0);
-  shim_xdna::cuidx_t cu_idx{.index = 0};
-  if (create_context) {
-    for (size_t i = 0; i < kernel_params.n_pdi_loads; i++) {
-      executable->context =
-          command_buffer->device->shim_device->create_hw_context(
-              kernel_params.pdi, kernel_params.kernel_name);
-    };
-    cu_idx = executable->context->open_cu_context(kernel_params.kernel_name);
+  if (command_buffer->recorded) {
+    // Build the exec bufs now and bind the bindings when replaying.
+    iree_hal_xrt_lite_recorded_command command;
+    command.type = iree_hal_xrt_lite_recorded_command::kind::dispatch;
+    command.refs.assign(bindings.values, bindings.values + bindings.count);
+    command.executable = executable;
+    command.entry_point = entry_point;
+    command.bound_bos.assign(bindings.count, nullptr);
+    IREE_RETURN_AND_END_ZONE_IF_ERROR(
+        z0, iree_hal_xrt_lite_direct_command_buffer_retain_refs(command_buffer,
+                                                                 command.refs));
+    IREE_RETURN_AND_END_ZONE_IF_ERROR(
+        z0, iree_hal_xrt_lite_direct_command_buffer_build_runs(
+                command_buffer, kernel_params, command.bound_bos,
+                command.runs));
+    command_buffer->recorded->push_back(std::move(command));
+    IREE_TRACE_ZONE_END(z0);
+    return iree_ok_status();
   }
-  shim_xdna::hw_q* hwq = executable->context->get_hw_queue();
 
-  if (num_reconfigurations == 0) {
-    // Normal kernel dispatch.
-    IREE_RETURN_AND_END_ZONE_IF_ERROR(
-        z0,
-        iree_hal_xrt_lite_direct_command_buffer_normal_run(
-            bindings, command_buffer, hwq, cu_idx, kernel_params.n_kernel_runs,
-            kernel_params.asm_inst_runlist[0]));
-  } else {
-    for (size_t i = 0; i < num_reconfigurations; i++) {
-      // Reconfigure the device.
-      IREE_RETURN_AND_END_ZONE_IF_ERROR(
-          z0, iree_hal_xrt_lite_direct_command_buffer_reconfigure(
-                  command_buffer, hwq, cu_idx, kernel_params.n_reconfigure_runs,
-                  kernel_params.asm_inst_runlist[2 * i],
-                  kernel_params.reconf_data_runlist[i]));
-      // Dispatch the new kernel.
-      IREE_RETURN_AND_END_ZONE_IF_ERROR(
-          z0, iree_hal_xrt_lite_direct_command_buffer_normal_run(
-                  bindings, command_buffer, hwq, cu_idx,
-                  kernel_params.n_kernel_runs,
-                  kernel_params.asm_inst_runlist[2 * i + 1]));
-    }
+  std::vector<shim_xdna::bo*> binding_bos;
+  for (iree_host_size_t j = 0; j < bindings.count; ++j) {
+    binding_bos.push_back(
+        iree_hal_xrt_lite_direct_command_buffer_bo(bindings.values[j]));
+  }
+  std::vector<iree_hal_xrt_lite_kernel_run> runs;
+  IREE_RETURN_AND_END_ZONE_IF_ERROR(
+      z0, iree_hal_xrt_lite_direct_command_buffer_build_runs(
+              command_buffer, kernel_params, binding_bos, runs));
+  std::shared_ptr<shim_xdna::hw_ctx_cache::entry> hw_ctx;
+  IREE_RETURN_AND_END_ZONE_IF_ERROR(
+      z0, iree_hal_xrt_lite_direct_command_buffer_prepare_context(
+              command_buffer, kernel_params, &hw_ctx));
+  IREE_RETURN_AND_END_ZONE_IF_ERROR(
+      z0, iree_hal_xrt_lite_direct_command_buffer_enqueue_runs(
+              command_buffer, hw_ctx, runs,
+              iree_hal_xrt_lite_direct_command_buffer_written_buffers(
+                  kernel_params, bindings.values, bindings.count)));
+  // The exec bufs have to outlive the submission of the pending chain.
+  for (iree_hal_xrt_lite_kernel_run& run : runs) {
+    command_buffer->pending->kernels.push_back(std::move(run.ebuf));
   }
 
   IREE_TRACE_ZONE_END(z0);
   return iree_ok_status();
 }
 
+static iree_status_t iree_hal_xrt_lite_direct_command_buffer_replay_dispatch(
+    iree_hal_xrt_lite_direct_command_buffer* command_buffer,
+    iree_hal_xrt_lite_recorded_command& command,
+    iree_hal_buffer_binding_table_t binding_table) {
+  std::vector<iree_hal_buffer_ref_t> resolved_refs(command.refs.size());
+  std::vector<shim_xdna::bo*> binding_bos;
+  for (size_t j = 0; j < command.refs.size(); ++j) {
+    IREE_RETURN_IF_ERROR(iree_hal_buffer_binding_table_resolve_ref(
+        binding_table, command.refs[j], &resolved_refs[j]));
+    binding_bos.push_back(
+        iree_hal_xrt_lite_direct_command_buffer_bo(resolved_refs[j]));
+  }
+  // Only patch the arguments whose BO changed since the previous replay.
+  for (size_t j = 0; j < binding_bos.size(); ++j) {
+    if (command.bound_bos[j] == binding_bos[j]) continue;
+    for (iree_hal_xrt_lite_kernel_run& run : command.runs) {
+      if (!run.has_bindings) continue;
+      run.ebuf->set_arg_bo(kBindingArgIndex + j, *binding_bos[j]);
+    }
+    command.bound_bos[j] = binding_bos[j];
+  }
+
+  const iree_hal_xrt_lite_kernel_params& kernel_params =
+      command.executable->entry_points[command.entry_point];
+  std::shared_ptr<shim_xdna::hw_ctx_cache::entry> hw_ctx;
+  IREE_RETURN_IF_ERROR(iree_hal_xrt_lite_direct_command_buffer_prepare_context(
+      command_buffer, kernel_params, &hw_ctx));
+  return iree_hal_xrt_lite_direct_command_buffer_enqueue_runs(
+      command_buffer, hw_ctx, command.runs,
+      iree_hal_xrt_lite_direct_command_buffer_written_buffers(
+          kernel_params, resolved_refs.data(), resolved_refs.size()));
+}
+
+iree_status_t iree_hal_xrt_lite_direct_command_buffer_replay(
+    iree_hal_command_buffer_t* base_command_buffer,
+    iree_hal_buffer_binding_table_t binding_table) {
+  IREE_TRACE_ZONE_BEGIN(z0);
+
+  iree_hal_xrt_lite_direct_command_buffer* command_buffer =
+      IREE_HAL_XRT_LITE_CHECKED_VTABLE_CAST(
+          base_command_buffer, iree_hal_xrt_lite_direct_command_buffer_vtable,
+          iree_hal_xrt_lite_direct_command_buffer);
+  if (!command_buffer->recorded) {
+    IREE_TRACE_ZONE_END(z0);
+    return iree_make_status(IREE_STATUS_FAILED_PRECONDITION,
+                            "only reusable command buffers can be replayed");
+  }
+
+  iree_status_t status = iree_ok_status();
+  for (iree_hal_xrt_lite_recorded_command& command :
+       *command_buffer->recorded) {
+    switch (command.type) {
+      case iree_hal_xrt_lite_recorded_command::kind::dispatch:
+        status = iree_hal_xrt_lite_direct_command_buffer_replay_dispatch(
+            command_buffer, command, binding_table);
+        break;
+      case iree_hal_xrt_lite_recorded_command::kind::update_buffer: {
+        iree_hal_buffer_ref_t target_ref;
+        status = iree_hal_buffer_binding_table_resolve_ref(
+            binding_table, command.refs[0], &target_ref);
+        if (iree_status_is_ok(status)) {
+          status = iree_hal_xrt_lite_direct_command_buffer_host_update(
+              command_buffer, command.source_data, target_ref);
+        }
+        break;
+      }
+      case iree_hal_xrt_lite_recorded_command::kind::copy_buffer: {
+        iree_hal_buffer_ref_t source_ref, target_ref;
+        status = iree_hal_buffer_binding_table_resolve_ref(
+            binding_table, command.refs[0], &source_ref);
+        if (iree_status_is_ok(status)) {
+          status = iree_hal_buffer_binding_table_resolve_ref(
+              binding_table, command.refs[1], &target_ref);
+        }
+        if (iree_status_is_ok(status)) {
+          status = iree_hal_xrt_lite_direct_command_buffer_host_copy(
+              command_buffer, source_ref, target_ref);
+        }
+        break;
+      }
+    }
+    if (!iree_status_is_ok(status)) break;
+  }
+  if (iree_status_is_ok(status)) {
+    status = iree_hal_xrt_lite_direct_command_buffer_flush(command_buffer);
+  } else {
+    // Drop whatever is left of the failed replay.
+    iree_hal_xrt_lite_direct_command_buffer_discard(command_buffer);
+  }
+
+  IREE_TRACE_ZONE_END(z0);
+  return status;
+}
+
 namespace {
 const iree_hal_command_buffer_vtable_t
     iree_hal_xrt_lite_direct_command_buffer_vtable = {
         .destroy = iree_hal_xrt_lite_direct_command_buffer_destroy,
         .begin = unimplemented_ok_status,
-        .end = unimplemented_ok_status,
+        .end = iree_hal_xrt_lite_direct_command_buffer_end,
         .execution_barrier = unimplemented_ok_status,
         .update_buffer = iree_hal_xrt_lite_direct_command_buffer_update_buffer,
         .copy_buffer = iree_hal_xrt_lite_direct_command_buffer_copy_buffer,
@@ -21,4 +21,16 @@ iree_status_t iree_hal_xrt_lite_direct_command_buffer_create(
     iree_allocator_t host_allocator,
     iree_hal_command_buffer_t** out_command_buffer);
 
+// Returns true if `command_buffer` is an xrt-lite direct command buffer.
+bool iree_hal_xrt_lite_direct_command_buffer_isa(
+    iree_hal_command_buffer_t* command_buffer);
+
+// Executes the commands recorded by the reusable (not one-shot)
+// `command_buffer` and waits for them to complete. Binding table slots are
+// resolved against `binding_table`; the exec bufs built when recording are
+// reused and only rebound when a binding resolves to a different buffer.
+iree_status_t iree_hal_xrt_lite_direct_command_buffer_replay(
+    iree_hal_command_buffer_t* command_buffer,
+    iree_hal_buffer_binding_table_t binding_table);
+
 #endif  // IREE_AMD_AIE_DRIVER_XRT_LITE_XRT_LITE_COMMAND_BUFFER_H_
@@ -7,7 +7,9 @@
 #include "iree-amd-aie/driver/xrt-lite/executable.h"
 
 #include <cstddef>
+#include <cstring>
 
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/bo.h"
 #include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/device.h"
 #include "iree-amd-aie/driver/xrt-lite/util.h"
 #include "iree-amd-aie/schemas/pdi_executable_def_reader.h"
@@ -229,6 +231,18 @@ iree_amd_aie_hal_xrt_lite_native_executable_flatbuffer_verify(
         entry_point_count, number_reconf_data_runlist);
   }
 
+  iree_amd_aie_hal_xrt_lite_UI32Array1dDef_vec_t binding_flags_vec =
+      iree_amd_aie_hal_xrt_lite_ExecutableDef_binding_flags_get(executable_def);
+  size_t number_binding_flags =
+      iree_amd_aie_hal_xrt_lite_UI32Array1dDef_vec_len(binding_flags_vec);
+  if (number_binding_flags != 0 && number_binding_flags != entry_point_count) {
+    IREE_TRACE_ZONE_END(z0);
+    return iree_make_status(IREE_STATUS_INVALID_ARGUMENT,
+                            "number of entry points (%zu) and number of "
+                            "binding flag lists (%zu) mismatched",
+                            entry_point_count, number_binding_flags);
+  }
+
   flatbuffers_int32_vec_t asm_instr_runlist_indices_vec =
       iree_amd_aie_hal_xrt_lite_ExecutableDef_asm_instr_runlist_indices_get(
           executable_def);
@@ -307,6 +321,19 @@ static iree_status_t iree_amd_aie_hal_xrt_lite_executable_parse_UI32Array2dDef(
   return iree_ok_status();
 }
 
+// Copies `data` into a new BO allocated with `flags` and syncs it to the
+// device.
+static std::unique_ptr<shim_xdna::bo> iree_hal_xrt_lite_executable_upload(
+    shim_xdna::device* shim_device, const std::vector<uint32_t>& data,
+    uint32_t flags) {
+  if (data.empty()) return nullptr;
+  size_t size = data.size() * sizeof(uint32_t);
+  std::unique_ptr<shim_xdna::bo> bo = shim_device->alloc_bo(size, flags);
+  memcpy(bo->map(), data.data(), size);
+  bo->sync(shim_xdna::direction::host2device);
+  return bo;
+}
+
 iree_status_t iree_hal_xrt_lite_native_executable_create(
     shim_xdna::device* shim_device,
     const iree_hal_executable_params_t* executable_params,
@@ -356,6 +383,8 @@ iree_status_t iree_hal_xrt_lite_native_executable_create(
   iree_amd_aie_hal_xrt_lite_UI32Array2dDef_vec_t reconf_data_runlists_vec =
       iree_amd_aie_hal_xrt_lite_ExecutableDef_reconf_data_runlists_get(
           executable_def);
+  iree_amd_aie_hal_xrt_lite_UI32Array1dDef_vec_t binding_flags_vec =
+      iree_amd_aie_hal_xrt_lite_ExecutableDef_binding_flags_get(executable_def);
   iree_host_size_t entry_point_count =
       flatbuffers_string_vec_len(entry_points_vec);
 
@@ -397,15 +426,16 @@ iree_status_t iree_hal_xrt_lite_native_executable_create(
         flatbuffers_int32_vec_at(pdi_indices_vec, entry_ordinal);
 
     // A negative index indicates that no PDI is required for this entry point.
+    std::vector<uint8_t> pdiVector;
     if (pdi_index >= 0) {
       iree_amd_aie_hal_xrt_lite_PdiDef_table_t pdi_def =
           iree_amd_aie_hal_xrt_lite_PdiDef_vec_at(pdis_vec, pdi_index);
       flatbuffers_string_t pdi_fb =
           iree_amd_aie_hal_xrt_lite_PdiDef_pdi_get(pdi_def);
-      std::vector<uint8_t> pdiVector(pdi_fb,
-                                     pdi_fb + flatbuffers_string_len(pdi_fb));
-      params->pdi = pdiVector;
+      pdiVector.assign(pdi_fb, pdi_fb + flatbuffers_string_len(pdi_fb));
     }
+    params->hw_ctx_key = shim_xdna::hw_ctx_cache::make_key(
+        std::move(pdiVector), params->kernel_name);
 
     // Get the asm instructions runlist for the current entry point, and store
     // it in the kernel parameters as a 2D std::vector.
@@ -433,6 +463,29 @@ iree_status_t iree_hal_xrt_lite_native_executable_create(
                   reconf_data_runlist_def, params->reconf_data_runlist));
     }
 
+    // Binding access flags are optional; without them every binding is
+    // treated as written.
+    if (iree_amd_aie_hal_xrt_lite_UI32Array1dDef_vec_len(binding_flags_vec)) {
+      flatbuffers_uint32_vec_t flags_vec =
+          iree_amd_aie_hal_xrt_lite_UI32Array1dDef_data_get(
+              iree_amd_aie_hal_xrt_lite_UI32Array1dDef_vec_at(binding_flags_vec,
+                                                              entry_ordinal));
+      params->binding_flags.assign(
+          flags_vec, flags_vec + flatbuffers_uint32_vec_len(flags_vec));
+    }
+
+    // The control code and control packets never change, so upload them once
+    // here instead of on every dispatch.
+    for (const std::vector<uint32_t>& asm_inst : params->asm_inst_runlist) {
+      params->asm_inst_bos.push_back(iree_hal_xrt_lite_executable_upload(
+          shim_device, asm_inst, XCL_BO_FLAGS_CACHEABLE));
+    }
+    for (const std::vector<uint32_t>& reconf_data :
+         params->reconf_data_runlist) {
+      params->reconf_data_bos.push_back(iree_hal_xrt_lite_executable_upload(
+          shim_device, reconf_data, XRT_BO_FLAGS_HOST_ONLY));
+    }
+
     IREE_TRACE({
       memcpy(string_table_buffer, params->kernel_name.data(),
              params->kernel_name.size());
@@ -474,6 +527,13 @@ static void iree_hal_xrt_lite_native_executable_destroy(
                                             iree_hal_xrt_lite_executable_vtable,
                                             iree_hal_xrt_lite_executable);
   iree_allocator_t host_allocator = executable->host_allocator;
+  // Release the device copies of the control code and control packets.
+  for (iree_host_size_t i = 0; i < executable->entry_point_count; ++i) {
+    executable->entry_points[i].asm_inst_bos.clear();
+    executable->entry_points[i].reconf_data_bos.clear();
+    executable->entry_points[i].binding_flags.clear();
+    executable->entry_points[i].hw_ctx_key.m_pdi.reset();
+  }
   iree_allocator_free(host_allocator, executable);
 
   IREE_TRACE_ZONE_END(z0);
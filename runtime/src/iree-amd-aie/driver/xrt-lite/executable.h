@@ -18,10 +18,20 @@
 #include "iree/hal/api.h"
 
 struct iree_hal_xrt_lite_kernel_params {
-  std::vector<uint8_t> pdi;
+  // The PDI and kernel name, keyed once for the device's context cache.
+  shim_xdna::hw_ctx_cache::key hw_ctx_key;
   std::vector<std::vector<uint32_t>> asm_inst_runlist;
   std::vector<std::vector<uint32_t>> reconf_data_runlist;
+  // Device copies of `asm_inst_runlist` and `reconf_data_runlist`, uploaded
+  // once when the executable is created and reused by every dispatch. Empty
+  // runlist entries have no BO.
+  std::vector<std::unique_ptr<shim_xdna::bo>> asm_inst_bos;
+  std::vector<std::unique_ptr<shim_xdna::bo>> reconf_data_bos;
   std::string kernel_name;
+  // Per-binding access flags (see `binding_flags` in the executable
+  // flatbuffer). Empty when the compiler did not provide any, in which case
+  // every binding is assumed to be written by the kernel.
+  std::vector<uint32_t> binding_flags;
   uint32_t n_kernel_runs{1};
   uint32_t n_reconfigure_runs{1};
   uint32_t n_pdi_loads{1};
@@ -29,6 +39,18 @@ struct iree_hal_xrt_lite_kernel_params {
   IREE_TRACE(uint32_t source_line;)
 };
 
+// Bit set in `iree_hal_xrt_lite_kernel_params::binding_flags` for bindings the
+// kernel only reads.
+#define IREE_HAL_XRT_LITE_BINDING_FLAG_READ_ONLY (1u << 0)
+
+// Returns true if the dispatch may write the binding at `ordinal`.
+static inline bool iree_hal_xrt_lite_kernel_params_is_binding_written(
+    const iree_hal_xrt_lite_kernel_params& params, iree_host_size_t ordinal) {
+  if (ordinal >= params.binding_flags.size()) return true;
+  return !(params.binding_flags[ordinal] &
+           IREE_HAL_XRT_LITE_BINDING_FLAG_READ_ONLY);
+}
+
 struct iree_hal_xrt_lite_executable {
   // Abstract resource used for injecting reference counting and vtable; must be
   // at offset 0.
@@ -36,7 +58,6 @@ struct iree_hal_xrt_lite_executable {
   iree_allocator_t host_allocator;
   iree_host_size_t entry_point_count;
   iree_hal_xrt_lite_kernel_params entry_points[16];
-  std::unique_ptr<shim_xdna::hw_ctx> context;
 };
 
 // `out_executable` must be released by the caller (see
@@ -16,6 +16,9 @@ IREE_FLAG(int32_t, xrt_lite_n_core_cols, 0,
           "Number of core cols to use on NPU.");
 // see shim/linux/kmq/amdxdna_accel.h#L460 for options
 IREE_FLAG(string, xrt_lite_power_mode, "", "Set the power mode of the NPU.");
+IREE_FLAG(int32_t, xrt_lite_hw_ctx_cache_capacity, 4,
+          "Number of hardware contexts (i.e., loaded PDIs) to keep around for "
+          "reuse by later dispatches.");
 
 static const iree_string_view_t key_xrt_lite_n_core_rows =
     iree_string_view_literal("xrt_lite_n_core_rows");
@@ -23,6 +26,8 @@ static const iree_string_view_t key_xrt_lite_n_core_cols =
     iree_string_view_literal("xrt_lite_n_core_cols");
 static const iree_string_view_t key_xrt_lite_power_mode =
     iree_string_view_literal("xrt_lite_power_mode");
+static const iree_string_view_t key_xrt_lite_hw_ctx_cache_capacity =
+    iree_string_view_literal("xrt_lite_hw_ctx_cache_capacity");
 
 static iree_status_t iree_hal_xrt_lite_driver_factory_enumerate(
     void* self, iree_host_size_t* out_driver_info_count,
@@ -50,6 +55,10 @@ static iree_status_t iree_hal_xrt_lite_driver_parse_flags(
   IREE_RETURN_AND_END_ZONE_IF_ERROR(
       z0, iree_string_pair_builder_add_int32(builder, key_xrt_lite_n_core_cols,
                                              FLAG_xrt_lite_n_core_cols));
+  IREE_RETURN_AND_END_ZONE_IF_ERROR(
+      z0, iree_string_pair_builder_add_int32(
+              builder, key_xrt_lite_hw_ctx_cache_capacity,
+              FLAG_xrt_lite_hw_ctx_cache_capacity));
   iree_string_view_t power_mode = IREE_SV(FLAG_xrt_lite_power_mode);
   if (!iree_string_view_is_empty(power_mode)) {
     IREE_RETURN_AND_END_ZONE_IF_ERROR(
@@ -120,6 +129,23 @@ static iree_status_t iree_hal_xrt_lite_driver_populate_options(
             (int)value.size, value.data);
       }
       device_params->power_mode = value;
+    } else if (iree_string_view_equal(key,
+                                      key_xrt_lite_hw_ctx_cache_capacity)) {
+      if (!iree_string_view_atoi_int32(value, &ivalue)) {
+        IREE_TRACE_ZONE_END(z0);
+        return iree_make_status(IREE_STATUS_FAILED_PRECONDITION,
+                                "Option 'xrt_lite_hw_ctx_cache_capacity' "
+                                "expected to be int. Got: '%.*s'",
+                                (int)value.size, value.data);
+      }
+      if (ivalue <= 0) {
+        IREE_TRACE_ZONE_END(z0);
+        return iree_make_status(IREE_STATUS_FAILED_PRECONDITION,
+                                "Option 'xrt_lite_hw_ctx_cache_capacity' "
+                                "expected to be > 0. Got: '%.*s'",
+                                (int)value.size, value.data);
+      }
+      device_params->hw_ctx_cache_capacity = ivalue;
     } else {
       IREE_TRACE_ZONE_END(z0);
       return iree_make_status(IREE_STATUS_INVALID_ARGUMENT,
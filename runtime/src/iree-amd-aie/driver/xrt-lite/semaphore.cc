@@ -0,0 +1,175 @@
+// Copyright 2024 The IREE Authors
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "iree-amd-aie/driver/xrt-lite/semaphore.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <mutex>
+
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/fence.h"
+#include "iree/base/api.h"
+#include "iree/hal/utils/semaphore_base.h"
+#include "util.h"
+
+namespace {
+extern const iree_hal_semaphore_vtable_t iree_hal_xrt_lite_semaphore_vtable;
+}  // namespace
+
+struct iree_hal_xrt_lite_semaphore {
+  iree_hal_semaphore_t base;
+  iree_allocator_t host_allocator;
+  // The payload value lives in the timeline of the syncobj.
+  shim_xdna::timeline_syncobj syncobj;
+  // Guards `failure_status` and signaling `syncobj`.
+  std::mutex mutex;
+  // Set once the semaphore has failed; waits and queries return a clone.
+  iree_status_t failure_status;
+
+  iree_hal_xrt_lite_semaphore(shim_xdna::device* shim_device,
+                              uint64_t initial_value,
+                              iree_allocator_t host_allocator)
+      : host_allocator(host_allocator),
+        syncobj(*shim_device),
+        failure_status(iree_ok_status()) {
+    iree_hal_semaphore_initialize(&iree_hal_xrt_lite_semaphore_vtable, &base);
+    if (initial_value > 0) syncobj.signal(initial_value);
+  }
+};
+
+static iree_hal_xrt_lite_semaphore* iree_hal_xrt_lite_semaphore_cast(
+    iree_hal_semaphore_t* base_semaphore) {
+  return IREE_HAL_XRT_LITE_CHECKED_VTABLE_CAST(
+      base_semaphore, iree_hal_xrt_lite_semaphore_vtable,
+      iree_hal_xrt_lite_semaphore);
+}
+
+// Returns a clone of the failure status, or OK if the semaphore has not
+// failed.
+static iree_status_t iree_hal_xrt_lite_semaphore_failure(
+    iree_hal_xrt_lite_semaphore* semaphore) {
+  std::lock_guard<std::mutex> guard(semaphore->mutex);
+  return iree_status_clone(semaphore->failure_status);
+}
+
+iree_status_t iree_hal_xrt_lite_semaphore_create(
+    shim_xdna::device* shim_device, iree_allocator_t host_allocator,
+    uint64_t initial_value, iree_hal_semaphore_t** out_semaphore) {
+  IREE_ASSERT_ARGUMENT(shim_device);
+  IREE_ASSERT_ARGUMENT(out_semaphore);
+  IREE_TRACE_ZONE_BEGIN(z0);
+
+  iree_hal_xrt_lite_semaphore* semaphore = nullptr;
+  IREE_RETURN_AND_END_ZONE_IF_ERROR(
+      z0, iree_allocator_malloc(host_allocator, sizeof(*semaphore),
+                                reinterpret_cast<void**>(&semaphore)));
+  semaphore = new (semaphore)
+      iree_hal_xrt_lite_semaphore(shim_device, initial_value, host_allocator);
+  *out_semaphore = &semaphore->base;
+
+  IREE_TRACE_ZONE_END(z0);
+  return iree_ok_status();
+}
+
+static void iree_hal_xrt_lite_semaphore_destroy(
+    iree_hal_semaphore_t* base_semaphore) {
+  IREE_TRACE_ZONE_BEGIN(z0);
+
+  iree_hal_xrt_lite_semaphore* semaphore =
+      iree_hal_xrt_lite_semaphore_cast(base_semaphore);
+  iree_allocator_t host_allocator = semaphore->host_allocator;
+  iree_status_ignore(semaphore->failure_status);
+  iree_hal_semaphore_deinitialize(&semaphore->base);
+  semaphore->~iree_hal_xrt_lite_semaphore();
+  iree_allocator_free(host_allocator, semaphore);
+
+  IREE_TRACE_ZONE_END(z0);
+}
+
+static iree_status_t iree_hal_xrt_lite_semaphore_query(
+    iree_hal_semaphore_t* base_semaphore, uint64_t* out_value) {
+  iree_hal_xrt_lite_semaphore* semaphore =
+      iree_hal_xrt_lite_semaphore_cast(base_semaphore);
+  iree_status_t status = iree_hal_xrt_lite_semaphore_failure(semaphore);
+  if (!iree_status_is_ok(status)) {
+    *out_value = IREE_HAL_SEMAPHORE_FAILURE_VALUE;
+    return status;
+  }
+  *out_value = semaphore->syncobj.query();
+  return iree_ok_status();
+}
+
+static iree_status_t iree_hal_xrt_lite_semaphore_signal(
+    iree_hal_semaphore_t* base_semaphore, uint64_t new_value) {
+  iree_hal_xrt_lite_semaphore* semaphore =
+      iree_hal_xrt_lite_semaphore_cast(base_semaphore);
+  {
+    // The check and the signal happen under the lock, so that concurrent
+    // signals and failures can't move the timeline backwards.
+    std::lock_guard<std::mutex> guard(semaphore->mutex);
+    if (!iree_status_is_ok(semaphore->failure_status)) {
+      return iree_status_clone(semaphore->failure_status);
+    }
+    uint64_t current_value = semaphore->syncobj.query();
+    if (new_value <= current_value) {
+      return iree_make_status(IREE_STATUS_OUT_OF_RANGE,
+                              "semaphore values must be monotonically "
+                              "increasing; current_value=%" PRIu64
+                              ", new_value=%" PRIu64,
+                              current_value, new_value);
+    }
+    semaphore->syncobj.signal(new_value);
+  }
+  // Notifies the timepoints that are reached. This queries the semaphore, so it
+  // must happen outside of the lock.
+  iree_hal_semaphore_poll(&semaphore->base);
+  return iree_ok_status();
+}
+
+static void iree_hal_xrt_lite_semaphore_fail(
+    iree_hal_semaphore_t* base_semaphore, iree_status_t status) {
+  iree_hal_xrt_lite_semaphore* semaphore =
+      iree_hal_xrt_lite_semaphore_cast(base_semaphore);
+  {
+    std::lock_guard<std::mutex> guard(semaphore->mutex);
+    // Only the first failure is kept.
+    if (!iree_status_is_ok(semaphore->failure_status)) {
+      iree_status_ignore(status);
+      return;
+    }
+    semaphore->failure_status = status;
+    // Wake up all waiters; they observe the failure once they return.
+    semaphore->syncobj.signal(IREE_HAL_SEMAPHORE_FAILURE_VALUE);
+  }
+  // Notifies all timepoints of the failure.
+  iree_hal_semaphore_poll(&semaphore->base);
+}
+
+static iree_status_t iree_hal_xrt_lite_semaphore_wait(
+    iree_hal_semaphore_t* base_semaphore, uint64_t value,
+    iree_timeout_t timeout) {
+  iree_hal_xrt_lite_semaphore* semaphore =
+      iree_hal_xrt_lite_semaphore_cast(base_semaphore);
+  iree_time_t deadline_ns = iree_timeout_as_deadline_ns(timeout);
+  int64_t timeout_ns = -1;
+  if (deadline_ns != IREE_TIME_INFINITE_FUTURE) {
+    timeout_ns = std::max<int64_t>(deadline_ns - iree_time_now(), 0);
+  }
+  if (!semaphore->syncobj.wait(value, timeout_ns)) {
+    return iree_status_from_code(IREE_STATUS_DEADLINE_EXCEEDED);
+  }
+  return iree_hal_xrt_lite_semaphore_failure(semaphore);
+}
+
+namespace {
+const iree_hal_semaphore_vtable_t iree_hal_xrt_lite_semaphore_vtable = {
+    .destroy = iree_hal_xrt_lite_semaphore_destroy,
+    .query = iree_hal_xrt_lite_semaphore_query,
+    .signal = iree_hal_xrt_lite_semaphore_signal,
+    .fail = iree_hal_xrt_lite_semaphore_fail,
+    .wait = iree_hal_xrt_lite_semaphore_wait,
+};
+}  // namespace
@@ -0,0 +1,23 @@
+// Copyright 2024 The IREE Authors
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#ifndef IREE_AMD_AIE_DRIVER_XRT_LITE_SEMAPHORE_H_
+#define IREE_AMD_AIE_DRIVER_XRT_LITE_SEMAPHORE_H_
+
+#include <cstdint>
+
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/device.h"
+#include "iree/base/api.h"
+#include "iree/hal/api.h"
+
+// Creates a timeline semaphore backed by a DRM timeline syncobj of
+// `shim_device`, so that host waits block in the kernel until the payload is
+// signaled.
+iree_status_t iree_hal_xrt_lite_semaphore_create(
+    shim_xdna::device* shim_device, iree_allocator_t host_allocator,
+    uint64_t initial_value, iree_hal_semaphore_t** out_semaphore);
+
+#endif  // IREE_AMD_AIE_DRIVER_XRT_LITE_SEMAPHORE_H_
@@ -9,6 +9,7 @@
 #include <sys/syscall.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -101,14 +102,32 @@ std::string ioctl_cmd2name(unsigned long cmd) {
 // Device memory heap needs to be within one 64MB page. The maximum size is
 // 64MB.
 const size_t dev_mem_size = (64 << 20);
+
+int libc_open(const char *path, int flags) { return ::open(path, flags); }
+int libc_close(int fd) { return ::close(fd); }
+int libc_ioctl(int fd, unsigned long cmd, void *arg) {
+  return ::ioctl(fd, cmd, arg);
+}
+
+const shim_xdna::pdev_syscalls libc_syscalls = {
+    .open = libc_open,
+    .close = libc_close,
+    .ioctl = libc_ioctl,
+};
+std::atomic<const shim_xdna::pdev_syscalls *> installed_syscalls{
+    &libc_syscalls};
 }  // namespace
 
 namespace shim_xdna {
 
-pdev::pdev() {
+void set_pdev_syscalls(const pdev_syscalls *syscalls) {
+  installed_syscalls = syscalls ? syscalls : &libc_syscalls;
+}
+
+pdev::pdev() : m_syscalls(installed_syscalls) {
   const std::lock_guard<std::mutex> lock(m_lock);
   // TODO(max): hardcoded
-  m_dev_fd = ::open("/dev/accel/accel0", O_RDWR);
+  m_dev_fd = m_syscalls->open("/dev/accel/accel0", O_RDWR);
   if (m_dev_fd < 0) shim_err(EINVAL, "Failed to open KMQ device");
   SHIM_DEBUG("Device opened, fd=%d", m_dev_fd);
   m_dev_heap_bo =
@@ -120,17 +139,21 @@ pdev::~pdev() {
   SHIM_DEBUG("Destroying KMQ pcidev");
   const std::lock_guard<std::mutex> lock(m_lock);
   m_dev_heap_bo.reset();
-  ::close(m_dev_fd);
+  m_syscalls->close(m_dev_fd);
   SHIM_DEBUG("Device closed, fd=%d", m_dev_fd);
   SHIM_DEBUG("Destroyed KMQ pcidev");
 }
 
 void pdev::ioctl(unsigned long cmd, void *arg) const {
-  if (::ioctl(m_dev_fd, cmd, arg) == -1) {
+  if (try_ioctl(cmd, arg) == -1) {
     shim_err(errno, "%s IOCTL failed", ioctl_cmd2name(cmd).c_str());
   }
 }
 
+int pdev::try_ioctl(unsigned long cmd, void *arg) const {
+  return m_syscalls->ioctl(m_dev_fd, cmd, arg);
+}
+
 void *pdev::mmap(void *addr, size_t len, int prot, int flags,
                  off_t offset) const {
   void *ret = ::mmap(addr, len, prot, flags, m_dev_fd, offset);
@@ -274,7 +297,7 @@ void device::set_power_mode(amdxdna_power_mode_type mode) const {
   amdxdna_drm_set_state arg = {.param = DRM_AMDXDNA_SET_POWER_MODE,
                                .buffer_size = sizeof(state),
                                .buffer = reinterpret_cast<uintptr_t>(&state)};
-  if (::ioctl(m_pdev.m_dev_fd, DRM_IOCTL_AMDXDNA_SET_STATE, &arg) == -1) {
+  if (m_pdev.try_ioctl(DRM_IOCTL_AMDXDNA_SET_STATE, &arg) == -1) {
     shim_err(
         errno,
         "DRM_AMDXDNA_SET_POWER_MODE failed; probably you need sudo privileges");
@@ -15,15 +15,31 @@ namespace shim_xdna {
 struct pdev;
 struct bo;
 
+// The system calls a `pdev` issues against the accel device node. Tests install
+// fakes through `set_pdev_syscalls` to drive the shim without an NPU.
+struct pdev_syscalls {
+  int (*open)(const char *path, int flags);
+  int (*close)(int fd);
+  int (*ioctl)(int fd, unsigned long cmd, void *arg);
+};
+
+// Installs `syscalls` for every `pdev` constructed afterwards; `nullptr`
+// restores the libc implementations.
+void set_pdev_syscalls(const pdev_syscalls *syscalls);
+
 struct pdev {
   mutable std::mutex m_lock;
   mutable int m_dev_fd = -1;
   mutable std::unique_ptr<bo> m_dev_heap_bo;
+  const pdev_syscalls *m_syscalls;
 
   pdev();
   ~pdev();
 
   void ioctl(unsigned long cmd, void *arg) const;
+  // Like `ioctl` but returns -1 and leaves `errno` set on failure instead of
+  // throwing.
+  int try_ioctl(unsigned long cmd, void *arg) const;
   void *mmap(void *addr, size_t len, int prot, int flags, off_t offset) const;
 };
 
@@ -5,6 +5,8 @@
 
 #include <unistd.h>
 
+#include <cerrno>
+#include <chrono>
 #include <limits>
 
 #include "hwctx.h"
@@ -77,6 +79,23 @@ void wait_syncobj_done(const shim_xdna::pdev &dev, uint32_t sobj_hdl,
   dev.ioctl(DRM_IOCTL_SYNCOBJ_TIMELINE_WAIT, &wsobj);
 }
 
+// Returns false if `timeout_nsec` (absolute, CLOCK_MONOTONIC) expired first.
+bool wait_syncobj_until(const shim_xdna::pdev &dev, uint32_t sobj_hdl,
+                        uint64_t timepoint, int64_t timeout_nsec) {
+  drm_syncobj_timeline_wait wsobj = {
+      .handles = reinterpret_cast<uintptr_t>(&sobj_hdl),
+      .points = reinterpret_cast<uintptr_t>(&timepoint),
+      .timeout_nsec = timeout_nsec,
+      .count_handles = 1,
+      .flags = DRM_SYNCOBJ_WAIT_FLAGS_WAIT_FOR_SUBMIT,
+  };
+  if (dev.try_ioctl(DRM_IOCTL_SYNCOBJ_TIMELINE_WAIT, &wsobj) == -1) {
+    if (errno == ETIME) return false;
+    shim_xdna::shim_err(errno, "DRM_IOCTL_SYNCOBJ_TIMELINE_WAIT IOCTL failed");
+  }
+  return true;
+}
+
 void wait_syncobj_available(const shim_xdna::pdev &dev,
                             const uint32_t *sobj_hdls,
                             const uint64_t *timepoints, uint32_t num) {
@@ -242,4 +261,37 @@ void fence_handle::submit_wait(
   submit_wait_syncobjs(dev, ctx, hdls, pts, i);
 }
 
+timeline_syncobj::timeline_syncobj(const device &device)
+    : m_pdev(device.get_pdev()), m_syncobj_hdl(create_syncobj(m_pdev)) {
+  SHIM_DEBUG("Timeline syncobj allocated: %d", m_syncobj_hdl);
+}
+
+timeline_syncobj::~timeline_syncobj() {
+  SHIM_DEBUG("Timeline syncobj going away: %d", m_syncobj_hdl);
+  destroy_syncobj(m_pdev, m_syncobj_hdl);
+}
+
+uint64_t timeline_syncobj::query() const {
+  return query_syncobj_timeline(m_pdev, m_syncobj_hdl);
+}
+
+void timeline_syncobj::signal(uint64_t point) const {
+  SHIM_DEBUG("Signaling timeline syncobj %d@%ld", m_syncobj_hdl, point);
+  signal_syncobj(m_pdev, m_syncobj_hdl, point);
+}
+
+bool timeline_syncobj::wait(uint64_t point, int64_t timeout_ns) const {
+  int64_t deadline = std::numeric_limits<int64_t>::max();
+  if (timeout_ns >= 0) {
+    // DRM syncobj timeouts are absolute CLOCK_MONOTONIC times, which is what
+    // `steady_clock` measures on Linux.
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count();
+    if (timeout_ns < deadline - now) deadline = now + timeout_ns;
+  }
+  SHIM_DEBUG("Waiting for timeline syncobj %d@%ld", m_syncobj_hdl, point);
+  return wait_syncobj_until(m_pdev, m_syncobj_hdl, point, deadline);
+}
+
 }  // namespace shim_xdna
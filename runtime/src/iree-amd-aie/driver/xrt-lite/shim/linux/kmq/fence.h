@@ -52,6 +52,27 @@ struct fence_handle {
   uint64_t signal_next_state() const;
 };
 
+// A DRM timeline syncobj addressed by absolute timeline points. Unlike
+// `fence_handle`, which steps its own state on every wait and signal, its
+// points map one to one onto the payload values of a HAL timeline semaphore.
+struct timeline_syncobj {
+  const pdev &m_pdev;
+  uint32_t m_syncobj_hdl;
+
+  timeline_syncobj(const device &device);
+  ~timeline_syncobj();
+  // no copying
+  timeline_syncobj(const timeline_syncobj &) = delete;
+  timeline_syncobj &operator=(const timeline_syncobj &) = delete;
+
+  // Returns the last signaled point.
+  uint64_t query() const;
+  void signal(uint64_t point) const;
+  // Blocks until `point` has been signaled or `timeout_ns` nanoseconds have
+  // passed; a negative timeout waits forever. Returns false on timeout.
+  bool wait(uint64_t point, int64_t timeout_ns) const;
+};
+
 }  // namespace shim_xdna
 
 #endif  // _FENCE_XDNA_H_
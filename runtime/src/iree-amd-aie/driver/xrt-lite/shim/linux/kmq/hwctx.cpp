@@ -3,8 +3,10 @@
 
 #include "hwctx.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <string_view>
 
 #include "amdxdna_accel.h"
 #include "bo.h"
@@ -188,4 +190,80 @@ void hw_ctx::set_metadata(int num_cols, size_t size, uint64_t bo_paddr,
   }
 }
 
+namespace {
+bool same_kernel(const hw_ctx_cache::key &lhs, const hw_ctx_cache::key &rhs) {
+  // Keys made from the same PDI, e.g. by the same executable, share it.
+  return lhs.m_pdi_hash == rhs.m_pdi_hash &&
+         lhs.m_kernel_name == rhs.m_kernel_name &&
+         (lhs.m_pdi == rhs.m_pdi || *lhs.m_pdi == *rhs.m_pdi);
+}
+}  // namespace
+
+hw_ctx_cache::hw_ctx_cache(device &dev, size_t capacity)
+    : m_device(dev), m_capacity(std::max<size_t>(capacity, 1)) {}
+
+hw_ctx_cache::key hw_ctx_cache::make_key(std::vector<uint8_t> pdi,
+                                         std::string kernel_name) {
+  size_t pdi_hash = std::hash<std::string_view>{}(std::string_view(
+      reinterpret_cast<const char *>(pdi.data()), pdi.size()));
+  return {.m_pdi_hash = pdi_hash,
+          .m_pdi = std::make_shared<const std::vector<uint8_t>>(std::move(pdi)),
+          .m_kernel_name = std::move(kernel_name)};
+}
+
+std::shared_ptr<hw_ctx_cache::entry> hw_ctx_cache::lookup(const key &k) {
+  std::lock_guard<std::mutex> guard(m_mutex);
+  for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+    if (!same_kernel((*it)->m_key, k)) continue;
+    m_hits++;
+    m_entries.splice(m_entries.begin(), m_entries, it);
+    return m_entries.front();
+  }
+  m_misses++;
+  return nullptr;
+}
+
+std::shared_ptr<hw_ctx_cache::entry> hw_ctx_cache::insert(const key &k,
+                                                          uint32_t n_loads) {
+  erase(k);
+  std::lock_guard<std::mutex> guard(m_mutex);
+  // Make room first, the device only has so many contexts to hand out.
+  while (m_entries.size() >= m_capacity) {
+    SHIM_DEBUG("Evicting HW context for %s",
+               m_entries.back()->m_key.m_kernel_name.c_str());
+    m_entries.pop_back();
+  }
+  std::unique_ptr<hw_ctx> ctx;
+  for (uint32_t i = 0; i < std::max<uint32_t>(n_loads, 1); i++) {
+    ctx.reset();
+    ctx = m_device.create_hw_context(*k.m_pdi, k.m_kernel_name);
+  }
+  cuidx_t cu_idx = ctx->open_cu_context(k.m_kernel_name);
+  m_entries.push_front(std::make_shared<entry>(
+      entry{.m_key = k, .m_ctx = std::move(ctx), .m_cu_idx = cu_idx}));
+  return m_entries.front();
+}
+
+void hw_ctx_cache::erase(const key &k) {
+  std::lock_guard<std::mutex> guard(m_mutex);
+  m_entries.remove_if([&](const std::shared_ptr<entry> &e) {
+    return same_kernel(e->m_key, k);
+  });
+}
+
+size_t hw_ctx_cache::size() const {
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_entries.size();
+}
+
+size_t hw_ctx_cache::hits() const {
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_hits;
+}
+
+size_t hw_ctx_cache::misses() const {
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_misses;
+}
+
 }  // namespace shim_xdna
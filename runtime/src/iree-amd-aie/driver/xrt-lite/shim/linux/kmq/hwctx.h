@@ -4,7 +4,12 @@
 #ifndef _HWCTX_XDNA_H_
 #define _HWCTX_XDNA_H_
 
+#include <list>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #include "device.h"
 
@@ -90,6 +95,57 @@ struct hw_ctx {
   void set_metadata(int num_cols, size_t size, uint64_t bo_paddr, uint8_t flag);
 };
 
+// A least recently used cache of hardware contexts keyed by PDI and kernel
+// name, so that dispatches alternating between a few kernels don't reload
+// their PDIs every time. The CU context of the kernel is opened once, when its
+// hardware context is created. All members are guarded by a mutex, so that the
+// statistics can be read while another thread dispatches. Entries are shared
+// with the callers of `lookup` and `insert`, so an evicted or erased context
+// is only destroyed once no caller holds it anymore.
+struct hw_ctx_cache {
+  // Identifies the cached context of a kernel. Keys are made once per kernel,
+  // so that looking up a context neither hashes nor compares the PDI bytes.
+  struct key {
+    size_t m_pdi_hash;
+    std::shared_ptr<const std::vector<uint8_t>> m_pdi;
+    std::string m_kernel_name;
+  };
+
+  struct entry {
+    key m_key;
+    std::unique_ptr<hw_ctx> m_ctx;
+    cuidx_t m_cu_idx;
+  };
+
+  device &m_device;
+  size_t m_capacity;
+  mutable std::mutex m_mutex;
+  // Most recently used first.
+  std::list<std::shared_ptr<entry>> m_entries;
+  size_t m_hits = 0;
+  size_t m_misses = 0;
+
+  // `capacity` is clamped to at least one context.
+  hw_ctx_cache(device &dev, size_t capacity);
+
+  static key make_key(std::vector<uint8_t> pdi, std::string kernel_name);
+
+  // Returns the cached context for `k` and marks it as the most recently used
+  // one, or nullptr if there is none.
+  std::shared_ptr<entry> lookup(const key &k);
+  // Creates the context for `k`, loading the PDI `n_loads` times, and caches
+  // it. Evicts the least recently used context when the cache is full; as the
+  // device only has so many contexts, callers should release the contexts they
+  // hold before inserting.
+  std::shared_ptr<entry> insert(const key &k, uint32_t n_loads = 1);
+  // Destroys the cached context for `k`, if any.
+  void erase(const key &k);
+
+  size_t size() const;
+  size_t hits() const;
+  size_t misses() const;
+};
+
 }  // namespace shim_xdna
 
 #endif  // _HWCTX_XDNA_H_
@@ -5,11 +5,15 @@
 
 #include <sys/ioctl.h>
 
+#include <cstring>
+
 #include "bo.h"
 #include "ert.h"
 #include "fence.h"
 #include "shim_debug.h"
 
+#define MAX_CHAIN_BO_SIZE 4096
+
 namespace {
 
 uint64_t abs_now_ns() {
@@ -45,7 +49,7 @@ int wait_cmd(const shim_xdna::pdev &pdev, const shim_xdna::hw_ctx *ctx,
         .count_handles = 1,
         .flags = 0,
     };
-    if (::ioctl(pdev.m_dev_fd, DRM_IOCTL_SYNCOBJ_TIMELINE_WAIT, &wsobj) == -1) {
+    if (pdev.try_ioctl(DRM_IOCTL_SYNCOBJ_TIMELINE_WAIT, &wsobj) == -1) {
       if (errno == ETIME) {
         ret = 0;
       } else {
@@ -59,7 +63,7 @@ int wait_cmd(const shim_xdna::pdev &pdev, const shim_xdna::hw_ctx *ctx,
         .timeout = timeout_ms,
         .seq = id,
     };
-    if (::ioctl(pdev.m_dev_fd, DRM_IOCTL_AMDXDNA_WAIT_CMD, &wcmd) == -1) {
+    if (pdev.try_ioctl(DRM_IOCTL_AMDXDNA_WAIT_CMD, &wcmd) == -1) {
       if (errno == ETIME) {
         ret = 0;
       } else {
@@ -137,4 +141,51 @@ int poll_command(bo *cmd) {
   return 0;
 }
 
+cmd_chain::cmd_chain(const pdev &p)
+    : m_chain_bo(std::make_unique<bo>(p, AMDXDNA_INVALID_CTX_HANDLE,
+                                      MAX_CHAIN_BO_SIZE,
+                                      XCL_BO_FLAGS_EXECBUF)) {}
+
+bool cmd_chain::empty() const { return m_cmds.empty(); }
+
+bool cmd_chain::full() const { return m_cmds.size() >= max_cmds; }
+
+void cmd_chain::add(bo *cmd) {
+  if (full())
+    shim_err(E2BIG, "Command chain holds at most %ld commands", max_cmds);
+  m_cmds.push_back(cmd);
+}
+
+void cmd_chain::clear() { m_cmds.clear(); }
+
+ert_cmd_state cmd_chain::submit_and_wait(hw_q &hwq, uint32_t *error_index) {
+  if (empty()) return ERT_CMD_STATE_COMPLETED;
+
+  auto *pkt = reinterpret_cast<ert_packet *>(m_chain_bo->map());
+  auto *payload = reinterpret_cast<ert_cmd_chain_data *>(pkt->data);
+  size_t payload_size =
+      sizeof(ert_cmd_chain_data) + m_cmds.size() * sizeof(uint64_t);
+  std::memset(pkt, 0, sizeof(*pkt) + payload_size);
+  pkt->state = ERT_CMD_STATE_NEW;
+  pkt->opcode = ERT_CMD_CHAIN;
+  pkt->type = ERT_CTRL;
+  pkt->count = payload_size / sizeof(uint32_t);
+  payload->command_count = m_cmds.size();
+  for (size_t i = 0; i < m_cmds.size(); ++i) {
+    reinterpret_cast<ert_packet *>(m_cmds[i]->map())->state =
+        ERT_CMD_STATE_NEW;
+    payload->data[i] = m_cmds[i]->get_drm_bo_handle();
+    // Collect the argument BOs of every chained command so that the driver
+    // keeps all of them resident while the chain runs.
+    m_chain_bo->bind_at(i, *m_cmds[i], 0, m_cmds[i]->size());
+  }
+  SHIM_DEBUG("Submitting chain of %ld commands", m_cmds.size());
+  m_cmds.clear();
+
+  hwq.issue_command(m_chain_bo.get());
+  hwq.wait_command(m_chain_bo.get(), 0);
+  if (error_index) *error_index = payload->error_index;
+  return static_cast<ert_cmd_state>(pkt->state);
+}
+
 }  // namespace shim_xdna
@@ -4,6 +4,7 @@
 #ifndef _HWQ_XDNA_H_
 #define _HWQ_XDNA_H_
 
+#include "ert.h"
 #include "fence.h"
 #include "hwctx.h"
 
@@ -28,6 +29,33 @@ struct hw_q {
 
 int poll_command(bo *);
 
+// Collects exec buf BOs and submits them to a `hw_q` as a single ERT_CMD_CHAIN
+// command, so that a batch of kernel runs costs one EXEC_CMD ioctl and one wait
+// instead of one of each per run.
+struct cmd_chain {
+  // Every chained command contributes up to 64 argument BOs (see
+  // `bo::bind_at`) and `hw_q::issue_command` passes at most 1024 of them.
+  static constexpr size_t max_cmds = 16;
+
+  std::unique_ptr<bo> m_chain_bo;
+  std::vector<bo *> m_cmds;
+
+  explicit cmd_chain(const pdev &p);
+
+  bool empty() const;
+  bool full() const;
+  // Appends `cmd` to the chain; commands run in the order they were added and
+  // the same BO may be added more than once. `cmd` must stay alive until the
+  // next `submit_and_wait`.
+  void add(bo *cmd);
+  // Drops all commands without issuing them.
+  void clear();
+  // Issues the chained commands on `hwq`, blocks until all of them have
+  // finished and empties the chain. Returns the ERT state of the chain; on
+  // failure, `error_index` holds the index of the failing command.
+  ert_cmd_state submit_and_wait(hw_q &hwq, uint32_t *error_index = nullptr);
+};
+
 }  // namespace shim_xdna
 
 #endif  // _HWQ_XDNA_H_
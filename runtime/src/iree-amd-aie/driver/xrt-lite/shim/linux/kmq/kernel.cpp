@@ -73,6 +73,7 @@ void kernel::add_ctrl_bo(bo &bo_ctrl) {
 
 void kernel::add_arg_32(uint32_t val) {
   inc_pkt_count(sizeof(val));
+  m_arg_reg_idx.push_back(m_reg_idx);
   auto args = get_ert_regmap_begin(m_cmd_pkt);
   args[m_reg_idx++] = val;
   m_arg_cnt++;
@@ -80,6 +81,7 @@ void kernel::add_arg_32(uint32_t val) {
 
 void kernel::add_arg_64(uint64_t val) {
   inc_pkt_count(sizeof(val));
+  m_arg_reg_idx.push_back(m_reg_idx);
   auto args = get_ert_regmap_begin(m_cmd_pkt);
   args[m_reg_idx++] = val;
   args[m_reg_idx++] = val >> 32;
@@ -98,6 +100,18 @@ void kernel::add_arg_bo(bo &bo_arg, const std::string &arg_name) {
   add_arg_64(bo_arg.get_paddr());
 }
 
+void kernel::set_arg_bo(uint32_t arg_idx, bo &bo_arg) {
+  if (arg_idx == 0 || arg_idx >= m_arg_cnt)
+    shim_err(EINVAL, "Can't rebind argument %d of %d", arg_idx, m_arg_cnt);
+  m_exec_buf_bo->bind_at(arg_idx, bo_arg, 0, bo_arg.size());
+  auto args = get_ert_regmap_begin(m_cmd_pkt);
+  uint32_t reg_idx = m_arg_reg_idx[arg_idx];
+  args[reg_idx] = bo_arg.get_paddr();
+  args[reg_idx + 1] = bo_arg.get_paddr() >> 32;
+  for (auto &[arg_name, arg_addr] : m_patching_args)
+    if (arg_name == std::to_string(arg_idx)) arg_addr = bo_arg.get_paddr();
+}
+
 void kernel::dump() {
   std::cout << "Dumping exec buf:";
   int *data = static_cast<int *>(m_exec_buf_bo->map());
@@ -17,6 +17,8 @@ struct kernel {
   uint32_t m_op;
   uint32_t m_arg_cnt;
   uint32_t m_reg_idx;
+  // The first register of every argument, indexed by argument.
+  std::vector<uint32_t> m_arg_reg_idx;
   std::vector<std::pair<std::string, uint64_t> > m_patching_args;
 
   kernel(const pdev &p, uint32_t op);
@@ -29,6 +31,9 @@ struct kernel {
   void add_arg_32(uint32_t val);
   void add_arg_64(uint64_t val);
   void add_arg_bo(bo &bo_arg, const std::string &arg_name = "");
+  // Rebinds the 64-bit argument `arg_idx` to `bo_arg`, so that the exec buf
+  // can be submitted again with a different buffer.
+  void set_arg_bo(uint32_t arg_idx, bo &bo_arg);
   void dump();
   void inc_pkt_count(uint32_t n) const;
 };
@@ -0,0 +1,163 @@
+// Copyright 2024 The IREE Authors
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/bo.h"
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/device.h"
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/hwctx.h"
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/hwq.h"
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/kernel.h"
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/test/fake_ioctl.h"
+
+namespace {
+
+using shim_xdna::testing::fake_ioctl_scope;
+
+class CmdChainTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    device = std::make_unique<shim_xdna::device>(/*n_rows=*/4, /*n_cols=*/4);
+    context = device->create_hw_context(std::vector<uint8_t>(64, 0), "dpu");
+    ctrl_code = device->alloc_bo(64, XCL_BO_FLAGS_CACHEABLE);
+    input = device->alloc_bo(1024, XCL_BO_FLAGS_HOST_ONLY);
+    output = device->alloc_bo(1024, XCL_BO_FLAGS_HOST_ONLY);
+    fake.reset();
+  }
+
+  // Builds a kernel run in the same way as the xrt-lite command buffer.
+  std::unique_ptr<shim_xdna::kernel> makeKernel() {
+    auto ebuf =
+        std::make_unique<shim_xdna::kernel>(device->get_pdev(), ERT_START_CU);
+    ebuf->set_cu_idx(context->open_cu_context("dpu"));
+    ebuf->add_arg_64(3);
+    ebuf->add_arg_bo(*ctrl_code);
+    ebuf->add_arg_32(16);
+    ebuf->add_arg_bo(*input);
+    ebuf->add_arg_bo(*output);
+    return ebuf;
+  }
+
+  shim_xdna::hw_q &hwq() { return *context->get_hw_queue(); }
+
+  fake_ioctl_scope fake;
+  std::unique_ptr<shim_xdna::device> device;
+  std::unique_ptr<shim_xdna::hw_ctx> context;
+  std::unique_ptr<shim_xdna::bo> ctrl_code;
+  std::unique_ptr<shim_xdna::bo> input;
+  std::unique_ptr<shim_xdna::bo> output;
+};
+
+TEST_F(CmdChainTest, UnchainedSubmitsEveryRun) {
+  auto ebuf = makeKernel();
+  for (int i = 0; i < 4; ++i) {
+    ebuf->m_cmd_pkt->state = ERT_CMD_STATE_NEW;
+    hwq().issue_command(ebuf->get_exec_buf_bo());
+    hwq().wait_command(ebuf->get_exec_buf_bo(), 0);
+  }
+  EXPECT_EQ(fake.stats().exec_cmd, 4);
+  EXPECT_EQ(fake.stats().wait_cmd, 4);
+  EXPECT_EQ(fake.stats().executed_cmds, 4);
+}
+
+TEST_F(CmdChainTest, ChainSubmitsOnce) {
+  std::vector<std::unique_ptr<shim_xdna::kernel>> kernels;
+  shim_xdna::cmd_chain chain(device->get_pdev());
+  for (int i = 0; i < 4; ++i) {
+    kernels.push_back(makeKernel());
+    chain.add(kernels.back()->get_exec_buf_bo());
+  }
+  fake.reset();
+  EXPECT_EQ(chain.submit_and_wait(hwq()), ERT_CMD_STATE_COMPLETED);
+  EXPECT_TRUE(chain.empty());
+  EXPECT_EQ(fake.stats().exec_cmd, 1);
+  EXPECT_EQ(fake.stats().wait_cmd, 1);
+  EXPECT_EQ(fake.stats().executed_cmds, 4);
+  // Every run passes the control code and its two bindings.
+  EXPECT_EQ(fake.stats().arg_bos, 4 * 3);
+  for (auto &kernel : kernels)
+    EXPECT_EQ(kernel->m_cmd_pkt->state, ERT_CMD_STATE_COMPLETED);
+}
+
+TEST_F(CmdChainTest, RepeatedCommand) {
+  auto ebuf = makeKernel();
+  shim_xdna::cmd_chain chain(device->get_pdev());
+  for (int i = 0; i < 3; ++i) chain.add(ebuf->get_exec_buf_bo());
+  EXPECT_EQ(chain.submit_and_wait(hwq()), ERT_CMD_STATE_COMPLETED);
+  EXPECT_EQ(fake.stats().exec_cmd, 1);
+  EXPECT_EQ(fake.stats().executed_cmds, 3);
+}
+
+TEST_F(CmdChainTest, EmptyChainSubmitsNothing) {
+  shim_xdna::cmd_chain chain(device->get_pdev());
+  EXPECT_EQ(chain.submit_and_wait(hwq()), ERT_CMD_STATE_COMPLETED);
+  EXPECT_EQ(fake.stats().exec_cmd, 0);
+  EXPECT_EQ(fake.stats().wait_cmd, 0);
+}
+
+TEST_F(CmdChainTest, Full) {
+  auto ebuf = makeKernel();
+  shim_xdna::cmd_chain chain(device->get_pdev());
+  for (size_t i = 0; i < shim_xdna::cmd_chain::max_cmds; ++i) {
+    EXPECT_FALSE(chain.full());
+    chain.add(ebuf->get_exec_buf_bo());
+  }
+  EXPECT_TRUE(chain.full());
+  EXPECT_EQ(chain.submit_and_wait(hwq()), ERT_CMD_STATE_COMPLETED);
+  EXPECT_EQ(fake.stats().exec_cmd, 1);
+  EXPECT_EQ(fake.stats().executed_cmds, shim_xdna::cmd_chain::max_cmds);
+}
+
+TEST_F(CmdChainTest, ReportsFailingCommand) {
+  auto ebuf = makeKernel();
+  shim_xdna::cmd_chain chain(device->get_pdev());
+  for (int i = 0; i < 4; ++i) chain.add(ebuf->get_exec_buf_bo());
+  fake.fail_command(2);
+  uint32_t error_index = 0;
+  EXPECT_EQ(chain.submit_and_wait(hwq(), &error_index), ERT_CMD_STATE_ERROR);
+  EXPECT_EQ(error_index, 2);
+  EXPECT_EQ(fake.stats().executed_cmds, 3);
+}
+
+TEST_F(CmdChainTest, ReboundArgumentIsSubmitted) {
+  // Arguments recorded as placeholders are bound right before submission, as
+  // done by reusable command buffers on replay.
+  auto ebuf =
+      std::make_unique<shim_xdna::kernel>(device->get_pdev(), ERT_START_CU);
+  ebuf->set_cu_idx(context->open_cu_context("dpu"));
+  ebuf->add_arg_64(3);
+  ebuf->add_arg_bo(*ctrl_code);
+  ebuf->add_arg_32(16);
+  ebuf->add_arg_64(0);
+  ebuf->add_arg_64(0);
+  ebuf->set_arg_bo(3, *input);
+  ebuf->set_arg_bo(4, *output);
+  uint32_t *args = get_ert_regmap_begin(ebuf->m_cmd_pkt);
+  // opcode (2 registers), control code (2), control code size (1), input.
+  EXPECT_EQ(args[5], static_cast<uint32_t>(input->get_paddr()));
+  EXPECT_EQ(args[6], static_cast<uint32_t>(input->get_paddr() >> 32));
+
+  shim_xdna::cmd_chain chain(device->get_pdev());
+  chain.add(ebuf->get_exec_buf_bo());
+  EXPECT_EQ(chain.submit_and_wait(hwq()), ERT_CMD_STATE_COMPLETED);
+  EXPECT_EQ(fake.stats().arg_bos, 3);
+
+  // Rebinding replaces the argument rather than adding one.
+  ebuf->set_arg_bo(3, *output);
+  EXPECT_EQ(args[5], static_cast<uint32_t>(output->get_paddr()));
+  chain.add(ebuf->get_exec_buf_bo());
+  EXPECT_EQ(chain.submit_and_wait(hwq()), ERT_CMD_STATE_COMPLETED);
+  EXPECT_EQ(fake.stats().arg_bos, 6);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
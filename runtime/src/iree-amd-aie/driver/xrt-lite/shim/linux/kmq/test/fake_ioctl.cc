@@ -0,0 +1,267 @@
+// Copyright 2024 The IREE Authors
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/test/fake_ioctl.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/amdxdna_accel.h"
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/device.h"
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/ert.h"
+
+namespace shim_xdna::testing {
+
+namespace {
+
+const int fake_dev_fd = 1 << 20;
+
+struct fake_driver {
+  std::mutex lock;
+  // Notified whenever a syncobj timeline advances.
+  std::condition_variable syncobj_cv;
+  fake_ioctl_stats stats;
+  // Syncobj handle to the last signaled point of its timeline.
+  std::map<uint32_t, uint64_t> syncobjs;
+  uint32_t next_syncobj_handle = 1;
+  std::map<uint32_t, std::vector<char>> bos;
+  uint32_t next_bo_handle = 1;
+  uint32_t next_ctx_handle = 1;
+  // Submitted but not yet completed command BOs, keyed by sequence number.
+  std::map<uint64_t, uint32_t> in_flight;
+  uint64_t next_seq = 1;
+  size_t failing_cmd = SIZE_MAX;
+};
+
+fake_driver *driver = nullptr;
+
+ert_packet *get_pkt(uint32_t handle) {
+  return reinterpret_cast<ert_packet *>(driver->bos.at(handle).data());
+}
+
+// Runs the command in BO `handle`; returns whether it succeeded.
+bool execute(uint32_t handle) {
+  bool ok = driver->stats.executed_cmds++ != driver->failing_cmd;
+  get_pkt(handle)->state = ok ? ERT_CMD_STATE_COMPLETED : ERT_CMD_STATE_ERROR;
+  return ok;
+}
+
+void complete(uint32_t handle) {
+  ert_packet *pkt = get_pkt(handle);
+  if (pkt->opcode != ERT_CMD_CHAIN) {
+    execute(handle);
+    return;
+  }
+  auto *payload = reinterpret_cast<ert_cmd_chain_data *>(pkt->data);
+  pkt->state = ERT_CMD_STATE_COMPLETED;
+  for (uint32_t i = 0; i < payload->command_count; ++i) {
+    if (!execute(static_cast<uint32_t>(payload->data[i]))) {
+      pkt->state = ERT_CMD_STATE_ERROR;
+      payload->error_index = i;
+      return;
+    }
+    payload->submit_index = i;
+  }
+}
+
+// Completes every in-flight command up to and including sequence number `seq`.
+void complete_until(uint64_t seq) {
+  auto &in_flight = driver->in_flight;
+  while (!in_flight.empty() && in_flight.begin()->first <= seq) {
+    complete(in_flight.begin()->second);
+    in_flight.erase(in_flight.begin());
+  }
+}
+
+// Blocks until the timelines in `wait` reach their points (all of them, or any
+// if DRM_SYNCOBJ_WAIT_FLAGS_WAIT_ALL is not set) or the deadline passes.
+int wait_syncobjs(std::unique_lock<std::mutex> &lock,
+                  const drm_syncobj_timeline_wait &wait) {
+  auto *handles = reinterpret_cast<const uint32_t *>(wait.handles);
+  auto *points = reinterpret_cast<const uint64_t *>(wait.points);
+  for (uint32_t i = 0; i < wait.count_handles; ++i) {
+    if (!driver->syncobjs.count(handles[i])) {
+      errno = EINVAL;
+      return -1;
+    }
+  }
+  auto ready = [&]() {
+    bool wait_all = wait.flags & DRM_SYNCOBJ_WAIT_FLAGS_WAIT_ALL;
+    for (uint32_t i = 0; i < wait.count_handles; ++i) {
+      bool signaled = driver->syncobjs[handles[i]] >= points[i];
+      if (signaled && !wait_all) return true;
+      if (!signaled && wait_all) return false;
+    }
+    return wait_all;
+  };
+  if (wait.timeout_nsec == std::numeric_limits<int64_t>::max()) {
+    driver->syncobj_cv.wait(lock, ready);
+    return 0;
+  }
+  std::chrono::steady_clock::time_point deadline{
+      std::chrono::nanoseconds(wait.timeout_nsec)};
+  if (!driver->syncobj_cv.wait_until(lock, deadline, ready)) {
+    errno = ETIME;
+    return -1;
+  }
+  return 0;
+}
+
+int fake_open(const char *, int) { return fake_dev_fd; }
+
+int fake_close(int) { return 0; }
+
+int fake_ioctl(int fd, unsigned long cmd, void *arg) {
+  std::unique_lock<std::mutex> lock(driver->lock);
+  if (fd != fake_dev_fd) {
+    errno = EBADF;
+    return -1;
+  }
+  switch (cmd) {
+    case DRM_IOCTL_AMDXDNA_CREATE_BO: {
+      auto *cbo = static_cast<amdxdna_drm_create_bo *>(arg);
+      cbo->handle = driver->next_bo_handle++;
+      driver->bos[cbo->handle].resize(cbo->size);
+      return 0;
+    }
+    case DRM_IOCTL_AMDXDNA_GET_BO_INFO: {
+      auto *info = static_cast<amdxdna_drm_get_bo_info *>(arg);
+      auto it = driver->bos.find(info->handle);
+      if (it == driver->bos.end()) break;
+      info->vaddr = reinterpret_cast<uintptr_t>(it->second.data());
+      info->xdna_addr = info->vaddr;
+      info->map_offset = AMDXDNA_INVALID_ADDR;
+      return 0;
+    }
+    case DRM_IOCTL_GEM_CLOSE: {
+      auto *close_bo = static_cast<drm_gem_close *>(arg);
+      if (!driver->bos.erase(close_bo->handle)) break;
+      return 0;
+    }
+    case DRM_IOCTL_AMDXDNA_CREATE_HWCTX: {
+      driver->stats.create_hwctx++;
+      auto *create = static_cast<amdxdna_drm_create_hwctx *>(arg);
+      create->handle = driver->next_ctx_handle++;
+      create->syncobj_handle = AMDXDNA_INVALID_FENCE_HANDLE;
+      create->umq_doorbell = 0;
+      return 0;
+    }
+    case DRM_IOCTL_AMDXDNA_EXEC_CMD: {
+      auto *ecmd = static_cast<amdxdna_drm_exec_cmd *>(arg);
+      if (ecmd->cmd_count != 1 || !driver->bos.count(ecmd->cmd_handles)) break;
+      driver->stats.exec_cmd++;
+      driver->stats.arg_bos += ecmd->arg_count;
+      ecmd->seq = driver->next_seq++;
+      driver->in_flight[ecmd->seq] = ecmd->cmd_handles;
+      return 0;
+    }
+    case DRM_IOCTL_AMDXDNA_WAIT_CMD: {
+      driver->stats.wait_cmd++;
+      complete_until(static_cast<amdxdna_drm_wait_cmd *>(arg)->seq);
+      return 0;
+    }
+    case DRM_IOCTL_SYNCOBJ_CREATE: {
+      auto *create = static_cast<drm_syncobj_create *>(arg);
+      create->handle = driver->next_syncobj_handle++;
+      driver->syncobjs[create->handle] = 0;
+      return 0;
+    }
+    case DRM_IOCTL_SYNCOBJ_DESTROY: {
+      auto *destroy = static_cast<drm_syncobj_destroy *>(arg);
+      if (!driver->syncobjs.erase(destroy->handle)) break;
+      return 0;
+    }
+    case DRM_IOCTL_SYNCOBJ_QUERY: {
+      auto *query = static_cast<drm_syncobj_timeline_array *>(arg);
+      auto *handles = reinterpret_cast<uint32_t *>(query->handles);
+      auto *points = reinterpret_cast<uint64_t *>(query->points);
+      for (uint32_t i = 0; i < query->count_handles; ++i) {
+        auto it = driver->syncobjs.find(handles[i]);
+        if (it == driver->syncobjs.end()) {
+          errno = EINVAL;
+          return -1;
+        }
+        points[i] = it->second;
+      }
+      return 0;
+    }
+    case DRM_IOCTL_SYNCOBJ_TIMELINE_SIGNAL: {
+      driver->stats.syncobj_signals++;
+      auto *signal = static_cast<drm_syncobj_timeline_array *>(arg);
+      auto *handles = reinterpret_cast<uint32_t *>(signal->handles);
+      auto *points = reinterpret_cast<uint64_t *>(signal->points);
+      for (uint32_t i = 0; i < signal->count_handles; ++i) {
+        auto it = driver->syncobjs.find(handles[i]);
+        if (it == driver->syncobjs.end()) {
+          errno = EINVAL;
+          return -1;
+        }
+        it->second = std::max(it->second, points[i]);
+      }
+      driver->syncobj_cv.notify_all();
+      return 0;
+    }
+    case DRM_IOCTL_SYNCOBJ_TIMELINE_WAIT: {
+      driver->stats.syncobj_waits++;
+      return wait_syncobjs(
+          lock, *static_cast<drm_syncobj_timeline_wait *>(arg));
+    }
+    case DRM_IOCTL_AMDXDNA_DESTROY_HWCTX:
+      driver->stats.destroy_hwctx++;
+      return 0;
+    case DRM_IOCTL_AMDXDNA_SYNC_BO:
+    case DRM_IOCTL_AMDXDNA_CONFIG_HWCTX:
+      return 0;
+    default:
+      errno = ENOTTY;
+      return -1;
+  }
+  errno = EINVAL;
+  return -1;
+}
+
+const pdev_syscalls fake_syscalls = {
+    .open = fake_open,
+    .close = fake_close,
+    .ioctl = fake_ioctl,
+};
+
+}  // namespace
+
+fake_ioctl_scope::fake_ioctl_scope() {
+  driver = new fake_driver();
+  set_pdev_syscalls(&fake_syscalls);
+}
+
+fake_ioctl_scope::~fake_ioctl_scope() {
+  set_pdev_syscalls(nullptr);
+  delete driver;
+  driver = nullptr;
+}
+
+const fake_ioctl_stats &fake_ioctl_scope::stats() const {
+  return driver->stats;
+}
+
+void fake_ioctl_scope::reset() {
+  std::lock_guard<std::mutex> lg(driver->lock);
+  driver->stats = {};
+  driver->failing_cmd = SIZE_MAX;
+}
+
+void fake_ioctl_scope::fail_command(size_t index) {
+  std::lock_guard<std::mutex> lg(driver->lock);
+  driver->failing_cmd = driver->stats.executed_cmds + index;
+}
+
+}  // namespace shim_xdna::testing
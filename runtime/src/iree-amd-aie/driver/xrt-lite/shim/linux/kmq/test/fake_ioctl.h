@@ -0,0 +1,57 @@
+// Copyright 2024 The IREE Authors
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#ifndef SHIM_XDNA_TEST_FAKE_IOCTL_H
+#define SHIM_XDNA_TEST_FAKE_IOCTL_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace shim_xdna::testing {
+
+// What the fake driver has been asked to do since the last `reset`.
+struct fake_ioctl_stats {
+  // DRM_IOCTL_AMDXDNA_CREATE_HWCTX and DRM_IOCTL_AMDXDNA_DESTROY_HWCTX
+  // ioctls; every created context loads a PDI.
+  size_t create_hwctx = 0;
+  size_t destroy_hwctx = 0;
+  // DRM_IOCTL_AMDXDNA_EXEC_CMD ioctls, i.e. submissions to a hardware queue.
+  size_t exec_cmd = 0;
+  // Commands executed by those submissions; a chain counts every command in
+  // it.
+  size_t executed_cmds = 0;
+  // Arguments BOs passed with the submissions.
+  size_t arg_bos = 0;
+  // DRM_IOCTL_AMDXDNA_WAIT_CMD ioctls.
+  size_t wait_cmd = 0;
+  // DRM_IOCTL_SYNCOBJ_TIMELINE_SIGNAL and DRM_IOCTL_SYNCOBJ_TIMELINE_WAIT
+  // ioctls.
+  size_t syncobj_signals = 0;
+  size_t syncobj_waits = 0;
+};
+
+// Replaces the device syscalls of every `pdev` created while it is alive by an
+// in-memory fake of the amdxdna driver: BOs are plain host allocations,
+// hardware contexts are just handles, submitted commands complete once they
+// are waited on and syncobjs are timelines that block waiters until they are
+// signaled. Only one instance may be alive at a time.
+class fake_ioctl_scope {
+ public:
+  fake_ioctl_scope();
+  ~fake_ioctl_scope();
+  fake_ioctl_scope(const fake_ioctl_scope &) = delete;
+  fake_ioctl_scope &operator=(const fake_ioctl_scope &) = delete;
+
+  const fake_ioctl_stats &stats() const;
+  void reset();
+  // Makes the `index`-th command executed from now on (0-based, counting the
+  // commands inside chains individually) fail with ERT_CMD_STATE_ERROR.
+  void fail_command(size_t index);
+};
+
+}  // namespace shim_xdna::testing
+
+#endif  // SHIM_XDNA_TEST_FAKE_IOCTL_H
@@ -0,0 +1,120 @@
+// Copyright 2024 The IREE Authors
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/device.h"
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/hwctx.h"
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/test/fake_ioctl.h"
+
+namespace {
+
+using shim_xdna::testing::fake_ioctl_scope;
+
+class HwCtxCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    device = std::make_unique<shim_xdna::device>(/*n_rows=*/4, /*n_cols=*/4);
+    fake.reset();
+  }
+
+  // Returns the context for `pdi`, creating it on a miss in the same way as
+  // the xrt-lite command buffer.
+  std::shared_ptr<shim_xdna::hw_ctx_cache::entry> get(
+      shim_xdna::hw_ctx_cache &cache, const shim_xdna::hw_ctx_cache::key &key) {
+    if (auto entry = cache.lookup(key)) return entry;
+    return cache.insert(key);
+  }
+
+  fake_ioctl_scope fake;
+  std::unique_ptr<shim_xdna::device> device;
+  shim_xdna::hw_ctx_cache::key pdi_a =
+      shim_xdna::hw_ctx_cache::make_key(std::vector<uint8_t>(64, 1), "dpu");
+  shim_xdna::hw_ctx_cache::key pdi_b =
+      shim_xdna::hw_ctx_cache::make_key(std::vector<uint8_t>(64, 2), "dpu");
+  shim_xdna::hw_ctx_cache::key pdi_c =
+      shim_xdna::hw_ctx_cache::make_key(std::vector<uint8_t>(64, 3), "dpu");
+};
+
+TEST_F(HwCtxCacheTest, LoadsEachPdiOnce) {
+  shim_xdna::hw_ctx_cache cache(*device, /*capacity=*/2);
+  shim_xdna::hw_ctx *ctx_a = get(cache, pdi_a)->m_ctx.get();
+  shim_xdna::hw_ctx *ctx_b = get(cache, pdi_b)->m_ctx.get();
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(get(cache, pdi_a)->m_ctx.get(), ctx_a);
+    EXPECT_EQ(get(cache, pdi_b)->m_ctx.get(), ctx_b);
+  }
+  EXPECT_EQ(fake.stats().create_hwctx, 2);
+  EXPECT_EQ(cache.misses(), 2);
+  EXPECT_EQ(cache.hits(), 8);
+}
+
+TEST_F(HwCtxCacheTest, KeyedByKernelName) {
+  shim_xdna::hw_ctx_cache cache(*device, /*capacity=*/2);
+  cache.insert(pdi_a);
+  EXPECT_EQ(cache.lookup(shim_xdna::hw_ctx_cache::make_key(*pdi_a.m_pdi,
+                                                           "other")),
+            nullptr);
+  EXPECT_NE(cache.lookup(pdi_a), nullptr);
+}
+
+TEST_F(HwCtxCacheTest, KeyedByPdiContents) {
+  shim_xdna::hw_ctx_cache cache(*device, /*capacity=*/2);
+  cache.insert(pdi_a);
+  // A key made separately from the same PDI finds the same context.
+  EXPECT_NE(cache.lookup(shim_xdna::hw_ctx_cache::make_key(*pdi_a.m_pdi,
+                                                           "dpu")),
+            nullptr);
+  EXPECT_EQ(fake.stats().create_hwctx, 1);
+}
+
+TEST_F(HwCtxCacheTest, EvictsLeastRecentlyUsed) {
+  shim_xdna::hw_ctx_cache cache(*device, /*capacity=*/2);
+  get(cache, pdi_a);
+  get(cache, pdi_b);
+  // Touch `pdi_a` so that `pdi_b` is evicted to make room for `pdi_c`.
+  get(cache, pdi_a);
+  get(cache, pdi_c);
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(fake.stats().destroy_hwctx, 1);
+  EXPECT_NE(cache.lookup(pdi_a), nullptr);
+  EXPECT_NE(cache.lookup(pdi_c), nullptr);
+  EXPECT_EQ(cache.lookup(pdi_b), nullptr);
+  EXPECT_EQ(fake.stats().create_hwctx, 3);
+}
+
+TEST_F(HwCtxCacheTest, HeldContextOutlivesEviction) {
+  shim_xdna::hw_ctx_cache cache(*device, /*capacity=*/1);
+  std::shared_ptr<shim_xdna::hw_ctx_cache::entry> held = get(cache, pdi_a);
+  get(cache, pdi_b);
+  // `pdi_a` is evicted, but its context is only destroyed once released.
+  EXPECT_EQ(cache.lookup(pdi_a), nullptr);
+  EXPECT_EQ(fake.stats().destroy_hwctx, 0);
+  EXPECT_NE(held->m_ctx->get_hw_queue(), nullptr);
+  held.reset();
+  EXPECT_EQ(fake.stats().destroy_hwctx, 1);
+}
+
+TEST_F(HwCtxCacheTest, RepeatedLoads) {
+  shim_xdna::hw_ctx_cache cache(*device, /*capacity=*/1);
+  cache.insert(pdi_a, /*n_loads=*/3);
+  EXPECT_EQ(fake.stats().create_hwctx, 3);
+  EXPECT_EQ(fake.stats().destroy_hwctx, 2);
+  EXPECT_EQ(cache.size(), 1);
+  // Inserting again replaces the cached context.
+  cache.insert(pdi_a);
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_EQ(fake.stats().create_hwctx, 4);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,69 @@
+// Copyright 2024 The IREE Authors
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <memory>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/device.h"
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/fence.h"
+#include "iree-amd-aie/driver/xrt-lite/shim/linux/kmq/test/fake_ioctl.h"
+
+namespace {
+
+using shim_xdna::testing::fake_ioctl_scope;
+
+class TimelineSyncobjTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    device = std::make_unique<shim_xdna::device>(/*n_rows=*/4, /*n_cols=*/4);
+  }
+
+  fake_ioctl_scope fake;
+  std::unique_ptr<shim_xdna::device> device;
+};
+
+TEST_F(TimelineSyncobjTest, SignalAndQuery) {
+  shim_xdna::timeline_syncobj syncobj(*device);
+  EXPECT_EQ(syncobj.query(), 0);
+  syncobj.signal(3);
+  EXPECT_EQ(syncobj.query(), 3);
+  syncobj.signal(7);
+  EXPECT_EQ(syncobj.query(), 7);
+}
+
+TEST_F(TimelineSyncobjTest, WaitOnSignaledPoint) {
+  shim_xdna::timeline_syncobj syncobj(*device);
+  syncobj.signal(2);
+  EXPECT_TRUE(syncobj.wait(1, /*timeout_ns=*/0));
+  EXPECT_TRUE(syncobj.wait(2, /*timeout_ns=*/-1));
+}
+
+TEST_F(TimelineSyncobjTest, WaitTimesOut) {
+  shim_xdna::timeline_syncobj syncobj(*device);
+  syncobj.signal(1);
+  EXPECT_FALSE(syncobj.wait(2, /*timeout_ns=*/0));
+  EXPECT_FALSE(syncobj.wait(2, /*timeout_ns=*/1000000));
+}
+
+TEST_F(TimelineSyncobjTest, WaitForSignalFromOtherThread) {
+  shim_xdna::timeline_syncobj syncobj(*device);
+  std::thread signaler([&]() {
+    syncobj.signal(1);
+    syncobj.signal(2);
+  });
+  EXPECT_TRUE(syncobj.wait(2, /*timeout_ns=*/-1));
+  signaler.join();
+  EXPECT_EQ(syncobj.query(), 2);
+  EXPECT_EQ(fake.stats().syncobj_signals, 2);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
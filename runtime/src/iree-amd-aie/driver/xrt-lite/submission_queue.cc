@@ -0,0 +1,362 @@
+// Copyright 2024 The IREE Authors
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "iree-amd-aie/driver/xrt-lite/submission_queue.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "iree-amd-aie/driver/xrt-lite/device.h"
+#include "iree-amd-aie/driver/xrt-lite/direct_command_buffer.h"
+#include "iree/hal/utils/deferred_command_buffer.h"
+#include "iree/hal/utils/semaphore_base.h"
+
+namespace {
+
+// A single queue_execute or barrier, holding references to everything it
+// touches until it has completed.
+struct iree_hal_xrt_lite_submission {
+  std::vector<iree_hal_semaphore_t*> wait_semaphores;
+  std::vector<uint64_t> wait_values;
+  std::vector<iree_hal_semaphore_t*> signal_semaphores;
+  std::vector<uint64_t> signal_values;
+  iree_hal_command_buffer_t* command_buffer = nullptr;
+  std::vector<iree_hal_buffer_binding_t> bindings;
+
+  // The queue to wake up once `timepoint` is reached.
+  iree_hal_xrt_lite_submission_queue* queue;
+  // Set while `timepoint` waits on one of the wait semaphores, guarded by the
+  // mutex of `queue`. The submission is neither executed nor freed while it is
+  // set, as the timepoint refers to it.
+  bool armed = false;
+  iree_hal_semaphore_timepoint_t timepoint = {};
+
+  iree_hal_xrt_lite_submission(
+      iree_hal_xrt_lite_submission_queue* queue,
+      const iree_hal_semaphore_list_t& wait_semaphore_list,
+      const iree_hal_semaphore_list_t& signal_semaphore_list,
+      iree_hal_command_buffer_t* command_buffer,
+      const iree_hal_buffer_binding_table_t& binding_table)
+      : wait_semaphores(wait_semaphore_list.semaphores,
+                        wait_semaphore_list.semaphores +
+                            wait_semaphore_list.count),
+        wait_values(wait_semaphore_list.payload_values,
+                    wait_semaphore_list.payload_values +
+                        wait_semaphore_list.count),
+        signal_semaphores(signal_semaphore_list.semaphores,
+                          signal_semaphore_list.semaphores +
+                              signal_semaphore_list.count),
+        signal_values(signal_semaphore_list.payload_values,
+                      signal_semaphore_list.payload_values +
+                          signal_semaphore_list.count),
+        command_buffer(command_buffer),
+        bindings(binding_table.bindings,
+                 binding_table.bindings + binding_table.count),
+        queue(queue) {
+    for (iree_hal_semaphore_t* semaphore : wait_semaphores)
+      iree_hal_semaphore_retain(semaphore);
+    for (iree_hal_semaphore_t* semaphore : signal_semaphores)
+      iree_hal_semaphore_retain(semaphore);
+    iree_hal_command_buffer_retain(command_buffer);
+    for (const iree_hal_buffer_binding_t& binding : bindings)
+      iree_hal_buffer_retain(binding.buffer);
+  }
+
+  ~iree_hal_xrt_lite_submission() {
+    for (const iree_hal_buffer_binding_t& binding : bindings)
+      iree_hal_buffer_release(binding.buffer);
+    iree_hal_command_buffer_release(command_buffer);
+    for (iree_hal_semaphore_t* semaphore : signal_semaphores)
+      iree_hal_semaphore_release(semaphore);
+    for (iree_hal_semaphore_t* semaphore : wait_semaphores)
+      iree_hal_semaphore_release(semaphore);
+  }
+
+  iree_hal_semaphore_list_t wait_list() {
+    return {wait_semaphores.size(), wait_semaphores.data(),
+            wait_values.data()};
+  }
+
+  iree_hal_semaphore_list_t signal_list() {
+    return {signal_semaphores.size(), signal_semaphores.data(),
+            signal_values.data()};
+  }
+};
+
+}  // namespace
+
+struct iree_hal_xrt_lite_submission_queue {
+  iree_hal_xrt_lite_device* device;
+  iree_allocator_t host_allocator;
+  // Guards `pending`, `generation`, `exit_requested` and the `armed` flags of
+  // the pending submissions.
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<std::unique_ptr<iree_hal_xrt_lite_submission>> pending;
+  // Bumped on every enqueue and every reached timepoint, so that the worker
+  // doesn't miss a wake-up that happens while it is scanning `pending`.
+  uint64_t generation = 0;
+  bool exit_requested = false;
+  std::thread worker;
+
+  iree_hal_xrt_lite_submission_queue(iree_hal_xrt_lite_device* device,
+                                     iree_allocator_t host_allocator)
+      : device(device), host_allocator(host_allocator) {
+    worker = std::thread([this]() { run(); });
+  }
+
+  ~iree_hal_xrt_lite_submission_queue() {
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      exit_requested = true;
+      ++generation;
+    }
+    cv.notify_one();
+    worker.join();
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      uint64_t seen_generation = generation;
+      // Only submissions whose waits are already reached are dequeued, so that
+      // a submission waiting on one enqueued after it can't block the queue.
+      auto it = std::find_if(
+          pending.begin(), pending.end(),
+          [](const std::unique_ptr<iree_hal_xrt_lite_submission>& submission) {
+            return !submission->armed && is_ready(*submission);
+          });
+      if (it != pending.end()) {
+        std::unique_ptr<iree_hal_xrt_lite_submission> submission =
+            std::move(*it);
+        pending.erase(it);
+        lock.unlock();
+        iree_status_t status = execute(*submission);
+        if (iree_status_is_ok(status)) {
+          status = iree_hal_semaphore_list_signal(submission->signal_list());
+        }
+        if (!iree_status_is_ok(status)) {
+          iree_hal_semaphore_list_fail(submission->signal_list(), status);
+        }
+        submission.reset();
+        lock.lock();
+        continue;
+      }
+      // Submissions that are ready but still armed get executed once their
+      // timepoint fires.
+      if (exit_requested &&
+          std::none_of(pending.begin(), pending.end(),
+                       [](const std::unique_ptr<iree_hal_xrt_lite_submission>&
+                              submission) { return is_ready(*submission); })) {
+        abort_pending(lock);
+        return;
+      }
+      // Waits until an unreached wait of each pending submission is signaled,
+      // rather than polling them. The timepoints are acquired outside of the
+      // lock, as they may fire right away and take it.
+      std::vector<iree_hal_xrt_lite_submission*> unarmed;
+      for (std::unique_ptr<iree_hal_xrt_lite_submission>& submission :
+           pending) {
+        if (submission->armed) continue;
+        submission->armed = true;
+        unarmed.push_back(submission.get());
+      }
+      if (!unarmed.empty()) {
+        lock.unlock();
+        for (iree_hal_xrt_lite_submission* submission : unarmed) {
+          arm(*submission);
+        }
+        lock.lock();
+        continue;
+      }
+      cv.wait(lock, [&]() { return generation != seen_generation; });
+    }
+  }
+
+  // Acquires a timepoint on the first unreached wait of `submission`.
+  void arm(iree_hal_xrt_lite_submission& submission) {
+    for (size_t i = 0; i < submission.wait_semaphores.size(); ++i) {
+      iree_hal_semaphore_t* semaphore = submission.wait_semaphores[i];
+      uint64_t value = 0;
+      iree_status_t status = iree_hal_semaphore_query(semaphore, &value);
+      if (!iree_status_is_ok(status)) {
+        iree_status_ignore(status);
+        break;
+      }
+      if (value >= submission.wait_values[i]) continue;
+      iree_hal_semaphore_acquire_timepoint(
+          semaphore, submission.wait_values[i], iree_infinite_timeout(),
+          iree_hal_semaphore_callback_t{wait_reached, &submission},
+          &submission.timepoint);
+      // Fires the timepoint if the wait was reached since the query.
+      iree_hal_semaphore_poll(semaphore);
+      return;
+    }
+    // All waits were reached, or one has failed, in the meantime.
+    wake(submission);
+  }
+
+  static iree_status_t wait_reached(void* user_data,
+                                    iree_hal_semaphore_t* semaphore,
+                                    uint64_t value,
+                                    iree_status_code_t status_code) {
+    auto* submission = static_cast<iree_hal_xrt_lite_submission*>(user_data);
+    submission->queue->wake(*submission);
+    return iree_ok_status();
+  }
+
+  void wake(iree_hal_xrt_lite_submission& submission) {
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      submission.armed = false;
+      ++generation;
+    }
+    cv.notify_one();
+  }
+
+  // Fails the signal semaphores of all pending submissions, as nothing is left
+  // that could signal their waits.
+  void abort_pending(std::unique_lock<std::mutex>& lock) {
+    std::deque<std::unique_ptr<iree_hal_xrt_lite_submission>> aborted;
+    aborted.swap(pending);
+    lock.unlock();
+    for (std::unique_ptr<iree_hal_xrt_lite_submission>& submission : aborted) {
+      if (submission->armed) {
+        iree_hal_semaphore_cancel_timepoint(submission->timepoint.semaphore,
+                                            &submission->timepoint);
+      }
+      iree_hal_semaphore_list_fail(
+          submission->signal_list(),
+          iree_make_status(IREE_STATUS_ABORTED,
+                           "device destroyed before the waits of a "
+                           "submission were reached"));
+    }
+  }
+
+  // Returns true if executing `submission` doesn't block, i.e. all of its
+  // waits are reached or one of its wait semaphores has failed.
+  static bool is_ready(iree_hal_xrt_lite_submission& submission) {
+    for (size_t i = 0; i < submission.wait_semaphores.size(); ++i) {
+      uint64_t value = 0;
+      iree_status_t status =
+          iree_hal_semaphore_query(submission.wait_semaphores[i], &value);
+      if (!iree_status_is_ok(status)) {
+        iree_status_ignore(status);
+        return true;
+      }
+      if (value < submission.wait_values[i]) return false;
+    }
+    return true;
+  }
+
+  iree_status_t execute(iree_hal_xrt_lite_submission& submission) {
+    IREE_TRACE_ZONE_BEGIN(z0);
+
+    IREE_RETURN_AND_END_ZONE_IF_ERROR(
+        z0, iree_hal_semaphore_list_wait(submission.wait_list(),
+                                         iree_infinite_timeout()));
+    if (!submission.command_buffer) {
+      IREE_TRACE_ZONE_END(z0);
+      return iree_ok_status();
+    }
+    iree_hal_buffer_binding_table_t binding_table = {
+        submission.bindings.size(), submission.bindings.data()};
+    if (iree_hal_xrt_lite_direct_command_buffer_isa(
+            submission.command_buffer)) {
+      // A reusable command buffer.
+      iree_status_t status = iree_hal_xrt_lite_direct_command_buffer_replay(
+          submission.command_buffer, binding_table);
+      IREE_TRACE_ZONE_END(z0);
+      return status;
+    }
+
+    iree_hal_command_buffer_t* xrt_command_buffer = nullptr;
+    iree_hal_command_buffer_mode_t mode =
+        IREE_HAL_COMMAND_BUFFER_MODE_ONE_SHOT |
+        IREE_HAL_COMMAND_BUFFER_MODE_ALLOW_INLINE_EXECUTION |
+        IREE_HAL_COMMAND_BUFFER_MODE_UNVALIDATED;
+    IREE_RETURN_AND_END_ZONE_IF_ERROR(
+        z0, iree_hal_xrt_lite_direct_command_buffer_create(
+                device, mode, IREE_HAL_COMMAND_CATEGORY_ANY,
+                /*binding_capacity=*/0, &device->block_pool, host_allocator,
+                &xrt_command_buffer));
+    iree_status_t status = iree_hal_deferred_command_buffer_apply(
+        submission.command_buffer, xrt_command_buffer, binding_table);
+    iree_hal_command_buffer_release(xrt_command_buffer);
+
+    IREE_TRACE_ZONE_END(z0);
+    return status;
+  }
+};
+
+iree_status_t iree_hal_xrt_lite_submission_queue_create(
+    iree_hal_xrt_lite_device* device, iree_allocator_t host_allocator,
+    iree_hal_xrt_lite_submission_queue** out_queue) {
+  IREE_ASSERT_ARGUMENT(device);
+  IREE_ASSERT_ARGUMENT(out_queue);
+  IREE_TRACE_ZONE_BEGIN(z0);
+
+  iree_hal_xrt_lite_submission_queue* queue = nullptr;
+  IREE_RETURN_AND_END_ZONE_IF_ERROR(
+      z0, iree_allocator_malloc(host_allocator, sizeof(*queue),
+                                reinterpret_cast<void**>(&queue)));
+  *out_queue =
+      new (queue) iree_hal_xrt_lite_submission_queue(device, host_allocator);
+
+  IREE_TRACE_ZONE_END(z0);
+  return iree_ok_status();
+}
+
+void iree_hal_xrt_lite_submission_queue_destroy(
+    iree_hal_xrt_lite_submission_queue* queue) {
+  IREE_TRACE_ZONE_BEGIN(z0);
+
+  iree_allocator_t host_allocator = queue->host_allocator;
+  queue->~iree_hal_xrt_lite_submission_queue();
+  iree_allocator_free(host_allocator, queue);
+
+  IREE_TRACE_ZONE_END(z0);
+}
+
+iree_status_t iree_hal_xrt_lite_submission_queue_enqueue(
+    iree_hal_xrt_lite_submission_queue* queue,
+    const iree_hal_semaphore_list_t wait_semaphore_list,
+    const iree_hal_semaphore_list_t signal_semaphore_list,
+    iree_hal_command_buffer_t* command_buffer,
+    iree_hal_buffer_binding_table_t binding_table) {
+  IREE_TRACE_ZONE_BEGIN(z0);
+
+  auto submission = std::make_unique<iree_hal_xrt_lite_submission>(
+      queue, wait_semaphore_list, signal_semaphore_list, command_buffer,
+      binding_table);
+  {
+    std::lock_guard<std::mutex> guard(queue->mutex);
+    queue->pending.push_back(std::move(submission));
+    ++queue->generation;
+  }
+  queue->cv.notify_one();
+
+  IREE_TRACE_ZONE_END(z0);
+  return iree_ok_status();
+}
+
+iree_status_t iree_hal_xrt_lite_submission_queue_enqueue_barrier(
+    iree_hal_xrt_lite_submission_queue* queue,
+    const iree_hal_semaphore_list_t wait_semaphore_list,
+    const iree_hal_semaphore_list_t signal_semaphore_list,
+    iree_hal_buffer_t* buffer) {
+  // The buffer is retained like a binding of the submission.
+  iree_hal_buffer_binding_t binding = {buffer, 0, IREE_HAL_WHOLE_BUFFER};
+  iree_hal_buffer_binding_table_t binding_table = {buffer ? 1u : 0u, &binding};
+  return iree_hal_xrt_lite_submission_queue_enqueue(
+      queue, wait_semaphore_list, signal_semaphore_list,
+      /*command_buffer=*/nullptr, binding_table);
+}
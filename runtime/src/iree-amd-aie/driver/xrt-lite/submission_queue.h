@@ -0,0 +1,48 @@
+// Copyright 2024 The IREE Authors
+//
+// Licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#ifndef IREE_AMD_AIE_DRIVER_XRT_LITE_SUBMISSION_QUEUE_H_
+#define IREE_AMD_AIE_DRIVER_XRT_LITE_SUBMISSION_QUEUE_H_
+
+#include "iree/base/api.h"
+#include "iree/hal/api.h"
+
+struct iree_hal_xrt_lite_device;
+struct iree_hal_xrt_lite_submission_queue;
+
+// Creates a queue that executes submissions of `device` on a dedicated host
+// thread, in FIFO order among the submissions whose waits are reached.
+iree_status_t iree_hal_xrt_lite_submission_queue_create(
+    iree_hal_xrt_lite_device* device, iree_allocator_t host_allocator,
+    iree_hal_xrt_lite_submission_queue** out_queue);
+
+// Executes all pending submissions that can still make progress and fails the
+// signal semaphores of the ones whose waits are never reached, then stops the
+// worker thread and frees the queue.
+void iree_hal_xrt_lite_submission_queue_destroy(
+    iree_hal_xrt_lite_submission_queue* queue);
+
+// Enqueues the execution of the deferred `command_buffer` (may be null for a
+// barrier) once all of `wait_semaphore_list` are reached and returns
+// immediately. `signal_semaphore_list` is signaled when the execution
+// completes, or failed with the execution status if it did not.
+iree_status_t iree_hal_xrt_lite_submission_queue_enqueue(
+    iree_hal_xrt_lite_submission_queue* queue,
+    const iree_hal_semaphore_list_t wait_semaphore_list,
+    const iree_hal_semaphore_list_t signal_semaphore_list,
+    iree_hal_command_buffer_t* command_buffer,
+    iree_hal_buffer_binding_table_t binding_table);
+
+// Enqueues a barrier that signals `signal_semaphore_list` once all of
+// `wait_semaphore_list` are reached and returns immediately. `buffer` (may be
+// null) is kept alive until then.
+iree_status_t iree_hal_xrt_lite_submission_queue_enqueue_barrier(
+    iree_hal_xrt_lite_submission_queue* queue,
+    const iree_hal_semaphore_list_t wait_semaphore_list,
+    const iree_hal_semaphore_list_t signal_semaphore_list,
+    iree_hal_buffer_t* buffer);
+
+#endif  // IREE_AMD_AIE_DRIVER_XRT_LITE_SUBMISSION_QUEUE_H_